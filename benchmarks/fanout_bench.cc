@@ -19,6 +19,7 @@
 
 #include "znet/client.h"
 #include "znet/client_events.h"
+#include "znet/client_pool.h"
 #include "znet/codec.h"
 #include "znet/init.h"
 #include "znet/packet.h"
@@ -84,6 +85,15 @@ class CountingHandler : public PacketHandler<CountingHandler, FanoutPacket> {
   std::atomic_uint32_t* received_;
 };
 
+// From here on the clients share a ClientPool and every session keeps the
+// library's queue bounds. A Client is a thread or two of its own, and the
+// bench bounds give each session a 2 MiB send ring; at a thousand clients
+// either runs a host out of threads or memory before the server is measured.
+// The wide cases send a few dozen messages a session, which the default
+// bounds hold.
+constexpr uint32_t kPooledClients = 1000;
+constexpr uint32_t kConnectWave = 250;
+
 struct FanoutResult {
   bool ok = false;
   uint32_t delivered = 0;
@@ -93,7 +103,8 @@ struct FanoutResult {
 
 FanoutResult RunFanout(const char* profile, ConnectionType type,
                        uint32_t client_count, uint32_t per_client,
-                       size_t payload_bytes, bool secure) {
+                       size_t payload_bytes, bool secure,
+                       IoBackend io_backend, bool connected_sockets) {
   const std::string payload = bench::MakePayload(payload_bytes);
   const char* transport = type == ConnectionType::TCP ? "TCP" : "ZDT";
   std::atomic_uint32_t received{0};
@@ -101,6 +112,7 @@ FanoutResult RunFanout(const char* profile, ConnectionType type,
 
   std::mutex sessions_mutex;
   std::vector<std::shared_ptr<PeerSession>> sessions;
+  const bool pooled = client_count >= kPooledClients;
 
   PortNumber port = bench::FreePort();
   ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(10), type};
@@ -108,7 +120,11 @@ FanoutResult RunFanout(const char* profile, ConnectionType type,
   server_config.child_options.common.compression =
       secure ? CompressionType::Default : CompressionType::None;
   // same bounds as znet_bench, so the two tables measure the same regime
-  bench::ApplyBenchQueueBounds(server_config.child_options);
+  if (!pooled) {
+    bench::ApplyBenchQueueBounds(server_config.child_options);
+  }
+  server_config.options.io_backend = io_backend;
+  server_config.child_options.zdt.connected_sockets = connected_sockets;
 
   Server server{server_config};
   server.SetEventCallback([&](Event& event) {
@@ -128,31 +144,57 @@ FanoutResult RunFanout(const char* profile, ConnectionType type,
     return {};
   }
 
-  std::vector<std::unique_ptr<Client>> clients;
-  clients.reserve(client_count);
-  for (uint32_t i = 0; i < client_count; i++) {
-    ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(10), type};
+  auto on_client_event = [&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          ev.session()->SetCodec(MakeCodec());
+          ev.session()->SetHandler(std::make_shared<CountingHandler>(&received));
+          clients_ready.fetch_add(1);
+          return false;
+        });
+  };
+  ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(10), type};
+  if (!pooled) {
     bench::ApplyBenchQueueBounds(client_config.options);
-    auto client = std::unique_ptr<Client>(new Client{client_config});
-    client->SetEventCallback([&](Event& event) {
-      EventDispatcher dispatcher{event};
-      dispatcher.Dispatch<ClientConnectedToServerEvent>(
-          [&](ClientConnectedToServerEvent& ev) {
-            ev.session()->SetCodec(MakeCodec());
-            ev.session()->SetHandler(std::make_shared<CountingHandler>(&received));
-            clients_ready.fetch_add(1);
-            return false;
-          });
-    });
-    client->Bind();
-    client->Connect();
-    clients.push_back(std::move(client));
+  }
+  std::vector<std::unique_ptr<Client>> clients;
+  std::unique_ptr<ClientPool> pool;
+  if (pooled) {
+    pool = std::make_unique<ClientPool>();
+    pool->SetEventCallback(on_client_event);
+    pool->Bind();
+    // in waves, each let through before the next starts: thousands of
+    // handshakes at once outlast the connect timeout on a small host
+    for (uint32_t i = 0; i < client_count; i++) {
+      pool->Connect(client_config);
+      if ((i + 1) % kConnectWave == 0) {
+        const auto wave_deadline =
+            bench::Clock::now() + std::chrono::seconds(10);
+        while (clients_ready.load() < i + 1 &&
+               bench::Clock::now() < wave_deadline) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+      }
+    }
+  } else {
+    clients.reserve(client_count);
+    for (uint32_t i = 0; i < client_count; i++) {
+      auto client = std::unique_ptr<Client>(new Client{client_config});
+      client->SetEventCallback(on_client_event);
+      client->Bind();
+      client->Connect();
+      clients.push_back(std::move(client));
+    }
   }
 
   auto teardown = [&]() {
     for (auto& client : clients) {
       client->Disconnect();
     }
+    if (pool) {
+      pool->Stop();
+    }
     server.Stop();
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
   };
@@ -281,10 +323,13 @@ void ReportFanout(const char* profile, ConnectionType type,
 }
 
 void RunCase(const char* profile, ConnectionType type, uint32_t clients,
-             uint32_t per_client, size_t payload, bool secure) {
+             uint32_t per_client, size_t payload, bool secure,
+             IoBackend io_backend = IoBackend::Readiness,
+             bool connected_sockets = false) {
   std::vector<FanoutResult> reps;
   for (int rep = 0; rep < bench::Reps(); rep++) {
-    FanoutResult r = RunFanout(profile, type, clients, per_client, payload, secure);
+    FanoutResult r = RunFanout(profile, type, clients, per_client, payload,
+                               secure, io_backend, connected_sockets);
     if (r.ok) {
       reps.push_back(r);
     }
@@ -324,6 +369,30 @@ int main() {
     RunCase("znet", ConnectionType::TCP, c.clients, c.per_client, c.payload, true);
   }
 
+  // the server's I/O backend at connection counts where a system call per
+  // socket operation adds up. Unencrypted, so the rows measure the I/O and
+  // not the cipher. 10k clients need a descriptor limit above 20k.
+  const Case wide_cases[] = {
+      {1000, 50, 1024},
+      {10000, 5, 1024},
+  };
+  for (const Case& c : wide_cases) {
+    RunCase("znet-raw", ConnectionType::TCP, c.clients, c.per_client,
+            c.payload, false);
+    RunCase("znet-uring", ConnectionType::TCP, c.clients, c.per_client,
+            c.payload, false, IoBackend::IoUring);
+  }
+  // ZDT's datagram path at the same width: every session behind the one
+  // shared socket, then each on a socket of its own connect()ed to its peer
+  // (ZDTOptions::connected_sockets). Only the narrower case, which keeps the
+  // run short.
+  const Case& zdt_wide = wide_cases[0];
+  RunCase("znet-raw", ConnectionType::ZDT, zdt_wide.clients,
+          zdt_wide.per_client, zdt_wide.payload, false);
+  RunCase("znet-conn", ConnectionType::ZDT, zdt_wide.clients,
+          zdt_wide.per_client, zdt_wide.payload, false, IoBackend::Readiness,
+          true);
+
   Cleanup();
   return 0;
 }
@@ -0,0 +1,350 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// File transfer: a server sending one large file to one client, through
+// PeerSession::SendFile() and through the loop an application would write
+// without it, reading the file into packets of StreamOptions::chunk_bytes.
+// Compares znet against itself, like fanout-bench.
+//
+
+#include "common/harness.h"
+#include "common/znet_tuning.h"
+
+#include "znet/client.h"
+#include "znet/client_events.h"
+#include "znet/codec.h"
+#include "znet/init.h"
+#include "znet/packet.h"
+#include "znet/packet_handler.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+#include "znet/version.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace znet;
+
+namespace {
+
+enum FilePacketType : PacketId { kPacketFileChunk = 1 };
+
+class FileChunkPacket : public Packet {
+ public:
+  FileChunkPacket() : Packet(kPacketFileChunk) {}
+  std::string data;
+};
+
+class FileChunkSerializer : public PacketSerializer<FileChunkPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(
+      std::shared_ptr<FileChunkPacket> packet,
+      std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteString(packet->data);
+    return buffer;
+  }
+  std::shared_ptr<FileChunkPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<FileChunkPacket>();
+    packet->data = buffer->ReadString();
+    return packet;
+  }
+};
+
+std::shared_ptr<Codec> MakeCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketFileChunk, std::make_unique<FileChunkSerializer>());
+  return codec;
+}
+
+class CountingHandler : public PacketHandler<CountingHandler, FileChunkPacket> {
+ public:
+  explicit CountingHandler(std::atomic_uint64_t* received)
+      : received_(received) {}
+  void OnPacket(std::shared_ptr<FileChunkPacket> packet) {
+    received_->fetch_add(packet->data.size(), std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic_uint64_t* received_;
+};
+
+enum class Mode { kSendFile, kPackets };
+
+const char* ModeName(Mode mode) {
+  return mode == Mode::kSendFile ? "sendfile" : "packets";
+}
+
+struct FileResult {
+  bool ok = false;
+  uint64_t delivered = 0;
+  double seconds = 0.0;
+  bool timed_out = false;
+};
+
+// The file is written once and reused by every case, so the page cache holds
+// it for all of them alike.
+bool WriteBenchFile(const std::string& path, uint64_t bytes) {
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  const std::string block = bench::MakePayload(1024 * 1024);
+  bool ok = true;
+  for (uint64_t left = bytes; left > 0 && ok;) {
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(left, block.size()));
+    ok = std::fwrite(block.data(), 1, n, file) == n;
+    left -= n;
+  }
+  return std::fclose(file) == 0 && ok;
+}
+
+// What SendFile() replaces: read a chunk, copy it into a packet, queue it,
+// and spin while the queue is full.
+bool SendAsPackets(PeerSession& session, const std::string& path,
+                   uint64_t bytes, size_t chunk_bytes,
+                   bench::Clock::time_point deadline) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  for (uint64_t left = bytes; left > 0;) {
+    auto packet = std::make_shared<FileChunkPacket>();
+    packet->data.resize(
+        static_cast<size_t>(std::min<uint64_t>(left, chunk_bytes)));
+    if (std::fread(&packet->data[0], 1, packet->data.size(), file) !=
+        packet->data.size()) {
+      break;
+    }
+    left -= packet->data.size();
+    while (session.SendPacket(packet) != Result::Success) {
+      if (bench::Clock::now() > deadline || !session.IsAlive()) {
+        std::fclose(file);
+        return false;
+      }
+      std::this_thread::yield();
+    }
+  }
+  std::fclose(file);
+  return true;
+}
+
+FileResult RunTransfer(const char* profile, ConnectionType type, Mode mode,
+                       const std::string& path, uint64_t bytes, bool secure) {
+  const char* transport = type == ConnectionType::TCP ? "TCP" : "ZDT";
+  std::atomic_uint64_t received{0};
+  std::atomic_bool client_ready{false};
+  std::mutex session_mutex;
+  std::shared_ptr<PeerSession> sender;
+
+  PortNumber port = bench::FreePort();
+  ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(10), type};
+  server_config.child_options.common.encryption = secure;
+  // the mapped paths are for uncompressed sessions; compressed, SendFile()
+  // chunks are encoded like any packet and the comparison measures nothing
+  server_config.child_options.common.compression = CompressionType::None;
+  bench::ApplyBenchQueueBounds(server_config.child_options);
+  const size_t chunk_bytes = server_config.child_options.stream.chunk_bytes;
+
+  Server server{server_config};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeCodec());
+          std::lock_guard<std::mutex> lock(session_mutex);
+          sender = ev.session();
+          return false;
+        });
+  });
+  if (server.Bind() != Result::Success ||
+      server.Listen() != Result::Success) {
+    std::printf("%-10s %-6s %-10s FAILED to bind/listen\n", profile, transport,
+                ModeName(mode));
+    return {};
+  }
+
+  ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(10), type};
+  client_config.options.common.encryption = secure;
+  client_config.options.common.compression = CompressionType::None;
+  bench::ApplyBenchQueueBounds(client_config.options);
+  Client client{client_config};
+  client.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          ev.session()->SetCodec(MakeCodec());
+          ev.session()->SetHandler(std::make_shared<CountingHandler>(&received));
+          ev.session()->SetStreamCallback([&](const StreamChunk& chunk) {
+            received.fetch_add(chunk.size, std::memory_order_relaxed);
+          });
+          client_ready.store(true);
+          return false;
+        });
+  });
+  client.Bind();
+  client.Connect();
+
+  auto teardown = [&]() {
+    client.Disconnect();
+    server.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  };
+
+  auto connect_deadline = bench::Clock::now() + std::chrono::seconds(30);
+  std::shared_ptr<PeerSession> session;
+  while (bench::Clock::now() < connect_deadline) {
+    {
+      std::lock_guard<std::mutex> lock(session_mutex);
+      session = sender;
+    }
+    if (session && session->IsReady() && client_ready.load()) {
+      break;
+    }
+    session = nullptr;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  if (!session) {
+    std::printf("%-10s %-6s %-10s session never connected\n", profile,
+                transport, ModeName(mode));
+    teardown();
+    return {};
+  }
+
+  auto deadline = bench::Clock::now() + std::chrono::seconds(120);
+  auto started = bench::Clock::now();
+  bool queued = false;
+  if (mode == Mode::kSendFile) {
+    queued = session->SendFile(path, 0, bytes) == Result::Success;
+  } else {
+    queued = SendAsPackets(*session, path, bytes, chunk_bytes, deadline);
+  }
+  while (queued && received.load() < bytes && bench::Clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+
+  FileResult out;
+  out.ok = queued;
+  out.delivered = received.load();
+  out.seconds =
+      std::chrono::duration<double>(bench::Clock::now() - started).count();
+  out.timed_out = out.delivered < bytes;
+  teardown();
+  return out;
+}
+
+double MiBPerSecond(const FileResult& r) {
+  return r.seconds > 0 ? static_cast<double>(r.delivered) / r.seconds /
+                             (1024.0 * 1024.0)
+                       : 0;
+}
+
+// Median rep by MiB/s; CSV gets every rep.
+void ReportTransfer(const char* profile, ConnectionType type, Mode mode,
+                    uint64_t bytes, const std::vector<FileResult>& reps) {
+  if (reps.empty()) {
+    return;
+  }
+  const char* transport = type == ConnectionType::TCP ? "TCP" : "ZDT";
+  char case_name[32];
+  std::snprintf(case_name, sizeof(case_name), "%s-%lluMiB", ModeName(mode),
+                static_cast<unsigned long long>(bytes >> 20));
+
+  for (size_t i = 0; i < reps.size(); i++) {
+    bench::CsvRow row;
+    row.kind = "file";
+    row.library = profile;
+    row.transport = transport;
+    row.case_name = case_name;
+    row.rep = static_cast<int>(i + 1);
+    row.delivered = static_cast<double>(reps[i].delivered);
+    row.seconds = reps[i].seconds;
+    row.mib_per_s = MiBPerSecond(reps[i]);
+    row.timed_out = reps[i].timed_out ? 1 : 0;
+    EmitCsv(row);
+  }
+
+  std::vector<FileResult> sorted = reps;
+  std::sort(sorted.begin(), sorted.end(),
+            [](const FileResult& a, const FileResult& b) {
+              return MiBPerSecond(a) < MiBPerSecond(b);
+            });
+  const FileResult& mid = sorted[sorted.size() / 2];
+  std::printf("%-10s %-6s %-10s %6llu MiB  %8.3f s  %8.1f MiB/s", profile,
+              transport, ModeName(mode),
+              static_cast<unsigned long long>(mid.delivered >> 20),
+              mid.seconds, MiBPerSecond(mid));
+  if (mid.timed_out) {
+    std::printf("  TIMEOUT (%llu/%llu bytes in 120 s)",
+                static_cast<unsigned long long>(mid.delivered),
+                static_cast<unsigned long long>(bytes));
+  }
+  if (reps.size() > 1) {
+    std::printf("  [%zu reps: %.1f..%.1f MiB/s]", reps.size(),
+                MiBPerSecond(sorted.front()), MiBPerSecond(sorted.back()));
+  }
+  std::printf("\n");
+  std::fflush(stdout);
+}
+
+void RunCase(const char* profile, ConnectionType type, Mode mode,
+             const std::string& path, uint64_t bytes, bool secure) {
+  std::vector<FileResult> reps;
+  for (int rep = 0; rep < bench::Reps(); rep++) {
+    FileResult r = RunTransfer(profile, type, mode, path, bytes, secure);
+    if (r.ok) {
+      reps.push_back(r);
+    }
+  }
+  ReportTransfer(profile, type, mode, bytes, reps);
+}
+
+}  // namespace
+
+int main() {
+  if (Init() != Result::Success) {
+    std::fprintf(stderr, "failed to initialize znet\n");
+    return 1;
+  }
+  std::printf("znet %s file transfer\n", ZNET_VERSION_STRING);
+  bench::AnnounceRunSettings();
+  std::fflush(stdout);
+
+  const uint64_t bytes = 256ull * 1024 * 1024;
+  const std::string path = "znet-file-bench.bin";
+  if (!WriteBenchFile(path, bytes)) {
+    std::fprintf(stderr, "failed to write %s\n", path.c_str());
+    return 1;
+  }
+
+  // "znet-raw" is the one sendfile() applies to on TCP; encrypted, both modes
+  // pay the cipher and SendFile() saves only the read and the packet copy
+  for (Mode mode : {Mode::kSendFile, Mode::kPackets}) {
+    RunCase("znet-raw", ConnectionType::TCP, mode, path, bytes, false);
+  }
+  for (Mode mode : {Mode::kSendFile, Mode::kPackets}) {
+    RunCase("znet", ConnectionType::TCP, mode, path, bytes, true);
+  }
+  for (Mode mode : {Mode::kSendFile, Mode::kPackets}) {
+    RunCase("znet-raw", ConnectionType::ZDT, mode, path, bytes, false);
+  }
+
+  std::remove(path.c_str());
+  Cleanup();
+  return 0;
+}
@@ -0,0 +1,331 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Idle cost: a server holding many connected sessions that have nothing to
+// say, and the CPU it burns keeping them. The server runs in a child process
+// so its getrusage() counts nothing of the clients in the parent. Then what
+// an empty server costs to start at several worker counts, again in a child
+// of its own so each row starts from the same footprint. Compares znet
+// against itself, like fanout-bench.
+//
+
+#include "common/harness.h"
+#include "common/znet_tuning.h"
+
+#include "znet/client.h"
+#include "znet/client_events.h"
+#include "znet/init.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+#include "znet/version.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace znet;
+
+namespace {
+
+// how long the server is left alone once every session is up, then measured
+constexpr auto kSettle = std::chrono::seconds(1);
+constexpr auto kWindow = std::chrono::seconds(5);
+
+// what the child hands back over its pipe
+struct IdleReport {
+  uint32_t sessions = 0;
+  double cpu_seconds = 0.0;
+  double wall_seconds = 0.0;
+};
+
+double CpuSeconds() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  auto seconds = [](const timeval& tv) {
+    return static_cast<double>(tv.tv_sec) +
+           static_cast<double>(tv.tv_usec) / 1e6;
+  };
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+bool ReadAll(int fd, void* data, size_t size) {
+  auto* out = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t got = read(fd, out, size);
+    if (got <= 0) {
+      return false;
+    }
+    out += got;
+    size -= static_cast<size_t>(got);
+  }
+  return true;
+}
+
+bool WriteAll(int fd, const void* data, size_t size) {
+  const auto* in = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t put = write(fd, in, size);
+    if (put <= 0) {
+      return false;
+    }
+    in += put;
+    size -= static_cast<size_t>(put);
+  }
+  return true;
+}
+
+// The child: serve, say which port, wait for the go byte, measure, report,
+// then wait for the stop byte.
+[[noreturn]] void ServeIdle(ConnectionType type, PortNumber port, int to_parent,
+                            int from_parent) {
+  std::atomic_uint32_t sessions{0};
+  ServerConfig config{"127.0.0.1", port, std::chrono::seconds(10), type};
+  config.child_options.common.encryption = false;
+  config.child_options.common.compression = CompressionType::None;
+  Server server{config};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent&) {
+          sessions.fetch_add(1);
+          return false;
+        });
+  });
+  bool listening = server.Bind() == Result::Success &&
+                   server.Listen() == Result::Success;
+  uint8_t ok = listening ? 1 : 0;
+  WriteAll(to_parent, &ok, sizeof(ok));
+  uint8_t go = 0;
+  if (listening && ReadAll(from_parent, &go, sizeof(go))) {
+    std::this_thread::sleep_for(kSettle);
+    IdleReport report;
+    const double cpu_before = CpuSeconds();
+    const auto started = bench::Clock::now();
+    std::this_thread::sleep_for(kWindow);
+    report.cpu_seconds = CpuSeconds() - cpu_before;
+    report.wall_seconds =
+        std::chrono::duration<double>(bench::Clock::now() - started).count();
+    report.sessions = sessions.load();
+    WriteAll(to_parent, &report, sizeof(report));
+    ReadAll(from_parent, &go, sizeof(go));
+  }
+  server.Stop();
+  server.Wait();
+  _exit(0);
+}
+
+void RunIdle(const char* profile, ConnectionType type, uint32_t client_count) {
+  const char* transport = type == ConnectionType::TCP ? "TCP" : "ZDT";
+  const PortNumber port = bench::FreePort();
+  int up[2];
+  int down[2];
+  if (pipe(up) != 0 || pipe(down) != 0) {
+    std::printf("%-10s %-6s idle       %6u  FAILED to create pipes\n", profile,
+                transport, client_count);
+    return;
+  }
+  std::fflush(stdout);
+  const pid_t child = fork();
+  if (child == 0) {
+    close(up[0]);
+    close(down[1]);
+    ServeIdle(type, port, up[1], down[0]);
+  }
+  close(up[1]);
+  close(down[0]);
+
+  uint8_t ok = 0;
+  if (child < 0 || !ReadAll(up[0], &ok, sizeof(ok)) || ok == 0) {
+    std::printf("%-10s %-6s idle       %6u  FAILED to bind/listen\n", profile,
+                transport, client_count);
+    close(up[0]);
+    close(down[1]);
+    if (child > 0) {
+      waitpid(child, nullptr, 0);
+    }
+    return;
+  }
+
+  std::atomic_uint32_t connected{0};
+  std::vector<std::unique_ptr<Client>> clients;
+  clients.reserve(client_count);
+  for (uint32_t i = 0; i < client_count; i++) {
+    ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(10), type};
+    client_config.options.common.encryption = false;
+    client_config.options.common.compression = CompressionType::None;
+    auto client = std::unique_ptr<Client>(new Client{client_config});
+    client->SetEventCallback([&](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<ClientConnectedToServerEvent>(
+          [&](ClientConnectedToServerEvent&) {
+            connected.fetch_add(1);
+            return false;
+          });
+    });
+    client->Bind();
+    client->Connect();
+    clients.push_back(std::move(client));
+  }
+  const auto connect_deadline = bench::Clock::now() + std::chrono::seconds(60);
+  while (connected.load() < client_count &&
+         bench::Clock::now() < connect_deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  uint8_t go = 1;
+  IdleReport report;
+  const bool measured = WriteAll(down[1], &go, sizeof(go)) &&
+                        ReadAll(up[0], &report, sizeof(report));
+  WriteAll(down[1], &go, sizeof(go));
+  close(up[0]);
+  close(down[1]);
+  waitpid(child, nullptr, 0);
+  for (auto& client : clients) {
+    client->Disconnect();
+  }
+  for (auto& client : clients) {
+    client->Wait();
+  }
+
+  if (!measured) {
+    std::printf("%-10s %-6s idle       %6u  server exited early\n", profile,
+                transport, client_count);
+    return;
+  }
+  const double share =
+      report.wall_seconds > 0 ? report.cpu_seconds / report.wall_seconds : 0;
+  std::printf("%-10s %-6s idle       %6u sessions  %7.2f%% CPU  %8.2f ms/s",
+              profile, transport, report.sessions, share * 100.0,
+              share * 1000.0);
+  if (report.sessions < client_count) {
+    std::printf("  (only %u/%u connected)", report.sessions, client_count);
+  }
+  std::printf("\n");
+  std::fflush(stdout);
+}
+
+// Resident set in KiB, or -1 where /proc is not there to ask.
+long ResidentKiB() {
+  std::ifstream statm("/proc/self/statm");
+  long size = 0;
+  long resident = 0;
+  if (!(statm >> size >> resident)) {
+    return -1;
+  }
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+struct StartupReport {
+  bool ok = false;
+  double start_ms = 0.0;
+  long rss_before_kib = -1;
+  long rss_after_kib = -1;
+};
+
+// Construct, bind and listen an empty server with `workers`, in a child.
+void RunStartup(const char* label, WorkerOptions workers) {
+  int up[2];
+  if (pipe(up) != 0) {
+    return;
+  }
+  std::fflush(stdout);
+  const pid_t child = fork();
+  if (child == 0) {
+    close(up[0]);
+    StartupReport report;
+    report.rss_before_kib = ResidentKiB();
+    ServerConfig config{"127.0.0.1", 0, std::chrono::seconds(10),
+                        ConnectionType::TCP};
+    config.options.workers = workers;
+    const auto started = bench::Clock::now();
+    {
+      Server server{config};
+      server.SetEventCallback([](Event&) {});
+      report.ok = server.Bind() == Result::Success &&
+                  server.Listen() == Result::Success;
+      report.start_ms = std::chrono::duration<double, std::milli>(
+                            bench::Clock::now() - started)
+                            .count();
+      // long enough for every worker to have run and parked
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      report.rss_after_kib = ResidentKiB();
+      WriteAll(up[1], &report, sizeof(report));
+      server.Stop();
+      server.Wait();
+    }
+    _exit(0);
+  }
+  close(up[1]);
+  StartupReport report;
+  const bool got = child > 0 && ReadAll(up[0], &report, sizeof(report));
+  close(up[0]);
+  if (child > 0) {
+    waitpid(child, nullptr, 0);
+  }
+  if (!got || !report.ok) {
+    std::printf("%-10s %-6s startup    %-10s FAILED to bind/listen\n",
+                "znet-raw", "TCP", label);
+    return;
+  }
+  std::printf("%-10s %-6s startup    %-10s %8.2f ms", "znet-raw", "TCP", label,
+              report.start_ms);
+  if (report.rss_before_kib >= 0 && report.rss_after_kib >= 0) {
+    std::printf("  %8ld KiB idle RSS  (+%ld KiB)", report.rss_after_kib,
+                report.rss_after_kib - report.rss_before_kib);
+  }
+  std::printf("\n");
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+int main() {
+  if (Init() != Result::Success) {
+    std::fprintf(stderr, "failed to initialize znet\n");
+    return 1;
+  }
+  std::printf("znet %s idle sessions\n", ZNET_VERSION_STRING);
+  std::fflush(stdout);
+
+  // unencrypted, so a row is the scheduling and the protocol's own upkeep
+  // (keepalives, idle checks), not the cipher. 10k clients need a descriptor
+  // limit above 20k, as in fanout-bench.
+  RunIdle("znet-raw", ConnectionType::TCP, 100);
+  RunIdle("znet-raw", ConnectionType::TCP, 1000);
+  RunIdle("znet-raw", ConnectionType::TCP, 10000);
+  // a ZDT client is a thread of its own, so only the narrower case
+  RunIdle("znet-raw", ConnectionType::ZDT, 1000);
+
+  // an empty server's cost to start, per WorkerOptions; an elastic pool
+  // starts no worker until a session arrives, whatever its count
+  for (uint32_t count : {1u, 4u, 16u, 64u}) {
+    WorkerOptions workers;
+    workers.count = count;
+    char label[32];
+    std::snprintf(label, sizeof(label), "%u-fixed", count);
+    RunStartup(label, workers);
+  }
+  WorkerOptions elastic;
+  elastic.count = 64;
+  elastic.elastic = true;
+  RunStartup("64-elastic", elastic);
+
+  Cleanup();
+  return 0;
+}
@@ -0,0 +1,366 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Priority: how long state updates take to cross while a bulk channel keeps
+// the send window full, with the updates at the bulk's priority and then
+// above it (PriorityKey). The updates go in bursts, a snapshot's worth at a
+// time, since a lone message on an idle channel is served next whatever its
+// priority; it is a backlog on both channels that priority decides. One
+// session, client to server, over ZDT; each update's one-way time is read on
+// the server against the same clock, since both ends are in the process.
+// Compares znet against itself, like fanout-bench.
+//
+
+#include "common/harness.h"
+#include "common/znet_tuning.h"
+
+#include "znet/client.h"
+#include "znet/client_events.h"
+#include "znet/codec.h"
+#include "znet/init.h"
+#include "znet/packet.h"
+#include "znet/packet_handler.h"
+#include "znet/send_options.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+#include "znet/version.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace znet;
+
+namespace {
+
+enum PriorityPacketType : PacketId { kPacketBulk = 1, kPacketProbe = 2 };
+
+class BulkPacket : public Packet {
+ public:
+  BulkPacket() : Packet(kPacketBulk) {}
+  std::string payload;
+};
+
+class ProbePacket : public Packet {
+ public:
+  ProbePacket() : Packet(kPacketProbe) {}
+  int64_t sent_ns = 0;
+  std::string payload;
+};
+
+class BulkSerializer : public PacketSerializer<BulkPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<BulkPacket> packet,
+                                         std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteString(packet->payload);
+    return buffer;
+  }
+  std::shared_ptr<BulkPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<BulkPacket>();
+    packet->payload = buffer->ReadString();
+    return packet;
+  }
+};
+
+class ProbeSerializer : public PacketSerializer<ProbePacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<ProbePacket> packet,
+                                         std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteInt<int64_t>(packet->sent_ns);
+    buffer->WriteString(packet->payload);
+    return buffer;
+  }
+  std::shared_ptr<ProbePacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<ProbePacket>();
+    packet->sent_ns = buffer->ReadInt<int64_t>();
+    packet->payload = buffer->ReadString();
+    return packet;
+  }
+};
+
+std::shared_ptr<Codec> MakeCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketBulk, std::make_unique<BulkSerializer>());
+  codec->Add(kPacketProbe, std::make_unique<ProbeSerializer>());
+  return codec;
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             bench::Clock::now().time_since_epoch())
+      .count();
+}
+
+// What the server sees: bulk counted, each probe's one-way time kept.
+struct Received {
+  std::atomic_uint64_t bulk{0};
+  std::mutex mutex;
+  std::vector<double> probe_us;
+};
+
+class ServerHandler
+    : public PacketHandler<ServerHandler, BulkPacket, ProbePacket> {
+ public:
+  explicit ServerHandler(Received* received) : received_(received) {}
+  void OnPacket(std::shared_ptr<BulkPacket>) {
+    received_->bulk.fetch_add(1, std::memory_order_relaxed);
+  }
+  void OnPacket(std::shared_ptr<ProbePacket> probe) {
+    const double us = static_cast<double>(NowNs() - probe->sent_ns) / 1000.0;
+    std::lock_guard<std::mutex> lock(received_->mutex);
+    received_->probe_us.push_back(us);
+  }
+
+ private:
+  Received* received_;
+};
+
+constexpr size_t kBulkBytes = 1024;
+// bulk messages queued ahead of the server at any time: well past what the
+// send window holds, well short of ZDTOptions::outbound_queue_capacity
+constexpr uint64_t kBulkBacklog = 2000;
+// a snapshot of kBurst messages, the bulk's size, every kBurstInterval
+constexpr uint32_t kBursts = 100;
+constexpr uint32_t kBurst = 32;
+constexpr uint32_t kProbes = kBursts * kBurst;
+constexpr auto kBurstInterval = std::chrono::milliseconds(20);
+
+// the bulk on a channel of its own at the default priority; the probe on
+// another, at `probe_priority`
+constexpr SendOptions kBulk = SendOptions().Channel(1);
+
+struct ProbeResult {
+  bool ok = false;
+  std::vector<double> probe_us;
+  uint32_t probes_lost = 0;
+  double bulk_mib_per_s = 0.0;
+};
+
+ProbeResult RunProbes(const char* profile, bool secure, uint8_t probe_priority) {
+  const std::string payload = bench::MakePayload(kBulkBytes);
+  Received received;
+  std::atomic_bool client_ready{false};
+  std::shared_ptr<PeerSession> client_session;
+
+  PortNumber port = bench::FreePort();
+  ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(10),
+                             ConnectionType::ZDT};
+  server_config.child_options.common.encryption = secure;
+  server_config.child_options.common.compression =
+      secure ? CompressionType::Default : CompressionType::None;
+
+  Server server{server_config};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeCodec());
+          ev.session()->SetHandler(std::make_shared<ServerHandler>(&received));
+          return false;
+        });
+  });
+  if (server.Bind() != Result::Success || server.Listen() != Result::Success) {
+    std::printf("%-10s %-6s priority   p%-3u  FAILED to bind/listen\n", profile,
+                "ZDT", probe_priority);
+    return {};
+  }
+
+  ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(10),
+                             ConnectionType::ZDT};
+  Client client{client_config};
+  client.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          ev.session()->SetCodec(MakeCodec());
+          client_session = ev.session();
+          client_ready = true;
+          return false;
+        });
+  });
+  client.Bind();
+  client.Connect();
+
+  auto teardown = [&]() {
+    client.Disconnect();
+    server.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  };
+
+  auto connect_deadline = bench::Clock::now() + std::chrono::seconds(10);
+  while (!client_ready.load() && bench::Clock::now() < connect_deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  if (!client_ready.load()) {
+    std::printf("%-10s %-6s priority   p%-3u  client never connected\n", profile,
+                "ZDT", probe_priority);
+    teardown();
+    return {};
+  }
+
+  // the bulk sender keeps kBulkBacklog messages ahead of what the server has
+  // received, which is a standing queue behind the send window for the whole
+  // run. Any deeper and the transport's own queue fills, and a full queue
+  // refuses the probe along with the bulk.
+  std::atomic_bool stop{false};
+  std::thread bulk_sender([&]() {
+    auto packet = std::make_shared<BulkPacket>();
+    packet->payload = payload;
+    uint64_t sent = 0;
+    while (!stop.load(std::memory_order_relaxed) && client_session->IsAlive()) {
+      if (sent - received.bulk.load(std::memory_order_relaxed) >= kBulkBacklog ||
+          client_session->SendPacket(packet, kBulk) != Result::Success) {
+        std::this_thread::yield();
+        continue;
+      }
+      sent++;
+    }
+  });
+  // long enough for the backlog to build before the first probe
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  const SendOptions probe_options =
+      SendOptions().Channel(2).Priority(probe_priority);
+  const uint64_t bulk_before = received.bulk.load();
+  const auto started = bench::Clock::now();
+  auto next = started;
+  for (uint32_t i = 0; i < kBursts; i++) {
+    std::this_thread::sleep_until(next);
+    next += kBurstInterval;
+    for (uint32_t j = 0; j < kBurst; j++) {
+      auto probe = std::make_shared<ProbePacket>();
+      probe->sent_ns = NowNs();
+      probe->payload = payload;
+      client_session->SendPacket(probe, probe_options);
+    }
+  }
+  const double seconds =
+      std::chrono::duration<double>(bench::Clock::now() - started).count();
+  const uint64_t bulk_during = received.bulk.load() - bulk_before;
+  stop = true;
+  bulk_sender.join();
+
+  // what is still in flight gets a moment to land before it counts as lost
+  auto drain_deadline = bench::Clock::now() + std::chrono::seconds(5);
+  while (bench::Clock::now() < drain_deadline) {
+    {
+      std::lock_guard<std::mutex> lock(received.mutex);
+      if (received.probe_us.size() >= kProbes) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  ProbeResult out;
+  out.ok = true;
+  {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    out.probe_us = received.probe_us;
+  }
+  out.probes_lost = kProbes - static_cast<uint32_t>(out.probe_us.size());
+  out.bulk_mib_per_s = static_cast<double>(bulk_during) *
+                       static_cast<double>(kBulkBytes) / (1024.0 * 1024.0) /
+                       seconds;
+  teardown();
+  return out;
+}
+
+// One row from every rep's probes pooled; CSV gets per-rep percentiles.
+void ReportProbes(const char* profile, uint8_t probe_priority,
+                  const std::vector<ProbeResult>& reps) {
+  if (reps.empty()) {
+    return;
+  }
+  char case_name[16];
+  std::snprintf(case_name, sizeof(case_name), "p%u", probe_priority);
+
+  std::vector<double> pooled;
+  uint32_t lost = 0;
+  double bulk = 0.0;
+  for (size_t i = 0; i < reps.size(); i++) {
+    bench::Percentiles p(reps[i].probe_us);
+    bench::CsvRow row;
+    row.kind = "priority";
+    row.library = profile;
+    row.transport = "ZDT";
+    row.case_name = case_name;
+    row.rep = static_cast<int>(i + 1);
+    row.rtt_count = static_cast<double>(p.count());
+    row.mean_us = p.Mean();
+    row.p50_us = p.At(0.50);
+    row.p95_us = p.At(0.95);
+    row.p99_us = p.At(0.99);
+    row.mib_per_s = reps[i].bulk_mib_per_s;
+    row.probes_lost = reps[i].probes_lost;
+    EmitCsv(row);
+    pooled.insert(pooled.end(), reps[i].probe_us.begin(),
+                  reps[i].probe_us.end());
+    lost += reps[i].probes_lost;
+    bulk += reps[i].bulk_mib_per_s;
+  }
+  bench::Percentiles p(std::move(pooled));
+  std::printf("%-10s %-6s priority   %-5s %6zu probes  p50 %8.1f us  p95 %8.1f"
+              "  p99 %8.1f  bulk %8.1f MiB/s",
+              profile, "ZDT", case_name, p.count(), p.At(0.50), p.At(0.95),
+              p.At(0.99), bulk / static_cast<double>(reps.size()));
+  if (lost != 0) {
+    std::printf("  (%u lost)", lost);
+  }
+  if (reps.size() > 1) {
+    std::printf("  (%zu reps pooled)", reps.size());
+  }
+  std::printf("\n");
+  std::fflush(stdout);
+}
+
+void RunCase(const char* profile, bool secure, uint8_t probe_priority) {
+  std::vector<ProbeResult> reps;
+  for (int rep = 0; rep < bench::Reps(); rep++) {
+    ProbeResult r = RunProbes(profile, secure, probe_priority);
+    if (r.ok) {
+      reps.push_back(std::move(r));
+    }
+  }
+  ReportProbes(profile, probe_priority, reps);
+}
+
+}  // namespace
+
+int main() {
+  if (Init() != Result::Success) {
+    std::fprintf(stderr, "failed to initialize znet\n");
+    return 1;
+  }
+  std::printf("znet %s priority under a saturating bulk channel\n",
+              ZNET_VERSION_STRING);
+  bench::AnnounceRunSettings();
+  std::fflush(stdout);
+
+  // p0 is the bulk's own priority, so the window is shared evenly; p255
+  // gives the updates' channel 256 times the bulk's share
+  for (uint8_t priority : {uint8_t{0}, uint8_t{255}}) {
+    RunCase("znet", true, priority);
+  }
+  for (uint8_t priority : {uint8_t{0}, uint8_t{255}}) {
+    RunCase("znet-raw", false, priority);
+  }
+
+  Cleanup();
+  return 0;
+}
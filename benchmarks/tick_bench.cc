@@ -0,0 +1,150 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Tick cost: what one pass over a server's session storage costs at 10k
+// sessions, dropping the dead and ticking the rest, in the slot map the
+// server keeps them in and in the address-keyed hash map it used before.
+// Sessions are stand-ins with a little state to touch, so the rows are the
+// container's walk and churn, not any transport's Process(). No sockets and
+// no threads; compares znet against itself, like fanout-bench.
+//
+
+#include "common/harness.h"
+
+#include "znet/detail/slot_map.h"
+#include "znet/inet_addr.h"
+#include "znet/version.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace znet;
+
+namespace {
+
+constexpr size_t kSessions = 10000;
+constexpr int kTicks = 2000;
+
+// about what a session's tick reads: a flag, a timer or two, some counters
+struct StubSession {
+  std::shared_ptr<InetAddress> address;
+  bool alive = true;
+  uint64_t state[6] = {};
+
+  bool IsAlive() const { return alive; }
+  void Process() {
+    state[0]++;
+    state[1] += state[0] >> 3;
+  }
+};
+
+std::shared_ptr<StubSession> MakeSession(uint32_t n) {
+  auto session = std::make_shared<StubSession>();
+  const std::string host = "10." + std::to_string((n >> 16) & 0xFF) + "." +
+                           std::to_string((n >> 8) & 0xFF) + "." +
+                           std::to_string(n & 0xFF);
+  session->address = InetAddress::from(host, static_cast<PortNumber>(n % 50000 + 1024));
+  return session;
+}
+
+// The old shape of Server::CleanupAndProcessSessions: gather the dead, erase
+// them by key, then tick what is left.
+struct HashStore {
+  std::unordered_map<std::shared_ptr<InetAddress>, std::shared_ptr<StubSession>> map;
+
+  void Add(std::shared_ptr<StubSession> session) {
+    map[session->address] = std::move(session);
+  }
+  void Tick() {
+    std::vector<std::shared_ptr<InetAddress>> remove;
+    for (auto&& item : map) {
+      if (!item.second->IsAlive()) {
+        remove.emplace_back(item.first);
+      }
+    }
+    for (auto&& address : remove) {
+      map.erase(address);
+    }
+    for (auto&& item : map) {
+      item.second->Process();
+    }
+  }
+  size_t size() const { return map.size(); }
+};
+
+// The current one: erase in place, then walk the packed values.
+struct SlotStore {
+  detail::SlotMap<std::shared_ptr<StubSession>> map;
+
+  void Add(std::shared_ptr<StubSession> session) {
+    map.Insert(std::move(session));
+  }
+  void Tick() {
+    map.EraseIf([](const std::shared_ptr<StubSession>& session) {
+      return !session->IsAlive();
+    });
+    for (auto& session : map) {
+      session->Process();
+    }
+  }
+  size_t size() const { return map.size(); }
+};
+
+// `churn` sessions die and as many connect between each pair of ticks.
+template <typename Store>
+void Run(const char* label, size_t churn) {
+  Store store;
+  std::vector<std::shared_ptr<StubSession>> live;
+  live.reserve(kSessions);
+  uint32_t next = 0;
+  for (size_t i = 0; i < kSessions; i++) {
+    live.push_back(MakeSession(next++));
+    store.Add(live.back());
+  }
+  std::mt19937 rng(12345);
+  bench::Clock::duration spent{};
+  for (int tick = 0; tick < kTicks; tick++) {
+    for (size_t i = 0; i < churn; i++) {
+      const size_t victim = rng() % live.size();
+      live[victim]->alive = false;
+      live[victim] = MakeSession(next++);
+      store.Add(live[victim]);
+    }
+    const auto started = bench::Clock::now();
+    store.Tick();
+    spent += bench::Clock::now() - started;
+  }
+  const double per_tick_us =
+      std::chrono::duration<double, std::micro>(spent).count() / kTicks;
+  std::printf("%-10s %-6s %-10s %6zu sessions  churn %3zu/tick  %9.2f us/tick"
+              "  %6.2f ns/session\n",
+              "znet-raw", "-", label, store.size(), churn, per_tick_us,
+              per_tick_us * 1000.0 / static_cast<double>(kSessions));
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("znet %s tick cost\n", ZNET_VERSION_STRING);
+  std::fflush(stdout);
+  // none dying, then 1% of them replaced every tick
+  for (size_t churn : {static_cast<size_t>(0), kSessions / 100}) {
+    Run<HashStore>("hash-map", churn);
+    Run<SlotStore>("slot-map", churn);
+  }
+  return 0;
+}
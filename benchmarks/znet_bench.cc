@@ -9,7 +9,8 @@
 //
 
 //
-// znet over TCP and over ZDT, on loopback, in one process.
+// znet over TCP, a Unix socket, shared memory and ZDT, on one host, in one
+// process.
 //
 // Read the numbers with the caveat in benchmarks/README.md: znet encrypts and
 // compresses every packet by default, which ENet and RakNet do not, so this is
@@ -29,6 +30,7 @@
 #include "znet/packet_handler.h"
 #include "znet/server.h"
 #include "znet/server_events.h"
+#include "znet/util.h"
 #include "znet/version.h"
 
 #include <atomic>
@@ -131,8 +133,28 @@ class CongestionHandler : public PacketHandler<CongestionHandler, BenchPacket> {
   std::atomic_uint32_t* bulk_;
 };
 
-const char* TransportName(ConnectionType type) {
-  return type == ConnectionType::ZDT ? "ZDT" : "TCP";
+// What a row runs over: a connection type, and whether the pair meets on a
+// Unix path rather than a loopback port. The path rows never see netem, which
+// only shapes lo.
+struct Transport {
+  const char* name;
+  ConnectionType type;
+  bool unix_path;
+};
+
+const Transport kTransports[] = {
+    {"TCP", ConnectionType::TCP, false},
+    {"UNIX", ConnectionType::TCP, true},
+    // as shipped this one is unencrypted in both profiles, per
+    // SharedMemoryOptions::encryption
+    {"SHM", ConnectionType::SharedMemory, true},
+    // no kernel at all: what is left is znet's own cost per message
+    {"LOOP", ConnectionType::InProcess, false},
+    {"ZDT", ConnectionType::ZDT, false},
+};
+
+std::string BenchSocketPath() {
+  return "unix:/tmp/znet-bench-" + std::to_string(GetProcessId()) + ".sock";
 }
 
 // Server-side profile. "raw" (no crypto, no compression) is the like-for-like
@@ -149,12 +171,6 @@ std::string LibraryName() {
   return std::string("znet") + g_profile.suffix;
 }
 
-// znet's TCP framing keeps a whole message in one buffer; ZDT fragments.
-bool TCPCanCarry(size_t payload_bytes) {
-  const size_t framing_slack = 64;  // packet id, length prefix, string prefix
-  return payload_bytes + framing_slack < ZNET_MAX_BUFFER_SIZE;
-}
-
 bench::Impairment g_impair;
 
 // What the server does with what it receives.
@@ -179,9 +195,13 @@ struct Harnessed {
 };
 
 // Brings up a loopback server/client pair and blocks until the session is live.
-bool Connect(Harnessed& h, ConnectionType type, PortNumber port,
+bool Connect(Harnessed& h, const Transport& t, PortNumber port,
              bench::Clock::duration* connect_time) {
-  ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(10), type};
+  const std::string host = t.unix_path ? BenchSocketPath() : "127.0.0.1";
+  if (t.unix_path) {
+    port = 0;
+  }
+  ServerConfig server_config{host, port, std::chrono::seconds(10), t.type};
   // Only the server configures these; the client adopts what it announces.
   server_config.child_options.common.encryption = g_profile.encryption;
   server_config.child_options.common.compression = g_profile.compression;
@@ -215,7 +235,7 @@ bool Connect(Harnessed& h, ConnectionType type, PortNumber port,
   }
 
   auto start = bench::Clock::now();
-  ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(10), type};
+  ClientConfig client_config{host, port, std::chrono::seconds(10), t.type};
   // the sending side, so its queue bounds matter most
   bench::ApplyBenchQueueBounds(client_config.options);
   h.client = std::make_unique<Client>(client_config);
@@ -259,11 +279,11 @@ void Teardown(Harnessed& h) {
 
 // FreePort() races other processes; retry with a fresh port rather than lose a
 // table row to a spurious failure.
-bool ConnectWithRetry(Harnessed& h, ConnectionType type,
+bool ConnectWithRetry(Harnessed& h, const Transport& t,
                       bench::Clock::duration* connect_time) {
   constexpr int kAttempts = 5;
   for (int attempt = 0; attempt < kAttempts; attempt++) {
-    if (Connect(h, type, bench::FreePort(), connect_time)) {
+    if (Connect(h, t, bench::FreePort(), connect_time)) {
       return true;
     }
     Teardown(h);
@@ -274,7 +294,7 @@ bool ConnectWithRetry(Harnessed& h, ConnectionType type,
 
 // ZNET_BENCH_METRICS=1: protocol counters after each rep, for correlating a
 // rate with the state that produced it. Off by default to keep tables diffable.
-void MaybePrintMetrics(const Harnessed& h, ConnectionType type,
+void MaybePrintMetrics(const Harnessed& h, const Transport& t,
                        const char* case_name) {
   if (std::getenv("ZNET_BENCH_METRICS") == nullptr || !h.client_session) {
     return;
@@ -283,7 +303,7 @@ void MaybePrintMetrics(const Harnessed& h, ConnectionType type,
   std::printf("%-10s %-6s metrics    %-6s  mtu %5u  cwnd %5u  dgram_tx %8llu  "
               "rtx %6llu  tlp %5llu  nak_rx %5llu  in_drop %5llu  "
               "reasm_drop %5llu  srtt %6u us  rtt_min %6u us  rto %7u us\n",
-              LibraryName().c_str(), TransportName(type), case_name,
+              LibraryName().c_str(), t.name, case_name,
               m.zdt.mtu, m.zdt.cwnd,
               static_cast<unsigned long long>(m.zdt.datagrams_sent),
               static_cast<unsigned long long>(m.zdt.retransmits),
@@ -294,12 +314,7 @@ void MaybePrintMetrics(const Harnessed& h, ConnectionType type,
               m.zdt.srtt_us, m.zdt.rtt_min_us, m.zdt.rto_us);
 }
 
-void RunThroughput(ConnectionType type, const bench::Workload& w) {
-  if (type == ConnectionType::TCP && !TCPCanCarry(w.payload_bytes)) {
-    std::printf("%-10s %-6s throughput %-6s  unsupported (exceeds ZNET_MAX_BUFFER_SIZE framing)\n",
-                LibraryName().c_str(), TransportName(type), w.name);
-    return;
-  }
+void RunThroughput(const Transport& t, const bench::Workload& w) {
   const std::string payload = bench::MakePayload(w.payload_bytes);
   std::vector<bench::LoopResult> reps;
   for (int rep = 0; rep < bench::Reps(); rep++) {
@@ -310,9 +325,9 @@ void RunThroughput(ConnectionType type, const bench::Workload& w) {
     h.role = ServerRole::Sink;
     h.server_received = &received;
     h.client_replies = &replies;
-    if (!ConnectWithRetry(h, type, &connect_time)) {
+    if (!ConnectWithRetry(h, t, &connect_time)) {
       std::printf("%-10s %-6s throughput %-6s  FAILED to connect\n",
-                  LibraryName().c_str(), TransportName(type), w.name);
+                  LibraryName().c_str(), t.name, w.name);
       Teardown(h);
       continue;
     }
@@ -343,13 +358,13 @@ void RunThroughput(ConnectionType type, const bench::Workload& w) {
           return progress;
         },
         bench::ThroughputWarmup(g_impair)));
-    MaybePrintMetrics(h, type, w.name);
+    MaybePrintMetrics(h, t, w.name);
     Teardown(h);
   }
-  bench::ReportThroughput(LibraryName().c_str(), TransportName(type), w, reps);
+  bench::ReportThroughput(LibraryName().c_str(), t.name, w, reps);
 }
 
-void RunLatency(ConnectionType type, const bench::Workload& w) {
+void RunLatency(const Transport& t, const bench::Workload& w) {
   const std::string payload = bench::MakePayload(w.payload_bytes);
   std::vector<std::vector<double>> rep_samples;
   for (int rep = 0; rep < bench::Reps(); rep++) {
@@ -360,14 +375,14 @@ void RunLatency(ConnectionType type, const bench::Workload& w) {
     h.role = ServerRole::Echo;
     h.server_received = &received;
     h.client_replies = &replies;
-    if (!ConnectWithRetry(h, type, &connect_time)) {
+    if (!ConnectWithRetry(h, t, &connect_time)) {
       std::printf("%-10s %-6s latency    %-6s  FAILED to connect\n",
-                  LibraryName().c_str(), TransportName(type), w.name);
+                  LibraryName().c_str(), t.name, w.name);
       Teardown(h);
       continue;
     }
     if (rep == 0) {
-      bench::ReportConnect(LibraryName().c_str(), TransportName(type),
+      bench::ReportConnect(LibraryName().c_str(), t.name,
                            connect_time);
     }
 
@@ -391,16 +406,11 @@ void RunLatency(ConnectionType type, const bench::Workload& w) {
         }));
     Teardown(h);
   }
-  bench::ReportLatency(LibraryName().c_str(), TransportName(type), w,
+  bench::ReportLatency(LibraryName().c_str(), t.name, w,
                        rep_samples);
 }
 
-void RunCongestion(ConnectionType type, const bench::CongestionCase& c) {
-  if (type == ConnectionType::TCP && !TCPCanCarry(c.bulk_bytes)) {
-    std::printf("%-10s %-6s congestion %-6s  unsupported (exceeds ZNET_MAX_BUFFER_SIZE framing)\n",
-                LibraryName().c_str(), TransportName(type), c.name);
-    return;
-  }
+void RunCongestion(const Transport& t, const bench::CongestionCase& c) {
   const std::string bulk_payload = bench::MakePayload(c.bulk_bytes);
   const std::string probe_payload = bench::MakePayload(c.probe_bytes);
   std::vector<bench::CongestionResult> reps;
@@ -413,9 +423,9 @@ void RunCongestion(ConnectionType type, const bench::CongestionCase& c) {
     h.probe_bytes = c.probe_bytes;
     h.server_received = &bulk;
     h.client_replies = &probes;
-    if (!ConnectWithRetry(h, type, &connect_time)) {
+    if (!ConnectWithRetry(h, t, &connect_time)) {
       std::printf("%-10s %-6s congestion %-6s  FAILED to connect\n",
-                  LibraryName().c_str(), TransportName(type), c.name);
+                  LibraryName().c_str(), t.name, c.name);
       Teardown(h);
       continue;
     }
@@ -445,7 +455,8 @@ void RunCongestion(ConnectionType type, const bench::CongestionCase& c) {
           auto packet = std::make_shared<BenchPacket>();
           packet->seq = seq;
           packet->payload = probe_payload;
-          return h.client_session->SendPacket(packet, kProbeOptions);
+          return h.client_session->SendPacket(packet, kProbeOptions) ==
+                 Result::Success;
         },
         [&]() {
           bench::PumpCounts counts;
@@ -457,12 +468,12 @@ void RunCongestion(ConnectionType type, const bench::CongestionCase& c) {
           probe_counted = now_probes;
           return counts;
         }));
-    MaybePrintMetrics(h, type, c.name);
+    MaybePrintMetrics(h, t, c.name);
     Teardown(h);
   }
-  bench::ReportCongestionCase(LibraryName().c_str(), TransportName(type), c,
+  bench::ReportCongestionCase(LibraryName().c_str(), t.name, c,
                               reps,
-                              type == ConnectionType::ZDT ? "channel" : "none");
+                              t.type == ConnectionType::ZDT ? "channel" : "none");
 }
 
 }  // namespace
@@ -494,32 +505,36 @@ int main() {
   };
   for (const Profile& profile : profiles) {
     g_profile = profile;
-    for (ConnectionType type : {ConnectionType::TCP, ConnectionType::ZDT}) {
+    for (const Transport& t : kTransports) {
       if (only_transport != nullptr) {
         std::string want(only_transport);
         for (char& c : want) {
           c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
         }
-        if (want != TransportName(type)) {
+        if (want != t.name) {
           continue;
         }
       }
-      bench::PrintHeader(LibraryName().c_str(), TransportName(type));
+      if ((t.unix_path || t.type == ConnectionType::InProcess) &&
+          g_impair.enabled()) {
+        continue;
+      }
+      bench::PrintHeader(LibraryName().c_str(), t.name);
       for (const auto& w : bench::ImpairedThroughputWorkloads(g_impair)) {
         if (only_case != nullptr && std::string(only_case) != w.name) {
           continue;
         }
-        RunThroughput(type, w);
+        RunThroughput(t, w);
       }
       if (!skip_latency) {
-        RunLatency(type, bench::ImpairedLatencyWorkload(g_impair));
+        RunLatency(t, bench::ImpairedLatencyWorkload(g_impair));
       }
       if (!skip_congestion) {
         for (const auto& c : bench::DefaultCongestionCases()) {
           if (only_case != nullptr && std::string(only_case) != c.name) {
             continue;
           }
-          RunCongestion(type, c);
+          RunCongestion(t, c);
         }
       }
     }
@@ -196,6 +196,7 @@ struct TestServer {
 struct TestClient {
   Client client;
   std::atomic<bool> connected{false};
+  std::atomic<bool> failed{false};
 
   explicit TestClient(const ClientConfig& config) : client(config) {
     client.SetEventCallback([this](Event& event) {
@@ -205,6 +206,11 @@ struct TestClient {
             connected = true;
             return false;
           });
+      dispatcher.Dispatch<ClientConnectionFailedEvent>(
+          [this](ClientConnectionFailedEvent&) {
+            failed = true;
+            return false;
+          });
     });
   }
 };
@@ -316,8 +322,11 @@ TEST(AdmissionEndToEnd, ZDTDenylistDropsTheHandshakeSilently) {
   TestClient client{ClientConfig{"127.0.0.1", port, std::chrono::seconds(2),
                                  ConnectionType::ZDT}};
   ASSERT_EQ(client.client.Bind(), Result::Success);
-  EXPECT_NE(client.client.Connect(), Result::Success)
+  // the handshake runs on the client's loop, so Connect() returns at once
+  ASSERT_EQ(client.client.Connect(), Result::Success);
+  EXPECT_TRUE(WaitFor(client.failed, 5000))
       << "every handshake datagram is dropped, so the connect must time out";
+  EXPECT_FALSE(client.connected.load());
   EXPECT_FALSE(server.saw_client.load());
 
   server.server.Stop();
@@ -0,0 +1,320 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// ClientPool: many sessions against one echo server on two worker threads.
+// Every session has to connect and get its echo back, every handler has to
+// run on one of the two workers, and Stop() has to end each session with its
+// disconnect event. Sessions with nothing to do have to cost a worker's
+// passes nothing, however many there are.
+//
+
+#include "znet/client_events.h"
+#include "znet/client_pool.h"
+#include "znet/init.h"
+#include "znet/packet.h"
+#include "znet/packet_handler.h"
+#include "znet/packet_serializer.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace znet;
+
+namespace {
+
+enum PoolPacketType : PacketId { kPacketEcho = 1 };
+
+class EchoPacket : public Packet {
+ public:
+  EchoPacket() : Packet(kPacketEcho) {}
+  uint32_t seq = 0;
+};
+
+class EchoSerializer : public PacketSerializer<EchoPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<EchoPacket> packet,
+                                         std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteInt<uint32_t>(packet->seq);
+    return buffer;
+  }
+  std::shared_ptr<EchoPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<EchoPacket>();
+    packet->seq = buffer->ReadInt<uint32_t>();
+    return packet;
+  }
+};
+
+std::shared_ptr<Codec> MakeEchoCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketEcho, std::make_unique<EchoSerializer>());
+  return codec;
+}
+
+class EchoBack : public PacketHandler<EchoBack, EchoPacket> {
+ public:
+  explicit EchoBack(std::shared_ptr<PeerSession> session)
+      : session_(std::move(session)) {}
+  void OnPacket(std::shared_ptr<EchoPacket> packet) {
+    session_->SendPacket(packet);
+  }
+
+ private:
+  std::shared_ptr<PeerSession> session_;
+};
+
+// What every pooled session's handler and events report into; touched from
+// both workers at once.
+struct Tally {
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::vector<std::shared_ptr<PeerSession>> sessions;
+  std::atomic<int> echoes{0};
+  std::atomic<int> disconnects{0};
+
+  void Saw() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  }
+};
+
+class CountEcho : public PacketHandler<CountEcho, EchoPacket> {
+ public:
+  explicit CountEcho(Tally* tally) : tally_(tally) {}
+  void OnPacket(std::shared_ptr<EchoPacket>) {
+    tally_->Saw();
+    tally_->echoes++;
+  }
+
+ private:
+  Tally* tally_;
+};
+
+bool WaitFor(const std::function<bool()>& done) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!done() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return done();
+}
+
+void RunPool(ConnectionType type) {
+  constexpr int kSessions = 40;
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig server_config{"127.0.0.1", 0, std::chrono::seconds(5), type};
+  // every session comes from one address, which the default handshake rate
+  // limit would rightly take for a flood
+  server_config.child_options.zdt.per_source_handshake_rate = 1000;
+  Server server{server_config};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeEchoCodec());
+          ev.session()->SetHandler(std::make_shared<EchoBack>(ev.session()));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  Tally tally;
+  ClientPoolOptions options;
+  options.workers = 2;
+  ClientPool pool{options};
+  pool.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          tally.Saw();
+          ev.session()->SetCodec(MakeEchoCodec());
+          ev.session()->SetHandler(std::make_shared<CountEcho>(&tally));
+          std::lock_guard<std::mutex> lock(tally.mutex);
+          tally.sessions.push_back(ev.session());
+          return false;
+        });
+    dispatcher.Dispatch<ClientDisconnectedFromServerEvent>(
+        [&](ClientDisconnectedFromServerEvent&) {
+          tally.Saw();
+          tally.disconnects++;
+          return false;
+        });
+  });
+  ASSERT_EQ(pool.Bind(), Result::Success);
+
+  const ClientConfig config{"127.0.0.1", server.bind_address()->port(),
+                            std::chrono::seconds(5), type};
+  for (int i = 0; i < kSessions; i++) {
+    ASSERT_EQ(pool.Connect(config), Result::Success) << "session " << i;
+  }
+  EXPECT_EQ(pool.size(), static_cast<size_t>(kSessions));
+  for (size_t count : pool.worker_sizes()) {
+    EXPECT_EQ(count, static_cast<size_t>(kSessions / 2))
+        << "placement should fill the emptier worker";
+  }
+  ASSERT_TRUE(WaitFor([&]() {
+    std::lock_guard<std::mutex> lock(tally.mutex);
+    return tally.sessions.size() == static_cast<size_t>(kSessions);
+  }));
+
+  std::vector<std::shared_ptr<PeerSession>> sessions;
+  {
+    std::lock_guard<std::mutex> lock(tally.mutex);
+    sessions = tally.sessions;
+  }
+  for (size_t i = 0; i < sessions.size(); i++) {
+    auto packet = std::make_shared<EchoPacket>();
+    packet->seq = static_cast<uint32_t>(i);
+    ASSERT_EQ(sessions[i]->SendPacket(packet), Result::Success);
+  }
+  EXPECT_TRUE(WaitFor([&]() { return tally.echoes == kSessions; }))
+      << tally.echoes << " of " << kSessions << " echoes came back";
+
+  EXPECT_EQ(pool.Stop(), Result::Success);
+  pool.Wait();
+  EXPECT_EQ(pool.Stop(), Result::AlreadyStopped);
+  EXPECT_EQ(pool.Connect(config), Result::AlreadyStopped);
+  EXPECT_EQ(tally.disconnects, kSessions);
+  EXPECT_EQ(pool.size(), 0u);
+  {
+    std::lock_guard<std::mutex> lock(tally.mutex);
+    EXPECT_LE(tally.threads.size(), 2u)
+        << "every event and handler runs on one of the two workers";
+    EXPECT_EQ(tally.threads.count(std::this_thread::get_id()), 0u);
+  }
+  server.Stop();
+  server.Wait();
+}
+
+}  // namespace
+
+TEST(ClientPool, TcpSessionsShareTwoWorkers) {
+  RunPool(ConnectionType::TCP);
+}
+
+TEST(ClientPool, ZdtSessionsShareTwoWorkers) {
+  RunPool(ConnectionType::ZDT);
+}
+
+TEST(ClientPool, AFailedConnectIsNotPooled) {
+  ASSERT_EQ(Init(), Result::Success);
+  ClientPool pool{ClientPoolOptions{1, 120}};
+  pool.SetEventCallback([](Event&) {});
+  ASSERT_EQ(pool.Bind(), Result::Success);
+  // nothing listens on the port a just-closed server had
+  PortNumber port = 0;
+  {
+    Server server{ServerConfig{"127.0.0.1", 0, std::chrono::seconds(5),
+                               ConnectionType::TCP}};
+    server.SetEventCallback([](Event&) {});
+    ASSERT_EQ(server.Bind(), Result::Success);
+    ASSERT_EQ(server.Listen(), Result::Success);
+    port = server.bind_address()->port();
+    server.Stop();
+    server.Wait();
+  }
+  const ClientConfig config{"127.0.0.1", port, std::chrono::seconds(1),
+                            ConnectionType::TCP};
+  EXPECT_NE(pool.Connect(config), Result::Success);
+  EXPECT_EQ(pool.size(), 0u);
+}
+
+TEST(ClientPool, IdleSessionsAreNotProcessedPerPacket) {
+  // one worker holds them all, so every echo wakes the worker they sit on
+  constexpr int kIdle = 2000;
+  constexpr int kRounds = 50;
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig server_config{"127.0.0.1", 0, std::chrono::seconds(5),
+                             ConnectionType::TCP};
+  // no keepalives either way, so an idle session is idle for the whole test
+  server_config.child_options.common.keepalive_interval =
+      std::chrono::milliseconds(0);
+  server_config.child_options.common.idle_timeout = std::chrono::milliseconds(0);
+  // and no key exchange, which would make connecting the test's slowest part
+  server_config.child_options.common.encryption = false;
+  Server server{server_config};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeEchoCodec());
+          ev.session()->SetHandler(std::make_shared<EchoBack>(ev.session()));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  Tally tally;
+  ClientPool pool{ClientPoolOptions{1, 120}};
+  pool.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          ev.session()->SetCodec(MakeEchoCodec());
+          ev.session()->SetHandler(std::make_shared<CountEcho>(&tally));
+          std::lock_guard<std::mutex> lock(tally.mutex);
+          tally.sessions.push_back(ev.session());
+          return false;
+        });
+  });
+  ASSERT_EQ(pool.Bind(), Result::Success);
+
+  ClientConfig config{"127.0.0.1", server.bind_address()->port(),
+                      std::chrono::seconds(5), ConnectionType::TCP};
+  config.options.common.keepalive_interval = std::chrono::milliseconds(0);
+  config.options.common.idle_timeout = std::chrono::milliseconds(0);
+  std::shared_ptr<PeerSession> active;
+  ASSERT_EQ(pool.Connect(config, &active), Result::Success);
+  // a batch at a time, so the server's handshakes never fall behind the
+  // connection timeout
+  for (int i = 0; i < kIdle; i++) {
+    ASSERT_EQ(pool.Connect(config), Result::Success) << "session " << i;
+    if ((i + 1) % 100 == 0 || i + 1 == kIdle) {
+      ASSERT_TRUE(WaitFor([&]() {
+        std::lock_guard<std::mutex> lock(tally.mutex);
+        return tally.sessions.size() == static_cast<size_t>(i + 2);
+      })) << "session " << i;
+    }
+  }
+  EXPECT_EQ(pool.size(), static_cast<size_t>(kIdle + 1));
+
+  const uint64_t before = pool.processed();
+  for (int i = 0; i < kRounds; i++) {
+    auto packet = std::make_shared<EchoPacket>();
+    packet->seq = static_cast<uint32_t>(i);
+    ASSERT_EQ(active->SendPacket(packet), Result::Success);
+    ASSERT_TRUE(WaitFor([&]() { return tally.echoes == i + 1; }))
+        << "echo " << i;
+  }
+  const uint64_t per_round = (pool.processed() - before) / kRounds;
+  // a round is the send's flush and the echo's read, give or take a pass
+  // for a connect still settling; a worker that looked at every session on
+  // every wake would make it at least kIdle
+  EXPECT_LT(per_round, 16u) << "Process() calls per echo with " << kIdle
+                            << " idle sessions on the worker";
+
+  EXPECT_EQ(pool.Stop(), Result::Success);
+  pool.Wait();
+  server.Stop();
+  server.Wait();
+}
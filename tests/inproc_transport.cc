@@ -0,0 +1,321 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// InProcessTransportLayer over a link made by hand and driven the way a
+// session worker would, and the whole stack through Server/Client with
+// ConnectionType::InProcess.
+//
+
+#include "znet/backends/inproc.h"
+
+#include "znet/client.h"
+#include "znet/client_events.h"
+#include "znet/init.h"
+#include "znet/inet_addr.h"
+#include "znet/packet.h"
+#include "znet/packet_handler.h"
+#include "znet/packet_serializer.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace znet;
+using namespace znet::backends;
+
+namespace {
+
+// Both ends of one link, each counting the wakeups the other sends it.
+struct TransportPair {
+  std::atomic<int> accepting_wakes{0};
+  std::atomic<int> connecting_wakes{0};
+  std::unique_ptr<InProcessTransportLayer> accepting;
+  std::unique_ptr<InProcessTransportLayer> connecting;
+
+  explicit TransportPair(InProcessOptions options = InProcessOptions()) {
+    auto link = std::make_shared<InProcessLink>(options.queue_capacity);
+    accepting = std::make_unique<InProcessTransportLayer>(
+        link, true, [this]() { accepting_wakes++; }, options);
+    connecting = std::make_unique<InProcessTransportLayer>(
+        link, false, [this]() { connecting_wakes++; }, options);
+  }
+};
+
+std::shared_ptr<Buffer> Numbered(uint32_t value) {
+  auto buffer = std::make_shared<Buffer>();
+  buffer->WriteInt<uint32_t>(value);
+  return buffer;
+}
+
+}  // namespace
+
+TEST(InProcessTransport, MessagesCrossInOrderBothWays) {
+  TransportPair pair;
+  for (uint32_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(pair.connecting->Send(Numbered(i)));
+    ASSERT_TRUE(pair.accepting->Send(Numbered(1000 + i)));
+  }
+  for (uint32_t i = 0; i < 100; i++) {
+    auto to_accepting = pair.accepting->Receive();
+    auto to_connecting = pair.connecting->Receive();
+    ASSERT_TRUE(to_accepting && to_connecting);
+    EXPECT_EQ(to_accepting->ReadInt<uint32_t>(), i);
+    EXPECT_EQ(to_connecting->ReadInt<uint32_t>(), 1000 + i);
+  }
+  EXPECT_EQ(pair.accepting->Receive(), nullptr);
+  EXPECT_EQ(pair.connecting->Receive(), nullptr);
+}
+
+TEST(InProcessTransport, OnlyADrainedQueueWakesItsReader) {
+  TransportPair pair;
+  for (uint32_t i = 0; i < 10; i++) {
+    pair.connecting->Send(Numbered(i));
+  }
+  EXPECT_EQ(pair.accepting_wakes.load(), 1)
+      << "a reader with messages waiting already has a reason to run";
+  while (pair.accepting->Receive()) {
+  }
+  pair.connecting->Send(Numbered(10));
+  EXPECT_EQ(pair.accepting_wakes.load(), 2);
+}
+
+TEST(InProcessTransport, AReaderThatStoppedEarlyIsWokenByTheNextSend) {
+  TransportPair pair;
+  for (uint32_t i = 0; i < 4; i++) {
+    pair.connecting->Send(Numbered(i));
+  }
+  ASSERT_TRUE(pair.accepting->Receive());
+  pair.accepting->Flush();  // the session's bound ran out with three queued
+  EXPECT_EQ(pair.accepting_wakes.load(), 1);
+  pair.connecting->Send(Numbered(4));
+  EXPECT_EQ(pair.accepting_wakes.load(), 2);
+}
+
+TEST(InProcessTransport, AFullQueueWakesItsWriterOnceDrained) {
+  InProcessOptions options;
+  options.queue_capacity = 2;
+  TransportPair pair(options);
+  for (uint32_t i = 0; i < 6; i++) {
+    ASSERT_TRUE(pair.connecting->Send(Numbered(i)));
+  }
+  SessionMetrics metrics;
+  pair.connecting->FillMetrics(metrics);
+#if ZNET_ENABLE_METRICS
+  EXPECT_GT(metrics.inproc.queue_full, 0u);
+  EXPECT_EQ(metrics.inproc.queued_bytes, 4 * sizeof(uint32_t));
+#endif
+  EXPECT_EQ(pair.connecting_wakes.load(), 0);
+  ASSERT_TRUE(pair.accepting->Receive());
+  EXPECT_EQ(pair.connecting_wakes.load(), 1);
+
+  uint32_t expected = 1;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (expected < 6 && std::chrono::steady_clock::now() < deadline) {
+    pair.connecting->Flush();
+    while (auto message = pair.accepting->Receive()) {
+      EXPECT_EQ(message->ReadInt<uint32_t>(), expected++);
+    }
+  }
+  EXPECT_EQ(expected, 6u);
+}
+
+TEST(InProcessTransport, ACloseDeliversWhatWasSentFirst) {
+  TransportPair pair;
+  pair.connecting->Send(Numbered(1));
+  pair.connecting->Send(Numbered(2));
+  const int wakes = pair.accepting_wakes.load();
+  pair.connecting->Close();
+  EXPECT_GT(pair.accepting_wakes.load(), wakes)
+      << "a reader asleep on an empty queue must hear about the close";
+  EXPECT_TRUE(pair.accepting->Receive());
+  EXPECT_TRUE(pair.accepting->Receive());
+  EXPECT_FALSE(pair.accepting->IsClosed());
+  EXPECT_EQ(pair.accepting->Receive(), nullptr);
+  EXPECT_TRUE(pair.accepting->IsClosed());
+}
+
+TEST(InProcessTransport, ADestroyedPeerEndsTheSession) {
+  TransportPair pair;
+  pair.connecting.reset();
+  EXPECT_EQ(pair.accepting->Receive(), nullptr);
+  EXPECT_TRUE(pair.accepting->IsClosed());
+}
+
+// --- Through Server and Client ----------------------------------------------
+
+namespace {
+
+enum InProcessPacketType : PacketId { kPacketCount = 1 };
+
+class CountPacket : public Packet {
+ public:
+  CountPacket() : Packet(kPacketCount) {}
+  uint32_t seq = 0;
+};
+
+class CountSerializer : public PacketSerializer<CountPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<CountPacket> packet,
+                                         std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteInt<uint32_t>(packet->seq);
+    return buffer;
+  }
+  std::shared_ptr<CountPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<CountPacket>();
+    packet->seq = buffer->ReadInt<uint32_t>();
+    return packet;
+  }
+};
+
+std::shared_ptr<Codec> MakeCountCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketCount, std::make_unique<CountSerializer>());
+  return codec;
+}
+
+class EchoCount : public PacketHandler<EchoCount, CountPacket> {
+ public:
+  explicit EchoCount(std::shared_ptr<PeerSession> session)
+      : session_(std::move(session)) {}
+  void OnPacket(std::shared_ptr<CountPacket> packet) {
+    session_->SendPacket(packet);
+  }
+
+ private:
+  std::shared_ptr<PeerSession> session_;
+};
+
+class InOrder : public PacketHandler<InOrder, CountPacket> {
+ public:
+  void OnPacket(std::shared_ptr<CountPacket> packet) {
+    if (packet->seq != next.load()) {
+      out_of_order++;
+    }
+    next = packet->seq + 1;
+  }
+  std::atomic<uint32_t> next{0};
+  std::atomic<int> out_of_order{0};
+};
+
+}  // namespace
+
+TEST(InProcessSession, ConnectingToNothingIsRefused) {
+  ASSERT_EQ(Init(), Result::Success);
+  ClientConfig config{"127.0.0.1", 1, std::chrono::seconds(2),
+                      ConnectionType::InProcess};
+  Client client{config};
+  ASSERT_EQ(client.Bind(), Result::Success);
+  EXPECT_EQ(client.Connect(), Result::ConnectionRefused);
+}
+
+TEST(InProcessSession, AnAddressHoldsOneServer) {
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig config{"127.0.0.1", 0, std::chrono::seconds(2),
+                      ConnectionType::InProcess};
+  Server first{config};
+  ASSERT_EQ(first.Bind(), Result::Success);
+  EXPECT_NE(first.bind_address()->port(), 0)
+      << "port zero takes a made-up one, as a kernel would assign";
+
+  ServerConfig same{"127.0.0.1", first.bind_address()->port(),
+                    std::chrono::seconds(2), ConnectionType::InProcess};
+  Server second{same};
+  EXPECT_EQ(second.Bind(), Result::CannotBind);
+}
+
+TEST(InProcessSession, EchoesThroughServerAndClientEncrypted) {
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig server_config{"unix:/znet-test/inproc-echo", 0,
+                             std::chrono::seconds(5),
+                             ConnectionType::InProcess};
+  Server server{server_config};
+  server.SetEventCallback([](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeCountCodec());
+          ev.session()->SetHandler(std::make_shared<EchoCount>(ev.session()));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  ClientConfig client_config{"unix:/znet-test/inproc-echo", 0,
+                             std::chrono::seconds(5),
+                             ConnectionType::InProcess};
+  Client client{client_config};
+  auto in_order = std::make_shared<InOrder>();
+  std::atomic<bool> connected{false};
+  std::shared_ptr<PeerSession> session;
+  std::mutex session_mutex;
+  client.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          ev.session()->SetCodec(MakeCountCodec());
+          ev.session()->SetHandler(in_order);
+          {
+            std::lock_guard<std::mutex> lock(session_mutex);
+            session = ev.session();
+          }
+          connected = true;
+          return false;
+        });
+  });
+  ASSERT_EQ(client.Bind(), Result::Success);
+  ASSERT_EQ(client.Connect(), Result::Success);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!connected.load() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  ASSERT_TRUE(connected.load());
+  std::shared_ptr<PeerSession> sender;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    sender = session;
+  }
+  EXPECT_EQ(sender->connection_type(), ConnectionType::InProcess);
+  unsigned char key[32];
+  EXPECT_EQ(sender->ExportKeyingMaterial("znet-test", key, sizeof(key)),
+            Result::Success)
+      << "in-process sessions run the key exchange like any other, so its "
+         "cost shows up in what they measure";
+
+  constexpr uint32_t kCount = 2000;
+  for (uint32_t i = 0; i < kCount; i++) {
+    auto packet = std::make_shared<CountPacket>();
+    packet->seq = i;
+    while (sender->SendPacket(packet) == Result::QueueFull) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (in_order->next.load() < kCount &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  EXPECT_EQ(in_order->next.load(), kCount);
+  EXPECT_EQ(in_order->out_of_order.load(), 0);
+
+  client.Disconnect();
+  server.Stop();
+  client.Wait();
+  server.Wait();
+}
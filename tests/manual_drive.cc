@@ -0,0 +1,276 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// DriveMode::Manual: a TCP server and client run by the test's own thread
+// through PollOnce() and Process(), with nothing of theirs spawned. Handlers
+// have to run on that thread, the poll descriptor has to turn readable when
+// there is work, and Stop() has to be seen by the next call.
+//
+
+#include "znet/client.h"
+#include "znet/client_events.h"
+#include "znet/init.h"
+#include "znet/packet.h"
+#include "znet/packet_handler.h"
+#include "znet/packet_serializer.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+using namespace znet;
+
+namespace {
+
+enum ManualPacketType : PacketId { kPacketEcho = 1 };
+
+class EchoPacket : public Packet {
+ public:
+  EchoPacket() : Packet(kPacketEcho) {}
+  uint32_t seq = 0;
+};
+
+class EchoSerializer : public PacketSerializer<EchoPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<EchoPacket> packet,
+                                         std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteInt<uint32_t>(packet->seq);
+    return buffer;
+  }
+  std::shared_ptr<EchoPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<EchoPacket>();
+    packet->seq = buffer->ReadInt<uint32_t>();
+    return packet;
+  }
+};
+
+std::shared_ptr<Codec> MakeEchoCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketEcho, std::make_unique<EchoSerializer>());
+  return codec;
+}
+
+// Sends every packet back, noting the thread it ran on.
+class EchoBack : public PacketHandler<EchoBack, EchoPacket> {
+ public:
+  EchoBack(std::shared_ptr<PeerSession> session, std::thread::id* ran_on)
+      : session_(std::move(session)), ran_on_(ran_on) {}
+  void OnPacket(std::shared_ptr<EchoPacket> packet) {
+    *ran_on_ = std::this_thread::get_id();
+    session_->SendPacket(packet);
+  }
+
+ private:
+  std::shared_ptr<PeerSession> session_;
+  std::thread::id* ran_on_;
+};
+
+class CountEchoes : public PacketHandler<CountEchoes, EchoPacket> {
+ public:
+  explicit CountEchoes(std::thread::id* ran_on) : ran_on_(ran_on) {}
+  void OnPacket(std::shared_ptr<EchoPacket> packet) {
+    *ran_on_ = std::this_thread::get_id();
+    last = packet->seq;
+    got++;
+  }
+  uint32_t last = 0;
+  int got = 0;
+
+ private:
+  std::thread::id* ran_on_;
+};
+
+// Drives both until `done` or five seconds pass.
+bool DriveUntil(Server& server, Client& client,
+                const std::function<bool()>& done) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!done() && std::chrono::steady_clock::now() < deadline) {
+    server.PollOnce(std::chrono::milliseconds(1));
+    client.PollOnce(std::chrono::milliseconds(1));
+  }
+  return done();
+}
+
+ServerConfig ManualServerConfig() {
+  ServerConfig config{"127.0.0.1", 0, std::chrono::seconds(5),
+                      ConnectionType::TCP};
+  config.drive = DriveMode::Manual;
+  return config;
+}
+
+}  // namespace
+
+TEST(ManualDrive, ServerAndClientRunOnTheCallersThread) {
+  ASSERT_EQ(Init(), Result::Success);
+  std::thread::id server_ran_on;
+  std::thread::id client_ran_on;
+  bool started = false;
+  Server server{ManualServerConfig()};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ServerStartupEvent>([&](ServerStartupEvent&) {
+      started = true;
+      return false;
+    });
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeEchoCodec());
+          ev.session()->SetHandler(
+              std::make_shared<EchoBack>(ev.session(), &server_ran_on));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+  EXPECT_TRUE(started) << "the startup event fires inside Listen()";
+#if defined(__linux__)
+  EXPECT_GE(server.poll_fd(), 0);
+#endif
+
+  ClientConfig client_config{"127.0.0.1", server.bind_address()->port(),
+                             std::chrono::seconds(5), ConnectionType::TCP};
+  client_config.drive = DriveMode::Manual;
+  Client client{client_config};
+  auto echoes = std::make_shared<CountEchoes>(&client_ran_on);
+  std::shared_ptr<PeerSession> session;
+  client.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          ev.session()->SetCodec(MakeEchoCodec());
+          ev.session()->SetHandler(echoes);
+          session = ev.session();
+          return false;
+        });
+  });
+  ASSERT_EQ(client.Bind(), Result::Success);
+  ASSERT_EQ(client.Connect(), Result::Success);
+#if defined(__linux__)
+  EXPECT_GE(client.poll_fd(), 0);
+#endif
+
+  ASSERT_TRUE(DriveUntil(server, client, [&]() { return session != nullptr; }));
+  for (uint32_t i = 1; i <= 20; i++) {
+    auto packet = std::make_shared<EchoPacket>();
+    packet->seq = i;
+    ASSERT_EQ(session->SendPacket(packet), Result::Success);
+    ASSERT_TRUE(DriveUntil(server, client, [&]() { return echoes->last == i; }))
+        << "echo " << i << " never came back";
+  }
+  EXPECT_EQ(echoes->got, 20);
+  EXPECT_EQ(server_ran_on, std::this_thread::get_id());
+  EXPECT_EQ(client_ran_on, std::this_thread::get_id());
+
+  const ServerMetrics metrics = server.metrics();
+  ASSERT_EQ(metrics.workers.size(), 1u);
+  EXPECT_TRUE(metrics.workers[0].running);
+  EXPECT_EQ(metrics.workers[0].sessions, 1u);
+
+  session->ReleaseHandler();
+  session = nullptr;
+}
+
+#if defined(__linux__)
+// What an application with its own epoll loop relies on: the descriptor is
+// quiet while nothing is due, and readable once a peer sends something.
+TEST(ManualDrive, PollFdTurnsReadableWhenThereIsWork) {
+  ASSERT_EQ(Init(), Result::Success);
+  std::thread::id ran_on;
+  int got = 0;
+  Server server{ManualServerConfig()};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeEchoCodec());
+          ev.session()->SetHandler(
+              std::make_shared<EchoBack>(ev.session(), &ran_on));
+          got++;
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+  pollfd entry{};
+  entry.fd = server.poll_fd();
+  entry.events = POLLIN;
+  ASSERT_EQ(poll(&entry, 1, 0), 0) << "nothing has connected yet";
+
+  // a client on its own threads, so only the server waits on the descriptor
+  ClientConfig client_config{"127.0.0.1", server.bind_address()->port(),
+                             std::chrono::seconds(5), ConnectionType::TCP};
+  Client client{client_config};
+  client.SetEventCallback([](Event&) {});
+  ASSERT_EQ(client.Bind(), Result::Success);
+  ASSERT_EQ(client.Connect(), Result::Success);
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  bool readable = false;
+  while (got == 0 && std::chrono::steady_clock::now() < deadline) {
+    entry.revents = 0;
+    if (poll(&entry, 1, 20) > 0 && (entry.revents & POLLIN) != 0) {
+      readable = true;
+    }
+    server.Process();
+  }
+  EXPECT_TRUE(readable);
+  EXPECT_EQ(got, 1);
+  client.Disconnect();
+  client.Wait();
+}
+#endif
+
+TEST(ManualDrive, StopIsSeenByTheNextProcess) {
+  ASSERT_EQ(Init(), Result::Success);
+  int shutdowns = 0;
+  Server server{ManualServerConfig()};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ServerShutdownEvent>([&](ServerShutdownEvent&) {
+      shutdowns++;
+      return false;
+    });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+  EXPECT_TRUE(server.Process());
+  EXPECT_EQ(server.Stop(), Result::Success);
+  EXPECT_FALSE(server.shutdown_complete());
+  EXPECT_FALSE(server.Process());
+  EXPECT_TRUE(server.shutdown_complete());
+  EXPECT_EQ(shutdowns, 1);
+  EXPECT_FALSE(server.PollOnce(std::chrono::milliseconds(1)));
+  EXPECT_EQ(shutdowns, 1);
+}
+
+TEST(ManualDrive, ABackendThatNeedsItsThreadsIsRefused) {
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig config{"127.0.0.1", 0, std::chrono::seconds(5),
+                      ConnectionType::ZDT};
+  config.drive = DriveMode::Manual;
+  Server server{config};
+  server.SetEventCallback([](Event&) {});
+  ASSERT_EQ(server.Bind(), Result::Success);
+  EXPECT_EQ(server.Listen(), Result::InvalidBackend);
+  EXPECT_FALSE(server.Process());
+}
@@ -0,0 +1,132 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Scheduler's waits on the real clock: that ticks keep to their grid rather
+// than drifting by each wake's lateness, what the measured stats count, and
+// the listener's copy of them in ServerMetrics. A loaded host is allowed to be
+// late, and a parallel test run is one, so nothing here bounds how late: the
+// checks compare against lateness the test caused itself, or against another
+// mode in the same run. Only early is wrong.
+//
+
+#include "znet/scheduler.h"
+
+#include "znet/init.h"
+#include "znet/server.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono;
+
+TEST(Scheduler, SleepUntilNeverReturnsEarly) {
+  for (int spin : {0, 200}) {
+    for (int i = 0; i < 20; i++) {
+      const auto deadline = Scheduler::Clock::now() + microseconds(1500);
+      Scheduler::SleepUntil(deadline, Scheduler::Duration(spin));
+      EXPECT_GE(Scheduler::Clock::now(), deadline) << "spin " << spin;
+    }
+  }
+}
+
+// Every tick starts 10 ms late, a fifth of its period, as if each wake were.
+// A loop that restarted its tick from the wake would end a fifth behind; on
+// the grid the lateness is made up inside the next tick.
+TEST(Scheduler, TicksKeepToTheirGridInsteadOfDrifting) {
+  Scheduler scheduler(20);
+  constexpr int kTicks = 20;
+  constexpr auto kTick = milliseconds(50);
+  constexpr auto kLate = milliseconds(10);
+  const auto started = Scheduler::Clock::now();
+  for (int i = 0; i < kTicks; i++) {
+    std::this_thread::sleep_for(kLate);
+    scheduler.Start();
+    scheduler.End();
+    scheduler.Wait();
+  }
+  const auto behind = Scheduler::Clock::now() - started - kTicks * kTick;
+  EXPECT_GE(behind, Scheduler::Duration::zero());
+  // drifting would put this at kTicks * kLate. Half of that leaves a loaded
+  // host a whole tick's worth of its own lateness on top of the one lag a grid
+  // keeps; anything later than a period past a deadline starts a new grid.
+  EXPECT_LT(behind, kTicks * kLate / 2)
+      << "each tick's lateness was carried into the next";
+}
+
+TEST(Scheduler, MeasuredWaitsCountTicksJitterAndOverruns) {
+  Scheduler scheduler(200);
+  scheduler.SetMeasureWaits(true);
+  for (int i = 0; i < 10; i++) {
+    scheduler.Start();
+    if (i == 5) {
+      std::this_thread::sleep_for(milliseconds(8));  // longer than the tick
+    }
+    scheduler.End();
+    scheduler.Wait();
+  }
+  const Scheduler::WaitStats& stats = scheduler.wait_stats();
+  EXPECT_EQ(stats.ticks, 10u);
+  // the long tick overran at least; a descheduled one may have as well
+  EXPECT_GE(stats.overruns, 1u);
+  EXPECT_LT(stats.overruns, stats.ticks);
+  EXPECT_GT(stats.waited, Scheduler::Duration::zero());
+  EXPECT_GE(stats.jitter_total, stats.jitter_max);
+  EXPECT_GE(stats.jitter_max, Scheduler::Duration::zero());
+  // CPU time inside an interval cannot exceed its wall time; the margin is for
+  // the two clocks' granularity
+  EXPECT_LE(stats.wait_cpu, stats.waited + milliseconds(1));
+}
+
+// The CPU a wait costs with half of each tick spun, against the same loop
+// sleeping the whole way.
+static Scheduler::Duration WaitCpu(Scheduler::Duration spin) {
+  Scheduler scheduler(100);
+  scheduler.SetMeasureWaits(true);
+  scheduler.SetSpinBudget(spin);
+  for (int i = 0; i < 10; i++) {
+    scheduler.Start();
+    scheduler.End();
+    scheduler.Wait();
+  }
+  return scheduler.wait_stats().wait_cpu;
+}
+
+TEST(Scheduler, ASpinBudgetIsPaidInCpu) {
+  const Scheduler::Duration sleeping = WaitCpu(Scheduler::Duration::zero());
+  const Scheduler::Duration spinning = WaitCpu(milliseconds(5));
+  // spun out in full that is 50 ms against tens of microseconds. A loaded host
+  // takes the CPU away mid-spin, so only the order is checked, and by a margin
+  // a sleeping wait cannot reach.
+  EXPECT_GT(spinning, sleeping * 2 + milliseconds(2))
+      << "sleeping " << duration_cast<microseconds>(sleeping).count()
+      << " us, spinning " << duration_cast<microseconds>(spinning).count()
+      << " us";
+}
+
+TEST(Scheduler, AServerReportsItsListenerTicks) {
+  ASSERT_EQ(znet::Init(), znet::Result::Success);
+  znet::ServerConfig config{"127.0.0.1", 0, seconds(2),
+                            znet::ConnectionType::TCP};
+  config.options.measure_ticks = true;
+  znet::Server server{config};
+  server.SetEventCallback([](znet::Event&) {});
+  ASSERT_EQ(server.Bind(), znet::Result::Success);
+  ASSERT_EQ(server.Listen(), znet::Result::Success);
+  std::this_thread::sleep_for(milliseconds(300));
+  const znet::TickMetrics tick = server.metrics().tick;
+  EXPECT_GT(tick.ticks, 5u);
+  EXPECT_GT(tick.wait_us, 100000u);
+  EXPECT_GE(tick.jitter_total_us, tick.jitter_max_us);
+  server.Stop();
+  server.Wait();
+}
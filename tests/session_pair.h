@@ -60,6 +60,7 @@ class FakeTransport : public TransportLayer {
   uint8_t OrderingDomain(const SendOptions& options) const override {
     return options.GetOr<ChannelKey>(0);
   }
+  size_t CoalesceLimit() const override { return coalesce_limit; }
   Result Close(CloseOptions = {}) override {
     closed = true;
     return Result::Success;
@@ -71,6 +72,8 @@ class FakeTransport : public TransportLayer {
   std::vector<Frame> sent;
   std::deque<std::shared_ptr<Buffer>> inbox;
   bool closed = false;
+  // zero, one message per Send(), unless a test is about packing them
+  size_t coalesce_limit = 0;
 };
 
 enum TestPacketType : PacketId { kPacketProbe = 1 };
@@ -28,7 +28,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cstdio>
 #include <memory>
 #include <set>
 #include <thread>
@@ -154,6 +156,84 @@ TEST(MpscQueueTest, ManyProducersLoseNothing) {
   EXPECT_EQ(seen.size(), static_cast<size_t>(kThreads * kPer));
 }
 
+TEST(MpscQueueTest, PushBatchAcceptsTheLongestPrefixThatFits) {
+  MpscQueue<int> q(8);
+  ASSERT_TRUE(q.Push(-1));
+  ASSERT_TRUE(q.Push(-2));
+  size_t queued = 999;
+  EXPECT_EQ(q.PushBatch(10, [](size_t i) { return static_cast<int>(i); },
+                        &queued),
+            6u)
+      << "six slots were free; the rest of the batch is refused, not dropped";
+  EXPECT_EQ(queued, 2u) << "depth ahead of the first of the batch";
+  EXPECT_EQ(q.PushBatch(1, [](size_t) { return 99; }), 0u) << "now full";
+
+  std::vector<int> out;
+  q.DrainTo(out);
+  EXPECT_EQ(out, (std::vector<int>{-1, -2, 0, 1, 2, 3, 4, 5}));
+}
+
+TEST(MpscQueueTest, PushBatchWrapsTheRing) {
+  MpscQueue<int> q(4);
+  int next = 0;
+  std::vector<int> out;
+  // each lap starts the run at a different offset, so some runs straddle the
+  // end of the ring
+  for (int lap = 0; lap < 10; lap++) {
+    const size_t accepted =
+        q.PushBatch(3, [&next](size_t) { return next++; });
+    ASSERT_EQ(accepted, 3u);
+    q.DrainTo(out);
+  }
+  ASSERT_EQ(out.size(), 30u);
+  for (int i = 0; i < 30; i++) {
+    EXPECT_EQ(out[static_cast<size_t>(i)], i);
+  }
+}
+
+TEST(MpscQueueTest, BatchAndSingleProducersLoseNothing) {
+  constexpr int kThreads = 4;
+  constexpr int kPer = 2000;
+  MpscQueue<int> q(256);
+
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kThreads; t++) {
+    producers.emplace_back([&, t] {
+      int i = 0;
+      while (i < kPer) {
+        if (t % 2 == 0) {
+          // batches of up to 7, resuming after whatever prefix was refused
+          const size_t want = static_cast<size_t>(std::min(7, kPer - i));
+          const int base = t * kPer + i;
+          i += static_cast<int>(q.PushBatch(
+              want, [base](size_t k) { return base + static_cast<int>(k); }));
+        } else if (q.Push(t * kPer + i)) {
+          i++;
+        }
+        std::this_thread::yield();
+      }
+    });
+  }
+
+  std::set<int> seen;
+  std::vector<int> last(kThreads, -1);
+  while (static_cast<int>(seen.size()) < kThreads * kPer) {
+    int v = 0;
+    if (q.Pop(v)) {
+      EXPECT_TRUE(seen.insert(v).second) << "duplicate value " << v;
+      const int producer = v / kPer;
+      EXPECT_GT(v, last[static_cast<size_t>(producer)])
+          << "one producer's values must stay in order";
+      last[static_cast<size_t>(producer)] = v;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& p : producers) {
+    p.join();
+  }
+}
+
 // --- OutboundQueue ------------------------------------------------------------
 
 namespace {
@@ -177,6 +257,19 @@ TEST(OutboundQueueTest, WakesOnTheIdleEdgeOnly) {
   EXPECT_EQ(wakes, 1) << "a drain is already on its way; further wakes are waste";
 }
 
+TEST(OutboundQueueTest, BatchWakesOnce) {
+  OutboundQueue q(16);
+  int wakes = 0;
+  q.SetWakeCallback([&] { wakes++; });
+
+  EXPECT_EQ(q.PushBatch(10, [](size_t) {
+              return OutboundQueue::Item{AnyPacket(), {}, nullptr, 0};
+            }),
+            10u);
+  EXPECT_EQ(wakes, 1) << "one run, one wake";
+  EXPECT_EQ(q.size(), 10u);
+}
+
 TEST(OutboundQueueTest, RefusesWhenFull) {
   OutboundQueue q(2);
   ASSERT_TRUE(q.Push(AnyPacket(), {}));
@@ -216,6 +309,87 @@ TEST(OutboundQueueTest, DrainsEvenWhenTheCallbackEncodesNothing) {
   EXPECT_EQ(q.size(), 0u);
 }
 
+// A packet queued behind a run of less urgent ones on other channels is
+// encoded ahead of them, and packets of one priority still go in the order
+// they were sent.
+TEST(OutboundQueueTest, DrainsHigherPriorityFirstAndEqualsInOrder) {
+  OutboundQueue q(16);
+  const uint8_t priorities[] = {0, 0, 5, 0, 9, 5};
+  for (uint8_t priority : priorities) {
+    ASSERT_TRUE(q.Push(AnyPacket(),
+                       SendOptions().Channel(priority).Priority(priority)));
+  }
+  // no priority at all is priority 0
+  ASSERT_TRUE(q.Push(AnyPacket(), {}));
+
+  std::vector<uint8_t> order;
+  q.Drain([&](OutboundQueue::Item& item) {
+    order.push_back(item.options.GetOr<PriorityKey>(0));
+    return true;
+  });
+  EXPECT_EQ(order, (std::vector<uint8_t>{9, 5, 5, 0, 0, 0, 0}));
+}
+
+TEST(OutboundQueueTest, EqualPrioritiesKeepSendOrder) {
+  OutboundQueue q(16);
+  std::vector<std::shared_ptr<Packet>> sent;
+  for (int i = 0; i < 6; i++) {
+    sent.push_back(std::make_shared<Packet>(static_cast<PacketId>(i)));
+    // two priorities, interleaved, each on its own channel
+    const uint8_t priority = i % 2 == 0 ? 3 : 1;
+    ASSERT_TRUE(q.Push(sent.back(),
+                       SendOptions().Channel(priority).Priority(priority)));
+  }
+  std::vector<PacketId> order;
+  q.Drain([&](OutboundQueue::Item& item) {
+    order.push_back(item.packet->id());
+    return true;
+  });
+  EXPECT_EQ(order, (std::vector<PacketId>{0, 2, 4, 1, 3, 5}));
+}
+
+// Priority never reorders an ordered channel: an urgent packet behind less
+// urgent ones on its own channel takes them along ahead of other channels
+// rather than overtaking them. This is all of TCP's traffic on the default
+// channel, which sorting the whole run used to shuffle.
+TEST(OutboundQueueTest, OrderedChannelKeepsSendOrderAcrossPriorities) {
+  OutboundQueue q(16);
+  struct Sent {
+    uint8_t channel;
+    uint8_t priority;
+  };
+  const Sent sent[] = {{2, 0}, {1, 0}, {1, 4}, {2, 0}, {1, 9}, {1, 2}};
+  for (size_t i = 0; i < std::size(sent); i++) {
+    ASSERT_TRUE(q.Push(std::make_shared<Packet>(static_cast<PacketId>(i)),
+                       SendOptions()
+                           .Channel(sent[i].channel)
+                           .Priority(sent[i].priority)));
+  }
+  std::vector<PacketId> order;
+  q.Drain([&](OutboundQueue::Item& item) {
+    order.push_back(item.packet->id());
+    return true;
+  });
+  // channel 1 in its own order, carried ahead by the 9 at its back; the 2 after
+  // that goes on its own merit, still ahead of channel 2
+  EXPECT_EQ(order, (std::vector<PacketId>{1, 2, 4, 5, 0, 3}));
+}
+
+// An unordered packet promises no order, so priority moves it on its own.
+TEST(OutboundQueueTest, UnorderedPacketsOvertakeTheirChannel) {
+  OutboundQueue q(16);
+  ASSERT_TRUE(q.Push(std::make_shared<Packet>(PacketId{0}), {}));
+  ASSERT_TRUE(q.Push(std::make_shared<Packet>(PacketId{1}),
+                     SendOptions().Ordered(false).Priority(6)));
+  ASSERT_TRUE(q.Push(std::make_shared<Packet>(PacketId{2}), {}));
+  std::vector<PacketId> order;
+  q.Drain([&](OutboundQueue::Item& item) {
+    order.push_back(item.packet->id());
+    return true;
+  });
+  EXPECT_EQ(order, (std::vector<PacketId>{1, 0, 2}));
+}
+
 // The claim is what keeps message order defined while letting any thread
 // encode. A second entrant must decline rather than interleave.
 TEST(OutboundQueueTest, ClaimIsExclusiveAndNonBlocking) {
@@ -658,3 +832,685 @@ TEST(ByteMetrics, WireBytesAreCountedWithoutACodec) {
   EXPECT_EQ(after.payload_bytes_received, before.payload_bytes_received)
       << "payload bytes only count what reached a handler";
 }
+
+// --- before the connect event -------------------------------------------------
+
+// The peer can be ready, and sending, before this end's connect event has
+// installed a codec. What arrives in that gap is held and delivered in order
+// once one is, ahead of anything that came after. It used to be dropped.
+TEST(HeldMessages, ArriveOnceACodecIsInstalled) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+  // as the handshake leaves it, before the application's codec goes on
+  pair.server->SetCodec(nullptr);
+
+  for (uint32_t seq = 1; seq <= 3; seq++) {
+    pair.Deliver(pair.Emit(seq, 0));
+  }
+  EXPECT_TRUE(pair.server_got.empty());
+
+  pair.server->SetCodec(MakeCodec());
+  pair.Deliver(pair.Emit(4, 0));
+  EXPECT_EQ(pair.server_got, (std::vector<uint32_t>{1, 2, 3, 4}));
+}
+
+// Held only up to a bound, so a peer cannot grow a session without limit
+// before it has been looked at; the oldest are the ones kept.
+TEST(HeldMessages, AreBounded) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+  pair.server->SetCodec(nullptr);
+
+  const uint32_t sent = PeerSession::kMaxHeldMessages + 5;
+  for (uint32_t seq = 0; seq < sent; seq++) {
+    pair.Deliver(pair.Emit(seq, 0));
+  }
+  pair.server->SetCodec(MakeCodec());
+  pair.server->Process();
+  ASSERT_EQ(pair.server_got.size(), PeerSession::kMaxHeldMessages);
+  EXPECT_EQ(pair.server_got.front(), 0u);
+  EXPECT_EQ(pair.server_got.back(), PeerSession::kMaxHeldMessages - 1);
+}
+
+// --- encode_on_send -----------------------------------------------------------
+
+// The caller serializes, so what goes out is the packet as it was when
+// SendPacket() returned, not whatever it holds by the time a worker drains.
+TEST(EncodeOnSend, SerializesOnTheCallingThread) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.common.encode_on_send = true;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+
+  auto packet = std::make_shared<ProbePacket>();
+  packet->seq = 1;
+  ASSERT_EQ(pair.client->SendPacket(packet), Result::Success);
+  packet->seq = 99;  // too late: the bytes are already queued
+  pair.client->DrainOutbound();
+  ASSERT_EQ(pair.client_wire->sent.size(), 1u);
+  pair.Deliver(pair.client_wire->sent.back());
+
+  EXPECT_EQ(pair.server_got, std::vector<uint32_t>{1});
+}
+
+// Encryption still runs at drain time, so prepared messages keep their queue
+// order on the wire and the metrics the drain owns still add up.
+TEST(EncodeOnSend, PreparedMessagesDecryptInOrder) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.common.encode_on_send = true;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+
+  const auto before = pair.client->metrics().common;
+  const auto before_recv = pair.server->metrics().common;
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < 50; i++) {
+    auto packet = std::make_shared<ProbePacket>();
+    packet->seq = i;
+    ASSERT_EQ(pair.client->SendPacket(packet), Result::Success);
+    expected.push_back(i);
+  }
+  pair.client->DrainOutbound();
+  for (auto& frame : pair.client_wire->sent) {
+    pair.Deliver(frame);
+  }
+
+  EXPECT_EQ(pair.server_got, expected);
+  const auto sent = pair.client->metrics().common;
+  const auto recv = pair.server->metrics().common;
+  EXPECT_EQ(sent.payload_bytes_sent - before.payload_bytes_sent,
+            recv.payload_bytes_received - before_recv.payload_bytes_received);
+  EXPECT_EQ(sent.messages_sent - before.messages_sent, 50u);
+}
+
+// Several threads prepare and queue at once while the worker drains and the
+// compression is switched under them: every packet arrives, each sender's in
+// the order it sent them. The race this guards is invisible without
+// ThreadSanitizer, so run it under one after touching the encode path.
+TEST(EncodeOnSend, ConcurrentSendersWhileTheWorkerDrains) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.common.encode_on_send = true;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+
+  const uint32_t kSenders = 4;
+  const uint32_t kEach = 2000;
+  std::atomic<uint32_t> finished{0};
+  std::vector<std::thread> senders;
+  for (uint32_t t = 0; t < kSenders; t++) {
+    senders.emplace_back([&pair, &finished, t, kEach]() {
+      for (uint32_t i = 0; i < kEach; i++) {
+        auto packet = std::make_shared<ProbePacket>();
+        packet->seq = (t << 24) | i;
+        Result result;
+        while ((result = pair.client->SendPacket(packet)) == Result::QueueFull) {
+          std::this_thread::yield();
+        }
+        EXPECT_EQ(result, Result::Success);
+      }
+      finished.fetch_add(1, std::memory_order_release);
+    });
+  }
+  std::thread switcher([&pair, &finished, kSenders]() {
+    for (uint32_t i = 0; finished.load(std::memory_order_acquire) < kSenders; i++) {
+      pair.client->SetOutCompression(i % 2 == 0 ? CompressionType::Zstandard
+                                                : CompressionType::None);
+      std::this_thread::yield();
+    }
+  });
+
+  // this thread is the worker
+  auto deliver = [&pair]() {
+    pair.client->DrainOutbound();
+    for (auto& frame : pair.client_wire->sent) {
+      pair.Deliver(frame);
+    }
+    pair.client_wire->sent.clear();
+  };
+  while (finished.load(std::memory_order_acquire) < kSenders) {
+    deliver();
+  }
+  deliver();
+  for (auto& sender : senders) {
+    sender.join();
+  }
+  switcher.join();
+
+  ASSERT_EQ(pair.server_got.size(), size_t{kSenders} * kEach);
+  std::vector<uint32_t> next(kSenders, 0);
+  for (uint32_t seq : pair.server_got) {
+    const uint32_t sender = seq >> 24;
+    ASSERT_LT(sender, kSenders);
+    EXPECT_EQ(seq & 0xFFFFFF, next[sender]) << "sender " << sender << " reordered";
+    next[sender] = (seq & 0xFFFFFF) + 1;
+  }
+}
+
+// A sender may be inside the codec at any moment, so a ready session keeps
+// the codec it has rather than free it under them.
+TEST(EncodeOnSend, ReadySessionKeepsItsCodec) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.common.encode_on_send = true;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+
+  pair.client->SetCodec(nullptr);  // refused: Handshake() installed one
+  auto packet = std::make_shared<ProbePacket>();
+  packet->seq = 7;
+  ASSERT_EQ(pair.client->SendPacket(packet), Result::Success);
+  pair.client->DrainOutbound();
+  ASSERT_EQ(pair.client_wire->sent.size(), 1u);
+  pair.Deliver(pair.client_wire->sent.back());
+  EXPECT_EQ(pair.server_got, std::vector<uint32_t>{7});
+}
+
+// --- SendPackets --------------------------------------------------------------
+
+TEST(SendPackets, QueuesTheBatchInOrder) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+
+  std::vector<OutgoingPacket> batch;
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < 20; i++) {
+    auto packet = std::make_shared<ProbePacket>();
+    packet->seq = i;
+    batch.push_back(OutgoingPacket{packet, SendOptions()});
+    expected.push_back(i);
+  }
+  size_t accepted = 0;
+  EXPECT_EQ(pair.client->SendPackets(batch, &accepted), Result::Success);
+  EXPECT_EQ(accepted, 20u);
+  pair.client->DrainOutbound();
+  for (auto& frame : pair.client_wire->sent) {
+    pair.Deliver(frame);
+  }
+  EXPECT_EQ(pair.server_got, expected);
+}
+
+// Backpressure takes a prefix, so retrying from the reported index keeps order.
+TEST(SendPackets, PartialAcceptanceIsAPrefix) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.common.send_queue_capacity = 8;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+
+  std::vector<OutgoingPacket> batch;
+  for (uint32_t i = 0; i < 12; i++) {
+    auto packet = std::make_shared<ProbePacket>();
+    packet->seq = i;
+    batch.push_back(OutgoingPacket{packet, SendOptions()});
+  }
+  size_t accepted = 0;
+  EXPECT_EQ(pair.client->SendPackets(batch, &accepted), Result::QueueFull);
+  EXPECT_EQ(accepted, 8u);
+  pair.client->DrainOutbound();
+
+  size_t rest = 0;
+  EXPECT_EQ(pair.client->SendPackets(batch.data() + accepted,
+                                     batch.size() - accepted, &rest),
+            Result::Success);
+  EXPECT_EQ(rest, 4u);
+  pair.client->DrainOutbound();
+  for (auto& frame : pair.client_wire->sent) {
+    pair.Deliver(frame);
+  }
+  ASSERT_EQ(pair.server_got.size(), 12u);
+  for (uint32_t i = 0; i < 12; i++) {
+    EXPECT_EQ(pair.server_got[i], i);
+  }
+}
+
+TEST(SendPackets, ANullEntryRefusesTheWholeBatch) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/false);
+  ASSERT_TRUE(pair.Handshake());
+
+  std::vector<OutgoingPacket> batch(3);
+  batch[0].packet = std::make_shared<ProbePacket>();
+  batch[2].packet = std::make_shared<ProbePacket>();
+  size_t accepted = 99;
+  EXPECT_EQ(pair.client->SendPackets(batch, &accepted),
+            Result::InvalidArgument);
+  EXPECT_EQ(accepted, 0u);
+  EXPECT_FALSE(pair.client->DrainOutbound()) << "nothing was queued";
+}
+
+// Queues `count` probes, sequenced from `first`, on `channel`.
+static void QueueProbes(Pair& pair, uint32_t first, uint32_t count,
+                        uint8_t channel = 0) {
+  for (uint32_t i = first; i < first + count; i++) {
+    auto packet = std::make_shared<ProbePacket>();
+    packet->seq = i;
+    SendOptions options;
+    options.Set<ChannelKey>(channel);
+    ASSERT_EQ(pair.client->SendPacket(packet, options), Result::Success);
+  }
+}
+
+TEST(Coalesce, PacksADrainIntoOneMessage) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+  pair.client_wire->coalesce_limit = 4096;
+  const SessionMetrics before = pair.client->metrics();
+
+  QueueProbes(pair, 0, 20);
+  pair.client->DrainOutbound();
+  ASSERT_EQ(pair.client_wire->sent.size(), 1u);
+  pair.Deliver(pair.client_wire->sent[0]);
+
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < 20; i++) {
+    expected.push_back(i);
+  }
+  EXPECT_EQ(pair.server_got, expected);
+#if ZNET_ENABLE_METRICS
+  const SessionMetrics after = pair.client->metrics();
+  EXPECT_EQ(after.common.messages_sent - before.common.messages_sent, 20u);
+  EXPECT_EQ(after.common.coalesced_messages - before.common.coalesced_messages,
+            20u);
+#else
+  (void)before;
+#endif
+}
+
+TEST(Coalesce, TheByteCapSplitsTheDrain) {
+  ASSERT_EQ(Init(), Result::Success);
+  const size_t probe_bytes =
+      MakeCodec()->Serialize(std::make_shared<ProbePacket>())->readable_bytes();
+  SessionOptions base;
+  base.common.coalesce_max_bytes = 64;
+  // only the cap is under test, not how long the encryption takes
+  base.common.coalesce_max_delay = std::chrono::microseconds(0);
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+  pair.client_wire->coalesce_limit = 4096;
+
+  QueueProbes(pair, 0, 20);
+  pair.client->DrainOutbound();
+  const size_t per_message = 64 / probe_bytes;
+  EXPECT_EQ(pair.client_wire->sent.size(),
+            (20 + per_message - 1) / per_message);
+  for (auto& frame : pair.client_wire->sent) {
+    pair.Deliver(frame);
+  }
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < 20; i++) {
+    expected.push_back(i);
+  }
+  EXPECT_EQ(pair.server_got, expected);
+}
+
+// Each ordering domain has its own cipher sequence, so a message never spans
+// two of them.
+TEST(Coalesce, OrderingDomainsAreNotMixed) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+  pair.client_wire->coalesce_limit = 4096;
+
+  QueueProbes(pair, 0, 3, /*channel=*/0);
+  QueueProbes(pair, 3, 3, /*channel=*/1);
+  QueueProbes(pair, 6, 3, /*channel=*/0);
+  pair.client->DrainOutbound();
+  ASSERT_EQ(pair.client_wire->sent.size(), 3u);
+  EXPECT_EQ(pair.client_wire->sent[0].channel, 0);
+  EXPECT_EQ(pair.client_wire->sent[1].channel, 1);
+  EXPECT_EQ(pair.client_wire->sent[2].channel, 0);
+  for (auto& frame : pair.client_wire->sent) {
+    pair.Deliver(frame);
+  }
+  EXPECT_EQ(pair.server_got.size(), 9u);
+}
+
+TEST(Coalesce, ZeroDisablesIt) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.common.coalesce_max_bytes = 0;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+  pair.client_wire->coalesce_limit = 4096;
+
+  QueueProbes(pair, 0, 5);
+  pair.client->DrainOutbound();
+  EXPECT_EQ(pair.client_wire->sent.size(), 5u);
+}
+
+// --- Streams: a transfer cut into chunks and paced by the receiver's credit.
+
+namespace {
+
+std::string StreamPattern(size_t size) {
+  std::string bytes(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    bytes[i] = static_cast<char>((i * 7 + i / 251) & 0xFF);
+  }
+  return bytes;
+}
+
+struct StreamSink {
+  std::string bytes;
+  uint64_t chunks = 0;
+  bool ended = false;
+  StreamId stream_id = 0;
+};
+
+void CollectStream(PeerSession& session, StreamSink* sink) {
+  session.SetStreamCallback([sink](const StreamChunk& chunk) {
+    EXPECT_EQ(chunk.offset, sink->bytes.size());
+    sink->bytes.append(chunk.data, chunk.size);
+    sink->chunks++;
+    sink->stream_id = chunk.stream_id;
+    sink->ended = chunk.last;
+  });
+}
+
+// Writes `bytes` as fast as credit allows, pumping the pair in between.
+void WriteAll(Pair& pair, StreamWriter& writer, const std::string& bytes) {
+  size_t offset = 0;
+  for (int round = 0; round < 10000 && offset < bytes.size(); round++) {
+    size_t written = 0;
+    writer.Write(bytes.data() + offset, bytes.size() - offset, &written);
+    offset += written;
+    pair.Pump();
+  }
+  ASSERT_EQ(offset, bytes.size());
+}
+
+}  // namespace
+
+TEST(Stream, ArrivesWholeAndInOrder) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.stream.chunk_bytes = 1000;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+  StreamSink sink;
+  CollectStream(*pair.server, &sink);
+
+  const std::string bytes = StreamPattern(10500);
+  auto writer = pair.client->OpenStream(/*channel=*/3);
+  ASSERT_TRUE(writer);
+  WriteAll(pair, *writer, bytes);
+  EXPECT_EQ(writer->Finish(), Result::Success);
+  pair.Pump();
+  pair.Pump();
+
+  EXPECT_EQ(sink.bytes, bytes);
+  EXPECT_EQ(sink.chunks, 12u) << "eleven chunks, then the empty last one";
+  EXPECT_TRUE(sink.ended);
+  EXPECT_EQ(sink.stream_id, writer->id());
+  EXPECT_EQ(writer->Write("x", 1), Result::AlreadyClosed);
+  EXPECT_TRUE(pair.server->IsAlive());
+}
+
+// The sender never runs further ahead of the receiver than its window, yet
+// a transfer many windows long still completes.
+TEST(Stream, CreditBoundsTheSender) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.stream.window_bytes = kStreamInitialCredit;
+  Pair pair(/*encryption=*/false, base);
+  ASSERT_TRUE(pair.Handshake());
+  StreamSink sink;
+  CollectStream(*pair.server, &sink);
+
+  const std::string bytes = StreamPattern(4 * 1024 * 1024);
+  auto writer = pair.client->OpenStream();
+  size_t first = 0;
+  EXPECT_EQ(writer->Write(bytes.data(), bytes.size(), &first),
+            Result::QueueFull);
+  EXPECT_EQ(first, kStreamInitialCredit) << "no grant has arrived yet";
+  EXPECT_EQ(writer->writable_bytes(), 0u);
+
+  size_t offset = first;
+  uint64_t max_ahead = 0;
+  for (int round = 0; round < 10000 && offset < bytes.size(); round++) {
+    pair.Pump();
+    max_ahead = std::max<uint64_t>(max_ahead,
+                                   writer->bytes_written() - sink.bytes.size());
+    size_t written = 0;
+    writer->Write(bytes.data() + offset, bytes.size() - offset, &written);
+    offset += written;
+  }
+  ASSERT_EQ(offset, bytes.size());
+  writer->Finish();
+  pair.Pump();
+  pair.Pump();
+  EXPECT_EQ(sink.bytes, bytes);
+  EXPECT_LE(max_ahead, 2 * kStreamInitialCredit);
+}
+
+TEST(Stream, TheWritableCallbackFiresOnAGrant) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.stream.window_bytes = kStreamInitialCredit;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+  StreamSink sink;
+  CollectStream(*pair.server, &sink);
+
+  auto writer = pair.client->OpenStream();
+  int wakes = 0;
+  writer->SetWritableCallback([&wakes]() { wakes++; });
+  const std::string bytes = StreamPattern(kStreamInitialCredit);
+  EXPECT_EQ(writer->Write(bytes.data(), bytes.size()), Result::Success);
+  EXPECT_EQ(writer->writable_bytes(), 0u);
+  for (int i = 0; i < 4; i++) {
+    pair.Pump();
+  }
+  EXPECT_GT(wakes, 0);
+  EXPECT_GT(writer->writable_bytes(), 0u);
+}
+
+// Dropping a writer ends its stream rather than leaving it open on the peer.
+TEST(Stream, DroppingTheWriterFinishesTheStream) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+  StreamSink sink;
+  CollectStream(*pair.server, &sink);
+
+  auto writer = pair.client->OpenStream();
+  EXPECT_EQ(writer->Write("abc", 3), Result::Success);
+  writer.reset();
+  pair.Pump();
+  pair.Pump();
+  EXPECT_EQ(sink.bytes, "abc");
+  EXPECT_TRUE(sink.ended);
+}
+
+TEST(Stream, AWriterOutlivingItsSessionReportsIt) {
+  ASSERT_EQ(Init(), Result::Success);
+  std::shared_ptr<StreamWriter> writer;
+  {
+    Pair pair(/*encryption=*/true);
+    ASSERT_TRUE(pair.Handshake());
+    writer = pair.client->OpenStream();
+  }
+  EXPECT_EQ(writer->Write("abc", 3), Result::NotConnected);
+  EXPECT_EQ(writer->Finish(), Result::NotConnected);
+}
+
+// A chunk the receiver never granted credit for, or out of its stream's
+// order, is a peer that cannot be trusted with the stream protocol.
+TEST(Stream, AChunkPastItsCreditClosesTheSession) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+
+  auto opening = std::make_shared<StreamChunkPacket>();
+  opening->stream_id = 9;
+  opening->data.assign(16, 'a');
+  auto rogue = std::make_shared<StreamChunkPacket>();
+  rogue->stream_id = 9;
+  rogue->offset = kStreamInitialCredit;
+  rogue->data.assign(16, 'b');
+  ASSERT_EQ(pair.client->SendPacket(opening), Result::Success);
+  ASSERT_EQ(pair.client->SendPacket(rogue), Result::Success);
+  pair.Pump();
+  pair.Pump();
+  EXPECT_FALSE(pair.server->IsAlive());
+}
+
+TEST(Stream, InboundStreamsAreCapped) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.stream.max_inbound = 2;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+
+  std::vector<std::shared_ptr<StreamWriter>> writers;
+  for (int i = 0; i < 2; i++) {
+    writers.push_back(pair.client->OpenStream());
+    EXPECT_EQ(writers.back()->Write("x", 1), Result::Success);
+  }
+  pair.Pump();
+  pair.Pump();
+  EXPECT_TRUE(pair.server->IsAlive());
+  writers.push_back(pair.client->OpenStream());
+  EXPECT_EQ(writers.back()->Write("x", 1), Result::Success);
+  pair.Pump();
+  pair.Pump();
+  EXPECT_FALSE(pair.server->IsAlive());
+}
+
+// --- SendFile: a mapped file sent as a stream, reported through events.
+
+namespace {
+
+std::string WriteTempFile(const std::string& name, const std::string& bytes) {
+  const std::string path = testing::TempDir() + name;
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  EXPECT_NE(file, nullptr);
+  if (file != nullptr) {
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+  }
+  return path;
+}
+
+struct FileEvents {
+  std::vector<uint64_t> progress;
+  int completed = 0;
+  Result result = Result::Failure;
+  uint64_t total = 0;
+};
+
+EventCallbackFn RecordFileEvents(FileEvents* events) {
+  return [events](Event& event) {
+    EventDispatcher dispatcher(event);
+    dispatcher.Dispatch<FileTransferProgressEvent>(
+        [events](FileTransferProgressEvent& progress) {
+          events->progress.push_back(progress.bytes_sent());
+          events->total = progress.total_bytes();
+          return true;
+        });
+    dispatcher.Dispatch<FileTransferCompletedEvent>(
+        [events](FileTransferCompletedEvent& completed) {
+          events->completed++;
+          events->result = completed.result();
+          return true;
+        });
+  };
+}
+
+}  // namespace
+
+TEST(SendFile, ArrivesWholeWithProgressThenCompletion) {
+  ASSERT_EQ(Init(), Result::Success);
+  SessionOptions base;
+  base.stream.window_bytes = kStreamInitialCredit;
+  Pair pair(/*encryption=*/true, base);
+  ASSERT_TRUE(pair.Handshake());
+  StreamSink sink;
+  CollectStream(*pair.server, &sink);
+
+  const std::string bytes = StreamPattern(3 * 1024 * 1024 + 123);
+  const std::string path = WriteTempFile("znet_sendfile_whole", bytes);
+  FileEvents events;
+  StreamId id = 0;
+  ASSERT_EQ(pair.client->SendFile(path, 0, kToEndOfFile,
+                                  RecordFileEvents(&events), &id),
+            Result::Success);
+  for (int i = 0; i < 2000 && !sink.ended; i++) {
+    pair.Pump();
+  }
+  EXPECT_TRUE(sink.ended);
+  EXPECT_TRUE(sink.bytes == bytes) << "the file arrives byte for byte";
+  EXPECT_EQ(sink.stream_id, id);
+  EXPECT_EQ(events.completed, 1);
+  EXPECT_EQ(events.result, Result::Success);
+  EXPECT_EQ(events.total, bytes.size());
+  ASSERT_GT(events.progress.size(), 1u) << "paced by credit, not in one go";
+  EXPECT_TRUE(std::is_sorted(events.progress.begin(), events.progress.end()));
+  EXPECT_EQ(events.progress.back(), bytes.size());
+  std::remove(path.c_str());
+}
+
+TEST(SendFile, SendsARangeOverAnUnencryptedSession) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/false);
+  ASSERT_TRUE(pair.Handshake());
+  StreamSink sink;
+  CollectStream(*pair.server, &sink);
+
+  // an offset off every page boundary, so the mapping has to reach back
+  const std::string bytes = StreamPattern(100000);
+  const std::string path = WriteTempFile("znet_sendfile_range", bytes);
+  FileEvents events;
+  ASSERT_EQ(pair.client->SendFile(path, 5001, 40000, RecordFileEvents(&events)),
+            Result::Success);
+  for (int i = 0; i < 100 && !sink.ended; i++) {
+    pair.Pump();
+  }
+  EXPECT_TRUE(sink.bytes == bytes.substr(5001, 40000));
+  EXPECT_EQ(events.result, Result::Success);
+
+  // a length past the end stops at the end
+  StreamSink tail;
+  CollectStream(*pair.server, &tail);
+  ASSERT_EQ(pair.client->SendFile(path, 99000, 5000), Result::Success);
+  for (int i = 0; i < 100 && !tail.ended; i++) {
+    pair.Pump();
+  }
+  EXPECT_TRUE(tail.bytes == bytes.substr(99000));
+  std::remove(path.c_str());
+}
+
+TEST(SendFile, RefusesWhatItCannotMap) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+  EXPECT_EQ(pair.client->SendFile(testing::TempDir() + "znet_no_such_file"),
+            Result::CannotOpenFile);
+  const std::string path = WriteTempFile("znet_sendfile_short", "abc");
+  EXPECT_EQ(pair.client->SendFile(path, 4), Result::InvalidArgument);
+  std::remove(path.c_str());
+}
+
+TEST(SendFile, ASessionClosingFirstCompletesItWithNotConnected) {
+  ASSERT_EQ(Init(), Result::Success);
+  Pair pair(/*encryption=*/true);
+  ASSERT_TRUE(pair.Handshake());
+  const std::string path =
+      WriteTempFile("znet_sendfile_cut", StreamPattern(2 * 1024 * 1024));
+  FileEvents events;
+  ASSERT_EQ(pair.client->SendFile(path, 0, kToEndOfFile,
+                                  RecordFileEvents(&events)),
+            Result::Success);
+  pair.client->Close();
+  pair.Pump();
+  EXPECT_EQ(events.completed, 1);
+  EXPECT_EQ(events.result, Result::NotConnected);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,400 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// SharedMemoryTransportLayer over a real rendezvous on a socketpair, driven
+// by hand the way a session worker would, and the whole stack through
+// Server/Client with ConnectionType::SharedMemory. Linux only, like the
+// transport.
+//
+
+#include "znet/backends/shm.h"
+
+#if ZNET_HAS_SHARED_MEMORY
+
+#include "znet/client.h"
+#include "znet/client_events.h"
+#include "znet/detail/socket_ops.h"
+#include "znet/init.h"
+#include "znet/inet_addr.h"
+#include "znet/packet.h"
+#include "znet/packet_handler.h"
+#include "znet/packet_serializer.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+#include "znet/util.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+
+using namespace znet;
+using namespace znet::backends;
+
+namespace {
+
+// Both ends of one rendezvous, made into transports.
+struct TransportPair {
+  std::unique_ptr<SharedMemoryTransportLayer> accepting;
+  std::unique_ptr<SharedMemoryTransportLayer> connecting;
+
+  explicit TransportPair(size_t ring_bytes,
+                         CommonOptions common = CommonOptions(),
+                         SharedMemoryOptions shm = SharedMemoryOptions()) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+      return;
+    }
+    SharedMemoryChannel offered;
+    SharedMemoryChannel joined;
+    if (!OfferChannel(sockets[0], ring_bytes, &offered)) {
+      CloseSocket(sockets[0]);
+      CloseSocket(sockets[1]);
+      return;
+    }
+    if (!JoinChannel(sockets[1], std::chrono::seconds(1), &joined)) {
+      CloseSocket(sockets[1]);
+      // a transport is what releases a channel
+      SharedMemoryTransportLayer release{offered};
+      return;
+    }
+    accepting =
+        std::make_unique<SharedMemoryTransportLayer>(offered, common, shm);
+    connecting =
+        std::make_unique<SharedMemoryTransportLayer>(joined, common, shm);
+  }
+
+  bool ok() const { return accepting && connecting; }
+};
+
+std::shared_ptr<Buffer> Pattern(size_t size, uint8_t seed) {
+  auto buffer = std::make_shared<Buffer>();
+  for (size_t i = 0; i < size; i++) {
+    buffer->WriteInt<uint8_t>(static_cast<uint8_t>(seed + i * 31));
+  }
+  return buffer;
+}
+
+bool MatchesPattern(const std::shared_ptr<Buffer>& buffer, size_t size,
+                    uint8_t seed) {
+  if (buffer->readable_bytes() != size) {
+    return false;
+  }
+  const char* data = buffer->read_cursor_data();
+  for (size_t i = 0; i < size; i++) {
+    if (static_cast<uint8_t>(data[i]) != static_cast<uint8_t>(seed + i * 31)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(SharedMemoryTransport, MessagesCrossWholeAndInOrder) {
+  TransportPair pair(4096);
+  ASSERT_TRUE(pair.ok());
+  // one byte, exactly a record, one past it, and several rings' worth
+  const std::vector<size_t> sizes = {1, 1024, 1025, 100, 50000, 7};
+  std::vector<std::shared_ptr<Buffer>> got;
+  size_t sent = 0;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (got.size() < sizes.size() &&
+         std::chrono::steady_clock::now() < deadline) {
+    if (sent < sizes.size()) {
+      ASSERT_TRUE(pair.accepting->Send(
+          Pattern(sizes[sent], static_cast<uint8_t>(sent))));
+      sent++;
+    }
+    pair.accepting->Flush();
+    while (auto message = pair.connecting->Receive()) {
+      got.push_back(message);
+    }
+  }
+  ASSERT_EQ(got.size(), sizes.size());
+  for (size_t i = 0; i < sizes.size(); i++) {
+    EXPECT_TRUE(MatchesPattern(got[i], sizes[i], static_cast<uint8_t>(i)))
+        << "message " << i;
+  }
+#if ZNET_ENABLE_METRICS
+  SessionMetrics received;
+  pair.connecting->FillMetrics(received);
+  EXPECT_EQ(received.shm.messages_reassembled, 2u);
+  SessionMetrics written;
+  pair.accepting->FillMetrics(written);
+  EXPECT_GT(written.shm.ring_full, 0u) << "50000 bytes cannot fit 4096";
+  EXPECT_EQ(written.shm.queued_bytes, 0u);
+#endif
+}
+
+TEST(SharedMemoryTransport, BothDirectionsAreIndependent) {
+  TransportPair pair(1 << 16);
+  ASSERT_TRUE(pair.ok());
+  ASSERT_TRUE(pair.accepting->Send(Pattern(10, 1)));
+  ASSERT_TRUE(pair.connecting->Send(Pattern(20, 2)));
+  auto at_connecting = pair.connecting->Receive();
+  auto at_accepting = pair.accepting->Receive();
+  ASSERT_TRUE(at_connecting);
+  ASSERT_TRUE(at_accepting);
+  EXPECT_TRUE(MatchesPattern(at_connecting, 10, 1));
+  EXPECT_TRUE(MatchesPattern(at_accepting, 20, 2));
+}
+
+#if ZNET_ENABLE_METRICS
+// the point of the edge: a reader that keeps finding records costs its
+// writer nothing, and only a reader that went to sleep is woken
+TEST(SharedMemoryTransport, OnlyASleepingReaderIsWoken) {
+  TransportPair pair(1 << 20);
+  ASSERT_TRUE(pair.ok());
+  for (uint8_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(pair.accepting->Send(Pattern(64, i)));
+  }
+  SessionMetrics metrics;
+  pair.accepting->FillMetrics(metrics);
+  EXPECT_EQ(metrics.shm.wakeups_sent, 0u) << "the reader never slept";
+
+  int received = 0;
+  while (pair.connecting->Receive()) {
+    received++;
+  }
+  EXPECT_EQ(received, 100);  // and the empty ring parked it
+
+  ASSERT_TRUE(pair.accepting->Send(Pattern(64, 0)));
+  ASSERT_TRUE(pair.accepting->Send(Pattern(64, 1)));
+  pair.accepting->FillMetrics(metrics);
+  EXPECT_EQ(metrics.shm.wakeups_sent, 1u)
+      << "one wakeup for the edge, none for the record behind it";
+}
+
+TEST(SharedMemoryTransport, AFullRingWakesItsWriterOnceDrained) {
+  TransportPair pair(4096);
+  ASSERT_TRUE(pair.ok());
+  for (uint8_t i = 0; i < 20; i++) {
+    ASSERT_TRUE(pair.accepting->Send(Pattern(500, i)));
+  }
+  SessionMetrics written;
+  pair.accepting->FillMetrics(written);
+  EXPECT_GT(written.shm.queued_bytes, 0u);
+
+  // what the reader takes frees room, and the writer parked on it
+  ASSERT_TRUE(pair.connecting->Receive());
+  SessionMetrics reader;
+  pair.connecting->FillMetrics(reader);
+  EXPECT_EQ(reader.shm.wakeups_sent, 1u);
+
+  int received = 1;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (received < 20 && std::chrono::steady_clock::now() < deadline) {
+    pair.accepting->Flush();
+    while (pair.connecting->Receive()) {
+      received++;
+    }
+  }
+  EXPECT_EQ(received, 20);
+}
+#endif
+
+TEST(SharedMemoryTransport, ACloseDeliversWhatWasWrittenFirst) {
+  TransportPair pair(1 << 16);
+  ASSERT_TRUE(pair.ok());
+  for (uint8_t i = 0; i < 3; i++) {
+    ASSERT_TRUE(pair.accepting->Send(Pattern(100, i)));
+  }
+  pair.accepting->Close();
+  for (uint8_t i = 0; i < 3; i++) {
+    auto message = pair.connecting->Receive();
+    ASSERT_TRUE(message) << "message " << int{i};
+    EXPECT_TRUE(MatchesPattern(message, 100, i));
+  }
+  EXPECT_FALSE(pair.connecting->Receive());
+  EXPECT_TRUE(pair.connecting->IsClosed());
+}
+
+TEST(SharedMemoryTransport, APeerThatExitsIsNoticed) {
+  CommonOptions common;
+  common.keepalive_interval = std::chrono::milliseconds(1);
+  TransportPair pair(1 << 16, common);
+  ASSERT_TRUE(pair.ok());
+  // no Close(): the ring never hears of it, only the socket does
+  pair.accepting = nullptr;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!pair.connecting->IsClosed() &&
+         std::chrono::steady_clock::now() < deadline) {
+    pair.connecting->Update();
+    pair.connecting->Receive();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  EXPECT_TRUE(pair.connecting->IsClosed());
+}
+
+// --- Through Server and Client ----------------------------------------------
+
+namespace {
+
+enum SharedMemoryPacketType : PacketId { kPacketCount = 1 };
+
+class CountPacket : public Packet {
+ public:
+  CountPacket() : Packet(kPacketCount) {}
+  uint32_t seq = 0;
+};
+
+class CountSerializer : public PacketSerializer<CountPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<CountPacket> packet,
+                                         std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteInt<uint32_t>(packet->seq);
+    return buffer;
+  }
+  std::shared_ptr<CountPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<CountPacket>();
+    packet->seq = buffer->ReadInt<uint32_t>();
+    return packet;
+  }
+};
+
+std::shared_ptr<Codec> MakeCountCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketCount, std::make_unique<CountSerializer>());
+  return codec;
+}
+
+class EchoCount : public PacketHandler<EchoCount, CountPacket> {
+ public:
+  explicit EchoCount(std::shared_ptr<PeerSession> session)
+      : session_(std::move(session)) {}
+  void OnPacket(std::shared_ptr<CountPacket> packet) {
+    session_->SendPacket(packet);
+  }
+
+ private:
+  std::shared_ptr<PeerSession> session_;
+};
+
+class InOrder : public PacketHandler<InOrder, CountPacket> {
+ public:
+  void OnPacket(std::shared_ptr<CountPacket> packet) {
+    if (packet->seq != next.load()) {
+      out_of_order++;
+    }
+    next = packet->seq + 1;
+  }
+  std::atomic<uint32_t> next{0};
+  std::atomic<int> out_of_order{0};
+};
+
+std::string TestSocketPath(const char* tag) {
+  return "/tmp/znet-test-" + std::to_string(GetProcessId()) + "-shm-" + tag +
+         ".sock";
+}
+
+}  // namespace
+
+TEST(SharedMemorySession, RefusesAnAddressThatIsNotAPath) {
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig config{"127.0.0.1", 0, std::chrono::seconds(2),
+                      ConnectionType::SharedMemory};
+  Server server{config};
+  EXPECT_NE(server.Bind(), Result::Success);
+}
+
+TEST(SharedMemorySession, EchoesThroughServerAndClientUnencrypted) {
+  ASSERT_EQ(Init(), Result::Success);
+  const std::string path = "unix:" + TestSocketPath("echo");
+
+  ServerConfig server_config{path, 0, std::chrono::seconds(5),
+                             ConnectionType::SharedMemory};
+  Server server{server_config};
+  server.SetEventCallback([](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeCountCodec());
+          ev.session()->SetHandler(std::make_shared<EchoCount>(ev.session()));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  ClientConfig client_config{path, 0, std::chrono::seconds(5),
+                             ConnectionType::SharedMemory};
+  Client client{client_config};
+  auto in_order = std::make_shared<InOrder>();
+  std::atomic<bool> connected{false};
+  std::shared_ptr<PeerSession> session;
+  std::mutex session_mutex;
+  client.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent& ev) {
+          ev.session()->SetCodec(MakeCountCodec());
+          ev.session()->SetHandler(in_order);
+          {
+            std::lock_guard<std::mutex> lock(session_mutex);
+            session = ev.session();
+          }
+          connected = true;
+          return false;
+        });
+  });
+  ASSERT_EQ(client.Bind(), Result::Success);
+  ASSERT_EQ(client.Connect(), Result::Success);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!connected.load() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  ASSERT_TRUE(connected.load());
+  std::shared_ptr<PeerSession> sender;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    sender = session;
+  }
+  EXPECT_EQ(sender->connection_type(), ConnectionType::SharedMemory);
+  unsigned char key[32];
+  EXPECT_NE(sender->ExportKeyingMaterial("znet-test", key, sizeof(key)),
+            Result::Success)
+      << "shared memory sessions skip the key exchange by default";
+
+  constexpr uint32_t kCount = 2000;
+  for (uint32_t i = 0; i < kCount; i++) {
+    auto packet = std::make_shared<CountPacket>();
+    packet->seq = i;
+    while (sender->SendPacket(packet) == Result::QueueFull) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (in_order->next.load() < kCount &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  EXPECT_EQ(in_order->next.load(), kCount);
+  EXPECT_EQ(in_order->out_of_order.load(), 0);
+
+  client.Disconnect();
+  server.Stop();
+  client.Wait();
+  server.Wait();
+}
+
+#endif  // ZNET_HAS_SHARED_MEMORY
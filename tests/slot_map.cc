@@ -0,0 +1,114 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// detail::SlotMap: that a key finds its value wherever erases have moved it,
+// that a key outlives its value without finding the next one in its slot,
+// and that EraseIf() visits each value once while erasing under itself.
+//
+
+#include "znet/detail/slot_map.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace znet::detail;
+
+TEST(SlotMap, KeysFindTheirValuesAcrossErases) {
+  SlotMap<int> map;
+  std::vector<SlotMap<int>::Key> keys;
+  for (int i = 0; i < 100; i++) {
+    keys.push_back(map.Insert(i));
+  }
+  // every third, so the survivors are shuffled into the gaps
+  for (size_t i = 0; i < keys.size(); i += 3) {
+    EXPECT_TRUE(map.Erase(keys[i]));
+  }
+  EXPECT_EQ(map.size(), 66u);
+  for (size_t i = 0; i < keys.size(); i++) {
+    const int* value = map.Find(keys[i]);
+    if (i % 3 == 0) {
+      EXPECT_EQ(value, nullptr) << i;
+    } else {
+      ASSERT_NE(value, nullptr) << i;
+      EXPECT_EQ(*value, static_cast<int>(i));
+    }
+  }
+}
+
+TEST(SlotMap, AStaleKeyMissesTheValueThatReusedItsSlot) {
+  SlotMap<int> map;
+  const auto old_key = map.Insert(1);
+  ASSERT_TRUE(map.Erase(old_key));
+  EXPECT_FALSE(map.Erase(old_key)) << "erased once already";
+  const auto new_key = map.Insert(2);
+  EXPECT_NE(new_key, old_key);
+  EXPECT_EQ(map.Find(old_key), nullptr);
+  ASSERT_NE(map.Find(new_key), nullptr);
+  EXPECT_EQ(*map.Find(new_key), 2);
+  EXPECT_EQ(map.Find(SlotMap<int>::kNullKey), nullptr);
+}
+
+TEST(SlotMap, IterationIsOverTheValuesPacked) {
+  SlotMap<int> map;
+  std::vector<SlotMap<int>::Key> keys;
+  for (int i = 0; i < 10; i++) {
+    keys.push_back(map.Insert(i));
+  }
+  map.Erase(keys[0]);
+  map.Erase(keys[5]);
+  std::vector<int> seen(map.begin(), map.end());
+  std::sort(seen.begin(), seen.end());
+  EXPECT_EQ(seen, (std::vector<int>{1, 2, 3, 4, 6, 7, 8, 9}));
+}
+
+TEST(SlotMap, EraseIfVisitsEachValueOnce) {
+  SlotMap<std::unique_ptr<int>> map;
+  std::vector<SlotMap<std::unique_ptr<int>>::Key> keys;
+  for (int i = 0; i < 50; i++) {
+    keys.push_back(map.Insert(std::unique_ptr<int>(new int(i))));
+  }
+  std::vector<int> visited;
+  const size_t erased = map.EraseIf([&](const std::unique_ptr<int>& value) {
+    visited.push_back(*value);
+    return *value % 2 == 0;
+  });
+  EXPECT_EQ(erased, 25u);
+  EXPECT_EQ(map.size(), 25u);
+  std::sort(visited.begin(), visited.end());
+  ASSERT_EQ(visited.size(), 50u);
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ(visited[static_cast<size_t>(i)], i);
+    const auto* value = map.Find(keys[static_cast<size_t>(i)]);
+    if (i % 2 == 0) {
+      EXPECT_EQ(value, nullptr);
+    } else {
+      ASSERT_NE(value, nullptr);
+      EXPECT_EQ(**value, i);
+    }
+  }
+}
+
+TEST(SlotMap, ClearInvalidatesEveryKey) {
+  SlotMap<int> map;
+  const auto a = map.Insert(1);
+  const auto b = map.Insert(2);
+  map.Clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.Find(a), nullptr);
+  EXPECT_EQ(map.Find(b), nullptr);
+  const auto c = map.Insert(3);
+  EXPECT_NE(c, a);
+  EXPECT_NE(c, b);
+  EXPECT_EQ(*map.Find(c), 3);
+}
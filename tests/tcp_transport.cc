@@ -17,6 +17,7 @@
 #include "znet/backends/tcp.h"
 #include "znet/client.h"
 #include "znet/detail/socket_ops.h"
+#include "znet/detail/uring.h"
 #include "znet/client_events.h"
 #include "znet/init.h"
 #include "znet/inet_addr.h"
@@ -32,8 +33,10 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -331,6 +334,67 @@ TEST(TCPLatency, RoundTripBeatsTheOldTickFloor) {
   server.Wait();
 }
 
+// a worker only looks at a session with work or a deadline due, so a peer
+// that goes silent is noticed by the idle deadline the worker slept until
+TEST(TCPKeepalive, AWorkerTimesOutAQuietSessionItLeftAlone) {
+  ASSERT_EQ(Init(), Result::Success);
+  const PortNumber port = FreeTcpPortLocal();
+  ASSERT_NE(port, 0);
+
+  ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(5),
+                             ConnectionType::TCP};
+  server_config.child_options.common.idle_timeout =
+      std::chrono::milliseconds(300);
+  Server server{server_config};
+  std::atomic<bool> connected{false};
+  std::atomic<bool> disconnected{false};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent&) {
+          connected = true;
+          return false;
+        });
+    dispatcher.Dispatch<IncomingClientDisconnectedEvent>(
+        [&](IncomingClientDisconnectedEvent&) {
+          disconnected = true;
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(5),
+                             ConnectionType::TCP};
+  // no pings, so nothing arrives to wake the server's worker
+  client_config.options.common.keepalive_interval =
+      std::chrono::milliseconds(0);
+  client_config.options.common.idle_timeout = std::chrono::milliseconds(0);
+  Client client{client_config};
+  client.SetEventCallback([](Event&) {});
+  ASSERT_EQ(client.Bind(), Result::Success);
+  ASSERT_EQ(client.Connect(), Result::Success);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!connected.load() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  ASSERT_TRUE(connected.load());
+  const auto since = std::chrono::steady_clock::now();
+  deadline = since + std::chrono::seconds(3);
+  while (!disconnected.load() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  EXPECT_TRUE(disconnected.load());
+  EXPECT_LT(std::chrono::steady_clock::now() - since, std::chrono::seconds(1))
+      << "the idle deadline was 300 ms out";
+
+  client.Disconnect();
+  server.Stop();
+  client.Wait();
+  server.Wait();
+}
+
 TEST(TCPKeepalive, DataSurvivesInterleavedControlFrames) {
   ASSERT_EQ(Init(), Result::Success);
   SocketPair pair;
@@ -347,6 +411,7 @@ TEST(TCPKeepalive, DataSurvivesInterleavedControlFrames) {
     auto payload = std::make_shared<Buffer>();
     payload->WriteInt<uint32_t>(i);
     ASSERT_TRUE(a.Send(payload));
+    a.Flush();
     a.Update();
     b.Update();
     while (auto got = b.Receive()) {
@@ -506,3 +571,952 @@ TEST(TCPFraming, OversizedFrameLengthCloses) {
   EXPECT_TRUE(transport.IsClosed());
   CloseSocket(pair.a);
 }
+
+// --- Gathered writes: Send() queues, Flush() hands the queue to the kernel in
+// as few syscalls as it can.
+
+TEST(TCPGather, NothingLeavesBeforeTheFlush) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPTransportLayer a(pair.a, Timers(0, 0));
+  TCPTransportLayer b(pair.b, Timers(0, 0));
+
+  auto payload = std::make_shared<Buffer>();
+  payload->WriteInt<uint32_t>(7);
+  ASSERT_TRUE(a.Send(payload));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(b.Receive(), nullptr);
+
+  a.Flush();
+  std::shared_ptr<Buffer> got;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!got && std::chrono::steady_clock::now() < deadline) {
+    got = b.Receive();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_NE(got, nullptr);
+  EXPECT_EQ(got->ReadInt<uint32_t>(), 7u);
+}
+
+TEST(TCPGather, ADrainLeavesInOneSyscall) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPTransportLayer a(pair.a, Timers(0, 0));
+  TCPTransportLayer b(pair.b, Timers(0, 0));
+
+  const uint32_t kFrames = 50;
+  for (uint32_t i = 0; i < kFrames; i++) {
+    auto payload = std::make_shared<Buffer>();
+    payload->WriteInt<uint32_t>(i);
+    ASSERT_TRUE(a.Send(payload));
+  }
+  a.Flush();
+
+  uint32_t received = 0;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (received < kFrames && std::chrono::steady_clock::now() < deadline) {
+    while (auto got = b.Receive()) {
+      EXPECT_EQ(got->ReadInt<uint32_t>(), received);
+      received++;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(received, kFrames);
+#if ZNET_ENABLE_METRICS
+  SessionMetrics metrics;
+  a.FillMetrics(metrics);
+  EXPECT_EQ(metrics.tcp.frames_sent, kFrames);
+  // 50 tiny frames fit one gather and a loopback socket buffer many times over
+  EXPECT_EQ(metrics.tcp.writes, 1u);
+#endif
+}
+
+// With small socket buffers every gathered send comes up short, most of them
+// inside a frame; the peer must still read each frame whole and in order.
+TEST(TCPGather, ShortWritesResumeInsideAFrame) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  int small = 4096;
+  setsockopt(pair.a, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&small),
+             sizeof(small));
+  setsockopt(pair.b, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&small),
+             sizeof(small));
+  TCPTransportLayer a(pair.a, Timers(0, 0));
+  TCPTransportLayer b(pair.b, Timers(0, 0));
+
+  // odd-sized, so frame edges never line up with what the kernel takes
+  const uint32_t kFrames = 300;
+  const size_t kPayload = 1001;
+  std::atomic<uint32_t> received{0};
+  std::atomic<bool> intact{true};
+  std::thread reader([&]() {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (received.load() < kFrames &&
+           std::chrono::steady_clock::now() < deadline) {
+      while (auto got = b.Receive()) {
+        const uint32_t seq = received.load();
+        if (got->readable_bytes() != kPayload ||
+            got->ReadInt<uint32_t>() != seq) {
+          intact = false;
+        }
+        for (size_t i = sizeof(uint32_t); i < kPayload; i++) {
+          if (got->ReadInt<uint8_t>() != static_cast<uint8_t>(seq + i)) {
+            intact = false;
+          }
+        }
+        received++;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  });
+  for (uint32_t seq = 0; seq < kFrames; seq++) {
+    auto payload = std::make_shared<Buffer>();
+    payload->WriteInt<uint32_t>(seq);
+    for (size_t i = sizeof(uint32_t); i < kPayload; i++) {
+      payload->WriteInt<uint8_t>(static_cast<uint8_t>(seq + i));
+    }
+    ASSERT_TRUE(a.Send(payload));
+  }
+  // a flush never waits on the socket, so keep flushing as the reader frees
+  // room, the way the reactor's writable wake would have the worker do
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (received.load() < kFrames &&
+         std::chrono::steady_clock::now() < deadline) {
+    a.Flush();
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  reader.join();
+  EXPECT_EQ(received.load(), kFrames);
+  EXPECT_TRUE(intact.load());
+  EXPECT_FALSE(a.IsClosed());
+#if ZNET_ENABLE_METRICS
+  SessionMetrics metrics;
+  a.FillMetrics(metrics);
+  EXPECT_EQ(metrics.tcp.frames_sent, kFrames);
+  EXPECT_GT(metrics.tcp.writes, 1u);
+#endif
+}
+
+// --- Backpressure: a peer that stops reading costs its own session a backlog,
+// never the worker a stall.
+
+namespace {
+
+void ShrinkBuffers(SocketPair& pair) {
+  int small = 4096;
+  setsockopt(pair.a, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&small),
+             sizeof(small));
+  setsockopt(pair.b, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&small),
+             sizeof(small));
+}
+
+std::shared_ptr<Buffer> SeqPayload(uint32_t seq, size_t size) {
+  auto payload = std::make_shared<Buffer>();
+  payload->WriteInt<uint32_t>(seq);
+  payload->SkipWrite(size - sizeof(uint32_t));
+  return payload;
+}
+
+}  // namespace
+
+TEST(TCPBackpressure, FlushNeverWaitsOnAStalledPeer) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  ShrinkBuffers(pair);
+  TCPTransportLayer a(pair.a, Timers(0, 0));
+
+  // far more than both socket buffers hold, and b never reads
+  for (uint32_t seq = 0; seq < 512; seq++) {
+    ASSERT_TRUE(a.Send(SeqPayload(seq, 2000)));
+  }
+  const auto start = std::chrono::steady_clock::now();
+  a.Flush();
+  a.Flush();
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(50))
+      << "the old send loop waited on the socket in 50 ms rounds";
+  EXPECT_FALSE(a.IsClosed());
+#if ZNET_ENABLE_METRICS
+  SessionMetrics metrics;
+  a.FillMetrics(metrics);
+  EXPECT_GT(metrics.tcp.queued_bytes, 0u);
+#endif
+  CloseSocket(pair.b);
+}
+
+TEST(TCPBackpressure, HighWaterDisconnectsASlowConsumer) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  ShrinkBuffers(pair);
+  TCPOptions tcp;
+  tcp.send_high_water = 64 * 1024;
+  TCPTransportLayer a(pair.a, Timers(0, 0), tcp);
+
+  uint32_t seq = 0;
+  while (!a.IsClosed() && seq < 10000) {
+    a.Send(SeqPayload(seq++, 2000));
+    a.Flush();
+  }
+  EXPECT_TRUE(a.IsClosed());
+  CloseSocket(pair.b);
+}
+
+// Shedding drops whole messages and nothing else, so what does arrive is
+// intact and in order, and the connection survives.
+TEST(TCPBackpressure, HighWaterShedsWholeMessages) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  ShrinkBuffers(pair);
+  TCPOptions tcp;
+  tcp.send_high_water = 64 * 1024;
+  tcp.slow_consumer = SlowConsumerPolicy::Shed;
+  TCPTransportLayer a(pair.a, Timers(0, 0), tcp);
+  TCPTransportLayer b(pair.b, Timers(0, 0));
+
+  const uint32_t kMessages = 200;
+  uint32_t refused = 0;
+  for (uint32_t seq = 0; seq < kMessages; seq++) {
+    if (!a.Send(SeqPayload(seq, 2000))) {
+      refused++;
+    }
+    a.Flush();
+  }
+  EXPECT_GT(refused, 0u);
+  EXPECT_FALSE(a.IsClosed());
+
+  std::vector<uint32_t> got;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (got.size() < kMessages - refused &&
+         std::chrono::steady_clock::now() < deadline) {
+    a.Flush();
+    while (auto frame = b.Receive()) {
+      EXPECT_EQ(frame->readable_bytes(), 2000u);
+      got.push_back(frame->ReadInt<uint32_t>());
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  EXPECT_EQ(got.size(), kMessages - refused);
+  EXPECT_TRUE(std::is_sorted(got.begin(), got.end()));
+  EXPECT_FALSE(b.IsClosed());
+#if ZNET_ENABLE_METRICS
+  SessionMetrics metrics;
+  a.FillMetrics(metrics);
+  EXPECT_EQ(metrics.tcp.frames_shed, refused);
+#endif
+}
+
+// --- Large messages: past one frame a message goes out in fragments and is
+// put back together on the other side.
+
+namespace {
+
+std::shared_ptr<Buffer> PatternBuffer(size_t size) {
+  const auto payload = PatternPayload(size);
+  return std::make_shared<Buffer>(
+      reinterpret_cast<const char*>(payload.data()), payload.size());
+}
+
+}  // namespace
+
+TEST(TCPLargeMessages, RoundTripWhole) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  // pings every millisecond land between fragments
+  TCPTransportLayer a(pair.a, Timers(1, 0));
+  TCPTransportLayer b(pair.b, Timers(1, 0));
+
+  // one frame's worth either side of the boundary, and messages large enough
+  // to fill the socket several times over
+  const size_t frame = ZNET_MAX_BUFFER_SIZE - 48 - 3;
+  const std::vector<size_t> sizes = {frame,  frame + 1, 10000,  100,
+                                     200000, 3,         1 << 20};
+  for (size_t size : sizes) {
+    ASSERT_TRUE(a.Send(PatternBuffer(size)));
+  }
+
+  std::vector<std::vector<uint8_t>> got;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (got.size() < sizes.size() &&
+         std::chrono::steady_clock::now() < deadline) {
+    a.Flush();
+    a.Update();
+    b.Update();
+    while (auto message = b.Receive()) {
+      got.push_back(FrameBytes(message));
+    }
+    while (a.Receive()) {
+    }
+  }
+  ASSERT_EQ(got.size(), sizes.size());
+  for (size_t i = 0; i < sizes.size(); i++) {
+    EXPECT_EQ(got[i], PatternPayload(sizes[i])) << "message " << i;
+  }
+  EXPECT_FALSE(a.IsClosed());
+  EXPECT_FALSE(b.IsClosed());
+#if ZNET_ENABLE_METRICS
+  SessionMetrics sent;
+  a.FillMetrics(sent);
+  SessionMetrics received;
+  b.FillMetrics(received);
+  EXPECT_GT(sent.tcp.fragments_sent, sizes.size());
+  EXPECT_EQ(received.tcp.messages_reassembled, 4u);
+#endif
+}
+
+// A control frame between two fragments is answered in place and leaves the
+// message it interrupts intact.
+TEST(TCPLargeMessages, ControlFramesMayFallBetweenFragments) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPTransportLayer transport(pair.b, Timers(0, 0));
+
+  const auto first = PatternPayload(700);
+  const auto second = PatternPayload(300);
+  std::vector<uint8_t> stream;
+  stream.push_back(static_cast<uint8_t>(0x80 | (first.size() >> 8)));
+  stream.push_back(static_cast<uint8_t>(first.size() & 0xFF));
+  stream.insert(stream.end(), first.begin(), first.end());
+  stream.insert(stream.end(), {0, 0, 1});  // ping control frame
+  AppendFrame(stream, second);
+  ASSERT_EQ(SocketSend(pair.a, stream.data(), stream.size()),
+            static_cast<ssize_t>(stream.size()));
+
+  std::shared_ptr<Buffer> message;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!message && std::chrono::steady_clock::now() < deadline) {
+    message = transport.Receive();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(message);
+  auto expected = first;
+  expected.insert(expected.end(), second.begin(), second.end());
+  EXPECT_EQ(FrameBytes(message), expected);
+  EXPECT_FALSE(transport.Receive());
+
+  uint8_t pong[3] = {};
+  ssize_t pong_len = 0;
+  const auto pong_deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (pong_len <= 0 && std::chrono::steady_clock::now() < pong_deadline) {
+    pong_len = SocketRecv(pair.a, pong, sizeof(pong));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(pong_len, 3);
+  EXPECT_EQ(pong[2], 2);  // kControlPong
+  CloseSocket(pair.a);
+}
+
+TEST(TCPLargeMessages, OutgrowingTheReassemblyLimitCloses) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPTransportLayer a(pair.a, Timers(0, 0));
+  TCPOptions tcp;
+  tcp.max_reassembly_bytes = 8192;
+  TCPTransportLayer b(pair.b, Timers(0, 0), tcp);
+
+  ASSERT_TRUE(a.Send(PatternBuffer(20000)));
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!b.IsClosed() && std::chrono::steady_clock::now() < deadline) {
+    a.Flush();
+    EXPECT_FALSE(b.Receive());
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(b.IsClosed());
+}
+
+// A message the send backlog could never hold is refused up front, not
+// treated as a slow peer.
+TEST(TCPLargeMessages, ALargerMessageThanTheBacklogIsRefused) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPOptions tcp;
+  tcp.send_high_water = 16 * 1024;
+  TCPTransportLayer a(pair.a, Timers(0, 0), tcp);
+
+  EXPECT_FALSE(a.Send(PatternBuffer(20000)));
+  EXPECT_FALSE(a.IsClosed());
+  EXPECT_TRUE(a.Send(PatternBuffer(10000)));
+  CloseSocket(pair.b);
+}
+
+// --- File spans: a frame's header from a buffer and its body straight from a
+// file, which the kernel copies with sendfile() where it can.
+
+namespace {
+
+std::shared_ptr<detail::MappedFile> MapPattern(const std::string& name,
+                                               size_t size,
+                                               std::string* out_path) {
+  const auto payload = PatternPayload(size);
+  *out_path = testing::TempDir() + name;
+  std::FILE* file = std::fopen(out_path->c_str(), "wb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+  std::fwrite(payload.data(), 1, payload.size(), file);
+  std::fclose(file);
+  Result result = Result::Failure;
+  return detail::MappedFile::Open(*out_path, 0, kToEndOfFile, &result);
+}
+
+std::shared_ptr<Buffer> FileHead(uint8_t tag) {
+  auto head = std::make_shared<Buffer>();
+  head->ReserveHeadroom(4);
+  head->WriteInt<uint8_t>(tag);
+  return head;
+}
+
+}  // namespace
+
+// Spans and ordinary frames leave in the order they were queued, and a span
+// the socket takes in pieces resumes where it stopped.
+TEST(TCPFileSpans, InterleaveWithFramesAndResume) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  // a send buffer smaller than a span, so the socket takes spans in pieces
+  int small = 4096;
+  setsockopt(pair.a, SOL_SOCKET, SO_SNDBUF,
+             reinterpret_cast<const char*>(&small), sizeof(small));
+  TCPTransportLayer a(pair.a, Timers(0, 0));
+  TCPTransportLayer b(pair.b, Timers(0, 0));
+  std::string path;
+  auto file = MapPattern("znet_tcp_file_spans", 200000, &path);
+  ASSERT_TRUE(file);
+  const auto pattern = PatternPayload(200000);
+
+  // a span per chunk, as a file transfer queues them, with frames between;
+  // each several frames' and receive buffers' worth
+  const size_t kChunk = 30000;
+  size_t expected = 0;
+  for (size_t offset = 0; offset < pattern.size(); offset += kChunk) {
+    const size_t size = std::min(kChunk, pattern.size() - offset);
+    ASSERT_TRUE(a.SendFile(FileHead(1), file, offset, size));
+    ASSERT_TRUE(a.Send(PatternBuffer(100)));
+    expected += 2;
+  }
+
+  std::vector<std::vector<uint8_t>> got;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (got.size() < expected &&
+         std::chrono::steady_clock::now() < deadline) {
+    a.Flush();
+    while (auto message = b.Receive()) {
+      got.push_back(FrameBytes(message));
+    }
+  }
+  ASSERT_EQ(got.size(), expected);
+  size_t offset = 0;
+  for (size_t i = 0; i < got.size(); i += 2) {
+    const size_t size = std::min(kChunk, pattern.size() - offset);
+    ASSERT_EQ(got[i].size(), size + 1);
+    EXPECT_EQ(got[i][0], 1);
+    EXPECT_TRUE(std::equal(got[i].begin() + 1, got[i].end(),
+                           pattern.begin() + static_cast<std::ptrdiff_t>(offset)))
+        << "span at " << offset;
+    EXPECT_EQ(got[i + 1], PatternPayload(100));
+    offset += size;
+  }
+#if ZNET_ENABLE_METRICS && ZNET_HAS_SENDFILE
+  SessionMetrics metrics;
+  a.FillMetrics(metrics);
+  EXPECT_EQ(metrics.tcp.file_bytes_sent, pattern.size())
+      << "every span went through sendfile()";
+#endif
+  std::remove(path.c_str());
+}
+
+// A span too large for one run is copied and fragmented like any large
+// message rather than refused.
+TEST(TCPFileSpans, PastOneRunFallsBackToFragments) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPTransportLayer a(pair.a, Timers(0, 0));
+  TCPTransportLayer b(pair.b, Timers(0, 0));
+  const size_t kSize = a.FileFrameLimit() + 1000;
+  std::string path;
+  auto file = MapPattern("znet_tcp_file_large", kSize, &path);
+  ASSERT_TRUE(file);
+
+  ASSERT_TRUE(a.SendFile(FileHead(2), file, 0, kSize));
+  std::shared_ptr<Buffer> message;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!message && std::chrono::steady_clock::now() < deadline) {
+    a.Flush();
+    message = b.Receive();
+  }
+  ASSERT_TRUE(message);
+  auto bytes = FrameBytes(message);
+  ASSERT_EQ(bytes.size(), kSize + 1);
+  EXPECT_EQ(bytes[0], 2);
+  EXPECT_TRUE(std::equal(bytes.begin() + 1, bytes.end(),
+                         PatternPayload(kSize).begin()));
+  std::remove(path.c_str());
+}
+
+namespace {
+
+// a run as SendFile() writes one: a control frame carrying its length, then
+// the message unframed
+void AppendRun(std::vector<uint8_t>& stream, const std::vector<uint8_t>& payload) {
+  const uint32_t size = static_cast<uint32_t>(payload.size());
+  stream.insert(stream.end(), {0, 0, 3});  // kControlRun
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    stream.push_back(static_cast<uint8_t>(size >> shift));
+  }
+  stream.insert(stream.end(), payload.begin(), payload.end());
+}
+
+}  // namespace
+
+// A run's header and body can split anywhere too, and the frames either side
+// of it still parse. Its body is larger than the receive buffer, which is what
+// a run is for.
+TEST(TCPFileSpans, RunsSurviveByteAtATimeDelivery) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPTransportLayer transport(pair.b, Timers(0, 0));
+
+  std::vector<std::vector<uint8_t>> payloads = {
+      PatternPayload(5), PatternPayload(ZNET_MAX_BUFFER_SIZE + 300),
+      PatternPayload(3)};
+  std::vector<uint8_t> stream;
+  AppendFrame(stream, payloads[0]);
+  AppendRun(stream, payloads[1]);
+  stream.insert(stream.end(), {0, 0, 1});  // ping control frame
+  AppendFrame(stream, payloads[2]);
+
+  // the header a byte at a time, then the body in uneven slices
+  std::vector<std::vector<uint8_t>> got;
+  size_t sent = 0;
+  while (sent < stream.size()) {
+    const size_t slice = sent < 16 ? 1 : std::min<size_t>(777, stream.size() - sent);
+    ASSERT_EQ(SocketSend(pair.a, stream.data() + sent, slice),
+              static_cast<ssize_t>(slice));
+    sent += slice;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    while (auto frame = transport.Receive()) {
+      got.push_back(FrameBytes(frame));
+    }
+  }
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (got.size() < payloads.size() &&
+         std::chrono::steady_clock::now() < deadline) {
+    while (auto frame = transport.Receive()) {
+      got.push_back(FrameBytes(frame));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(got, payloads);
+  EXPECT_FALSE(transport.IsClosed());
+  CloseSocket(pair.a);
+}
+
+// A run of nothing, or one past the reassembly limit, could not have come from
+// SendFile() and closes the connection.
+TEST(TCPFileSpans, MalformedRunsClose) {
+  ASSERT_EQ(Init(), Result::Success);
+  for (uint32_t length : {0u, 0x7FFFFFFFu}) {
+    SocketPair pair;
+    ASSERT_TRUE(pair.ok);
+    TCPTransportLayer transport(pair.b, Timers(0, 0));
+    const uint8_t header[7] = {0, 0, 3,
+                               static_cast<uint8_t>(length >> 24),
+                               static_cast<uint8_t>(length >> 16),
+                               static_cast<uint8_t>(length >> 8),
+                               static_cast<uint8_t>(length)};
+    ASSERT_EQ(SocketSend(pair.a, header, sizeof(header)), 7);
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!transport.IsClosed() &&
+           std::chrono::steady_clock::now() < deadline) {
+      transport.Receive();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(transport.IsClosed()) << "a run of " << length;
+    CloseSocket(pair.a);
+  }
+}
+
+// --- Zerocopy: gathers past TCPOptions::zerocopy_threshold go out with
+// MSG_ZEROCOPY, their buffers held until the kernel reports them done.
+// Loopback always copies, so it also exercises the fallback.
+
+TEST(TCPZeroCopy, LoopbackCopiesSoTheSessionFallsBackToCopies) {
+  ASSERT_EQ(Init(), Result::Success);
+  SocketPair pair;
+  ASSERT_TRUE(pair.ok);
+  TCPOptions tcp;
+  tcp.zerocopy_threshold = 1;
+  TCPTransportLayer a(pair.a, Timers(0, 0), tcp);
+  TCPTransportLayer b(pair.b, Timers(0, 0));
+
+  const uint32_t kMessages = 40;
+  uint32_t received = 0;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  for (uint32_t i = 0; i < kMessages; i++) {
+    auto payload = PatternBuffer(3000);
+    payload->WriteInt<uint32_t>(i);
+    ASSERT_TRUE(a.Send(payload));
+    a.Flush();
+    // the completions of earlier sends arrive while later ones go out
+    a.Update();
+    while (auto got = b.Receive()) {
+      ASSERT_EQ(got->readable_bytes(), 3004u);
+      got->SkipRead(3000);
+      EXPECT_EQ(got->ReadInt<uint32_t>(), received);
+      received++;
+    }
+  }
+  while (received < kMessages && std::chrono::steady_clock::now() < deadline) {
+    a.Flush();
+    a.Update();
+    while (auto got = b.Receive()) {
+      got->SkipRead(3000);
+      EXPECT_EQ(got->ReadInt<uint32_t>(), received);
+      received++;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(received, kMessages);
+#if ZNET_ENABLE_METRICS && ZNET_HAS_ZEROCOPY
+  SessionMetrics metrics;
+  a.FillMetrics(metrics);
+  // the first report of a copy turns zerocopy off, so few sends ever used it
+  EXPECT_GT(metrics.tcp.zerocopy_copied, 0u);
+  EXPECT_EQ(metrics.tcp.zerocopy_completed, 0u);
+  EXPECT_LT(metrics.tcp.zerocopy_copied, uint64_t{kMessages});
+#endif
+}
+
+// --- io_uring: the same protocol with the server's sockets on per-worker
+// rings. Skipped where the kernel lacks what the backend needs, since the
+// server would fall back to readiness and these would test nothing new.
+
+#if ZNET_HAS_IO_URING
+
+namespace {
+
+enum UringPacketType : PacketId { kPacketBlob = 2 };
+
+class BlobPacket : public Packet {
+ public:
+  BlobPacket() : Packet(kPacketBlob) {}
+  std::string data;
+};
+
+class BlobSerializer : public PacketSerializer<BlobPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<BlobPacket> packet,
+                                         std::shared_ptr<Buffer> buffer) override {
+    // in pieces, each under the longest string a buffer reads
+    const size_t pieces = (packet->data.size() + kPiece - 1) / kPiece;
+    buffer->WriteVarInt(pieces);
+    for (size_t i = 0; i < pieces; i++) {
+      buffer->WriteString(packet->data.substr(i * kPiece, kPiece));
+    }
+    return buffer;
+  }
+  std::shared_ptr<BlobPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<BlobPacket>();
+    const auto pieces = buffer->ReadVarInt<size_t>();
+    for (size_t i = 0; i < pieces; i++) {
+      packet->data += buffer->ReadString();
+    }
+    return packet;
+  }
+
+ private:
+  static constexpr size_t kPiece = 32 * 1024;
+};
+
+std::shared_ptr<Codec> MakeUringCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketEcho, std::make_unique<EchoSerializer>());
+  codec->Add(kPacketBlob, std::make_unique<BlobSerializer>());
+  return codec;
+}
+
+// an echo of this sequence number closes the session instead
+constexpr uint32_t kCloseSeq = UINT32_MAX;
+
+// echoes everything, counting the blobs
+class UringEcho : public PacketHandler<UringEcho, EchoPacket, BlobPacket> {
+ public:
+  UringEcho(std::shared_ptr<PeerSession> session,
+            std::atomic<size_t>* blobs_echoed)
+      : session_(std::move(session)), blobs_echoed_(blobs_echoed) {}
+  void OnPacket(std::shared_ptr<EchoPacket> packet) {
+    if (packet->seq == kCloseSeq) {
+      session_->Close();
+      return;
+    }
+    session_->SendPacket(packet);
+  }
+  void OnPacket(std::shared_ptr<BlobPacket> packet) {
+    session_->SendPacket(packet);
+    (*blobs_echoed_)++;
+  }
+
+ private:
+  std::shared_ptr<PeerSession> session_;
+  std::atomic<size_t>* blobs_echoed_;
+};
+
+class UringReceived : public PacketHandler<UringReceived, EchoPacket, BlobPacket> {
+ public:
+  void OnPacket(std::shared_ptr<EchoPacket> packet) {
+    std::lock_guard<std::mutex> lock(mutex);
+    seqs.push_back(packet->seq);
+  }
+  void OnPacket(std::shared_ptr<BlobPacket> packet) {
+    std::lock_guard<std::mutex> lock(mutex);
+    blobs.push_back(packet->data);
+  }
+  size_t seq_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return seqs.size();
+  }
+  size_t blob_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blobs.size();
+  }
+
+  std::mutex mutex;
+  std::vector<uint32_t> seqs;
+  std::vector<std::string> blobs;
+};
+
+// a server on io_uring echoing through UringEcho, and a readiness client
+// connected to it
+struct UringEchoPair {
+  UringEchoPair() {
+    port = FreeTcpPortLocal();
+    ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(5),
+                               ConnectionType::TCP};
+    server_config.options.io_backend = IoBackend::IoUring;
+    server = std::make_unique<Server>(server_config);
+    server->SetEventCallback([this](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<IncomingClientConnectedEvent>(
+          [this](IncomingClientConnectedEvent& ev) {
+            ev.session()->SetCodec(MakeUringCodec());
+            ev.session()->SetHandler(
+                std::make_shared<UringEcho>(ev.session(), &blobs_echoed));
+            return false;
+          });
+      dispatcher.Dispatch<IncomingClientDisconnectedEvent>(
+          [this](IncomingClientDisconnectedEvent&) {
+            server_saw_disconnect = true;
+            return false;
+          });
+    });
+    if (server->Bind() != Result::Success ||
+        server->Listen() != Result::Success) {
+      return;
+    }
+
+    ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(5),
+                               ConnectionType::TCP};
+    client = std::make_unique<Client>(client_config);
+    client->SetEventCallback([this](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<ClientConnectedToServerEvent>(
+          [this](ClientConnectedToServerEvent& ev) {
+            ev.session()->SetCodec(MakeUringCodec());
+            ev.session()->SetHandler(received);
+            std::lock_guard<std::mutex> lock(session_mutex);
+            session = ev.session();
+            return false;
+          });
+      dispatcher.Dispatch<ClientDisconnectedFromServerEvent>(
+          [this](ClientDisconnectedFromServerEvent&) {
+            client_saw_disconnect = true;
+            return false;
+          });
+    });
+    if (client->Bind() != Result::Success ||
+        client->Connect() != Result::Success) {
+      return;
+    }
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+      {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        if (session) {
+          ok = true;
+          return;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+
+  ~UringEchoPair() {
+    if (client) {
+      client->Disconnect();
+      client->Wait();
+    }
+    server->Stop();
+    server->Wait();
+  }
+
+  template <typename Pred>
+  bool WaitFor(Pred pred) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pred() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return pred();
+  }
+
+  bool ok = false;
+  PortNumber port = 0;
+  std::unique_ptr<Server> server;
+  std::unique_ptr<Client> client;
+  std::shared_ptr<UringReceived> received{std::make_shared<UringReceived>()};
+  std::mutex session_mutex;
+  std::shared_ptr<PeerSession> session;
+  std::atomic<size_t> blobs_echoed{0};
+  std::atomic<bool> server_saw_disconnect{false};
+  std::atomic<bool> client_saw_disconnect{false};
+};
+
+}  // namespace
+
+TEST(TCPIoUring, EchoesInOrderAlongsideLargeMessages) {
+  if (!detail::Uring::Supported()) {
+    GTEST_SKIP() << "io_uring backend unsupported on this kernel";
+  }
+  ASSERT_EQ(Init(), Result::Success);
+  UringEchoPair pair;
+  ASSERT_TRUE(pair.ok);
+
+  // past one frame, and past one provided buffer, so it comes back as
+  // fragments from several receive completions
+  std::string large(100000, '\0');
+  for (size_t i = 0; i < large.size(); i++) {
+    large[i] = static_cast<char>('a' + i % 26);
+  }
+  const uint32_t kMessages = 500;
+  for (uint32_t i = 0; i < kMessages; i++) {
+    auto packet = std::make_shared<EchoPacket>();
+    packet->seq = i;
+    ASSERT_EQ(pair.session->SendPacket(packet), Result::Success);
+    if (i % 100 == 0) {
+      auto blob = std::make_shared<BlobPacket>();
+      blob->data = large;
+      ASSERT_EQ(pair.session->SendPacket(blob), Result::Success);
+    }
+  }
+  ASSERT_TRUE(pair.WaitFor([&]() {
+    return pair.received->seq_count() == kMessages &&
+           pair.received->blob_count() == kMessages / 100;
+  })) << pair.received->seq_count() << " echoes, "
+      << pair.received->blob_count() << " blobs";
+  {
+    std::lock_guard<std::mutex> lock(pair.received->mutex);
+    for (uint32_t i = 0; i < kMessages; i++) {
+      ASSERT_EQ(pair.received->seqs[i], i);
+    }
+    for (const std::string& blob : pair.received->blobs) {
+      EXPECT_TRUE(blob == large);
+    }
+  }
+
+  pair.client->Disconnect();
+  EXPECT_TRUE(pair.WaitFor([&]() { return pair.server_saw_disconnect.load(); }))
+      << "the peer's close reaches the session as an end of stream";
+}
+
+TEST(TCPIoUring, ACloseStillSendsWhatWasQueued) {
+  if (!detail::Uring::Supported()) {
+    GTEST_SKIP() << "io_uring backend unsupported on this kernel";
+  }
+  ASSERT_EQ(Init(), Result::Success);
+  UringEchoPair pair;
+  ASSERT_TRUE(pair.ok);
+
+  // far more than a socket buffer holds, so the echo is still queued, or
+  // still in a send chain, when the server closes
+  std::string large(3 * 1024 * 1024, '\0');
+  for (size_t i = 0; i < large.size(); i++) {
+    large[i] = static_cast<char>('a' + i % 26);
+  }
+  auto blob = std::make_shared<BlobPacket>();
+  blob->data = large;
+  ASSERT_EQ(pair.session->SendPacket(blob), Result::Success);
+  ASSERT_TRUE(pair.WaitFor([&]() { return pair.blobs_echoed.load() == 1; }));
+  // handled a tick later, by which time the echo has left the session's
+  // queue for the transport's
+  auto close = std::make_shared<EchoPacket>();
+  close->seq = kCloseSeq;
+  ASSERT_EQ(pair.session->SendPacket(close), Result::Success);
+
+  // the socket is shut down once the last chain completes, not before
+  EXPECT_TRUE(pair.WaitFor([&]() { return pair.client_saw_disconnect.load(); }));
+  ASSERT_EQ(pair.received->blob_count(), 1u);
+  std::lock_guard<std::mutex> lock(pair.received->mutex);
+  EXPECT_TRUE(pair.received->blobs[0] == large);
+}
+
+TEST(TCPIoUring, RoundTripIsCompletionDriven) {
+  if (!detail::Uring::Supported()) {
+    GTEST_SKIP() << "io_uring backend unsupported on this kernel";
+  }
+  ASSERT_EQ(Init(), Result::Success);
+  UringEchoPair pair;
+  ASSERT_TRUE(pair.ok);
+
+  std::vector<double> rtts_ms;
+  for (uint32_t i = 0; i < 31; i++) {
+    const size_t before = pair.received->seq_count();
+    auto packet = std::make_shared<EchoPacket>();
+    packet->seq = i;
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(pair.session->SendPacket(packet), Result::Success);
+    while (pair.received->seq_count() == before &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    ASSERT_GT(pair.received->seq_count(), before);
+    if (i > 0) {
+      rtts_ms.push_back(std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+    }
+  }
+  std::sort(rtts_ms.begin(), rtts_ms.end());
+  // a receive completion ends the worker's wait, as the poll thread's wake
+  // does for readiness; sleeping out the tick would be ~8 ms
+  EXPECT_LT(rtts_ms[rtts_ms.size() / 2], 3.0);
+}
+
+#endif  // ZNET_HAS_IO_URING
@@ -0,0 +1,182 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// detail::TimerWheel on a clock the test moves by hand: deadlines within the
+// root, ones that have to cascade down from each outer level, cancelling and
+// re-arming, and what NextExpiry() promises.
+//
+
+#include "znet/detail/timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+using namespace znet::detail;
+using std::chrono::hours;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+namespace {
+
+struct Timer : TimerWheel::Node {
+  int id = 0;
+  TimerWheel::TimePoint fired_at{};
+};
+
+const TimerWheel::TimePoint kEpoch{seconds(1000)};
+
+// advances a millisecond at a time, as a worker waking at each expiry would,
+// stamping each timer with the moment it fired
+std::vector<int> RunUntil(TimerWheel& wheel, TimerWheel::TimePoint& now,
+                          TimerWheel::TimePoint until) {
+  std::vector<int> order;
+  while (now < until) {
+    now += milliseconds(1);
+    wheel.Advance(now, [&](TimerWheel::Node& node) {
+      auto& timer = static_cast<Timer&>(node);
+      timer.fired_at = now;
+      order.push_back(timer.id);
+    });
+  }
+  return order;
+}
+
+}  // namespace
+
+TEST(TimerWheel, FiresInDeadlineOrderAtTheTickItFallsIn) {
+  TimerWheel wheel(kEpoch);
+  Timer a, b, c;
+  a.id = 1;
+  b.id = 2;
+  c.id = 3;
+  wheel.Schedule(c, kEpoch + milliseconds(200));
+  wheel.Schedule(a, kEpoch + milliseconds(5));
+  wheel.Schedule(b, kEpoch + std::chrono::microseconds(40500));
+  EXPECT_EQ(wheel.size(), 3u);
+
+  auto now = kEpoch;
+  EXPECT_EQ(RunUntil(wheel, now, kEpoch + milliseconds(300)),
+            (std::vector<int>{1, 2, 3}));
+  EXPECT_EQ(a.fired_at, kEpoch + milliseconds(5));
+  EXPECT_EQ(b.fired_at, kEpoch + milliseconds(41))
+      << "a deadline between ticks rounds up, never fires early";
+  EXPECT_EQ(c.fired_at, kEpoch + milliseconds(200));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(a.scheduled());
+}
+
+TEST(TimerWheel, FarDeadlinesCascadeDownAndFireOnTime) {
+  TimerWheel wheel(kEpoch);
+  // one per outer level, each landing off any slot boundary
+  const milliseconds delays[] = {milliseconds(1000), milliseconds(70000),
+                                 milliseconds(3 * 3600 * 1000 + 1234)};
+  Timer timers[3];
+  for (int i = 0; i < 3; i++) {
+    timers[i].id = i;
+    wheel.Schedule(timers[i], kEpoch + delays[i]);
+  }
+  auto now = kEpoch;
+  // a real worker sleeps to NextExpiry(); do the same to get there quickly
+  std::vector<int> order;
+  while (!wheel.empty()) {
+    const auto next = wheel.NextExpiry();
+    ASSERT_GT(next, now);
+    now = next;
+    wheel.Advance(now, [&](TimerWheel::Node& node) {
+      auto& timer = static_cast<Timer&>(node);
+      timer.fired_at = now;
+      order.push_back(timer.id);
+    });
+  }
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(timers[i].fired_at, kEpoch + delays[i]) << "timer " << i;
+  }
+}
+
+TEST(TimerWheel, CancelAndRescheduleMoveADeadline) {
+  TimerWheel wheel(kEpoch);
+  Timer kept, cancelled, moved;
+  kept.id = 1;
+  cancelled.id = 2;
+  moved.id = 3;
+  wheel.Schedule(kept, kEpoch + milliseconds(10));
+  wheel.Schedule(cancelled, kEpoch + milliseconds(10));
+  wheel.Schedule(moved, kEpoch + milliseconds(10));
+  wheel.Cancel(cancelled);
+  wheel.Cancel(cancelled);  // twice is harmless
+  wheel.Schedule(moved, kEpoch + milliseconds(500));
+  EXPECT_EQ(wheel.size(), 2u);
+
+  auto now = kEpoch;
+  EXPECT_EQ(RunUntil(wheel, now, kEpoch + milliseconds(100)),
+            (std::vector<int>{1}));
+  EXPECT_EQ(RunUntil(wheel, now, kEpoch + milliseconds(600)),
+            (std::vector<int>{3}));
+  EXPECT_EQ(moved.fired_at, kEpoch + milliseconds(500));
+}
+
+TEST(TimerWheel, APastDeadlineFiresOnTheNextAdvance) {
+  TimerWheel wheel(kEpoch);
+  auto now = kEpoch + milliseconds(50);
+  wheel.Advance(now, [](TimerWheel::Node&) {});
+  Timer late;
+  late.id = 7;
+  wheel.Schedule(late, kEpoch);
+  EXPECT_EQ(RunUntil(wheel, now, now + milliseconds(1)),
+            (std::vector<int>{7}));
+}
+
+TEST(TimerWheel, AFiredTimerCanArmItselfAgain) {
+  TimerWheel wheel(kEpoch);
+  Timer periodic;
+  wheel.Schedule(periodic, kEpoch + milliseconds(100));
+  auto now = kEpoch;
+  int fires = 0;
+  while (now < kEpoch + seconds(1)) {
+    now += milliseconds(1);
+    wheel.Advance(now, [&](TimerWheel::Node& node) {
+      fires++;
+      wheel.Schedule(node, now + milliseconds(100));
+    });
+  }
+  EXPECT_EQ(fires, 10);
+  EXPECT_TRUE(periodic.scheduled());
+  wheel.Cancel(periodic);
+}
+
+TEST(TimerWheel, NextExpiryIsExactNearAndNeverLateFar) {
+  TimerWheel wheel(kEpoch);
+  EXPECT_EQ(wheel.NextExpiry(), TimerWheel::TimePoint::max());
+  Timer near, far;
+  wheel.Schedule(far, kEpoch + seconds(30));
+  EXPECT_LE(wheel.NextExpiry(), kEpoch + seconds(30));
+  EXPECT_GT(wheel.NextExpiry(), kEpoch);
+  wheel.Schedule(near, kEpoch + milliseconds(120));
+  EXPECT_EQ(wheel.NextExpiry(), kEpoch + milliseconds(120));
+  wheel.Cancel(near);
+  wheel.Cancel(far);
+}
+
+TEST(TimerWheel, AnEmptyWheelSkipsAheadAtOnce) {
+  TimerWheel wheel(kEpoch);
+  // a worker idle for a day advances in one step, not a million
+  EXPECT_EQ(wheel.Advance(kEpoch + hours(24), [](TimerWheel::Node&) {}), 0u);
+  Timer next;
+  next.id = 1;
+  wheel.Schedule(next, kEpoch + hours(24) + milliseconds(3));
+  EXPECT_EQ(wheel.NextExpiry(), kEpoch + hours(24) + milliseconds(3));
+  auto now = kEpoch + hours(24);
+  EXPECT_EQ(RunUntil(wheel, now, now + milliseconds(5)),
+            (std::vector<int>{1}));
+}
@@ -0,0 +1,711 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// The server's worker pool as WorkerOptions shapes it, seen from the thread
+// a session's handler runs on and from ServerMetrics::workers: how many
+// there are, when elastic ones start, where pinned ones run, sessions
+// arriving at a busy one or moving off it, sharing its tick under a budget,
+// and finding them again by id.
+// Over ConnectionType::InProcess, so no socket or port gets in the way.
+//
+
+#include "znet/client.h"
+#include "znet/client_events.h"
+#include "znet/init.h"
+#include "znet/packet.h"
+#include "znet/packet_handler.h"
+#include "znet/packet_serializer.h"
+#include "znet/server.h"
+#include "znet/server_events.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace znet;
+
+namespace {
+
+enum WorkerPacketType : PacketId { kPacketHello = 1 };
+
+class HelloPacket : public Packet {
+ public:
+  HelloPacket() : Packet(kPacketHello) {}
+};
+
+class HelloSerializer : public PacketSerializer<HelloPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(std::shared_ptr<HelloPacket>,
+                                         std::shared_ptr<Buffer> buffer) override {
+    return buffer;
+  }
+  std::shared_ptr<HelloPacket> DeserializeTyped(std::shared_ptr<Buffer>) override {
+    return std::make_shared<HelloPacket>();
+  }
+};
+
+std::shared_ptr<Codec> MakeHelloCodec() {
+  auto codec = std::make_shared<Codec>();
+  codec->Add(kPacketHello, std::make_unique<HelloSerializer>());
+  return codec;
+}
+
+// Where each server-side handler ran: the worker's thread, and what that
+// thread was allowed to run on.
+struct Sightings {
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::vector<size_t> allowed_cpus;
+  int hellos = 0;
+};
+
+class RecordWorker : public PacketHandler<RecordWorker, HelloPacket> {
+ public:
+  explicit RecordWorker(Sightings* sightings) : sightings_(sightings) {}
+  void OnPacket(std::shared_ptr<HelloPacket>) {
+    std::lock_guard<std::mutex> lock(sightings_->mutex);
+    sightings_->threads.insert(std::this_thread::get_id());
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      sightings_->allowed_cpus.push_back(
+          static_cast<size_t>(CPU_COUNT(&set)));
+    }
+#endif
+    sightings_->hellos++;
+  }
+
+ private:
+  Sightings* sightings_;
+};
+
+// Connects `clients` sessions one at a time, each saying hello once, and
+// waits for every hello to reach the server.
+void ConnectAndGreet(const std::string& address, WorkerOptions workers,
+                     int clients, Sightings& sightings) {
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig server_config{address, 0, std::chrono::seconds(5),
+                             ConnectionType::InProcess};
+  server_config.options.workers = std::move(workers);
+  Server server{server_config};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeHelloCodec());
+          ev.session()->SetHandler(std::make_shared<RecordWorker>(&sightings));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  std::vector<std::unique_ptr<Client>> connected;
+  for (int i = 0; i < clients; i++) {
+    ClientConfig client_config{address, 0, std::chrono::seconds(5),
+                               ConnectionType::InProcess};
+    auto client = std::unique_ptr<Client>(new Client{client_config});
+    client->SetEventCallback([](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<ClientConnectedToServerEvent>(
+          [](ClientConnectedToServerEvent& ev) {
+            ev.session()->SetCodec(MakeHelloCodec());
+            ev.session()->SendPacket(std::make_shared<HelloPacket>());
+            return false;
+          });
+    });
+    ASSERT_EQ(client->Bind(), Result::Success);
+    ASSERT_EQ(client->Connect(), Result::Success);
+    // one at a time, so each lands after the last is counted on its worker
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+      {
+        std::lock_guard<std::mutex> lock(sightings.mutex);
+        if (sightings.hellos > i) {
+          break;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    connected.push_back(std::move(client));
+  }
+
+  for (auto& client : connected) {
+    client->Disconnect();
+  }
+  server.Stop();
+  for (auto& client : connected) {
+    client->Wait();
+  }
+  server.Wait();
+}
+
+}  // namespace
+
+TEST(WorkerPool, SessionsSpreadOverTheConfiguredWorkers) {
+  WorkerOptions workers;
+  workers.count = 3;
+  Sightings sightings;
+  ConnectAndGreet("unix:/znet-test/workers-fixed", workers, 6, sightings);
+  EXPECT_EQ(sightings.hellos, 6);
+  EXPECT_EQ(sightings.threads.size(), 3u)
+      << "each new session goes to the emptiest of the three";
+}
+
+TEST(WorkerPool, ElasticStartsWorkersOnlyAsSessionsNeedThem) {
+  WorkerOptions workers;
+  workers.count = 8;
+  workers.elastic = true;
+  workers.elastic_threshold = 2;
+  Sightings sightings;
+  ConnectAndGreet("unix:/znet-test/workers-elastic", workers, 5, sightings);
+  EXPECT_EQ(sightings.hellos, 5);
+  EXPECT_EQ(sightings.threads.size(), 3u)
+      << "two sessions each on the first two, the fifth on a third";
+}
+
+#if defined(__linux__)
+TEST(WorkerPool, PinnedWorkersRunOnTheirCpuAlone) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  uint32_t cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) {
+    cpu++;
+  }
+  WorkerOptions workers;
+  workers.cpus = {cpu};
+  Sightings sightings;
+  ConnectAndGreet("unix:/znet-test/workers-pinned", workers, 2, sightings);
+  EXPECT_EQ(sightings.threads.size(), 1u)
+      << "one CPU named and no count given, so one worker";
+  ASSERT_EQ(sightings.allowed_cpus.size(), 2u);
+  EXPECT_EQ(sightings.allowed_cpus[0], 1u);
+  EXPECT_EQ(sightings.allowed_cpus[1], 1u);
+}
+#endif
+
+namespace {
+
+// Burns `spin` of its worker's time on every hello, and notes the thread.
+class CostlyHandler : public PacketHandler<CostlyHandler, HelloPacket> {
+ public:
+  CostlyHandler(Sightings* sightings, std::chrono::microseconds spin)
+      : sightings_(sightings), spin_(spin) {}
+  void OnPacket(std::shared_ptr<HelloPacket>) {
+    const auto until = std::chrono::steady_clock::now() + spin_;
+    while (std::chrono::steady_clock::now() < until) {
+    }
+    std::lock_guard<std::mutex> lock(sightings_->mutex);
+    sightings_->threads.insert(std::this_thread::get_id());
+    sightings_->hellos++;
+  }
+
+ private:
+  Sightings* sightings_;
+  std::chrono::microseconds spin_;
+};
+
+// A client's side of a greeting the server starts: each hello is answered
+// with one.
+class AnswerHello : public PacketHandler<AnswerHello, HelloPacket> {
+ public:
+  // the session owns this handler, so it outlives it
+  explicit AnswerHello(PeerSession* session) : session_(session) {}
+  void OnPacket(std::shared_ptr<HelloPacket>) {
+    session_->SendPacket(std::make_shared<HelloPacket>());
+  }
+
+ private:
+  PeerSession* session_;
+};
+
+}  // namespace
+
+TEST(WorkerPool, ABusyWorkerHandsSessionsToAnIdleOne) {
+  ASSERT_EQ(Init(), Result::Success);
+  const std::string address = "unix:/znet-test/workers-rebalance";
+  ServerConfig server_config{address, 0, std::chrono::seconds(5),
+                             ConnectionType::InProcess};
+  server_config.options.workers.count = 2;
+  server_config.options.workers.rebalance_interval =
+      std::chrono::milliseconds(200);
+  Server server{server_config};
+  // one Sightings per client, so each session's threads can be told apart
+  Sightings sightings[4];
+  std::atomic<int> accepted{0};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          const int index = accepted++;
+          ev.session()->SetCodec(MakeHelloCodec());
+          ev.session()->SetHandler(std::make_shared<CostlyHandler>(
+              &sightings[index], std::chrono::microseconds(400)));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  // placed one at a time on the emptiest worker: 0 and 2 share one, 1 and 3
+  // the other
+  std::unique_ptr<Client> clients[4];
+  std::shared_ptr<PeerSession> sessions[4];
+  std::mutex sessions_mutex;
+  for (int i = 0; i < 4; i++) {
+    ClientConfig client_config{address, 0, std::chrono::seconds(5),
+                               ConnectionType::InProcess};
+    clients[i] = std::unique_ptr<Client>(new Client{client_config});
+    clients[i]->SetEventCallback([&, i](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<ClientConnectedToServerEvent>(
+          [&, i](ClientConnectedToServerEvent& ev) {
+            ev.session()->SetCodec(MakeHelloCodec());
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            sessions[i] = ev.session();
+            return false;
+          });
+    });
+    ASSERT_EQ(clients[i]->Bind(), Result::Success);
+    ASSERT_EQ(clients[i]->Connect(), Result::Success);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (accepted.load() <= i && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_GT(accepted.load(), i);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  // the second worker is left with nothing, the first with two busy sessions
+  clients[1]->Disconnect();
+  clients[3]->Disconnect();
+  clients[1]->Wait();
+  clients[3]->Wait();
+
+  std::shared_ptr<PeerSession> busy[2];
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    busy[0] = sessions[0];
+    busy[1] = sessions[2];
+  }
+  ASSERT_TRUE(busy[0] && busy[1]);
+  // every hello each busy session got out, so the counts can be waited for
+  // rather than read while some are still on their way
+  int sent[2] = {0, 0};
+  auto greet = [&]() {
+    for (int i = 0; i < 2; i++) {
+      if (busy[i]->SendPacket(std::make_shared<HelloPacket>()) ==
+          Result::Success) {
+        sent[i]++;
+      }
+    }
+  };
+  auto wait_for_hellos = [&]() {
+    const auto greeted_by =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < greeted_by) {
+      bool all = true;
+      for (int i = 0; i < 2; i++) {
+        std::lock_guard<std::mutex> lock(sightings[i * 2].mutex);
+        all = all && sightings[i * 2].hellos >= sent[i];
+      }
+      if (all) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  };
+  bool moved = false;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!moved && std::chrono::steady_clock::now() < deadline) {
+    greet();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    const ServerMetrics metrics = server.metrics();
+    ASSERT_EQ(metrics.workers.size(), 2u);
+    moved = metrics.workers[0].sessions_moved_out +
+                metrics.workers[1].sessions_moved_out >
+            0;
+  }
+  ASSERT_TRUE(moved) << "two busy sessions on one worker, none on the other";
+  const ServerMetrics metrics = server.metrics();
+  EXPECT_EQ(metrics.workers[0].sessions, 1u);
+  EXPECT_EQ(metrics.workers[1].sessions, 1u);
+  EXPECT_GT(metrics.workers[0].busy_us, 0u);
+  EXPECT_GT(metrics.workers[1].busy_us, 0u);
+
+  // and the moved session carries on, on its new worker. The hellos sent
+  // while it moved are let in first, so the 20 below are counted on their own
+  wait_for_hellos();
+  int before[2];
+  for (int i = 0; i < 2; i++) {
+    std::lock_guard<std::mutex> lock(sightings[i * 2].mutex);
+    before[i] = sightings[i * 2].hellos;
+    ASSERT_EQ(before[i], sent[i]) << "a hello was lost while its session moved";
+  }
+  for (int n = 0; n < 20; n++) {
+    greet();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  ASSERT_EQ(sent[0], before[0] + 20);
+  ASSERT_EQ(sent[1], before[1] + 20);
+  wait_for_hellos();
+  std::set<std::thread::id> threads;
+  for (int i = 0; i < 2; i++) {
+    std::lock_guard<std::mutex> lock(sightings[i * 2].mutex);
+    EXPECT_EQ(sightings[i * 2].hellos, before[i] + 20);
+    threads.insert(sightings[i * 2].threads.begin(),
+                   sightings[i * 2].threads.end());
+  }
+  EXPECT_EQ(threads.size(), 2u);
+
+  clients[0]->Disconnect();
+  clients[2]->Disconnect();
+  server.Stop();
+  clients[0]->Wait();
+  clients[2]->Wait();
+  server.Wait();
+}
+
+TEST(WorkerPool, ABurstOfArrivalsIsCountedUntilEachSessionLeaves) {
+  ASSERT_EQ(Init(), Result::Success);
+  const std::string address = "unix:/znet-test/workers-burst";
+  ServerConfig server_config{address, 0, std::chrono::seconds(5),
+                             ConnectionType::InProcess};
+  server_config.options.workers.count = 1;
+  Server server{server_config};
+  // the first session's handler holds the worker for a while, so the rest
+  // arrive while it is mid-tick. The server greets first and counts the
+  // answers, so every hello it counts was sent once its handler was in place.
+  Sightings sightings;
+  std::atomic<int> accepted{0};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          const bool first = accepted++ == 0;
+          ev.session()->SetCodec(MakeHelloCodec());
+          ev.session()->SetHandler(std::make_shared<CostlyHandler>(
+              &sightings, std::chrono::microseconds(first ? 1000000 : 0)));
+          ev.session()->SendPacket(std::make_shared<HelloPacket>());
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  constexpr int kClients = 30;
+  std::vector<std::unique_ptr<Client>> clients;
+  for (int i = 0; i < kClients; i++) {
+    ClientConfig client_config{address, 0, std::chrono::seconds(5),
+                               ConnectionType::InProcess};
+    auto client = std::unique_ptr<Client>(new Client{client_config});
+    client->SetEventCallback([](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<ClientConnectedToServerEvent>(
+          [](ClientConnectedToServerEvent& ev) {
+            ev.session()->SetCodec(MakeHelloCodec());
+            ev.session()->SetHandler(
+                std::make_shared<AnswerHello>(ev.session().get()));
+            return false;
+          });
+    });
+    ASSERT_EQ(client->Bind(), Result::Success);
+    ASSERT_EQ(client->Connect(), Result::Success);
+    clients.push_back(std::move(client));
+    if (i == 0) {
+      // until the first hello is being handled, and the worker with it
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (accepted.load() == 0 &&
+             std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }
+  }
+  // the acceptor places every one without waiting for the worker's tick
+  const auto placed_by = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while ((accepted.load() < kClients ||
+          server.metrics().workers[0].sessions < static_cast<size_t>(kClients)) &&
+         std::chrono::steady_clock::now() < placed_by) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  EXPECT_EQ(accepted.load(), kClients);
+  EXPECT_EQ(server.metrics().workers[0].sessions,
+            static_cast<size_t>(kClients))
+      << "counted from the moment each is handed in, not once the worker "
+         "takes it on";
+  {
+    std::lock_guard<std::mutex> lock(sightings.mutex);
+    EXPECT_LT(sightings.hellos, kClients) << "the worker is still busy";
+  }
+
+  const auto greeted_by = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < greeted_by) {
+    {
+      std::lock_guard<std::mutex> lock(sightings.mutex);
+      if (sightings.hellos == kClients) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  {
+    std::lock_guard<std::mutex> lock(sightings.mutex);
+    EXPECT_EQ(sightings.hellos, kClients);
+  }
+
+  for (auto& client : clients) {
+    client->Disconnect();
+  }
+  for (auto& client : clients) {
+    client->Wait();
+  }
+  const auto released_by = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (server.metrics().workers[0].sessions != 0 &&
+         std::chrono::steady_clock::now() < released_by) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  EXPECT_EQ(server.metrics().workers[0].sessions, 0u);
+  server.Stop();
+  server.Wait();
+}
+
+TEST(WorkerPool, FindSessionReachesEachSessionUntilItLeaves) {
+  ASSERT_EQ(Init(), Result::Success);
+  const std::string address = "unix:/znet-test/workers-find";
+  ServerConfig server_config{address, 0, std::chrono::seconds(5),
+                             ConnectionType::InProcess};
+  server_config.options.workers.count = 2;
+  Server server{server_config};
+  std::mutex mutex;
+  std::vector<SessionId> ids;
+  std::vector<SessionId> gone;
+  bool found_in_event = true;
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          std::lock_guard<std::mutex> lock(mutex);
+          found_in_event = found_in_event &&
+                           server.FindSession(ev.session()->id()) == ev.session();
+          ids.push_back(ev.session()->id());
+          return false;
+        });
+    dispatcher.Dispatch<IncomingClientDisconnectedEvent>(
+        [&](IncomingClientDisconnectedEvent& ev) {
+          std::lock_guard<std::mutex> lock(mutex);
+          gone.push_back(ev.session()->id());
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  constexpr size_t kClients = 4;
+  std::vector<std::unique_ptr<Client>> clients;
+  for (size_t i = 0; i < kClients; i++) {
+    ClientConfig client_config{address, 0, std::chrono::seconds(5),
+                               ConnectionType::InProcess};
+    clients.push_back(std::unique_ptr<Client>(new Client{client_config}));
+    clients.back()->SetEventCallback([](Event&) {});
+    ASSERT_EQ(clients.back()->Bind(), Result::Success);
+    ASSERT_EQ(clients.back()->Connect(), Result::Success);
+  }
+  auto wait_for = [&](const std::vector<SessionId>& list, size_t count) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (list.size() >= count) {
+          return;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  };
+  wait_for(ids, kClients);
+  std::vector<SessionId> connected;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(ids.size(), kClients);
+    EXPECT_TRUE(found_in_event) << "listed before the connect event";
+    connected = ids;
+  }
+  for (SessionId id : connected) {
+    auto session = server.FindSession(id);
+    ASSERT_NE(session, nullptr) << id;
+    EXPECT_EQ(session->id(), id);
+  }
+  EXPECT_EQ(server.FindSession(0), nullptr);
+
+  clients[0]->Disconnect();
+  clients[0]->Wait();
+  wait_for(gone, 1);
+  SessionId left;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(gone.size(), 1u);
+    left = gone[0];
+  }
+  EXPECT_EQ(server.FindSession(left), nullptr);
+  size_t still_found = 0;
+  for (SessionId id : connected) {
+    still_found += server.FindSession(id) != nullptr ? 1 : 0;
+  }
+  EXPECT_EQ(still_found, kClients - 1);
+
+  for (size_t i = 1; i < kClients; i++) {
+    clients[i]->Disconnect();
+  }
+  server.Stop();
+  for (size_t i = 1; i < kClients; i++) {
+    clients[i]->Wait();
+  }
+  server.Wait();
+}
+
+namespace {
+
+// Notes how many of another session's hellos had been handled when this
+// session's first one was.
+class OvertakeHandler : public PacketHandler<OvertakeHandler, HelloPacket> {
+ public:
+  OvertakeHandler(Sightings* other, std::atomic<int>* seen_at)
+      : other_(other), seen_at_(seen_at) {}
+  void OnPacket(std::shared_ptr<HelloPacket>) {
+    std::lock_guard<std::mutex> lock(other_->mutex);
+    int expected = -1;
+    seen_at_->compare_exchange_strong(expected, other_->hellos);
+  }
+
+ private:
+  Sightings* other_;
+  std::atomic<int>* seen_at_;
+};
+
+}  // namespace
+
+TEST(WorkerPool, ATickBudgetLetsACheapSessionOvertakeACostlyBacklog) {
+  ASSERT_EQ(Init(), Result::Success);
+  const std::string address = "unix:/znet-test/workers-budget";
+  ServerConfig server_config{address, 0, std::chrono::seconds(5),
+                             ConnectionType::InProcess};
+  server_config.options.workers.count = 1;
+  server_config.options.workers.tick_budget = std::chrono::milliseconds(2);
+  Server server{server_config};
+  Sightings costly;
+  std::atomic<int> seen_at{-1};
+  std::atomic<int> accepted{0};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          ev.session()->SetCodec(MakeHelloCodec());
+          if (accepted++ == 0) {
+            ev.session()->SetHandler(std::make_shared<CostlyHandler>(
+                &costly, std::chrono::microseconds(500)));
+          } else {
+            ev.session()->SetHandler(
+                std::make_shared<OvertakeHandler>(&costly, &seen_at));
+          }
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  std::unique_ptr<Client> clients[2];
+  std::shared_ptr<PeerSession> sessions[2];
+  std::mutex sessions_mutex;
+  for (int i = 0; i < 2; i++) {
+    ClientConfig client_config{address, 0, std::chrono::seconds(5),
+                               ConnectionType::InProcess};
+    clients[i] = std::unique_ptr<Client>(new Client{client_config});
+    clients[i]->SetEventCallback([&, i](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<ClientConnectedToServerEvent>(
+          [&, i](ClientConnectedToServerEvent& ev) {
+            ev.session()->SetCodec(MakeHelloCodec());
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            sessions[i] = ev.session();
+            return false;
+          });
+    });
+    ASSERT_EQ(clients[i]->Bind(), Result::Success);
+    ASSERT_EQ(clients[i]->Connect(), Result::Success);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (accepted.load() <= i && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_GT(accepted.load(), i);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::shared_ptr<PeerSession> costly_session;
+  std::shared_ptr<PeerSession> cheap_session;
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    costly_session = sessions[0];
+    cheap_session = sessions[1];
+  }
+  ASSERT_TRUE(costly_session && cheap_session);
+
+  // 100 ms of handler time, all of it queued before the cheap hello. Without
+  // a budget the worker would deliver the lot in one Process() call.
+  constexpr int kBacklog = 200;
+  for (int i = 0; i < kBacklog; i++) {
+    costly_session->SendPacket(std::make_shared<HelloPacket>());
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  cheap_session->SendPacket(std::make_shared<HelloPacket>());
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (std::chrono::steady_clock::now() < deadline) {
+    {
+      std::lock_guard<std::mutex> lock(costly.mutex);
+      if (costly.hellos == kBacklog) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  {
+    std::lock_guard<std::mutex> lock(costly.mutex);
+    EXPECT_EQ(costly.hellos, kBacklog);
+  }
+  ASSERT_GE(seen_at.load(), 0) << "the cheap hello never arrived";
+  EXPECT_LT(seen_at.load(), kBacklog / 2)
+      << "the cheap session waited out most of the costly one's backlog";
+  const ServerMetrics metrics = server.metrics();
+  ASSERT_EQ(metrics.workers.size(), 1u);
+  EXPECT_GT(metrics.workers[0].sessions_deferred, 0u);
+
+  for (auto& client : clients) {
+    client->Disconnect();
+  }
+  server.Stop();
+  for (auto& client : clients) {
+    client->Wait();
+  }
+  server.Wait();
+}
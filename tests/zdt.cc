@@ -415,6 +415,29 @@ static CommonOptions QuietCommon() {
   return common;
 }
 
+// Drives both ends until the server has `count` messages or 15 s pass, and
+// returns the leading T of each in the order it arrived.
+template <typename T>
+static std::vector<T> DeliverAll(ZDTTransportLayer& client,
+                                 UDPSocket& client_socket,
+                                 ZDTTransportLayer& server,
+                                 UDPSocket& server_socket, size_t count) {
+  std::vector<T> received;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+  while (received.size() < count &&
+         std::chrono::steady_clock::now() < deadline) {
+    client.Update();
+    Pump(server_socket, server);
+    server.Update();
+    Pump(client_socket, client);
+    while (auto buffer = server.Receive()) {
+      received.push_back(buffer->ReadInt<T>());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return received;
+}
+
 // Zero means disabled, per the CommonOptions contract. It used to mean
 // "expired before the first tick", which closed the connection instantly.
 TEST(ZDTTimers, ZeroDisablesIdleAndKeepalive) {
@@ -461,6 +484,63 @@ TEST(ZDTUdpSocket, Loopback) {
   ASSERT_TRUE(from && from->is_valid());
 }
 
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+// Two sockets share one port; the one connect()ed to a peer gets that peer's
+// datagrams and the other gets everyone else's.
+TEST(ZDTUdpSocket, ConnectedSocketTakesOnlyItsPeer) {
+  ASSERT_EQ(Init(), Result::Success);
+
+  UDPSocket shared;
+  ASSERT_EQ(shared.Open(InetProtocolVersion::IPv4), Result::Success);
+  shared.SetBlocking(false);
+  ASSERT_TRUE(shared.SetReusePort(true));
+  ASSERT_EQ(shared.Bind(*InetAddress::from("127.0.0.1", 0)), Result::Success);
+  auto port_addr = shared.local_address();
+
+  UDPSocket peer;
+  UDPSocket other;
+  for (UDPSocket* socket : {&peer, &other}) {
+    ASSERT_EQ(socket->Open(InetProtocolVersion::IPv4), Result::Success);
+    socket->SetBlocking(false);
+    ASSERT_EQ(socket->Bind(*InetAddress::from("127.0.0.1", 0)),
+              Result::Success);
+  }
+
+  UDPSocket connected;
+  ASSERT_EQ(connected.Open(InetProtocolVersion::IPv4), Result::Success);
+  connected.SetBlocking(false);
+  ASSERT_TRUE(connected.SetReusePort(true));
+  ASSERT_EQ(connected.Bind(*port_addr), Result::Success);
+  ASSERT_EQ(connected.Connect(peer.local_address()), Result::Success);
+  connected.DiscardQueued();
+
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(peer.SendTo(*port_addr, "peer", 4));
+    ASSERT_TRUE(other.SendTo(*port_addr, "else", 4));
+  }
+
+  uint8_t buf[64];
+  size_t len = 0;
+  std::shared_ptr<InetAddress> from;
+  for (int i = 0; i < 8; i++) {
+    ASSERT_EQ(RecvWithRetry(connected, buf, sizeof(buf), len, from),
+              RecvResult::Received);
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(buf), len), "peer");
+    ASSERT_TRUE(from);
+    EXPECT_TRUE(*from == *peer.local_address());
+    ASSERT_EQ(RecvWithRetry(shared, buf, sizeof(buf), len, from),
+              RecvResult::Received);
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(buf), len), "else");
+  }
+
+  // and sends with no address go to the peer
+  ASSERT_TRUE(connected.SendTo(*port_addr, "back", 4));
+  ASSERT_EQ(RecvWithRetry(peer, buf, sizeof(buf), len, from),
+            RecvResult::Received);
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(buf), len), "back");
+}
+#endif  // ZNET_HAS_ZDT_CONNECTED_SOCKETS
+
 // --- Transport data path ------------------------------------------------------
 
 // The session crypto scopes its message sequence and its replay window to
@@ -720,6 +800,127 @@ TEST(ZDTIntegration, RejectsIncompatibleVersion) {
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
 
+// The handshake as the client's loop drives it: nothing in it waits, so a
+// caller that never gets a reply sees each resend fall due on its own clock,
+// one rung at a time, and then a timeout.
+TEST(ZDTClientHandshakeTest, WalksTheLadderThenTimesOut) {
+  ASSERT_EQ(Init(), Result::Success);
+  auto sink = OpenBoundSocket();
+  auto client = OpenBoundSocket();
+  ZDTOptions config;
+  config.mtu_ladder.Set({1200, 576});
+  config.handshake_retries_per_rung = 3;
+  ZDTClientHandshake handshake(client, sink->local_address(), config, 7);
+
+  auto now = std::chrono::steady_clock::now();
+  handshake.Start(now);
+  EXPECT_EQ(handshake.state(), ZDTClientHandshake::State::Probing);
+  EXPECT_EQ(handshake.deadline(), now + config.handshake_retransmit);
+  handshake.Poll(now);  // not due yet, so nothing goes out
+  for (int i = 0; i < 10 && !handshake.finished(); i++) {
+    now += config.handshake_retransmit;
+    handshake.Poll(now);
+  }
+  EXPECT_EQ(handshake.state(), ZDTClientHandshake::State::Failed);
+  EXPECT_EQ(handshake.result(), Result::Timeout);
+  EXPECT_EQ(handshake.deadline(), std::chrono::steady_clock::time_point::max());
+
+  // three probes padded to each rung, largest first
+  std::vector<size_t> sizes;
+  uint8_t buf[ZNET_MAX_BUFFER_SIZE];
+  size_t len = 0;
+  std::shared_ptr<InetAddress> from;
+  while (RecvWithRetry(*sink, buf, sizeof(buf), len, from) ==
+         RecvResult::Received) {
+    sizes.push_back(len);
+    if (sizes.size() == 6) {
+      break;
+    }
+  }
+  ASSERT_EQ(sizes.size(), 6u);
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(sizes[i], ZDTPayloadForLinkMTU(1200, InetProtocolVersion::IPv4));
+    EXPECT_EQ(sizes[3 + i],
+              ZDTPayloadForLinkMTU(576, InetProtocolVersion::IPv4));
+  }
+}
+
+TEST(ZDTClientHandshakeTest, ReachesDoneAgainstARealServer) {
+  ASSERT_EQ(Init(), Result::Success);
+  PortNumber port = FreeUdpPort();
+  ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(5),
+                             ConnectionType::ZDT};
+  Server server{server_config};
+  server.SetEventCallback([](Event&) {});
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  auto client = OpenBoundSocket();
+  ZDTClientHandshake handshake(client, InetAddress::from("127.0.0.1", port),
+                               ZDTOptions{}, 42);
+  handshake.Start(std::chrono::steady_clock::now());
+  Buffer reply(Endianness::BigEndian);
+  reply.ReserveExact(ZNET_MAX_BUFFER_SIZE);
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!handshake.finished() && std::chrono::steady_clock::now() < deadline) {
+    reply.Reset();
+    size_t len = 0;
+    std::shared_ptr<InetAddress> from;
+    if (client->RecvFrom(reply.write_cursor_data(), reply.writable_bytes(), len,
+                         from) == RecvResult::Received) {
+      reply.CommitWrite(len);
+      handshake.OnDatagram(reply, std::chrono::steady_clock::now());
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    handshake.Poll(std::chrono::steady_clock::now());
+  }
+  ASSERT_EQ(handshake.state(), ZDTClientHandshake::State::Done);
+  EXPECT_EQ(handshake.result(), Result::Success);
+  EXPECT_GT(handshake.connection().mtu, 0);
+  EXPECT_EQ(handshake.connection().local_guid, 42u);
+  EXPECT_NE(handshake.connection().remote_guid, 0u);
+
+  server.Stop();
+  server.Wait();
+}
+
+// Connect() no longer waits on the handshake: against a port nobody answers
+// it returns at once, and the failure arrives as an event once the client's
+// loop gives up.
+TEST(ZDTIntegration, ConnectReturnsBeforeTheHandshakeSettles) {
+  ASSERT_EQ(Init(), Result::Success);
+  auto silent = OpenBoundSocket();  // bound, so nothing answers with an ICMP
+  ClientConfig config{"127.0.0.1", silent->local_address()->port(),
+                      std::chrono::milliseconds(500), ConnectionType::ZDT};
+  Client client{config};
+  std::atomic_bool failed{false};
+  std::atomic_bool connected{false};
+  client.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<ClientConnectionFailedEvent>(
+        [&](ClientConnectionFailedEvent&) {
+          failed = true;
+          return false;
+        });
+    dispatcher.Dispatch<ClientConnectedToServerEvent>(
+        [&](ClientConnectedToServerEvent&) {
+          connected = true;
+          return false;
+        });
+  });
+  ASSERT_EQ(client.Bind(), Result::Success);
+  const auto started = std::chrono::steady_clock::now();
+  ASSERT_EQ(client.Connect(), Result::Success);
+  EXPECT_LT(std::chrono::steady_clock::now() - started,
+            ZDTOptions{}.handshake_retransmit)
+      << "Connect() sat out a handshake resend";
+  client.Wait();
+  EXPECT_TRUE(failed);
+  EXPECT_FALSE(connected);
+}
+
 // --- Reliability under packet loss --------------------------------------------
 
 TEST(ZDTReliability, ReliableOrderedDeliversInOrderUnderLoss) {
@@ -913,6 +1114,216 @@ TEST(ZDTReliability, BulkBacklogDoesNotDelayAnotherChannel) {
   }
 }
 
+// Queues `count` messages of `bytes` on each of two channels, first all of
+// `first` then all of `second`, behind a window far smaller than either
+// backlog, and returns the channel of each message in the order it arrived.
+static std::vector<uint8_t> ArrivalOrderOfTwoBacklogs(SendOptions first,
+                                                      size_t first_bytes,
+                                                      SendOptions second,
+                                                      size_t second_bytes,
+                                                      uint32_t count) {
+  auto server_socket = OpenBoundSocket();
+  auto client_socket = OpenBoundSocket();
+  auto server_addr = server_socket->local_address();
+  auto client_addr = client_socket->local_address();
+
+  ZDTOptions config = FastConfig();
+  config.max_messages_in_flight = 8;
+
+  ZDTConnection connection;
+  ZDTTransportLayer client(client_socket, server_addr, config, false, nullptr,
+                           connection, QuietCommon());
+  ZDTTransportLayer server(server_socket, client_addr, config, false, nullptr,
+                           connection, QuietCommon());
+
+  for (const auto& lane : {std::make_pair(first, first_bytes),
+                           std::make_pair(second, second_bytes)}) {
+    const std::vector<char> pad(lane.second - 1, 'p');
+    for (uint32_t i = 0; i < count; i++) {
+      auto payload = std::make_shared<Buffer>();
+      payload->WriteInt<uint8_t>(lane.first.GetOr<ChannelKey>(0));
+      payload->Write(pad.data(), pad.size());
+      EXPECT_TRUE(client.Send(payload, lane.first));
+    }
+  }
+
+  return DeliverAll<uint8_t>(client, *client_socket, server, *server_socket,
+                             2 * count);
+}
+
+// How many of `channel`'s messages had arrived when `other` delivered its last.
+static uint32_t CountBeforeLastOf(const std::vector<uint8_t>& arrivals,
+                                  uint8_t channel, uint8_t other) {
+  uint32_t seen = 0;
+  uint32_t at_last = 0;
+  for (uint8_t arrived : arrivals) {
+    if (arrived == channel) {
+      seen++;
+    } else if (arrived == other) {
+      at_last = seen;
+    }
+  }
+  return at_last;
+}
+
+// Two channels backlogged behind one window share it by PriorityKey: at 7 the
+// urgent channel moves eight times the bytes of the one at 0, so it is through
+// its backlog while the other has sent a fraction of its own. Taking turns
+// would have finished the two together.
+TEST(ZDTReliability, BackloggedChannelsShareTheWindowByPriority) {
+  ASSERT_EQ(Init(), Result::Success);
+  const uint32_t kEach = 160;
+  auto arrivals = ArrivalOrderOfTwoBacklogs(SendOptions().Channel(1), 997,
+                                            SendOptions().Channel(2).Priority(7),
+                                            997, kEach);
+  ASSERT_EQ(std::count(arrivals.begin(), arrivals.end(), 2), kEach);
+  ASSERT_EQ(std::count(arrivals.begin(), arrivals.end(), 1), kEach)
+      << "the bulk channel must not be starved";
+  // about kEach / 8 at an exact share; the bound leaves room for the window's
+  // granularity, and taking turns would have sat at kEach
+  EXPECT_LT(CountBeforeLastOf(arrivals, 1, 2), kEach / 3)
+      << "the urgent channel did not get the larger share of the window";
+}
+
+// At equal priority the share is even whatever the sizes: a channel whose
+// messages are a few bytes larger than the bulk's still takes turns with it.
+// It used to wait out the whole bulk backlog, its tag recomputed from a clock
+// the bulk kept moving.
+TEST(ZDTReliability, EqualPrioritiesShareTheWindowWhateverTheSizes) {
+  ASSERT_EQ(Init(), Result::Success);
+  const uint32_t kEach = 160;
+  auto arrivals = ArrivalOrderOfTwoBacklogs(
+      SendOptions().Channel(1), 997, SendOptions().Channel(2), 1005, kEach);
+  ASSERT_EQ(arrivals.size(), 2u * kEach);
+  EXPECT_GT(CountBeforeLastOf(arrivals, 2, 1), kEach * 3 / 4)
+      << "the larger messages waited behind the bulk instead of taking turns";
+}
+
+// Unreliable updates queued behind a shut window under one CoalesceKey go out
+// as the newest alone, in the oldest's place. Stale snapshots used to be sent
+// one after another once the window opened, each already out of date.
+TEST(ZDTReliability, QueuedUpdatesUnderOneCoalesceKeySendOnlyTheNewest) {
+  ASSERT_EQ(Init(), Result::Success);
+
+  auto server_socket = OpenBoundSocket();
+  auto client_socket = OpenBoundSocket();
+  auto server_addr = server_socket->local_address();
+  auto client_addr = client_socket->local_address();
+
+  ZDTOptions config = FastConfig();
+  config.max_messages_in_flight = 8;
+
+  ZDTConnection connection;
+  ZDTTransportLayer client(client_socket, server_addr, config, false, nullptr,
+                           connection, QuietCommon());
+  ZDTTransportLayer server(server_socket, client_addr, config, false, nullptr,
+                           connection, QuietCommon());
+
+  // a reliable backlog on the channel holds the window, and so the updates
+  // queued behind it, shut
+  const uint32_t kBacklog = 40;
+  for (uint32_t i = 0; i < kBacklog; i++) {
+    auto payload = std::make_shared<Buffer>();
+    payload->WriteInt<uint32_t>(i);
+    ASSERT_TRUE(client.Send(payload, SendOptions().Channel(1)));
+  }
+  client.Update();
+
+  const SendOptions kUpdate = SendOptions().Reliable(false).Channel(1);
+  const uint32_t kUpdates = 50;
+  for (uint32_t i = 0; i < kUpdates; i++) {
+    auto payload = std::make_shared<Buffer>();
+    payload->WriteInt<uint32_t>(1000 + i);
+    ASSERT_TRUE(client.Send(payload, kUpdate.Coalesce(7)));
+    client.Update();  // staged one at a time, as a real sender's would be
+  }
+  // neither another key nor the same key on another channel is replaced
+  auto other_key = std::make_shared<Buffer>();
+  other_key->WriteInt<uint32_t>(2000);
+  ASSERT_TRUE(client.Send(other_key, kUpdate.Coalesce(8)));
+  auto other_channel = std::make_shared<Buffer>();
+  other_channel->WriteInt<uint32_t>(3000);
+  ASSERT_TRUE(client.Send(other_channel,
+                          SendOptions().Reliable(false).Channel(2).Coalesce(7)));
+
+  auto received = DeliverAll<uint32_t>(client, *client_socket, server,
+                                       *server_socket, kBacklog + 3);
+  ASSERT_EQ(received.size(), kBacklog + 3);
+  // nothing more is on its way: give a straggler the chance to show
+  for (int i = 0; i < 20; i++) {
+    client.Update();
+    Pump(*server_socket, server);
+    EXPECT_EQ(server.Receive(), nullptr) << "a superseded update was sent";
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  EXPECT_EQ(std::count(received.begin(), received.end(), 1000 + kUpdates - 1), 1)
+      << "the newest update never arrived";
+  EXPECT_EQ(std::count_if(received.begin(), received.end(),
+                          [](uint32_t value) { return value >= 1000 && value < 2000; }),
+            1)
+      << "stale updates were sent alongside the newest";
+  EXPECT_EQ(std::count(received.begin(), received.end(), 2000u), 1);
+  EXPECT_EQ(std::count(received.begin(), received.end(), 3000u), 1);
+
+  SessionMetrics metrics;
+  client.FillMetrics(metrics);
+  EXPECT_EQ(metrics.zdt.messages_superseded, kUpdates - 1);
+}
+
+// An unreliable message still queued past its DeadlineKey is dropped, not
+// sent late; one within its deadline, or without one, still goes.
+TEST(ZDTReliability, QueuedUnreliablePastItsDeadlineIsDropped) {
+  ASSERT_EQ(Init(), Result::Success);
+
+  auto server_socket = OpenBoundSocket();
+  auto client_socket = OpenBoundSocket();
+  auto server_addr = server_socket->local_address();
+  auto client_addr = client_socket->local_address();
+
+  ZDTOptions config = FastConfig();
+  config.max_messages_in_flight = 8;
+
+  ZDTConnection connection;
+  ZDTTransportLayer client(client_socket, server_addr, config, false, nullptr,
+                           connection, QuietCommon());
+  ZDTTransportLayer server(server_socket, client_addr, config, false, nullptr,
+                           connection, QuietCommon());
+
+  const uint32_t kBacklog = 40;
+  for (uint32_t i = 0; i < kBacklog; i++) {
+    auto payload = std::make_shared<Buffer>();
+    payload->WriteInt<uint32_t>(i);
+    ASSERT_TRUE(client.Send(payload, SendOptions().Channel(1)));
+  }
+  const SendOptions kUpdate = SendOptions().Reliable(false).Channel(1);
+  auto stale = std::make_shared<Buffer>();
+  stale->WriteInt<uint32_t>(1000);
+  ASSERT_TRUE(client.Send(stale, kUpdate.Deadline(std::chrono::milliseconds(5))));
+  auto fresh = std::make_shared<Buffer>();
+  fresh->WriteInt<uint32_t>(1001);
+  ASSERT_TRUE(client.Send(fresh, kUpdate.Deadline(std::chrono::seconds(30))));
+  auto patient = std::make_shared<Buffer>();
+  patient->WriteInt<uint32_t>(1002);
+  ASSERT_TRUE(client.Send(patient, kUpdate));
+  // the window takes the first few and holds the rest, the updates among them,
+  // until well past the short deadline
+  client.Update();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  auto received = DeliverAll<uint32_t>(client, *client_socket, server,
+                                       *server_socket, kBacklog + 2);
+  ASSERT_EQ(received.size(), kBacklog + 2);
+  EXPECT_EQ(std::count(received.begin(), received.end(), 1000u), 0)
+      << "the update was sent past its deadline";
+  EXPECT_EQ(std::count(received.begin(), received.end(), 1001u), 1);
+  EXPECT_EQ(std::count(received.begin(), received.end(), 1002u), 1);
+
+  SessionMetrics metrics;
+  client.FillMetrics(metrics);
+  EXPECT_EQ(metrics.zdt.messages_expired, 1u);
+}
+
 // A lost burst tail is invisible to the NAK path: nothing arrives after it, so
 // the receiver cannot see a gap to report, and the sender's window may be shut
 // so it cannot expose one by sending new data. Before the tail-loss probe the
@@ -1285,6 +1696,16 @@ TEST(ZDTOptionsPlumbing, ChildOptionsReachTheSession) {
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
 
+TEST(ZDTOptionsPlumbing, IoUringIsRefusedNotIgnored) {
+  ASSERT_EQ(Init(), Result::Success);
+  ServerConfig server_config{"127.0.0.1", FreeUdpPort(),
+                             std::chrono::seconds(5), ConnectionType::ZDT};
+  server_config.options.io_backend = IoBackend::IoUring;
+  Server server{server_config};
+  EXPECT_EQ(server.Bind(), Result::InvalidBackend);
+  EXPECT_EQ(server.Listen(), Result::InvalidBackend);
+}
+
 TEST(ZDTOptionsPlumbing, DefaultsMatchZDTOptions) {
   ZDTOptions defaults;
   EXPECT_EQ(defaults.max_messages_in_flight, 4096);
@@ -1611,6 +2032,89 @@ TEST(ZDTIntegration, AppPacketRoundTripOverUdp) {
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
 
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+// Several clients at once, so the kernel has more than one peer to tell apart
+// on the server's port.
+TEST(ZDTIntegration, AppPacketRoundTripOverConnectedSockets) {
+  ASSERT_EQ(Init(), Result::Success);
+  PortNumber port = FreeUdpPort();
+
+  ServerConfig server_config{"127.0.0.1", port, std::chrono::seconds(5),
+                             ConnectionType::ZDT};
+  server_config.child_options.zdt.connected_sockets = true;
+  Server server{server_config};
+  server.SetEventCallback([&](Event& event) {
+    EventDispatcher dispatcher{event};
+    dispatcher.Dispatch<IncomingClientConnectedEvent>(
+        [&](IncomingClientConnectedEvent& ev) {
+          auto codec = std::make_shared<Codec>();
+          codec->Add(kPacketDemo, std::make_unique<DemoSerializer>());
+          ev.session()->SetCodec(codec);
+          ev.session()->SetHandler(
+              std::make_shared<ServerEchoHandler>(ev.session()));
+          return false;
+        });
+  });
+  ASSERT_EQ(server.Bind(), Result::Success);
+  ASSERT_EQ(server.Listen(), Result::Success);
+
+  constexpr int kClients = 4;
+  RoundTripState states[kClients];
+  std::vector<std::unique_ptr<Client>> clients;
+  for (int i = 0; i < kClients; i++) {
+    ClientConfig client_config{"127.0.0.1", port, std::chrono::seconds(5),
+                               ConnectionType::ZDT};
+    clients.push_back(std::make_unique<Client>(client_config));
+    RoundTripState* state = &states[i];
+    const std::string text = "hello" + std::to_string(i);
+    clients.back()->SetEventCallback([state, text](Event& event) {
+      EventDispatcher dispatcher{event};
+      dispatcher.Dispatch<ClientConnectedToServerEvent>(
+          [state, text](ClientConnectedToServerEvent& ev) {
+            auto codec = std::make_shared<Codec>();
+            codec->Add(kPacketDemo, std::make_unique<DemoSerializer>());
+            ev.session()->SetCodec(codec);
+            ev.session()->SetHandler(
+                std::make_shared<ClientReplyHandler>(state));
+            auto packet = std::make_shared<DemoPacket>();
+            packet->text = text;
+            ev.session()->SendPacket(packet);
+            return false;
+          });
+    });
+    ASSERT_EQ(clients.back()->Bind(), Result::Success);
+    ASSERT_EQ(clients.back()->Connect(), Result::Success);
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  auto all_replied = [&]() {
+    for (auto& state : states) {
+      if (!state.got_reply) {
+        return false;
+      }
+    }
+    return true;
+  };
+  while (!all_replied() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  for (int i = 0; i < kClients; i++) {
+    EXPECT_TRUE(states[i].got_reply.load()) << "client " << i;
+    EXPECT_EQ(states[i].reply_text, "reply:hello" + std::to_string(i));
+  }
+#if ZNET_ENABLE_METRICS
+  EXPECT_EQ(server.metrics().zdt.connected_sockets_failed, 0u)
+      << "every session should have had a socket of its own";
+#endif
+
+  for (auto& client : clients) {
+    client->Disconnect();
+  }
+  server.Stop();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+#endif  // ZNET_HAS_ZDT_CONNECTED_SOCKETS
+
 // --- Full channel matrix (M4) -------------------------------------------------
 
 // reliable + unordered: every message arrives exactly once (dedup on retransmit),
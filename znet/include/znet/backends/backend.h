@@ -11,9 +11,11 @@
 #ifndef ZNET_BACKENDS_BACKEND_H_
 #define ZNET_BACKENDS_BACKEND_H_
 
+#include "znet/manual_poller.h"
 #include "znet/metrics.h"
 #include "znet/options.h"
 #include "znet/peer_session.h"
+#include "znet/worker_io.h"
 
 namespace znet {
 namespace backends {
@@ -73,6 +75,32 @@ class ClientBackend {
   virtual void WaitReadable(std::chrono::milliseconds timeout) {
     (void)timeout;
   }
+
+  /**
+   * @brief Has the backend report through `poller` instead of any thread of
+   *        its own, for DriveMode::Manual. Called before Connect().
+   *
+   * @return false when it cannot do without one, which is the default.
+   */
+  virtual bool DriveManually(std::shared_ptr<ManualPoller> poller) {
+    (void)poller;
+    return false;
+  }
+
+  /**
+   * @brief Under DriveManually(), whatever the poller's readiness leaves
+   *        to settle before the session is processed. Never blocks.
+   */
+  virtual void Pump() {}
+
+  /**
+   * @brief What this backend's descriptors are added to the poller under, so
+   *        ManualPoller::Wait() can say whose they are. Set before Connect().
+   */
+  void SetPollTag(void* tag) { poll_tag_ = tag; }
+
+ protected:
+  void* poll_tag_ = nullptr;
 };
 
 class ServerBackend {
@@ -122,6 +150,32 @@ class ServerBackend {
    * it. Idempotent, and a no-op for backends without their own thread.
    */
   virtual void StopReceiving() {}
+
+  /**
+   * @brief The I/O one server worker sleeps on, for a backend that does its
+   *        sessions' reading and writing itself; null leaves the worker its
+   *        usual sleep. Called once per worker, at server construction.
+   */
+  virtual std::shared_ptr<WorkerIo> CreateWorkerIo() { return nullptr; }
+
+  /**
+   * @brief Has the backend put what its receive thread would watch into
+   *        `poller`, and start no thread, for DriveMode::Manual. Called
+   *        before Listen().
+   *
+   * @return false when it cannot do without one, which is the default.
+   */
+  virtual bool DriveManually(std::shared_ptr<ManualPoller> poller) {
+    (void)poller;
+    return false;
+  }
+
+  /**
+   * @brief Under DriveManually(), one non-blocking round of what the
+   *        receive thread would have done: the wake callback and the
+   *        sessions' ready hooks fire from here, on the caller's thread.
+   */
+  virtual void Pump() {}
 };
 
 std::unique_ptr<ClientBackend> CreateClientFromType(
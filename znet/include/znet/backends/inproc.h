@@ -0,0 +1,289 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Sessions between a client and a server in the same process. A connection is
+// two lock-free queues of encoded messages, one per direction, and nothing
+// else: no socket, no copy, no system call on the way. What a session costs
+// over one of these is znet's own work, the codec, compression, the cipher and
+// the session's queues, which is what makes it the transport to measure that
+// with. It is also a deterministic stand-in for a network in tests that want
+// the whole stack without the kernel in the loop.
+//
+// Servers are found by the address they were bound to, as text, in a table
+// this process keeps; no port is ever opened. A client connecting to an
+// address nothing in the process listens on fails at once.
+//
+// A side's loop is woken, through the same callback a backend's receive
+// thread would use, when a message lands on a queue it had emptied or when it
+// stopped with messages still queued and the peer sends again. A reader that
+// keeps up therefore costs its writer no wakeup at all.
+//
+
+#ifndef ZNET_BACKENDS_INPROC_H_
+#define ZNET_BACKENDS_INPROC_H_
+
+#include "znet/backends/backend.h"
+#include "znet/mpsc_queue.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace znet {
+namespace backends {
+
+/**
+ * @brief Both directions of one in-process connection. Shared by the two
+ *        transports, so whichever is destroyed last frees it.
+ */
+class InProcessLink {
+ public:
+  /** @brief One direction: written by one side's transport, read by the
+   *         other's. */
+  struct Direction {
+    explicit Direction(size_t capacity) : queue(capacity) {}
+
+    MpscQueue<std::shared_ptr<Buffer>> queue;
+    /** @brief Set by the writer once it will push nothing more. */
+    std::atomic_bool closed{false};
+    /** @brief Set by a reader that stopped with messages still queued; the
+     *         writer's next push wakes it again. */
+    std::atomic_bool reader_behind{false};
+    /** @brief Set by a writer that found the queue full; the reader's next
+     *         pop wakes it. */
+    std::atomic_bool writer_blocked{false};
+  };
+
+  explicit InProcessLink(size_t capacity)
+      : to_accepting(capacity), to_connecting(capacity) {}
+
+  InProcessLink(const InProcessLink&) = delete;
+  InProcessLink& operator=(const InProcessLink&) = delete;
+
+  Direction to_accepting;
+  Direction to_connecting;
+
+  /**
+   * @brief Installs what wakes one side's loop; an empty function disarms it.
+   *
+   * Waits out a wake already running, so once it returns nothing reaches
+   * the old callback again.
+   */
+  void SetWake(bool accepting, std::function<void()> wake);
+
+  /** @brief Runs the side's wake callback, if it has one. */
+  void Wake(bool accepting);
+
+ private:
+  // held across the call, which is what makes SetWake() a barrier
+  std::mutex wake_mutex_;
+  std::function<void()> wake_connecting_;
+  std::function<void()> wake_accepting_;
+};
+
+class InProcessTransportLayer : public TransportLayer {
+ public:
+  /**
+   * @param link      the connection this is one end of.
+   * @param accepting which end: the accepting side reads to_accepting and
+   *                  writes to_connecting.
+   * @param wake      what the peer calls to wake this side's loop. Disarmed
+   *                  when the transport is destroyed.
+   */
+  InProcessTransportLayer(std::shared_ptr<InProcessLink> link, bool accepting,
+                          std::function<void()> wake,
+                          InProcessOptions inproc = InProcessOptions());
+  ~InProcessTransportLayer() override;
+
+  std::shared_ptr<Buffer> Receive() override;
+  bool Send(std::shared_ptr<Buffer> buffer, SendOptions options = {}) override;
+
+  Result Close(CloseOptions options = {}) override;
+
+  bool IsClosed() const override {
+    return is_closed_.load(std::memory_order_acquire);
+  }
+
+  void Update() override;
+
+  void Flush() override;
+
+  void FillMetrics(SessionMetrics& out) const override;
+
+  /** @brief Replaces the wake the transport was built with, so the peer's
+   *         sends reach this session alone. */
+  bool SetReadyCallback(std::function<void()> ready) override;
+
+  /** @brief Now while anything is queued either way, else never: the link
+   *         has no timers. */
+  std::chrono::steady_clock::time_point NextDeadline() override;
+
+ private:
+  /**
+   * @brief Pushes one message to the peer and wakes it if it had drained
+   *        its queue or asked to be. False when the queue is full.
+   */
+  bool Offer(const std::shared_ptr<Buffer>& buffer);
+
+  /** @brief Pushes the backlog until the queue fills. Caller holds
+   *         write_mutex_. */
+  void WritePending();
+
+  void WakePeer();
+
+  std::shared_ptr<InProcessLink> link_;
+  bool accepting_;
+  InProcessLink::Direction& inbound_;
+  InProcessLink::Direction& outbound_;
+  std::atomic_bool is_closed_{false};
+  // serializes writers of the backlog: the encoder thread sends while the
+  // worker flushes. Pushes to the queue itself need no lock.
+  std::mutex write_mutex_;
+  std::deque<std::shared_ptr<Buffer>> pending_;
+  // bytes in pending_, atomic for FillMetrics()
+  std::atomic<size_t> pending_bytes_{0};
+  size_t send_high_water_;
+#if ZNET_ENABLE_METRICS
+  std::atomic<uint64_t> wire_bytes_sent_{0};
+  uint64_t wire_bytes_received_ = 0;  // the reader's thread only
+  std::atomic<uint64_t> wakeups_sent_{0};
+  std::atomic<uint64_t> queue_full_{0};
+#endif
+};
+
+class InProcessServerBackend;
+
+class InProcessClientBackend : public ClientBackend {
+ public:
+  explicit InProcessClientBackend(std::shared_ptr<InetAddress> server_address,
+                                  const SessionOptions& options = {});
+  ~InProcessClientBackend() override;
+  InProcessClientBackend(const InProcessClientBackend&) = delete;
+
+  /** @brief Nothing to bind: takes a made-up loopback address to be known
+   *         by, unique in this process. */
+  Result Bind() override;
+  /** @brief Same as Bind(); there is no socket to put anywhere. */
+  Result Bind(const std::string& ip, PortNumber port) override;
+
+  /** @brief Hands a new link to the server listening on the address, or
+   *         fails at once when none does. */
+  Result Connect() override;
+  Result Close() override;
+
+  void Update() override {}
+
+  bool IsAlive() override;
+
+  std::shared_ptr<PeerSession> client_session() override {
+    return client_session_;
+  }
+
+  std::shared_ptr<InetAddress> local_address() override {
+    return local_address_;
+  }
+
+  void ReleaseSession() override {
+    if (client_session_ && !client_session_->IsAlive()) {
+      client_session_ = nullptr;
+    }
+  }
+
+  void SetWakeCallback(std::function<void()> on_data) override {
+    on_data_ = std::move(on_data);
+  }
+
+  /** @brief The server's sends wake the loop, so it can sleep out its
+   *         tick. */
+  bool DrivesOwnReceive() const override { return true; }
+
+ private:
+  SessionOptions options_;
+  std::shared_ptr<InetAddress> server_address_;
+  std::shared_ptr<InetAddress> local_address_;
+  std::shared_ptr<PeerSession> client_session_;
+  std::function<void()> on_data_;
+};
+
+/**
+ * @brief Listens on a name in this process's table of in-process servers.
+ *
+ * The bound address is only that name: any host and port, or a `unix:` path,
+ * none of which is opened. Port zero takes a made-up one. The allow and deny
+ * lists do not apply, since every connection comes from this process.
+ */
+class InProcessServerBackend : public ServerBackend {
+ public:
+  explicit InProcessServerBackend(std::shared_ptr<InetAddress> bind_address,
+                                  const SessionOptions& child_options = {},
+                                  const ServerOptions& server_options = {});
+  ~InProcessServerBackend() override;
+  InProcessServerBackend(const InProcessServerBackend&) = delete;
+
+  Result Bind() override;
+  Result Listen() override;
+  Result Close() override;
+
+  void Update() override {}
+
+  std::shared_ptr<PeerSession> Accept() override;
+  void AcceptAndReject() override;
+
+  bool IsAlive() override { return listening_.load(); }
+
+  std::shared_ptr<InetAddress> bind_address() const override {
+    return bind_address_;
+  }
+
+  void SetWakeCallback(std::function<void()> on_data) override {
+    on_data_ = std::move(on_data);
+  }
+
+  /** @brief Disarms the wake callback on every link handed out, so a client
+   *         sending after the server is gone reaches nothing of it. */
+  void StopReceiving() override;
+
+ private:
+  friend class InProcessClientBackend;
+
+  // a connection waiting for Accept()
+  struct Offered {
+    std::shared_ptr<InProcessLink> link;
+    std::shared_ptr<InetAddress> remote_address;
+  };
+
+  /** @brief Queues a client's link for Accept(). Called under the table's
+   *         lock, which keeps this backend alive for the call. */
+  std::shared_ptr<InProcessLink> Offer(std::shared_ptr<InetAddress> remote);
+
+  /** @brief Unregisters from the table; after it returns no client can
+   *         reach this backend. */
+  void Unregister();
+
+  std::shared_ptr<InetAddress> bind_address_;
+  SessionOptions child_options_;
+  std::function<void()> on_data_;
+  std::atomic_bool listening_{false};
+  bool registered_ = false;
+  std::mutex offered_mutex_;
+  std::deque<Offered> offered_;
+  // every link accepted, to disarm in StopReceiving()
+  std::vector<std::weak_ptr<InProcessLink>> accepted_;
+  bool stopped_ = false;  // guarded by offered_mutex_
+};
+
+}  // namespace backends
+}  // namespace znet
+
+#endif  // ZNET_BACKENDS_INPROC_H_
@@ -0,0 +1,255 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Sessions between processes on one host, over memory they share. The server
+// listens on a `unix:` path like a TCP server there would, and answers each
+// connection with a memfd holding two rings, one per direction, and an
+// eventfd for each side. From then on messages never touch the socket: a send
+// copies into the peer's ring and a receive copies out of its own. An eventfd
+// is only written when its side went to sleep on an empty or full ring, so a
+// pair that keeps up with each other crosses no system call at all.
+//
+// The socket stays open for the life of the session. Nothing is sent on it
+// after the rendezvous; it is there to be read at the keepalive interval,
+// which tells a peer that exited from one that is only quiet.
+//
+
+#ifndef ZNET_BACKENDS_SHM_H_
+#define ZNET_BACKENDS_SHM_H_
+
+#include "znet/backends/backend.h"
+#include "znet/backends/tcp.h"
+#include "znet/detail/shm_ring.h"
+
+#if ZNET_HAS_SHARED_MEMORY
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace znet {
+namespace backends {
+
+/**
+ * @brief What the rendezvous leaves a side holding. Owned by the transport
+ *        it is handed to, which releases all of it.
+ */
+struct SharedMemoryChannel {
+  /** @brief The rendezvous socket, kept to notice the peer exiting. */
+  SocketHandle socket = kSocketInvalid;
+  /** @brief The mapping of both rings, and its length. */
+  void* region = nullptr;
+  size_t region_size = 0;
+  /** @brief Data bytes in each ring. */
+  size_t ring_bytes = 0;
+  /** @brief Written to wake this side, and to wake the peer. */
+  int wake_self = -1;
+  int wake_peer = -1;
+  /** @brief The accepting side writes the first ring and reads the second;
+   *         the connecting side the other way round. */
+  bool accepting = false;
+};
+
+/**
+ * @brief The accepting half of the rendezvous: creates rings of at least
+ *        `ring_bytes` each and both eventfds, and sends them down `socket`.
+ *
+ * @return false, having released all of it, if the peer could not be
+ *         handed them. `socket` is left to the caller either way.
+ */
+bool OfferChannel(SocketHandle socket, size_t ring_bytes,
+                  SharedMemoryChannel* out);
+
+/**
+ * @brief The connecting half: waits up to `timeout` for what OfferChannel()
+ *        sends down `socket`, checks it, and maps the rings.
+ */
+bool JoinChannel(SocketHandle socket, std::chrono::milliseconds timeout,
+                 SharedMemoryChannel* out);
+
+class SharedMemoryTransportLayer : public TransportLayer {
+ public:
+  SharedMemoryTransportLayer(SharedMemoryChannel channel,
+                             CommonOptions common = CommonOptions(),
+                             SharedMemoryOptions shm = SharedMemoryOptions());
+  ~SharedMemoryTransportLayer() override;
+
+  /** @brief The reactor's hook on this side's eventfd; see
+   *         TCPTransportLayer::SetReadyWatch(). */
+  void SetReadyWatch(std::shared_ptr<ReadyWatch> ready) {
+    ready_ = std::move(ready);
+  }
+
+  std::shared_ptr<Buffer> Receive() override;
+  bool Send(std::shared_ptr<Buffer> buffer, SendOptions options = {}) override;
+
+  Result Close(CloseOptions options = {}) override;
+
+  bool IsClosed() const override {
+    return is_closed_.load(std::memory_order_acquire);
+  }
+
+  void Update() override;
+
+  void Flush() override;
+
+  // write_mutex_ makes this side the ring's one writer whichever thread sends
+  bool FlushIsThreadSafe() const override { return true; }
+
+  void FillMetrics(SessionMetrics& out) const override;
+
+  bool SetReadyCallback(std::function<void()> ready) override;
+
+  /** @brief The next liveness check, or now while a backlog waits for room
+   *         or the ring holds more than the last Receive() took. */
+  std::chrono::steady_clock::time_point NextDeadline() override;
+
+ private:
+  // the top bit of a record's prefix marks a fragment with more of its
+  // message in the next record
+  static constexpr uint32_t kMoreFragments = 0x80000000u;
+
+  // one message, or what is left of it, waiting for room in the ring
+  struct PendingMessage {
+    std::shared_ptr<Buffer> buffer;
+    size_t offset = 0;  // past the read cursor, already in the ring
+  };
+
+  /**
+   * @brief Writes queued messages into the peer's ring until it fills, and
+   *        wakes the peer if it was asleep. Caller holds write_mutex_.
+   */
+  void WritePending();
+
+  /** @brief Adds one to an eventfd, for the thread waiting on it. */
+  void Signal(int wake);
+
+  std::shared_ptr<Buffer> Reassemble(uint32_t size, bool last);
+
+  SharedMemoryChannel channel_;
+  detail::ShmRing inbound_;
+  detail::ShmRing outbound_;
+  // the largest record body; anything larger crosses as fragments
+  size_t max_record_;
+  std::atomic_bool is_closed_{false};
+  // touched only by the worker
+  std::chrono::milliseconds liveness_interval_;
+  std::chrono::steady_clock::time_point last_liveness_check_;
+  std::shared_ptr<Buffer> reassembly_;
+  bool reassembling_ = false;
+  size_t max_reassembly_bytes_;
+  // the last Receive() handed up a message rather than finding the ring
+  // empty. Atomic because a thread-safe Flush() reads it.
+  std::atomic_bool unread_{false};
+  // serializes writers of outbound_: the encoder thread sends while the
+  // worker flushes. pending_ is guarded by it too.
+  std::mutex write_mutex_;
+  std::deque<PendingMessage> pending_;
+  // unsent bytes in pending_, atomic for FillMetrics()
+  std::atomic<size_t> pending_bytes_{0};
+  size_t send_high_water_;
+  std::shared_ptr<ReadyWatch> ready_;
+#if ZNET_ENABLE_METRICS
+  SessionMetrics metrics_;
+#endif
+};
+
+class SharedMemoryClientBackend : public ClientBackend {
+ public:
+  explicit SharedMemoryClientBackend(
+      std::shared_ptr<InetAddress> server_address,
+      const SessionOptions& options = {});
+  ~SharedMemoryClientBackend() override;
+  SharedMemoryClientBackend(const SharedMemoryClientBackend&) = delete;
+
+  Result Bind() override;
+  /** @brief There is no local address to take: the rendezvous socket is
+   *         unnamed. Same as Bind(). */
+  Result Bind(const std::string& ip, PortNumber port) override;
+
+  /**
+   * @brief Connects to the server's path and maps the rings it hands back.
+   *        Waits for them for CommonOptions::idle_timeout, or a second when
+   *        that is zero.
+   */
+  Result Connect() override;
+  Result Close() override;
+
+  void Update() override {}
+
+  bool IsAlive() override;
+
+  /** @brief Sleeps on this side's eventfd. */
+  void WaitReadable(std::chrono::milliseconds timeout) override;
+
+  /** @brief The eventfd joins `poller` once Connect() maps the rings. */
+  bool DriveManually(std::shared_ptr<ManualPoller> poller) override {
+    poller_ = std::move(poller);
+    return true;
+  }
+
+  /** @brief Re-arms the eventfd, which the poller only watches. */
+  void Pump() override { WaitReadable(std::chrono::milliseconds(0)); }
+
+  std::shared_ptr<PeerSession> client_session() override {
+    return client_session_;
+  }
+
+  std::shared_ptr<InetAddress> local_address() override {
+    return local_address_;
+  }
+
+  void ReleaseSession() override {
+    if (client_session_ && !client_session_->IsAlive()) {
+      client_session_ = nullptr;
+    }
+  }
+
+ private:
+  SessionOptions options_;
+  std::shared_ptr<InetAddress> server_address_;
+  std::shared_ptr<InetAddress> local_address_;
+  std::shared_ptr<PeerSession> client_session_;
+  SocketHandle client_socket_ = kSocketInvalid;
+  // non-owning copy of the session's wake_self; the transport closes it
+  int wait_fd_ = -1;
+  std::shared_ptr<ManualPoller> poller_;
+};
+
+/**
+ * @brief Accepts on a `unix:` path as TCPServerBackend does, then hands each
+ *        connection its rings instead of framing the socket.
+ *
+ * The poll thread watches each session's eventfd rather than its socket.
+ * Sessions take SharedMemoryOptions::encryption in place of
+ * CommonOptions::encryption.
+ */
+class SharedMemoryServerBackend : public TCPServerBackend {
+ public:
+  explicit SharedMemoryServerBackend(std::shared_ptr<InetAddress> bind_address,
+                                     const SessionOptions& child_options = {},
+                                     const ServerOptions& server_options = {});
+
+ protected:
+  std::unique_ptr<TransportLayer> CreateTransport(SocketHandle socket) override;
+
+  ConnectionType connection_type() const override {
+    return ConnectionType::SharedMemory;
+  }
+};
+
+}  // namespace backends
+}  // namespace znet
+
+#endif  // ZNET_HAS_SHARED_MEMORY
+
+#endif  // ZNET_BACKENDS_SHM_H_
@@ -15,27 +15,103 @@
 #include "znet/backends/backend.h"
 #include "znet/buffer.h"
 #include "znet/compat.h"
+#include "znet/detail/sys_net.h"
 #include "znet/options.h"
 #include "znet/peer_session.h"
 
+#include <atomic>
 #include <deque>
+#include <functional>
 #include <mutex>
+#include <vector>
 
 namespace znet {
 namespace backends {
 
+/**
+ * @brief A reactor's line to the session behind one descriptor: the poll
+ *        thread fires it when the descriptor turns ready, and the session's
+ *        transport arms it once a worker owns the session.
+ */
+class ReadyWatch {
+ public:
+  /** @brief Installs what Fire() calls. Once, before anything fires it. */
+  void Arm(std::function<void()> ready) {
+    ready_ = std::move(ready);
+    armed_.store(true, std::memory_order_release);
+  }
+
+  /**
+   * @brief Calls the armed callback. Poll thread, or an io_uring worker.
+   *
+   * @return false when nothing armed it yet, as while the session is still
+   *         handshaking; the caller falls back to waking every worker.
+   */
+  bool Fire() {
+    if (!armed_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    ready_();
+    return true;
+  }
+
+ private:
+  std::function<void()> ready_;
+  std::atomic_bool armed_{false};
+};
+
 class TCPTransportLayer : public TransportLayer {
  public:
-  // `common` carries the keepalive knobs; the default matches CommonOptions
-  // so call sites without a SessionOptions in hand behave like a default
-  // session
+  // `common` carries the keepalive knobs and `tcp` the backlog bound; the
+  // defaults match the option structs, so call sites without a SessionOptions
+  // in hand behave like a default session
   TCPTransportLayer(SocketHandle socket,
-                    CommonOptions common = CommonOptions());
+                    CommonOptions common = CommonOptions(),
+                    TCPOptions tcp = TCPOptions());
   ~TCPTransportLayer() override;
 
+  /**
+   * @brief Shares the flag a reactor watches to learn this socket has a
+   *        backlog, and so should wake a worker once it turns writable.
+   *
+   * Set before the transport reaches a session. Without one, a backlog
+   * still drains, only at the pace of the worker's own flushes.
+   */
+  void SetWritableWatch(std::shared_ptr<std::atomic_bool> want_writable) {
+    want_writable_ = std::move(want_writable);
+  }
+
+  /**
+   * @brief Shares the hook the reactor fires when this socket turns
+   *        readable, writable with a backlog, or hung up. Set before the
+   *        transport reaches a session, like SetWritableWatch(). Without one,
+   *        SetReadyCallback() reports the transport can not tell.
+   */
+  void SetReadyWatch(std::shared_ptr<ReadyWatch> ready) {
+    ready_ = std::move(ready);
+  }
+
   std::shared_ptr<Buffer> Receive() override;
   bool Send(std::shared_ptr<Buffer> buffer, SendOptions options = {}) override;
 
+  /**
+   * @brief Queues `head` behind a run header, and the file span behind it for
+   *        one sendfile() to write, where the platform has it. Otherwise the
+   *        default's copy.
+   *
+   * A run is not cut into frames, so a chunk of any size up to
+   * FileFrameLimit() costs the header's share of a gathered send and a single
+   * sendfile(), where frames would have interleaved a prefix every few KiB.
+   */
+  bool SendFile(std::shared_ptr<Buffer> head,
+                const std::shared_ptr<detail::MappedFile>& file,
+                uint64_t position, size_t size,
+                SendOptions options = {}) override;
+
+  size_t FileFrameLimit() const override;
+
+  size_t CoalesceLimit() const override;
+
   Result Close(CloseOptions options = {}) override;
 
   bool IsClosed() const override { return is_closed_.load(std::memory_order_acquire); }
@@ -44,26 +120,150 @@ class TCPTransportLayer : public TransportLayer {
 
   void Flush() override;
 
+  // write_mutex_ already serializes the queue against the encoder's Send()s
+  bool FlushIsThreadSafe() const override { return true; }
+
   void FillMetrics(SessionMetrics& out) const override;
 
- private:
+  /** @brief Arms the reactor's watch on this socket, if it has one. */
+  bool SetReadyCallback(std::function<void()> ready) override;
+
+  /** @brief The idle timeout and keepalive, or now while a backlog or a
+   *         zerocopy send is outstanding. */
+  std::chrono::steady_clock::time_point NextDeadline() override;
+
+ protected:
   // control frames ride inside the stream as a zero length prefix followed by
   // one of these. A data frame's payload is never empty (Send refuses them),
   // so a zero length is unambiguous.
   static constexpr uint8_t kControlPing = 1;
   static constexpr uint8_t kControlPong = 2;
+  // a run: a big-endian uint32 length follows, then that many bytes making up
+  // one whole message, unframed. What lets a file span go out in a single
+  // sendfile(). The reader takes the body straight into the message's buffer
+  // rather than through recv_buffer_, so it is not bounded by that either.
+  static constexpr uint8_t kControlRun = 3;
+  static constexpr size_t kRunHeaderSize = 7;  // 0, 0, kControlRun, length
+  // the longest run SendFile() writes; well inside the reader's default
+  // max_reassembly_bytes, which a run answers to like any large message
+  static constexpr size_t kMaxRunLength = 1024u * 1024u;
+  // the top bit of a data frame's length marks a fragment with more of its
+  // message in the next data frame. A frame is bounded far below it, so the
+  // length keeps the other fifteen bits.
+  static constexpr uint16_t kMoreFragments = 0x8000;
+  static constexpr size_t kMaxFrameLength = 0x7FFF;
+  // frames handed to one gathered send. Well inside every platform's
+  // IOV_MAX, and past it the saving per syscall is already negligible.
+  static constexpr size_t kMaxGatherFrames = 64;
+
+  // one piece of the outgoing stream: a buffer's readable bytes, or a span
+  // of a file the kernel copies to the socket itself
+  struct PendingFrame {
+    PendingFrame() = default;
+    explicit PendingFrame(std::shared_ptr<Buffer> bytes)
+        : buffer(std::move(bytes)) {}
+
+    std::shared_ptr<Buffer> buffer;
+    std::shared_ptr<detail::MappedFile> file;
+    uint64_t file_offset = 0;  // within the file, not the mapping
+    size_t file_size = 0;
+    bool run_body = false;  // part of a run, whose header is the frame
+
+    size_t size() const {
+      return buffer ? buffer->readable_bytes() : file_size;
+    }
+  };
+
+  // the buffers of one MSG_ZEROCOPY send, kept until the kernel reports it
+  // done with their pages
+  struct ZeroCopySend {
+    uint32_t id;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+  };
 
   std::shared_ptr<Buffer> ReadBuffer();
 
+  /**
+   * @brief Reads up to `size` more bytes of the stream into `out`, as recv()
+   *        would: the count, 0 at the peer's close, or -1 with errno set.
+   *        Worker thread only.
+   */
+  virtual ssize_t ReadSome(char* out, size_t size);
+
+  /**
+   * @brief Releases the buffers of every zerocopy send the kernel has
+   *        reported done. Caller holds write_mutex_.
+   */
+  void ReapZeroCopy();
+
   void HandleControl(uint8_t type);
 
-  /** @brief Writes one control frame; a failure is left to the idle timer. */
+  /**
+   * @brief Writes one control frame, and whatever data is queued ahead of it,
+   *        as far as the socket takes them; a failure is left to the idle
+   *        timer.
+   */
   void SendControl(uint8_t type);
 
-  /** @brief Writes a whole framed message, looping over partial sends. */
-  bool WriteAll(Buffer& buffer);
+  /**
+   * @brief Writes the queued frames with as few gathered sends as it can,
+   *        stopping where the socket fills. Caller holds write_mutex_.
+   *
+   * Never waits: what the socket does not take stays queued, from whatever
+   * byte it stopped on, for the next call. Raises want_writable_ while
+   * anything is left.
+   *
+   * @return false if the socket failed, leaving the peer a torn frame.
+   */
+  virtual bool WritePending();
+
+  /**
+   * @brief Queues the frames of one message for the next Flush(), writing
+   *        the queue out early once it holds a full gather's worth.
+   *
+   * Data frames answer to send_high_water here, all of a message's fragments
+   * together; a control frame is three bytes and always admitted.
+   *
+   * @return false if the frames were refused, or the connection closed.
+   */
+  bool Enqueue(PendingFrame* frames, size_t count, bool control);
+
+  /**
+   * @brief Splits a message past one frame into fragments and queues them.
+   *        Costs a copy, which a message that fits a frame never pays.
+   */
+  bool SendFragmented(const Buffer& buffer);
+
+  /**
+   * @brief Appends one fragment to the message being reassembled.
+   *
+   * @return the whole message once `last` completes it, else null. Closes
+   *         the connection when the message outgrows max_reassembly_bytes.
+   */
+  std::shared_ptr<Buffer> Reassemble(const char* data, size_t size, bool last);
+
+  /**
+   * @brief Points reassembly_ at an empty buffer for the next message, the
+   *        last one's when the session has let go of it.
+   */
+  void StartReassembly();
+
+  /**
+   * @brief Starts reading a run of `length` bytes into reassembly_.
+   *
+   * @return false, having closed the connection, when the run could not have
+   *         been sent or outgrows max_reassembly_bytes.
+   */
+  bool StartRun(size_t length);
 
   Buffer recv_buffer_{Endianness::BigEndian};
+  // the message whose fragments are arriving. Kept between messages and
+  // reused once the session has let go of the last one, so a run of large
+  // messages grows one allocation instead of one per message
+  std::shared_ptr<Buffer> reassembly_;
+  bool reassembling_ = false;
+  // bytes of the current run still to come; they are read into reassembly_
+  size_t run_remaining_ = 0;
   SocketHandle socket_;
   // read by IsClosed() from whichever thread owns the application, written by
   // Close() from the same, so it cannot be a plain bool
@@ -78,6 +278,29 @@ class TCPTransportLayer : public TransportLayer {
   // both paths stamp it.
   std::mutex write_mutex_;
   std::chrono::steady_clock::time_point last_send_;
+  // framed messages waiting for the socket, oldest first, each already
+  // carrying its length prefix, and how much of the front one is already
+  // written. Guarded by write_mutex_ as well: the encoder thread queues while
+  // the worker flushes.
+  std::deque<PendingFrame> pending_;
+  size_t pending_offset_ = 0;
+  // unsent bytes in pending_. Written under write_mutex_, but atomic so
+  // FillMetrics() can sample it without the lock
+  std::atomic<size_t> pending_bytes_{0};
+  size_t send_high_water_;
+  SlowConsumerPolicy slow_consumer_;
+  size_t max_reassembly_bytes_;
+  // TCPOptions::zerocopy_threshold, or zero once the socket refused
+  // SO_ZEROCOPY or the kernel reported copying anyway. The rest is the
+  // zerocopy sends still in flight, oldest first, and the id the kernel gives
+  // the next. All guarded by write_mutex_.
+  size_t zerocopy_threshold_;
+  std::deque<ZeroCopySend> zerocopy_held_;
+  uint32_t zerocopy_next_id_ = 0;
+  // shared with the backend's reactor; see SetWritableWatch()
+  std::shared_ptr<std::atomic_bool> want_writable_;
+  // and see SetReadyWatch()
+  std::shared_ptr<ReadyWatch> ready_;
 #if ZNET_ENABLE_METRICS
   SessionMetrics metrics_;
 #endif
@@ -103,6 +326,12 @@ class TCPClientBackend : public ClientBackend {
 
   void WaitReadable(std::chrono::milliseconds timeout) override;
 
+  /** @brief The connected socket joins `poller` once Connect() makes it. */
+  bool DriveManually(std::shared_ptr<ManualPoller> poller) override {
+    poller_ = std::move(poller);
+    return true;
+  }
+
   std::shared_ptr<PeerSession> client_session() override { return client_session_; }
 
   std::shared_ptr<InetAddress> local_address() override { return local_address_; }
@@ -125,6 +354,10 @@ class TCPClientBackend : public ClientBackend {
   // non-owning copy kept after the transport takes the descriptor, so
   // WaitReadable can poll it; the transport closes it, never this
   SocketHandle wait_socket_ = kSocketInvalid;
+  // raised by the transport while it holds a backlog, so WaitReadable also
+  // returns once the socket can take more
+  std::shared_ptr<std::atomic_bool> want_writable_;
+  std::shared_ptr<ManualPoller> poller_;
 };
 
 class TCPServerBackend : public ServerBackend {
@@ -156,16 +389,54 @@ class TCPServerBackend : public ServerBackend {
     return bind_address_;
   }
 
- private:
+  /** @brief The listening socket and every watched one go into `poller`,
+   *         and StartWatching() starts no poll thread. */
+  bool DriveManually(std::shared_ptr<ManualPoller> poller) override {
+    poller_ = std::move(poller);
+    return true;
+  }
+
+  void Pump() override { PollOnce(0); }
+
+ protected:
+  /**
+   * @brief Starts whatever tells the server a session has work, once the
+   *        socket listens. Here, the poll thread.
+   */
+  virtual void StartWatching();
+
+  /**
+   * @brief The next connection off the listen queue, or an invalid handle
+   *        when none is waiting. Caller holds mutex_.
+   */
+  virtual SocketHandle AcceptSocket(sockaddr_storage* out_address,
+                                    socklen_t* out_length);
+
+  /**
+   * @brief The transport an admitted connection's session gets, or null to
+   *        drop the connection, having closed `socket`.
+   */
+  virtual std::unique_ptr<TransportLayer> CreateTransport(SocketHandle socket);
+
+  /** @brief What the sessions this backend accepts report themselves as. */
+  virtual ConnectionType connection_type() const { return ConnectionType::TCP; }
+
   /**
    * @brief Watches every accepted socket and fires the wake callback when
-   *        one turns readable.
+   *        one turns readable, or writable with a backlog waiting on it.
    *
    * Without it, inbound TCP data sat until a worker's next tick: an 8 ms
    * round-trip floor at the default 120 tps, three orders of magnitude above
    * the socket's own latency.
    */
   void PollLoop();
+  /**
+   * @brief One round of PollLoop(): waits up to `timeout_ms` for a watched
+   *        socket, then fires what turned ready.
+   *
+   * @return whether anything did.
+   */
+  bool PollOnce(int timeout_ms);
   // serializes Close() against Accept(): the server's loop accepts on
   // server_socket_ while the application may close it from its own thread, and
   // accept() on a descriptor that has been closed and reused would hand back a
@@ -182,10 +453,25 @@ class TCPServerBackend : public ServerBackend {
   SocketHandle server_socket_ = kSocketInvalid;
   std::function<void()> on_data_;
   Task poll_task_;
+  struct Watched {
+    SocketHandle socket;
+    // raised by the socket's transport while it holds a backlog, which
+    // turns writability into a reason to wake a worker
+    std::shared_ptr<std::atomic_bool> want_writable;
+    // the session's own wake, once a worker owns it; see ReadyWatch
+    std::shared_ptr<ReadyWatch> ready;
+    // an eventfd rather than a socket: read to re-arm once it has woken a
+    // worker, since nothing else drains it
+    bool counter = false;
+  };
+  /** @brief Puts `watched` under watch, and into poller_ if there is one. */
+  void Watch(Watched watched);
   // accepted sockets under watch; the poll thread prunes entries whose
   // descriptors have been closed by their transports
   std::mutex poll_mutex_;
-  std::vector<SocketHandle> polled_;
+  std::vector<Watched> polled_;
+  // set by DriveManually(), before Listen()
+  std::shared_ptr<ManualPoller> poller_;
 };
 
 }  // namespace backends
@@ -0,0 +1,289 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// The TCP server over io_uring, for ServerOptions::io_backend. The wire format,
+// framing and options are TCPTransportLayer's; what changes is who touches
+// the socket. Each worker owns a ring. A session's socket gets one multishot
+// receive into the ring's provided buffers for its whole life, and its queued
+// frames leave as a chain of linked sendmsg()s. The worker submits all of it
+// when its tick ends and reaps while it sleeps, so a busy worker makes one
+// system call per tick, not one per socket operation.
+//
+// Accepting moves onto a ring as well, a multishot accept on the server's
+// own loop, and the poll thread goes away: completions wake the worker that
+// owns the socket, not every worker.
+//
+
+#ifndef ZNET_BACKENDS_TCP_URING_H_
+#define ZNET_BACKENDS_TCP_URING_H_
+
+#include "znet/backends/tcp.h"
+#include "znet/detail/uring.h"
+
+#if ZNET_HAS_IO_URING
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace znet {
+namespace backends {
+
+class UringTCPTransportLayer;
+
+/**
+ * @brief One socket's state on a worker's ring: what it has received and
+ *        not yet been read, and the send chain in flight.
+ *
+ * Outlives its transport when the kernel still holds operations on the
+ * socket; the descriptor is the channel's from then on, closed once they
+ * complete. Apart from the fields marked otherwise, only the worker thread
+ * touches it.
+ */
+struct UringChannel {
+  SocketHandle socket = kSocketInvalid;
+  uint64_t id = 0;
+
+  // received bytes the transport has not read yet, from `inbox_offset` on
+  std::vector<char> inbox;
+  size_t inbox_offset = 0;
+  bool eof = false;
+  // errno of the receive or send that failed, or zero
+  int error = 0;
+  bool recv_armed = false;
+  // the receive was cancelled because the transport stopped reading
+  bool recv_paused = false;
+
+  // the send chain in flight: its sendmsg()s not yet completed, the frames
+  // they read from, the bytes they were handed, of those the ones from a
+  // file, and the bytes written so far
+  unsigned sends_in_flight = 0;
+  size_t send_frames = 0;
+  size_t send_expected = 0;
+  size_t send_file_bytes = 0;
+  size_t send_bytes = 0;
+  std::vector<std::shared_ptr<void>> held;
+  std::vector<iovec> iov;
+  std::vector<msghdr> msgs;
+
+  // what the transport left unsent when it was destroyed after a Close(),
+  // and what keeps those bytes alive; it follows the chain in flight
+  // before the socket is shut down
+  std::deque<iovec> backlog;
+  std::vector<std::shared_ptr<void>> backlog_held;
+
+  // set from any thread
+  std::atomic_bool shutdown_requested{false};
+  std::atomic_bool released{false};
+  bool shut = false;
+  bool cancelling = false;
+
+  // null once the transport is destroyed. Guarded by the worker's mutex.
+  UringTCPTransportLayer* transport = nullptr;
+  // fired on each of the socket's completions, so the worker runs the
+  // session when the ring has news for it rather than every tick
+  std::shared_ptr<ReadyWatch> ready;
+};
+
+/** @brief One worker's ring, and the sockets of the sessions it drives. */
+class UringWorker : public WorkerIo {
+ public:
+  UringWorker();
+  ~UringWorker() override;
+  UringWorker(const UringWorker&) = delete;
+  UringWorker& operator=(const UringWorker&) = delete;
+
+  bool Poll(std::chrono::nanoseconds timeout) override;
+  void Wake() override;
+  void Shutdown(std::chrono::milliseconds grace) override;
+
+  /**
+   * @brief Takes `socket` onto the ring for `transport`; its receive starts
+   *        at the next Poll(), and its completions fire `ready`. Callable
+   *        from any thread.
+   */
+  std::shared_ptr<UringChannel> Attach(SocketHandle socket,
+                                       UringTCPTransportLayer* transport,
+                                       std::shared_ptr<ReadyWatch> ready);
+
+  /**
+   * @brief Asks the worker to look at `channel` again: to shut it down once
+   *        its sends drain, or to let it go. Callable from any thread.
+   */
+  void Request(const std::shared_ptr<UringChannel>& channel);
+
+  /** @brief Detaches a transport being destroyed from its channel. */
+  void Release(const std::shared_ptr<UringChannel>& channel);
+
+  /** @brief Whether the caller is the thread that submits to the ring. */
+  ZNET_NODISCARD bool OnOwnerThread() const {
+    return ring_ready_.load(std::memory_order_acquire) &&
+           std::this_thread::get_id() == owner_;
+  }
+
+  /**
+   * @brief Queues the frames gathered in `channel`'s iov as one linked
+   *        chain. Worker thread only.
+   */
+  void SubmitSends(UringChannel& channel);
+
+  /**
+   * @brief Re-arms a receive the transport paused by not reading, once it
+   *        has caught up. Worker thread only.
+   */
+  void ResumeReceive(UringChannel& channel);
+
+  /**
+   * @brief Notes that a transport left bytes in its channel for its next
+   *        read, so the next Poll() does not wait. Worker thread only.
+   */
+  void MarkUnread() { unread_ = true; }
+
+ private:
+  bool InitRing();
+  /** @brief A submission, submitting what is queued first if it is full. */
+  io_uring_sqe* Sqe();
+  void ArmReceive(UringChannel& channel);
+  void ArmWake();
+  void Dispatch(const io_uring_cqe& cqe);
+  void OnReceive(UringChannel& channel, const io_uring_cqe& cqe);
+  void OnSend(UringChannel& channel, const io_uring_cqe& cqe);
+  /** @brief Sends the next chain of what a destroyed transport left. */
+  void SendBacklog(UringChannel& channel);
+  /**
+   * @brief Shuts a closing channel down once its sends drain, and forgets a
+   *        released one once nothing of it is left in the kernel.
+   */
+  void Attend(const std::shared_ptr<UringChannel>& channel);
+  /** @brief Waits on the wake descriptor alone, while there is no ring. */
+  bool SleepWithoutRing(std::chrono::nanoseconds timeout);
+
+  int wake_fd_ = -1;
+  // what the armed read of wake_fd_ lands in
+  uint64_t wake_value_ = 0;
+  bool wake_armed_ = false;
+
+  // guards everything channels hand over from other threads: the queues
+  // below and each channel's transport pointer
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<UringChannel>> attach_queue_;
+  std::vector<std::shared_ptr<UringChannel>> requests_;
+  uint64_t next_id_ = 1;
+
+  // the rest is the worker thread's
+  std::thread::id owner_;
+  std::atomic_bool ring_ready_{false};
+  bool ring_failed_ = false;
+  // the ring's counterpart of a socket that stays readable: a reason to
+  // tick again without waiting
+  bool unread_ = false;
+  std::unordered_map<uint64_t, std::shared_ptr<UringChannel>> channels_;
+  // last, so it is closed, cancelling what is in flight, before the
+  // channels and the memory those operations point into go
+  std::unique_ptr<detail::Uring> ring_;
+};
+
+class UringTCPTransportLayer : public TCPTransportLayer {
+ public:
+  UringTCPTransportLayer(SocketHandle socket, CommonOptions common,
+                         TCPOptions tcp);
+  ~UringTCPTransportLayer() override;
+
+  /**
+   * @brief Moves the socket onto `io`'s ring. Until then, through the
+   *        handshake, it is read and written like any TCP socket.
+   */
+  void BindWorkerIo(const std::shared_ptr<WorkerIo>& io) override;
+
+  Result Close(CloseOptions options = {}) override;
+
+  /**
+   * @brief The completion of `channel`'s send chain, whole or failed.
+   *        Worker thread, under the worker's mutex.
+   */
+  void OnSent(const UringChannel& channel);
+
+  /**
+   * @brief Queues what is pending as the next send chain. Worker thread,
+   *        under the worker's mutex; for the worker closing the socket.
+   */
+  void FlushFromWorker();
+
+  // frames one sendmsg() gathers, and sendmsg()s in one chain
+  static constexpr size_t kFramesPerSend = kMaxGatherFrames;
+  static constexpr size_t kMaxChainSends = 8;
+
+ protected:
+  ssize_t ReadSome(char* out, size_t size) override;
+  bool WritePending() override;
+
+ private:
+  /**
+   * @brief The bytes of `frame` from `offset` on, moving what keeps them
+   *        alive into `held`.
+   */
+  static iovec Slice(PendingFrame& frame, size_t offset,
+                     std::vector<std::shared_ptr<void>>* held);
+
+  std::shared_ptr<UringWorker> worker_;
+  std::shared_ptr<UringChannel> channel_;
+};
+
+class UringTCPServerBackend : public TCPServerBackend {
+ public:
+  UringTCPServerBackend(std::shared_ptr<InetAddress> bind_address,
+                        const SessionOptions& child_options = {},
+                        const ServerOptions& server_options = {});
+  ~UringTCPServerBackend() override;
+
+  Result Close() override;
+
+  std::shared_ptr<WorkerIo> CreateWorkerIo() override;
+
+  // each worker sleeps in its own ring, which no one descriptor stands for
+  bool DriveManually(std::shared_ptr<ManualPoller> poller) override {
+    (void)poller;
+    return false;
+  }
+
+ protected:
+  // completions wake the owning worker; there is nothing to poll
+  void StartWatching() override {}
+  SocketHandle AcceptSocket(sockaddr_storage* out_address,
+                            socklen_t* out_length) override;
+  std::unique_ptr<TransportLayer> CreateTransport(
+      SocketHandle socket) override;
+
+ private:
+  /** @brief Closes the accept ring and whatever it accepted. Holds mutex_. */
+  void DropAcceptRing();
+
+  // the server's loop is the only thread accepting, so the only one that
+  // submits here. Guarded by mutex_ like the listening socket.
+  std::unique_ptr<detail::Uring> accept_ring_;
+  bool accept_armed_ = false;
+  bool accept_failed_ = false;
+  std::deque<SocketHandle> accepted_;
+};
+
+}  // namespace backends
+}  // namespace znet
+
+#endif  // ZNET_HAS_IO_URING
+
+#endif  // ZNET_BACKENDS_TCP_URING_H_
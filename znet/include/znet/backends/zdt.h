@@ -19,6 +19,7 @@
 #define ZNET_BACKENDS_ZDT_H_
 
 #include "znet/backends/zdt/zdt_backends.h"
+#include "znet/backends/zdt/zdt_client_handshake.h"
 #include "znet/backends/zdt/zdt_net.h"
 #include "znet/backends/zdt/zdt_transport.h"
 #include "znet/backends/zdt/zdt_wire.h"
@@ -68,7 +68,17 @@ class ZDTClientBackend : public ClientBackend {
     on_data_ = std::move(on_data);
   }
   void StopReceiving() override;
-  bool DrivesOwnReceive() const override { return true; }
+  bool DrivesOwnReceive() const override { return !poller_; }
+
+  /** @brief The socket joins `poller` and no receive thread starts; Pump()
+   *         does its reading, the handshake's replies included. */
+  bool DriveManually(std::shared_ptr<ManualPoller> poller) override {
+    poller_ = std::move(poller);
+    return true;
+  }
+
+  /** @brief Moves what has arrived into the inbox, as ReceiveLoop() would. */
+  void Pump() override;
 
   std::shared_ptr<PeerSession> client_session() override { return client_session_; }
   std::shared_ptr<InetAddress> local_address() override { return local_address_; }
@@ -80,15 +90,15 @@ class ZDTClientBackend : public ClientBackend {
   }
 
  private:
-  // on success fills `out` with the negotiated connection and returns Result::Success; otherwise a
-  // granular failure Result (IncompatibleVersion, ServerFull, Timeout, ...).
-  Result Handshake(ZDTConnection& out);
-
   // like the server's, so an arriving datagram is seen at once rather than on
-  // the client loop's next tick. started only after the handshake, which reads
-  // the socket directly and would otherwise race it.
+  // the client loop's next tick. the handshake's replies go through it too.
   void ReceiveLoop();
 
+  /** @brief Queues the datagram in `scratch` for the transport if it came
+   *         from the server. */
+  void Deliver(Buffer& scratch, size_t len,
+               const std::shared_ptr<InetAddress>& from);
+
   std::shared_ptr<InetAddress> server_address_;
   std::shared_ptr<InetAddress> local_address_;
   std::shared_ptr<UDPSocket> socket_;
@@ -97,6 +107,9 @@ class ZDTClientBackend : public ClientBackend {
   std::mutex receive_thread_mutex_;
   std::atomic_bool receiving_{false};
   std::function<void()> on_data_;
+  // DriveMode::Manual, in place of the receive thread; see DriveManually()
+  std::shared_ptr<ManualPoller> poller_;
+  std::unique_ptr<Buffer> pump_scratch_;
   std::shared_ptr<PeerSession> client_session_;
   ZDTOptions config_;
   SessionOptions session_options_;  // passed to the PeerSession it creates
@@ -128,6 +141,10 @@ class ZDTServerBackend : public ServerBackend {
 
   void StopReceiving() override;
 
+  /** @brief With ZDTOptions::connected_sockets, a ZDTWorkerPoller, which
+   *         wakes the worker for its sessions' own sockets. */
+  std::shared_ptr<WorkerIo> CreateWorkerIo() override;
+
   std::shared_ptr<InetAddress> bind_address() const override {
     return bind_address_;
   }
@@ -153,11 +170,17 @@ class ZDTServerBackend : public ServerBackend {
   // handshake path (which may create a session and push it onto
   // pending_accept_). Returns when is_listening_ goes false.
   void ReceiveLoop();
-  void RouteDatagram(Buffer& datagram,
+  // false when no worker needs the wake callback for it: dropped, or handed
+  // to a session whose inbox wakes its worker itself
+  bool RouteDatagram(Buffer& datagram,
                      const std::shared_ptr<InetAddress>& from);
   void HandleOffline(Buffer& buffer, const std::shared_ptr<InetAddress>& from,
                      size_t datagram_size);
   void MaybeRotateSecret();
+  // with connected_sockets, a non-blocking socket on the server's port
+  // connect()ed to `peer`; null when the option is off or any step fails.
+  std::shared_ptr<UDPSocket> OpenPeerSocket(
+      const std::shared_ptr<InetAddress>& peer);
   ZDTCookie CookieFor(const std::string& peer_readable, uint32_t epoch) const;
   // per-source handshake rate limit (bounded, self-pruning). returns false when
   // the source has exceeded per_source_handshake_rate this second.
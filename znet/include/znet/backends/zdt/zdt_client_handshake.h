@@ -0,0 +1,111 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// The client's half of the ZDT offline handshake, as a state machine the
+// session's owner advances: Request1 down the MTU ladder until a Reply1 comes
+// back, then Request2 with the cookie until a Reply2 does. It sends on the
+// socket it is given but never reads it, and time arrives as a parameter, so
+// whoever takes datagrams off the socket (the receive thread, a ManualPoller
+// pump) hands over the replies and nothing blocks waiting for them.
+//
+
+#ifndef ZNET_BACKENDS_ZDT_ZDT_CLIENT_HANDSHAKE_H_
+#define ZNET_BACKENDS_ZDT_ZDT_CLIENT_HANDSHAKE_H_
+
+#include "znet/backends/zdt/zdt_connection.h"
+#include "znet/backends/zdt/zdt_net.h"
+#include "znet/backends/zdt/zdt_wire.h"
+#include "znet/buffer.h"
+#include "znet/compat.h"
+#include "znet/error.h"
+#include "znet/inet_addr.h"
+#include "znet/options.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace znet {
+namespace backends {
+
+/** @brief One client's way through the offline handshake. */
+class ZDTClientHandshake {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  enum class State : uint8_t {
+    /** @brief Sending Request1, one MTU rung at a time. */
+    Probing,
+    /** @brief Got a Reply1; sending Request2 with its cookie. */
+    Confirming,
+    /** @brief Got a Reply2; connection() holds what was settled. */
+    Done,
+    /** @brief Refused or timed out; result() says which. */
+    Failed,
+  };
+
+  ZDTClientHandshake(std::shared_ptr<UDPSocket> socket,
+                     std::shared_ptr<InetAddress> server,
+                     const ZDTOptions& config, uint64_t guid);
+
+  /** @brief Sends the first Request1. */
+  void Start(TimePoint now);
+
+  /** @brief Takes one offline datagram from the server. Others are ignored. */
+  void OnDatagram(Buffer& datagram, TimePoint now);
+
+  /** @brief Resends whatever is due, stepping down the ladder or giving up
+   *         once a rung's or the confirmation's attempts run out. */
+  void Poll(TimePoint now);
+
+  ZNET_NODISCARD State state() const { return state_; }
+  ZNET_NODISCARD bool finished() const {
+    return state_ == State::Done || state_ == State::Failed;
+  }
+  /** @brief Success once Done; IncompatibleVersion, ServerFull or Timeout
+   *         once Failed. */
+  ZNET_NODISCARD Result result() const { return result_; }
+  ZNET_NODISCARD const ZDTConnection& connection() const { return connection_; }
+  /** @brief When Poll() next has a resend to make; max() once finished. */
+  ZNET_NODISCARD TimePoint deadline() const {
+    return finished() ? TimePoint::max() : deadline_;
+  }
+
+ private:
+  // the next Request1, on this rung or the first further down that the path
+  // takes; fails once the ladder is used up
+  void SendRequest1(TimePoint now);
+  void SendRequest2(TimePoint now);
+  void Fail(Result result);
+
+  std::shared_ptr<UDPSocket> socket_;
+  std::shared_ptr<InetAddress> server_;
+  ZDTOptions config_;
+  uint64_t guid_;
+
+  State state_ = State::Probing;
+  Result result_ = Result::Timeout;
+  TimePoint deadline_{};
+  size_t rung_ = 0;
+  int attempts_ = 0;  // on this rung while probing, in total while confirming
+
+  // from Reply1, echoed back in Request2
+  ZDTCookie cookie_{};
+  uint32_t epoch_ = 0;
+  uint16_t negotiated_mtu_ = 0;
+  uint64_t server_guid_ = 0;
+  ZDTConnection connection_;
+};
+
+}  // namespace backends
+}  // namespace znet
+
+#endif  // ZNET_BACKENDS_ZDT_ZDT_CLIENT_HANDSHAKE_H_
@@ -24,13 +24,16 @@
 #include "znet/options.h"
 #include "znet/peer_session.h"
 #include "znet/compat.h"
+#include "znet/detail/platform.h"
 #include "znet/transport.h"
+#include "znet/worker_io.h"
 
 #include <array>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <deque>
+#include <functional>
 #include <map>
 #include <mutex>
 #include <set>
@@ -73,6 +76,28 @@ class UDPSocket {
   // best-effort; the handshake MTU probe needs oversized datagrams dropped
   // rather than IP-fragmented.
   bool SetDontFragment(bool enabled);
+  // lets another socket bind the same address, the way a server's per-peer
+  // sockets share its port. Before Bind(), on every socket sharing it.
+  bool SetReusePort(bool enabled);
+
+  /**
+   * @brief Fixes the socket's peer.
+   *
+   * The kernel then delivers this socket only that peer's datagrams, and
+   * SendTo() stops naming a destination, which skips the route lookup
+   * sendto() makes on every call. RecvFrom() reports `peer` as the source
+   * without building an address per datagram.
+   */
+  Result Connect(std::shared_ptr<InetAddress> peer);
+
+  /**
+   * @brief Reads and drops whatever is queued. For a socket that sat
+   *        unconnected in a port's reuseport group, where the kernel may have
+   *        handed it anyone's datagrams. Non-blocking sockets only.
+   *
+   * @return how many were dropped.
+   */
+  size_t DiscardQueued();
 
   /**
    * @brief Wakes a blocked RecvFrom without releasing the descriptor.
@@ -100,6 +125,9 @@ class UDPSocket {
 
  private:
   std::atomic<SocketHandle> socket_{kSocketInvalid};
+  // set by Connect() before any thread sends or reads, and never changed
+  std::shared_ptr<InetAddress> peer_;
+  std::atomic_bool connected_{false};
 };
 
 // Applies both buffer sizes (0 = leave the OS default) and logs the granted
@@ -108,6 +136,52 @@ class UDPSocket {
 // carries ZDT traffic goes through this: both backends and the P2P punch.
 void ApplySocketBufferSizes(UDPSocket& socket, int recv_bytes, int send_bytes);
 
+#if defined(ZNET_TARGET_LINUX)
+#define ZNET_HAS_ZDT_CONNECTED_SOCKETS 1
+#else
+#define ZNET_HAS_ZDT_CONNECTED_SOCKETS 0
+#endif
+
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+/**
+ * @brief What a server worker sleeps on when its ZDT sessions each read a
+ *        connected socket of their own: an epoll set of those sockets, and an
+ *        eventfd for Wake().
+ *
+ * Level-triggered, since a session drains its socket on every tick: a socket
+ * it has not caught up on ends the next sleep at once, which is the point.
+ */
+class ZDTWorkerPoller : public WorkerIo {
+ public:
+  ZDTWorkerPoller();
+  ~ZDTWorkerPoller() override;
+  ZDTWorkerPoller(const ZDTWorkerPoller&) = delete;
+  ZDTWorkerPoller& operator=(const ZDTWorkerPoller&) = delete;
+
+  ZNET_NODISCARD bool valid() const { return epoll_ >= 0 && wake_ >= 0; }
+
+  bool Poll(std::chrono::nanoseconds timeout) override;
+  void Wake() override;
+  /** @brief Nothing to wait for: a datagram's send completes in the call. */
+  void Shutdown(std::chrono::milliseconds grace) override { (void)grace; }
+
+  /** @brief Adds a session's socket to the set. Any thread. */
+  bool Watch(SocketHandle socket);
+  /** @brief Has Poll() call `on_readable` for a watched socket that turns
+   *         readable, on the worker's thread. Any thread. */
+  void OnReadable(SocketHandle socket, std::function<void()> on_readable);
+  /** @brief Takes it out again, ahead of a shutdown that would otherwise
+   *         leave it reporting readable until it is closed. Any thread. */
+  void Unwatch(SocketHandle socket);
+
+ private:
+  int epoll_ = -1;
+  int wake_ = -1;
+  std::mutex callbacks_mutex_;
+  std::unordered_map<SocketHandle, std::function<void()>> callbacks_;
+};
+#endif  // ZNET_HAS_ZDT_CONNECTED_SOCKETS
+
 // thread-safe datagram queue, shared by a producer and a consumer running on
 // different threads (see ZDTTransportLayer for the threading rule).
 class ZDTInbox {
@@ -119,11 +193,20 @@ class ZDTInbox {
   bool Push(Buffer&& datagram, size_t limit);
   void Drain(std::deque<Buffer>& out);
   size_t dropped() const;
+  bool empty() const;
+
+  // called by Push() on the datagram that finds the queue empty, outside the
+  // lock: anything before it was drained already, so the consumer is owed a
+  // look. set once, before it matters; never replaced.
+  void SetOnArrival(std::function<void()> on_arrival);
+  bool notifies() const { return notifies_.load(std::memory_order_acquire); }
 
  private:
   mutable std::mutex mutex_;
   std::deque<Buffer> queue_;
   size_t dropped_ = 0;
+  std::function<void()> on_arrival_;
+  std::atomic_bool notifies_{false};
 };
 
 }  // namespace backends
@@ -31,12 +31,14 @@
 #include <cstdint>
 #include <deque>
 #include <map>
+#include <mutex>
 #include <set>
 #include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
 #include "znet/backends/zdt/zdt_ack_history.h"
+#include "znet/backends/zdt/zdt_client_handshake.h"
 #include "znet/backends/zdt/zdt_congestion.h"
 #include "znet/backends/zdt/zdt_connection.h"
 #include "znet/backends/zdt/zdt_domain.h"
@@ -52,6 +54,8 @@ namespace backends {
 // it just appends raw bytes to the inbox which Update() drains.
 class ZDTTransportLayer : public TransportLayer {
  public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
   // `common` carries the transport-agnostic keepalive knobs; the defaults
   // match CommonOptions so call sites without a SessionOptions in hand (the
   // dialer, the tests) behave like a default session
@@ -77,14 +81,33 @@ class ZDTTransportLayer : public TransportLayer {
   // feeds one raw ZDT datagram (UDP payload) to this transport. Thread-safe.
   void OnDatagram(const uint8_t* data, size_t len);
 
+  /**
+   * @brief Starts `handshake` and holds everything back until it is Done:
+   *        Update() hands it the offline replies from the inbox and polls
+   *        its resends, and only then does anything reach the wire. One that
+   *        fails closes the transport. Before the session is handed out.
+   */
+  void AwaitHandshake(std::unique_ptr<ZDTClientHandshake> handshake);
+
   void FillMetrics(SessionMetrics& out) const override;
 
+  /** @brief Puts a transport that reads its own socket in the worker's
+   *        ZDTWorkerPoller, so the worker wakes for its datagrams. */
+  void BindWorkerIo(const std::shared_ptr<WorkerIo>& io) override;
+
+  /** @brief Fired by the inbox on its first datagram since the last drain,
+   *         by the worker's poller for a socket of its own, and by Send() on
+   *         an idle queue. False for a socket of its own no poller watches. */
+  bool SetReadyCallback(std::function<void()> ready) override;
+
+  /** @brief The soonest of the retransmit scan, the tail probe, keepalive,
+   *         idle timeout, reassembly expiry and the sent-packet prune. */
+  TimePoint NextDeadline() override;
+
   std::shared_ptr<InetAddress> peer() const { return peer_; }
   std::shared_ptr<ZDTInbox> inbox() const { return inbox_; }
 
  private:
-  using TimePoint = std::chrono::steady_clock::time_point;
-
   // identifies one reliable datagram / reassembly buffer.
   struct MsgKey {
     uint8_t channel = 0;
@@ -98,12 +121,16 @@ class ZDTTransportLayer : public TransportLayer {
     }
   };
 
-  void DrainSocket();     // client-side: recvfrom own socket -> inbox
+  void DrainSocket();     // own socket (client, connected server) -> inbox
+  void StopWatching();    // out of the worker's poll set, before a shutdown
   void ProcessInbound();  // parse queued raw datagrams (worker thread)
   void FlushOutbound();   // send queued NEW messages (worker thread)
   size_t StageOutbound(); // move ring entries into their channel lanes
   void SendControl(uint8_t flags);
   void CheckTimers();
+  // once the handshake has finished: takes up its connection, or closes on
+  // its failure. False while it is still under way or once it has failed.
+  bool SettleHandshake();
 
   // one message queued for the datagram being packed. `owner` keeps the source
   // buffer alive until the batch goes out, since `payload` points into it.
@@ -188,6 +215,9 @@ class ZDTTransportLayer : public TransportLayer {
   struct QueuedOut {
     std::shared_ptr<Buffer> payload;
     SendOptions options;
+    // past this an unreliable message is dropped rather than sent; max() when
+    // it carries no DeadlineKey
+    TimePoint expires = TimePoint::max();
   };
   // a datagram can carry several reliable messages, so acking it retires all of
   // them. fixed capacity and inline, like TransmissionLog: batching must not add
@@ -256,6 +286,8 @@ class ZDTTransportLayer : public TransportLayer {
   bool drains_own_socket_;
   std::shared_ptr<ZDTInbox> inbox_;
   ZDTConnection connection_;
+  // under way until connection_ is settled; see AwaitHandshake(). Worker only.
+  std::unique_ptr<ZDTClientHandshake> handshake_;
 
   // packet_seq 0 is reserved as the "nothing to ack yet" sentinel: a peer that
   // has not received anything sends ack=0, and AckPacket(0) is a no-op. Without
@@ -271,13 +303,28 @@ class ZDTTransportLayer : public TransportLayer {
   // or backlogged channel cannot hold another channel's traffic behind it.
   // Worker only, so it needs no lock. Lanes persist once created: a channel
   // that bursts repeatedly reuses its deque's nodes instead of allocating.
+  // A deque of lanes too, so adding one never moves the others' messages out
+  // from under coalescing_.
   struct StagedLane {
     uint8_t channel = 0;
     std::deque<QueuedOut> messages;
+    // virtual time at which the head message starts; see FlushOutbound()
+    uint64_t start = 0;
   };
-  std::vector<StagedLane> staged_;
+  std::deque<StagedLane> staged_;
   size_t staged_count_ = 0;   // total queued across lanes; bounds the drain
   size_t staged_cursor_ = 0;  // rotates so no lane is always served first
+  // the finish tag of the message last sent from a lane. A message's tag is
+  // its bytes * kLaneWeightScale / (PriorityKey + 1) past its start, so a
+  // weight of 256 still moves it by whole units
+  uint64_t virtual_clock_ = 0;
+  static constexpr uint64_t kLaneWeightScale = 256;
+  // the staged message each CoalesceKey on each channel would replace, keyed
+  // by channel << 32 | key. A deque keeps its elements in place through pushes
+  // and pops at either end, so these stay valid until the message is popped.
+  std::unordered_map<uint64_t, QueuedOut*> coalescing_;
+  // takes the head of `lane`, forgetting it as a coalescing target
+  QueuedOut PopStaged(StagedLane& lane);
   // reused across ProcessInbound() calls. a default-constructed std::deque
   // allocates its map and first node immediately, so declaring this local meant
   // two mallocs on every tick whether or not a datagram had arrived. swapping
@@ -296,6 +343,15 @@ class ZDTTransportLayer : public TransportLayer {
   // read via IsAlive() from whichever thread owns the application, written by
   // Close() from the same, so it cannot be a plain bool
   std::atomic_bool is_closed_{false};
+  // see SetReadyCallback(); set before the session is handed out and never
+  // replaced, so Send() reads it without synchronizing
+  std::function<void()> on_ready_;
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+  // the poll set socket_ is in, if any. Bound from the accepting thread and
+  // dropped by whichever of Close() and a FIN gets there first.
+  std::mutex poller_mutex_;
+  std::shared_ptr<ZDTWorkerPoller> poller_;
+#endif
 #ifndef NDEBUG
   // Update/Flush/Receive belong to whichever thread is driving this session.
   // Send, OnDatagram and Close are deliberately outside it: they are the three
@@ -13,6 +13,7 @@
 
 #include "znet/compat.h"
 #include "znet/interface.h"
+#include "znet/manual_poller.h"
 #include "znet/options.h"
 #include "znet/peer_session.h"
 #include "znet/scheduler.h"
@@ -43,6 +44,9 @@ struct ClientConfig {
   ConnectionType connection_type = ConnectionType::ZDT;
   /** @brief This client's session options; see options.h. */
   SessionOptions options;
+  /** @brief Manual spawns no loop or encoder thread; the application calls
+   * Process() instead. See DriveMode. */
+  DriveMode drive = DriveMode::Threads;
 };
 
 /**
@@ -139,7 +143,33 @@ class Client : public Interface {
 
   ZNET_NODISCARD std::shared_ptr<InetAddress> local_address() const;
 
+  /**
+   * @brief Under DriveMode::Manual, one round of the client's loop: process
+   *        the session, and fire the connected, failed or disconnected event
+   *        when it gets there. Never blocks; call it from one thread.
+   *
+   * @return false before Connect(), and once the session has ended.
+   */
+  bool Process();
+
+  /**
+   * @brief Under DriveMode::Manual, waits up to `timeout` for the session
+   *        to have work, or until its next deadline if sooner, then
+   *        Process()es it.
+   */
+  bool PollOnce(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Under DriveMode::Manual, a descriptor that turns readable when
+   *        Process() has work, for the application's own epoll or poll set.
+   *        Valid from Connect(). -1 in thread mode, and off Linux.
+   */
+  ZNET_NODISCARD int poll_fd() const { return poller_ ? poller_->fd() : -1; }
+
  private:
+  // how far DriveMode::Manual's Process() has taken the session
+  enum class Stage : uint8_t { Idle, Connecting, Connected, Done };
+
   ClientConfig config_;
   std::shared_ptr<InetAddress> server_address_;
   std::unique_ptr<backends::ClientBackend> backend_;
@@ -151,6 +181,9 @@ class Client : public Interface {
   // a client has one session and one loop, so without this the loop would
   // serialize encoding behind putting bytes on the wire
   SessionEncoder encoder_;
+  // DriveMode::Manual only
+  std::shared_ptr<ManualPoller> poller_;
+  Stage stage_ = Stage::Idle;
 };
 
 }  // namespace znet
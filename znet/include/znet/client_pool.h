@@ -0,0 +1,205 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Many client sessions on a fixed set of threads. A Client runs a loop
+// thread of its own, plus an encoder thread and, over ZDT, a receive thread:
+// three per connection, which is what caps a load generator long before the
+// network does. A pool's workers drive their sessions the way a Client in
+// DriveMode::Manual is driven: every socket a worker owns sits in its one
+// ManualPoller, so it sleeps in one wait for all of them, and reads and
+// processes on its own thread. A pass runs only the sessions with something
+// to do, so thousands of idle ones cost a worker nothing per packet.
+//
+
+#ifndef ZNET_CLIENT_POOL_H_
+#define ZNET_CLIENT_POOL_H_
+
+#include "znet/client.h"
+#include "znet/compat.h"
+#include "znet/detail/timer_wheel.h"
+#include "znet/interface.h"
+#include "znet/manual_poller.h"
+#include "znet/peer_session.h"
+#include "znet/scheduler.h"
+#include "znet/task.h"
+#include "znet/worker_signal.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace znet {
+
+namespace backends {
+class ClientBackend;
+}  // namespace backends
+
+/** @brief What a ClientPool is constructed from. */
+struct ClientPoolOptions {
+  /** @brief Worker threads. Zero is std::thread::hardware_concurrency(). */
+  uint32_t workers = 0;
+  /**
+   * @brief Passes per second a worker makes while one of its sessions has
+   *        work left over or is still handshaking. Otherwise it sleeps until
+   *        a socket turns readable, a session is sent to, or a session's
+   *        next deadline.
+   */
+  uint16_t ticks_per_second = 120;
+};
+
+/**
+ * @brief Client sessions multiplexed over a fixed pool of worker threads.
+ *
+ * Each Connect() is one session to one server, placed on the worker with the
+ * fewest. Its events arrive through the pool's event callback, on that
+ * worker's thread, exactly as a Client would fire them. TCP, ZDT and shared
+ * memory sessions need no thread of their own; a connection type that does
+ * is refused.
+ */
+class ClientPool : public Interface {
+ public:
+  explicit ClientPool(const ClientPoolOptions& options = {});
+  ClientPool(const ClientPool&) = delete;
+  ~ClientPool() override;
+
+  /**
+   * @brief Initializes znet. Each Connect() binds a socket of its own, so
+   *        there is nothing else to bind.
+   */
+  Result Bind() override;
+
+  /**
+   * @brief Connects one more session and hands it to a worker. Thread-safe.
+   *
+   * Blocks for as long as Client::Connect() would, which is the TCP connect;
+   * a ZDT handshake is left to the worker. `config.drive` is ignored; the
+   * pool drives it.
+   *
+   * @param out_session if given, the session, which is ready once the
+   *        ClientConnectedToServerEvent for it fires.
+   * @return what Client::Connect() would, or Result::AlreadyStopped after
+   *         Stop(), or Result::InvalidBackend for a connection type that
+   *         needs its own thread.
+   */
+  Result Connect(const ClientConfig& config,
+                 std::shared_ptr<PeerSession>* out_session = nullptr);
+
+  /**
+   * @brief Closes every session and joins the workers. Each session still
+   *        connected fires its disconnect event on the way. Thread-safe,
+   *        but not from an event handler, which runs on a worker.
+   *
+   * @return Result::AlreadyStopped on the second call.
+   */
+  Result Stop();
+
+  /** @brief Blocks until Stop() has finished. Thread-safe. */
+  void Wait() override;
+
+  /** @brief Sessions handed to a worker and not yet ended. */
+  ZNET_NODISCARD size_t size() const;
+
+  /** @brief How many sessions each worker holds, in worker order. */
+  ZNET_NODISCARD std::vector<size_t> worker_sizes() const;
+
+  /**
+   * @brief Process() calls the workers have made on their sessions, all
+   *        told. A pass runs only the sessions that were readable, sent to,
+   *        due a deadline or still connecting, so this grows with traffic
+   *        rather than with how many sessions sit idle.
+   */
+  ZNET_NODISCARD uint64_t processed() const;
+
+ private:
+  struct Member;
+
+  /**
+   * @brief A member's place in its worker's ready queue. Shared with the
+   *        wake callback its session holds, which may outlive the member,
+   *        so it holds the member weakly.
+   */
+  struct Mark {
+    std::weak_ptr<Member> member;
+    // set by whoever queues it, cleared by the worker once Process() is done
+    // with it, so a burst of sends queues it once
+    std::atomic_bool queued{true};
+  };
+
+  // one connection: the backend it came from, which keeps the socket, how
+  // far the worker has taken it, and its deadline on the worker's wheel
+  struct Member : detail::TimerWheel::Node {
+    std::unique_ptr<backends::ClientBackend> backend;
+    std::shared_ptr<PeerSession> session;
+    std::shared_ptr<Mark> mark{std::make_shared<Mark>()};
+    std::chrono::steady_clock::duration connection_timeout{};
+    bool connected = false;
+    // the worker's: the last pass that ran it, so one found twice runs once
+    uint64_t pass = 0;
+  };
+
+  /** @brief Members whose sessions were sent to, for their worker to take. */
+  class ReadyQueue {
+   public:
+    void Push(std::shared_ptr<Mark> mark) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      marks_.push_back(std::move(mark));
+    }
+
+    /** @brief Appends everything queued to `out`. */
+    void TakeAll(std::vector<std::shared_ptr<Mark>>& out) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      out.insert(out.end(), std::make_move_iterator(marks_.begin()),
+                 std::make_move_iterator(marks_.end()));
+      marks_.clear();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Mark>> marks_;
+  };
+
+  struct Worker {
+    std::shared_ptr<ManualPoller> poller{std::make_shared<ManualPoller>()};
+    std::shared_ptr<WorkerSignal> signal{std::make_shared<WorkerSignal>()};
+    // shared with every session's wake callback, which may outlive the pool
+    std::shared_ptr<ReadyQueue> ready{std::make_shared<ReadyQueue>()};
+    // connections handed over since the worker last looked
+    std::mutex arrivals_mutex;
+    std::vector<std::shared_ptr<Member>> arrivals;
+    // from Connect() handing it over until the worker drops it
+    std::atomic<size_t> count{0};
+    std::atomic<uint64_t> processed{0};
+    Scheduler scheduler{120};
+    Task task;
+  };
+
+  void WorkerLoop(Worker& worker);
+  /**
+   * @brief Fires whichever event `member` has reached since the last pass,
+   *        as Client's loop would. Worker thread only.
+   *
+   * @return false once the session is over and can be dropped.
+   */
+  bool Advance(Member& member);
+  Worker& SelectWorker();
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+  bool stopped_ = false;
+  std::atomic_bool stopping_{false};
+};
+
+}  // namespace znet
+
+#endif  // ZNET_CLIENT_POOL_H_
@@ -41,7 +41,11 @@ struct DecodeStats {
  */
 class Codec {
  public:
-  Codec() = default;
+  /**
+   * @brief Starts with the serializers for the session's own stream messages
+   *        (see PeerSession::OpenStream()), under ids reserved for them.
+   */
+  Codec();
   ~Codec() = default;
 
   /**
@@ -79,6 +83,22 @@ class Codec {
   std::shared_ptr<Buffer> Serialize(std::shared_ptr<Packet> packet,
                                     size_t headroom = 0);
 
+  /**
+   * @brief Serializes a packet onto the end of an existing buffer.
+   *
+   * What Serialize() does, minus the allocation, so several packets can share
+   * one buffer: Deserialize() already reads frames back to back. On failure
+   * the buffer is left as it was.
+   *
+   * @param trailing_bytes bytes of the packet its serializer leaves out, for
+   *        the caller to send straight after the buffer. Counted in the
+   *        frame's length all the same.
+   * @return false if there is no serializer for the packet, or it failed.
+   */
+  bool SerializeInto(const std::shared_ptr<Packet>& packet,
+                     const std::shared_ptr<Buffer>& buffer,
+                     size_t trailing_bytes = 0);
+
   /**
    * @brief Registers a packet serializer for a specific packet type.
    *
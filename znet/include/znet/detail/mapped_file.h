@@ -0,0 +1,80 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Internal: the file behind PeerSession::SendFile(). Shared by the chunks in
+// flight so the mapping outlives every frame that still points into it, and
+// by the TCP transport, which hands the descriptor to sendfile() instead.
+//
+
+#ifndef ZNET_DETAIL_MAPPED_FILE_H_
+#define ZNET_DETAIL_MAPPED_FILE_H_
+
+#include "znet/compat.h"
+#include "znet/detail/platform.h"
+#include "znet/types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace znet {
+namespace detail {
+
+/**
+ * @brief A read-only mapping of one range of a file, and the file itself.
+ */
+class MappedFile {
+ public:
+  /**
+   * @brief Maps `length` bytes of `path` from `offset`, or up to its end
+   *        when the file is shorter.
+   *
+   * @return null on failure, with `out_result` saying why: CannotOpenFile
+   *         when it could not be opened, stat-ed or mapped, InvalidArgument
+   *         when `offset` is past its end.
+   */
+  static std::shared_ptr<MappedFile> Open(const std::string& path,
+                                          uint64_t offset, uint64_t length,
+                                          Result* out_result);
+
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /** @brief The first byte of the range. Null for an empty one. */
+  ZNET_NODISCARD const char* data() const { return data_; }
+  ZNET_NODISCARD uint64_t size() const { return size_; }
+  /** @brief Where data() starts within the file. */
+  ZNET_NODISCARD uint64_t offset() const { return offset_; }
+  /** @brief The open descriptor on POSIX, for sendfile(); -1 elsewhere. */
+  ZNET_NODISCARD int descriptor() const { return fd_; }
+
+ private:
+  MappedFile() = default;
+
+  const char* data_ = nullptr;
+  uint64_t size_ = 0;
+  uint64_t offset_ = 0;
+  // the mapping starts on an allocation boundary at or before data_
+  void* view_ = nullptr;
+  size_t view_size_ = 0;
+  int fd_ = -1;
+#ifdef ZNET_TARGET_WIN
+  void* file_handle_ = nullptr;
+  void* mapping_handle_ = nullptr;
+#endif
+};
+
+}  // namespace detail
+}  // namespace znet
+
+#endif  // ZNET_DETAIL_MAPPED_FILE_H_
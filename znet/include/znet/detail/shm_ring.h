@@ -0,0 +1,231 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// A single-producer, single-consumer byte ring laid out in memory two
+// processes share. Records are a native-endian uint32 prefix and that many
+// bytes, wrapping across the end of the data as they fall. The positions only
+// ever grow; a position masked by the capacity is the offset.
+//
+// Nothing here sleeps or signals. Each side owns one flag saying it has gone
+// to sleep, and the other side's Take*Park() call reports when it should be
+// woken: after the reader parked on an empty ring or the writer on a full
+// one, never while both keep up, so a busy pair crosses no system call.
+//
+
+#ifndef ZNET_DETAIL_SHM_RING_H_
+#define ZNET_DETAIL_SHM_RING_H_
+
+#include "znet/compat.h"
+#include "znet/detail/platform.h"
+
+// memfd_create() and eventfd() are Linux's
+#if defined(ZNET_TARGET_LINUX)
+#define ZNET_HAS_SHARED_MEMORY 1
+#else
+#define ZNET_HAS_SHARED_MEMORY 0
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace znet {
+namespace detail {
+
+class ShmRing {
+ public:
+  // the peer is another process, so nothing may fall back to a lock that
+  // lives in this one's memory
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                "shared memory rings need lock-free atomics");
+
+  /** @brief Bytes of record prefix in front of every record's body. */
+  static constexpr size_t kPrefixSize = sizeof(uint32_t);
+
+  /** @brief The bytes one ring of `capacity` data bytes takes up. */
+  static constexpr size_t RegionSize(size_t capacity) {
+    return sizeof(Header) + capacity;
+  }
+
+  /**
+   * @brief Views the ring at `region`, which holds RegionSize(capacity)
+   *        bytes. `capacity` is a power of two.
+   */
+  void Attach(void* region, size_t capacity) {
+    header_ = static_cast<Header*>(region);
+    data_ = static_cast<char*>(region) + sizeof(Header);
+    capacity_ = capacity;
+  }
+
+  /** @brief Resets the ring to empty. Its creator only, before sharing it. */
+  void Initialize() {
+    header_->head.store(0, std::memory_order_relaxed);
+    header_->tail.store(0, std::memory_order_relaxed);
+    header_->reader_parked.store(0, std::memory_order_relaxed);
+    header_->writer_parked.store(0, std::memory_order_relaxed);
+    header_->closed.store(0, std::memory_order_relaxed);
+  }
+
+  ZNET_NODISCARD size_t capacity() const { return capacity_; }
+
+  // -- writer ---------------------------------------------------------------
+
+  /**
+   * @brief Appends one record, or returns false without writing anything
+   *        when it does not fit yet.
+   *
+   * Published at once; call TakeReaderPark() after a batch of these.
+   */
+  bool TryWrite(uint32_t prefix, const char* body, size_t size) {
+    const uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (capacity_ - static_cast<size_t>(tail - head) < kPrefixSize + size) {
+      return false;
+    }
+    CopyIn(tail, reinterpret_cast<const char*>(&prefix), kPrefixSize);
+    CopyIn(tail + kPrefixSize, body, size);
+    header_->tail.store(tail + kPrefixSize + size, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Whether the reader parked on an empty ring since the last call,
+   *        and so has to be woken to see what was written.
+   */
+  bool TakeReaderPark() {
+    // against the fence in ParkReader(): either it sees the new tail, or
+    // this sees its flag
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return header_->reader_parked.load(std::memory_order_relaxed) != 0 &&
+           header_->reader_parked.exchange(0, std::memory_order_acq_rel) != 0;
+  }
+
+  /**
+   * @brief Asks to be woken once a record of `size` bytes fits.
+   *
+   * @return false when it already does, and there is no need to sleep.
+   */
+  bool ParkWriter(size_t size) {
+    header_->writer_parked.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    return capacity_ - static_cast<size_t>(tail - head) < kPrefixSize + size;
+  }
+
+  /** @brief Tells the reader nothing more follows what is in the ring. */
+  void MarkClosed() { header_->closed.store(1, std::memory_order_release); }
+
+  // -- reader ---------------------------------------------------------------
+
+  ZNET_NODISCARD bool empty() const {
+    return header_->tail.load(std::memory_order_acquire) ==
+           header_->head.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief The prefix of the oldest record, or false when there is none.
+   *
+   * Also false, with `*corrupt` set, when the positions say something no
+   * honest writer could have written.
+   */
+  bool Front(uint32_t* prefix, bool* corrupt) const {
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    const uint64_t used = tail - head;
+    if (used == 0) {
+      return false;
+    }
+    if (used < kPrefixSize || used > capacity_) {
+      *corrupt = true;
+      return false;
+    }
+    CopyOut(head, reinterpret_cast<char*>(prefix), kPrefixSize);
+    return true;
+  }
+
+  /**
+   * @brief Copies the body of the record Front() reported, `size` bytes, to
+   *        `out` and frees its space. False if the ring holds fewer.
+   */
+  bool Take(char* out, size_t size) {
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    if (static_cast<size_t>(tail - head) < kPrefixSize + size) {
+      return false;
+    }
+    CopyOut(head + kPrefixSize, out, size);
+    header_->head.store(head + kPrefixSize + size, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Whether the writer parked on a full ring since the last call,
+   *        and so has to be woken to use the space taken records freed.
+   */
+  bool TakeWriterPark() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return header_->writer_parked.load(std::memory_order_relaxed) != 0 &&
+           header_->writer_parked.exchange(0, std::memory_order_acq_rel) != 0;
+  }
+
+  /**
+   * @brief Asks to be woken once the ring has a record.
+   *
+   * @return false when it already has one, and there is no need to sleep.
+   */
+  bool ParkReader() {
+    header_->reader_parked.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return empty();
+  }
+
+  /** @brief Whether the writer marked the ring closed. Read it before
+   *         empty(), so a record written ahead of the close is not missed. */
+  ZNET_NODISCARD bool closed() const {
+    return header_->closed.load(std::memory_order_acquire) != 0;
+  }
+
+ private:
+  // the positions on lines of their own, so the two sides do not take turns
+  // owning one cache line on every record
+  struct Header {
+    alignas(64) std::atomic<uint64_t> head;  // written by the reader
+    alignas(64) std::atomic<uint64_t> tail;  // written by the writer
+    alignas(64) std::atomic<uint32_t> reader_parked;
+    std::atomic<uint32_t> writer_parked;
+    std::atomic<uint32_t> closed;
+  };
+
+  void CopyIn(uint64_t position, const char* from, size_t size) {
+    const size_t offset = static_cast<size_t>(position) & (capacity_ - 1);
+    const size_t first = size < capacity_ - offset ? size : capacity_ - offset;
+    std::memcpy(data_ + offset, from, first);
+    std::memcpy(data_, from + first, size - first);
+  }
+
+  void CopyOut(uint64_t position, char* to, size_t size) const {
+    const size_t offset = static_cast<size_t>(position) & (capacity_ - 1);
+    const size_t first = size < capacity_ - offset ? size : capacity_ - offset;
+    std::memcpy(to, data_ + offset, first);
+    std::memcpy(to + first, data_, size - first);
+  }
+
+  Header* header_ = nullptr;
+  char* data_ = nullptr;
+  size_t capacity_ = 0;
+};
+
+}  // namespace detail
+}  // namespace znet
+
+#endif  // ZNET_DETAIL_SHM_RING_H_
@@ -0,0 +1,181 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Internal: the sessions a server worker ticks, and the ones the listener is
+// still handshaking. Values sit packed in one vector, so a tick walks them
+// front to back instead of chasing a hash table's nodes; a key names a slot
+// rather than a position, so removing one moves the last value into the gap
+// and nothing else is disturbed.
+//
+// Each slot carries a generation that is bumped whenever its value is erased,
+// and a key carries the generation it was issued under, so a key kept past
+// its value's removal finds nothing rather than whichever value took the
+// slot over.
+//
+
+#ifndef ZNET_DETAIL_SLOT_MAP_H_
+#define ZNET_DETAIL_SLOT_MAP_H_
+
+#include "znet/compat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace znet {
+namespace detail {
+
+/**
+ * @brief Values in contiguous storage, each reachable in constant time by
+ *        the key Insert() returned for it.
+ *
+ * Not thread-safe: one thread owns it and everything in it. Iteration order
+ * is storage order, which an erase reshuffles.
+ */
+template <typename T>
+class SlotMap {
+ public:
+  /**
+   * @brief A slot's index in the low 32 bits and its generation in the high.
+   *        Generations start at one, so kNullKey never names a value.
+   */
+  using Key = uint64_t;
+  static constexpr Key kNullKey = 0;
+
+  using iterator = typename std::vector<T>::iterator;
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  /** @brief Stores `value` and returns its key. */
+  Key Insert(T value) {
+    uint32_t slot;
+    if (free_head_ != kNoSlot) {
+      slot = free_head_;
+      free_head_ = slots_[slot].index;
+    } else {
+      slot = static_cast<uint32_t>(slots_.size());
+      slots_.push_back(Slot{});
+    }
+    slots_[slot].index = static_cast<uint32_t>(values_.size());
+    values_.push_back(std::move(value));
+    owners_.push_back(slot);
+    return MakeKey(slot, slots_[slot].generation);
+  }
+
+  /** @brief The value `key` names, or null once it has been erased. */
+  ZNET_NODISCARD T* Find(Key key) {
+    const uint32_t slot = SlotOf(key);
+    return slot == kNoSlot ? nullptr : &values_[slots_[slot].index];
+  }
+
+  ZNET_NODISCARD const T* Find(Key key) const {
+    const uint32_t slot = SlotOf(key);
+    return slot == kNoSlot ? nullptr : &values_[slots_[slot].index];
+  }
+
+  /** @brief Drops the value `key` names. False if it already was. */
+  bool Erase(Key key) {
+    const uint32_t slot = SlotOf(key);
+    if (slot == kNoSlot) {
+      return false;
+    }
+    EraseAt(slots_[slot].index);
+    return true;
+  }
+
+  /**
+   * @brief Calls `pred` on every value and erases those it returns true
+   *        for, each visited exactly once.
+   *
+   * Walks from the back, so the value an erase moves into the gap is one
+   * already visited.
+   *
+   * @return how many were erased.
+   */
+  template <typename Pred>
+  size_t EraseIf(Pred&& pred) {
+    size_t erased = 0;
+    for (size_t i = values_.size(); i-- > 0;) {
+      if (pred(values_[i])) {
+        EraseAt(static_cast<uint32_t>(i));
+        erased++;
+      }
+    }
+    return erased;
+  }
+
+  /** @brief Drops every value. Keys issued before stay invalid. */
+  void Clear() {
+    while (!values_.empty()) {
+      EraseAt(static_cast<uint32_t>(values_.size() - 1));
+    }
+  }
+
+  ZNET_NODISCARD size_t size() const { return values_.size(); }
+  ZNET_NODISCARD bool empty() const { return values_.empty(); }
+
+  iterator begin() { return values_.begin(); }
+  iterator end() { return values_.end(); }
+  const_iterator begin() const { return values_.begin(); }
+  const_iterator end() const { return values_.end(); }
+
+ private:
+  static constexpr uint32_t kNoSlot = 0xFFFFFFFFu;
+
+  struct Slot {
+    // while live, where its value sits in values_; while free, the next
+    // free slot
+    uint32_t index = kNoSlot;
+    uint32_t generation = 1;
+  };
+
+  static Key MakeKey(uint32_t slot, uint32_t generation) {
+    return (static_cast<Key>(generation) << 32) | slot;
+  }
+
+  /** @brief The live slot `key` names, or kNoSlot. */
+  uint32_t SlotOf(Key key) const {
+    const auto slot = static_cast<uint32_t>(key & 0xFFFFFFFFu);
+    const auto generation = static_cast<uint32_t>(key >> 32);
+    if (slot >= slots_.size() || slots_[slot].generation != generation) {
+      return kNoSlot;
+    }
+    return slot;
+  }
+
+  void EraseAt(uint32_t index) {
+    const uint32_t slot = owners_[index];
+    const auto last = static_cast<uint32_t>(values_.size() - 1);
+    if (index != last) {
+      values_[index] = std::move(values_[last]);
+      owners_[index] = owners_[last];
+      slots_[owners_[index]].index = index;
+    }
+    values_.pop_back();
+    owners_.pop_back();
+    // zero is what kNullKey carries, so a wrapped generation skips it
+    uint32_t generation = slots_[slot].generation + 1;
+    slots_[slot].generation = generation == 0 ? 1 : generation;
+    slots_[slot].index = free_head_;
+    free_head_ = slot;
+  }
+
+  std::vector<T> values_;
+  // which slot each value belongs to, parallel to values_
+  std::vector<uint32_t> owners_;
+  std::vector<Slot> slots_;
+  uint32_t free_head_ = kNoSlot;
+};
+
+}  // namespace detail
+}  // namespace znet
+
+#endif  // ZNET_DETAIL_SLOT_MAP_H_
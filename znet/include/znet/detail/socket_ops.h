@@ -25,11 +25,32 @@
 #include "znet/types.h"
 
 #include <cstddef>
+#include <cstring>
 #include <limits>
 
 #ifndef ZNET_TARGET_WIN
 #include <cerrno>
 #include <poll.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef ZNET_TARGET_LINUX
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <sys/sendfile.h>
+#define ZNET_HAS_SENDFILE 1
+#else
+#define ZNET_HAS_SENDFILE 0
+#endif
+
+// MSG_ZEROCOPY, Linux 4.14 on. The headers may be newer than the kernel; a
+// kernel without it refuses SO_ZEROCOPY, and the transport never asks again.
+#if defined(ZNET_TARGET_LINUX) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define ZNET_HAS_ZEROCOPY 1
+#else
+#define ZNET_HAS_ZEROCOPY 0
 #endif
 
 namespace znet {
@@ -129,6 +150,157 @@ inline ssize_t SocketSend(SocketHandle socket, const void* data, size_t len) {
 #endif
 }
 
+/**
+ * @brief One piece of a gathered send: an iovec, or Winsock's WSABUF.
+ *
+ * Filled with SetIoSlice(), since the two lay out and name their fields
+ * differently.
+ */
+#ifdef ZNET_TARGET_WIN
+using SocketIoSlice = WSABUF;
+#else
+using SocketIoSlice = iovec;
+#endif
+
+inline void SetIoSlice(SocketIoSlice& slice, const void* data, size_t len) {
+  const size_t length = detail::SocketIoLength(len);
+#ifdef ZNET_TARGET_WIN
+  // WSASend never writes through it; WSABUF is simply not const-qualified
+  slice.buf = static_cast<CHAR*>(const_cast<void*>(data));
+  slice.len = static_cast<ULONG>(length);
+#else
+  slice.iov_base = const_cast<void*>(data);
+  slice.iov_len = length;
+#endif
+}
+
+/**
+ * @brief Sends `count` slices over a connected socket in one call, in order.
+ *
+ * Like SocketSend() the transfer can be short, and it can end anywhere,
+ * including inside a slice. @return bytes sent, or -1 on error.
+ */
+inline ssize_t SocketSendv(SocketHandle socket, SocketIoSlice* slices,
+                           size_t count) {
+#ifdef ZNET_TARGET_WIN
+  DWORD sent = 0;
+  if (WSASend(socket, slices, static_cast<DWORD>(count), &sent, 0, nullptr,
+              nullptr) != 0) {
+    return -1;
+  }
+  return static_cast<ssize_t>(sent);
+#else
+  msghdr message{};
+  message.msg_iov = slices;
+  message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(count);
+#if defined(MSG_NOSIGNAL)
+  // see SocketSend()
+  return sendmsg(socket, &message, MSG_NOSIGNAL);
+#else
+  return sendmsg(socket, &message, 0);
+#endif
+#endif
+}
+
+#if ZNET_HAS_SENDFILE
+/**
+ * @brief Sends `len` bytes of the file `fd` from `offset` over a connected
+ *        socket, the kernel copying them without a trip through user space.
+ *
+ * Short like SocketSend(). @return bytes sent, or -1 on error.
+ */
+inline ssize_t SocketSendFile(SocketHandle socket, int fd, uint64_t offset,
+                              size_t len) {
+  // sendfile() takes no MSG_NOSIGNAL, so SIGPIPE is held back on this thread
+  // for the call, and one it raised is taken before it can be delivered
+  sigset_t pipe_set;
+  sigset_t old_set;
+  sigemptyset(&pipe_set);
+  sigaddset(&pipe_set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+  off_t position = static_cast<off_t>(offset);
+  const ssize_t sent =
+      sendfile(socket, fd, &position, detail::SocketIoLength(len));
+  if (sent < 0 && errno == EPIPE) {
+    const int error = errno;
+    const timespec no_wait{0, 0};
+    sigtimedwait(&pipe_set, nullptr, &no_wait);
+    errno = error;
+  }
+  pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+  return sent;
+}
+#endif
+
+#if ZNET_HAS_ZEROCOPY
+/** @brief Allows SocketSendvZeroCopy() on the socket. @return false if the
+ *         kernel refuses it. */
+inline bool SocketEnableZeroCopy(SocketHandle socket) {
+  int one = 1;
+  return setsockopt(socket, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+}
+
+/**
+ * @brief SocketSendv() with MSG_ZEROCOPY: the kernel sends from the slices'
+ *        pages instead of copying them, so they must stay untouched until
+ *        SocketReadZeroCopyCompletion() reports the send done.
+ *
+ * Each call that sends anything takes the next of the socket's send ids,
+ * counting from zero. @return bytes sent, or -1 on error.
+ */
+inline ssize_t SocketSendvZeroCopy(SocketHandle socket, SocketIoSlice* slices,
+                                   size_t count) {
+  msghdr message{};
+  message.msg_iov = slices;
+  message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(count);
+  return sendmsg(socket, &message, MSG_ZEROCOPY | MSG_NOSIGNAL);
+}
+
+/**
+ * @brief Takes one completion off the socket's error queue, without waiting.
+ *
+ * A completion covers the zerocopy sends `out_first` through `out_last`
+ * inclusive; `out_copied` says the kernel copied their bytes after all, as
+ * it does over loopback.
+ *
+ * @return 1 for a completion, 0 when none is waiting, -1 on error.
+ */
+inline int SocketReadZeroCopyCompletion(SocketHandle socket,
+                                        uint32_t* out_first,
+                                        uint32_t* out_last,
+                                        bool* out_copied) {
+  // anything else on the error queue is taken off it and skipped
+  for (;;) {
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err)) + 64];
+    msghdr message{};
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+      const bool ip = (header->cmsg_level == SOL_IP &&
+                       header->cmsg_type == IP_RECVERR) ||
+                      (header->cmsg_level == SOL_IPV6 &&
+                       header->cmsg_type == IPV6_RECVERR);
+      if (!ip) {
+        continue;
+      }
+      sock_extended_err error;
+      std::memcpy(&error, CMSG_DATA(header), sizeof(error));
+      if (error.ee_errno != 0 || error.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      *out_first = error.ee_info;
+      *out_last = error.ee_data;
+      *out_copied = (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+      return 1;
+    }
+  }
+}
+#endif
+
 /**
  * @brief Receives from a connected socket. @return bytes read, 0 on an orderly
  *        shutdown by the peer, or -1 on error.
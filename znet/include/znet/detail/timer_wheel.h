@@ -0,0 +1,137 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Internal: the deadlines a server worker sleeps until. Each session it owns
+// has at most one, the soonest of its transport's retransmit, probe,
+// keepalive and idle timers, so a worker holding thousands of quiet sessions
+// wakes when one of them is due rather than every tick to ask all of them.
+//
+// A hierarchical wheel of millisecond ticks: 256 slots one tick wide, then
+// three levels of 64 slots each 64 times wider than the last, about eighteen
+// hours in all. Scheduling and cancelling are constant time; an entry far out
+// is moved down a level as its slot comes round, never scanned before.
+//
+
+#ifndef ZNET_DETAIL_TIMER_WHEEL_H_
+#define ZNET_DETAIL_TIMER_WHEEL_H_
+
+#include "znet/compat.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace znet {
+namespace detail {
+
+/**
+ * @brief Deadlines at millisecond resolution, fired in order of expiry.
+ *
+ * Not thread-safe: one worker owns it and everything scheduled on it.
+ */
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using TimePoint = Clock::time_point;
+
+  /**
+   * @brief One deadline, embedded in whatever it belongs to. Cancel it, or
+   *        let it fire, before destroying it.
+   */
+  class Node {
+   public:
+    Node() = default;
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+
+    ZNET_NODISCARD bool scheduled() const { return next_ != nullptr; }
+
+   private:
+    friend class TimerWheel;
+
+    Node* prev_ = nullptr;
+    Node* next_ = nullptr;
+    uint64_t expiry_ = 0;  // in ticks since the wheel's epoch
+  };
+
+  explicit TimerWheel(TimePoint now = Clock::now());
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /**
+   * @brief Arms `node` for `deadline`, rounded up to the next tick, moving
+   *        it if it was already armed. A deadline already past fires on the
+   *        next Advance().
+   */
+  void Schedule(Node& node, TimePoint deadline);
+
+  /** @brief Disarms `node`; nothing if it was not armed. */
+  void Cancel(Node& node);
+
+  /**
+   * @brief Moves the wheel up to `now`, handing every node that fell due
+   *        to `fire`, disarmed, oldest expiry first. `fire` may arm nodes
+   *        again, this one included.
+   *
+   * @return how many fired.
+   */
+  size_t Advance(TimePoint now, const std::function<void(Node&)>& fire);
+
+  /**
+   * @brief When Advance() could next fire anything: exact for a deadline
+   *        within 256 ticks, and otherwise the moment the next one moves
+   *        closer, which is never later. TimePoint::max() when empty.
+   */
+  ZNET_NODISCARD TimePoint NextExpiry() const;
+
+  ZNET_NODISCARD size_t size() const { return size_; }
+  ZNET_NODISCARD bool empty() const { return size_ == 0; }
+
+ private:
+  static constexpr int kRootBits = 8;
+  static constexpr int kLevelBits = 6;
+  static constexpr size_t kRootSlots = size_t{1} << kRootBits;
+  static constexpr size_t kLevelSlots = size_t{1} << kLevelBits;
+  static constexpr int kLevels = 3;
+  // the furthest a deadline can sit; later ones are pulled in to it
+  static constexpr uint64_t kMaxDelta =
+      (uint64_t{1} << (kRootBits + kLevels * kLevelBits)) - 1;
+
+  // a circular list's head; a slot with head.next_ == &head is empty
+  struct Slot {
+    Node head;
+    Slot() { head.prev_ = head.next_ = &head; }
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+  };
+
+  /** @brief Links `node` into the slot its expiry falls in from now_. */
+  void Place(Node& node);
+  /** @brief Re-places everything in one slot of an outer level. */
+  void Cascade(int level, size_t index);
+
+  ZNET_NODISCARD uint64_t CeilTick(TimePoint time) const;
+  ZNET_NODISCARD uint64_t FloorTick(TimePoint time) const;
+
+  TimePoint epoch_;
+  // the last tick Advance() reached; everything armed expires after it
+  uint64_t now_ = 0;
+  size_t size_ = 0;
+  std::array<Slot, kRootSlots> root_;
+  std::array<std::array<Slot, kLevelSlots>, kLevels> levels_;
+};
+
+}  // namespace detail
+}  // namespace znet
+
+#endif  // ZNET_DETAIL_TIMER_WHEEL_H_
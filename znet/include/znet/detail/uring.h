@@ -0,0 +1,177 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// A minimal io_uring: the rings, one group of provided buffers, and the
+// handful of calls the io_uring backend makes, over the raw system calls so
+// that nothing beyond the kernel's own headers is needed.
+//
+// Every ring here has one thread that submits to it and reaps it, the thread
+// that created it; nothing in this class locks.
+//
+
+#ifndef ZNET_DETAIL_URING_H_
+#define ZNET_DETAIL_URING_H_
+
+#include "znet/compat.h"
+#include "znet/detail/platform.h"
+
+// 0 leaves the io_uring backend out even where the platform has it
+#ifndef ZNET_ENABLE_IO_URING
+#define ZNET_ENABLE_IO_URING 1
+#endif
+
+#if defined(ZNET_TARGET_LINUX) && ZNET_ENABLE_IO_URING
+#define ZNET_HAS_IO_URING 1
+#else
+#define ZNET_HAS_IO_URING 0
+#endif
+
+#if ZNET_HAS_IO_URING
+
+#include <linux/io_uring.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace znet {
+namespace detail {
+
+class Uring {
+ public:
+  Uring() = default;
+  ~Uring();
+  Uring(const Uring&) = delete;
+  Uring& operator=(const Uring&) = delete;
+
+  /**
+   * @brief Whether this kernel has everything the io_uring backend uses:
+   *        multishot receives, so Linux 6.0 on,
+   *        with io_uring not disabled. Probed once.
+   */
+  static bool Supported();
+
+  /**
+   * @brief The user_data of the submissions this class makes itself. Their
+   *        completions, failures only, are the caller's to skip.
+   */
+  static constexpr uint64_t kInternal = ~uint64_t{0};
+
+  /**
+   * @brief Creates the ring with room for `entries` submissions and four
+   *        times that many completions. The calling thread becomes the only
+   *        one that may submit.
+   */
+  bool Init(unsigned entries);
+
+  ZNET_NODISCARD bool valid() const { return fd_ >= 0; }
+
+  /**
+   * @brief A zeroed submission to fill in, or null when the queue is full
+   *        until the next Submit().
+   */
+  io_uring_sqe* NextSqe();
+
+  /** @brief How many NextSqe() calls succeed before the next Submit(). */
+  ZNET_NODISCARD unsigned space() const {
+    return sq_entries_ -
+           (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE));
+  }
+
+  /**
+   * @brief Hands the kernel every submission filled since the last call, in
+   *        one system call. @return how many it took, or -errno.
+   */
+  int Submit();
+
+  /**
+   * @brief Waits up to `timeout` for a completion, or not at all when one is
+   *        waiting already. Also runs the ring's deferred work, so call it
+   *        before Reap() even with a zero timeout.
+   */
+  void Wait(std::chrono::nanoseconds timeout);
+
+  /**
+   * @brief Calls `fn` with each waiting completion, oldest first, and
+   *        consumes them. `fn` may fill new submissions.
+   *
+   * @return how many there were.
+   */
+  template <typename Fn>
+  size_t Reap(Fn&& fn) {
+    unsigned head = *cq_head_;
+    size_t count = 0;
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      const io_uring_cqe cqe = cqes_[head & cq_mask_];
+      head++;
+      // consumed before the call, so a slot is never reused under it
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      fn(cqe);
+      count++;
+    }
+    return count;
+  }
+
+  /**
+   * @brief Provides `count` buffers of `size` bytes each as buffer group
+   *        `group`, for receives that pick their own. Call it before
+   *        anything else is in flight: it waits for its own completion.
+   */
+  bool SetupBuffers(uint16_t group, uint16_t count, uint32_t size);
+
+  /** @brief The bytes of provided buffer `id`. */
+  ZNET_NODISCARD const char* buffer(uint16_t id) const {
+    return buffers_ + static_cast<size_t>(id) * buffer_size_;
+  }
+
+  /**
+   * @brief Gives buffer `id` back to the kernel once its bytes are read.
+   *        Takes a submission, going out with the next Submit().
+   */
+  void RecycleBuffer(uint16_t id);
+
+ private:
+  int Enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+            const void* arg, size_t arg_size);
+
+  int fd_ = -1;
+  // the mappings, released in the destructor
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  // filled but not yet published to the kernel
+  unsigned sqe_tail_ = 0;
+
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  char* buffers_ = nullptr;
+  size_t buffers_size_ = 0;
+  uint32_t buffer_size_ = 0;
+  uint16_t buffer_group_ = 0;
+};
+
+}  // namespace detail
+}  // namespace znet
+
+#endif  // ZNET_HAS_IO_URING
+
+#endif  // ZNET_DETAIL_URING_H_
@@ -210,9 +210,21 @@ class EncryptionLayer {
    *                nonce, so each stream has its own sequence and its own
    *                replay window on the far side. A single-stream transport
    *                always passes 0.
+   * @param tail    more of the message, after `buffer`, read where it lies.
    */
   std::shared_ptr<Buffer> HandleOut(std::shared_ptr<Buffer> buffer,
-                                    uint8_t stream);
+                                    uint8_t stream, const char* tail = nullptr,
+                                    size_t tail_size = 0);
+
+  /**
+   * @brief Whether messages are encrypted, once the handshake has settled.
+   *        Before that, and on an unencrypted session, they go out as they
+   *        are.
+   *
+   * Written only during the handshake, so once the session is ready any
+   * thread may read it: PeerSession::IsReady() publishes it with the rest.
+   */
+  ZNET_NODISCARD bool encrypts() const { return enable_encryption_; }
 
   void OnHandshakePacket(std::shared_ptr<HandshakePacket> packet);
   void OnAcknowledgePacket(std::shared_ptr<ConnectionReadyPacket> packet);
@@ -24,6 +24,7 @@ enum EventCategory {
   EventCategoryServer = 1 << 0,
   EventCategoryClient = 1 << 1,
   EventCategoryP2P = 1 << 2,
+  EventCategorySession = 1 << 3,
 };
 
 class Event {
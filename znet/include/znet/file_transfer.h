@@ -0,0 +1,132 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Files sent with PeerSession::SendFile(). A file goes out as a stream, so the
+// receiver sees it through the stream callback like any other; what this adds
+// is the sending side: the file is mapped rather than read, and its bytes go
+// to the wire, or into the cipher, from the mapping.
+//
+
+#ifndef ZNET_FILE_TRANSFER_H_
+#define ZNET_FILE_TRANSFER_H_
+
+#include "znet/compat.h"
+#include "znet/detail/mapped_file.h"
+#include "znet/event.h"
+#include "znet/stream.h"
+#include "znet/types.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace znet {
+
+/** @brief SendFile()'s length for everything from the offset on. */
+ZNET_INLINE_CONSTEXPR uint64_t kToEndOfFile = ~uint64_t{0};
+
+/**
+ * @brief Event fired as a file's bytes are handed to the session.
+ *
+ * At most once per worker pass per file, so a fast transfer does not raise
+ * one per chunk.
+ */
+class FileTransferProgressEvent : public Event {
+ public:
+  FileTransferProgressEvent(StreamId stream_id, uint64_t bytes_sent,
+                            uint64_t total_bytes)
+      : stream_id_(stream_id),
+        bytes_sent_(bytes_sent),
+        total_bytes_(total_bytes) {}
+
+  /** @brief The stream the receiver sees the file on. */
+  ZNET_NODISCARD StreamId stream_id() const { return stream_id_; }
+  ZNET_NODISCARD uint64_t bytes_sent() const { return bytes_sent_; }
+  ZNET_NODISCARD uint64_t total_bytes() const { return total_bytes_; }
+
+  ZNET_EVENT_CLASS_TYPE(FileTransferProgressEvent)
+  ZNET_EVENT_CLASS_CATEGORY(EventCategorySession)
+ private:
+  StreamId stream_id_;
+  uint64_t bytes_sent_;
+  uint64_t total_bytes_;
+};
+
+/**
+ * @brief Event fired once per file, when the last of it and the end of its
+ *        stream are queued, or when the session closes first.
+ *
+ * Queued, not delivered: the chunks are reliable, so they arrive unless the
+ * session is lost on the way.
+ */
+class FileTransferCompletedEvent : public Event {
+ public:
+  FileTransferCompletedEvent(StreamId stream_id, Result result,
+                             uint64_t bytes_sent, uint64_t total_bytes)
+      : stream_id_(stream_id),
+        result_(result),
+        bytes_sent_(bytes_sent),
+        total_bytes_(total_bytes) {}
+
+  ZNET_NODISCARD StreamId stream_id() const { return stream_id_; }
+  /** @brief Success, or NotConnected when the session closed first. */
+  ZNET_NODISCARD Result result() const { return result_; }
+  ZNET_NODISCARD uint64_t bytes_sent() const { return bytes_sent_; }
+  ZNET_NODISCARD uint64_t total_bytes() const { return total_bytes_; }
+
+  ZNET_EVENT_CLASS_TYPE(FileTransferCompletedEvent)
+  ZNET_EVENT_CLASS_CATEGORY(EventCategorySession)
+ private:
+  StreamId stream_id_;
+  Result result_;
+  uint64_t bytes_sent_;
+  uint64_t total_bytes_;
+};
+
+namespace detail {
+
+/**
+ * @brief One file on its way out. Owned by the session and driven by its
+ *        worker.
+ */
+class FileTransfer {
+ public:
+  FileTransfer(std::shared_ptr<MappedFile> file,
+               std::shared_ptr<StreamWriter> writer, EventCallbackFn on_event);
+
+  /** @brief Queues what credit and the session's queue take, silently. */
+  void Write();
+
+  /**
+   * @brief Write(), then the events it earned.
+   *
+   * @param alive whether the session still is; a transfer outliving it
+   *        completes with NotConnected.
+   * @return whether the transfer is over, completed either way.
+   */
+  bool Pump(bool alive);
+
+  ZNET_NODISCARD StreamId stream_id() const { return writer_->id(); }
+
+ private:
+  void Complete(Result result);
+
+  std::shared_ptr<MappedFile> file_;
+  std::shared_ptr<StreamWriter> writer_;
+  EventCallbackFn on_event_;
+  uint64_t sent_ = 0;
+  uint64_t reported_ = 0;
+  bool done_ = false;
+};
+
+}  // namespace detail
+}  // namespace znet
+
+#endif  // ZNET_FILE_TRANSFER_H_
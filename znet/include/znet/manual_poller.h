@@ -0,0 +1,94 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// What a Server or Client under DriveMode::Manual waits on in place of its
+// threads: every descriptor its backend would have had a thread watch, plus
+// one more that any other thread can raise. On Linux that is an epoll set
+// with an eventfd in it, and the epoll descriptor is what the application
+// adds to its own loop.
+//
+
+#ifndef ZNET_MANUAL_POLLER_H_
+#define ZNET_MANUAL_POLLER_H_
+
+#include "znet/compat.h"
+#include "znet/types.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace znet {
+
+/**
+ * @brief A level-triggered readiness set plus a wake, for a loop the
+ *        application runs.
+ *
+ * Add() and Wait() belong to the driving thread; Wake() is callable from
+ * any. Descriptors leave the set by being closed. Off Linux there is no set:
+ * fd() is invalid, Add() does nothing, and Wait() returns on Wake() or the
+ * timeout only.
+ */
+class ManualPoller {
+ public:
+  ManualPoller();
+  ~ManualPoller();
+
+  ManualPoller(const ManualPoller&) = delete;
+  ManualPoller& operator=(const ManualPoller&) = delete;
+
+  /** @brief Readable whenever Wait() would return at once. -1 where there is
+   *         none to give out. */
+  ZNET_NODISCARD int fd() const { return epoll_fd_; }
+
+  /**
+   * @brief Watches `socket` for input, or for a hang-up or error.
+   *
+   * @param tag what Wait() reports `socket` as when it is ready. Null leaves
+   *        it unreported: its readiness still ends the wait.
+   */
+  void Add(SocketHandle socket, void* tag = nullptr);
+
+  /** @brief Makes the set ready until the next Drain(). Any thread. */
+  void Wake();
+
+  /** @brief Takes back the readiness Wake() gave. */
+  void Drain();
+
+  /**
+   * @brief Blocks until something in the set is ready, Wake() was called
+   *        since the last Drain(), or `timeout` passes.
+   *
+   * @param ready if given, has the tag of each tagged descriptor found ready
+   *        appended, each once. At most kMaxEvents are taken per call; the
+   *        rest stay ready, so the next call returns at once with them.
+   * @return whether it returned for a reason other than the timeout.
+   */
+  bool Wait(std::chrono::milliseconds timeout,
+            std::vector<void*>* ready = nullptr);
+
+  static constexpr int kMaxEvents = 64;
+
+ private:
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+  // set by the Wake() that wrote, so a burst of them writes once
+  std::atomic_bool woken_{false};
+  // the wait itself, where there is no descriptor to wait on
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+}  // namespace znet
+
+#endif  // ZNET_MANUAL_POLLER_H_
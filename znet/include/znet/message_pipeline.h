@@ -28,6 +28,7 @@
 #include "znet/packet_handler.h"
 #include "znet/types.h"
 
+#include <atomic>
 #include <memory>
 
 namespace znet {
@@ -41,7 +42,7 @@ class EncryptionLayer;
  * @par Threading
  * Not synchronized. Everything here belongs to whichever thread currently holds
  * the session's encode claim, which is what lets the codec and the cipher state
- * be touched without a lock.
+ * be touched without a lock. Prepare() is the exception; see there.
  */
 class MessagePipeline {
  public:
@@ -75,6 +76,71 @@ class MessagePipeline {
                                  uint8_t stream,
                                  size_t* out_payload_bytes = nullptr);
 
+  /**
+   * @brief Encode's first two stages: serialize, then compress.
+   *
+   * Neither keeps state between messages, so unlike the rest of this class it
+   * may run on any thread once the session is ready, which is what
+   * CommonOptions::encode_on_send does with it. The codec is read through an
+   * atomic view and the compression type is an atomic read once per message,
+   * so a SetOutCompression() mid-session takes effect from the next message
+   * rather than racing this one. Replacing an installed codec is the one thing
+   * it cannot survive, which PeerSession::SetCodec() refuses in that mode.
+   *
+   * @return null if either stage fails, having logged why.
+   */
+  std::shared_ptr<Buffer> Prepare(const std::shared_ptr<Packet>& packet,
+                                  size_t* out_payload_bytes = nullptr);
+
+  /**
+   * @brief Prepare() for a packet whose last `trailing_bytes` stay where they
+   *        are, for Seal() or the transport to take from there.
+   *
+   * The frame is written whole except for those bytes, so nothing is
+   * compressed: the caller checks out_compression() is None first.
+   *
+   * @return null if serializing fails, having logged why.
+   */
+  std::shared_ptr<Buffer> PrepareHead(const std::shared_ptr<Packet>& packet,
+                                      size_t trailing_bytes,
+                                      size_t* out_payload_bytes = nullptr);
+
+  /**
+   * @brief Serializes a packet onto the end of `batch`, for Compress() and
+   *        Seal() to finish together with whatever else it holds.
+   *
+   * The receiving side needs nothing new: Dispatch() reads every frame in a
+   * payload. Under the encode claim, like the stages that follow it.
+   *
+   * @param out_payload_bytes optionally receives the bytes this packet added.
+   * @return false if it failed, having logged why and left `batch` as it was.
+   */
+  bool Append(const std::shared_ptr<Packet>& packet,
+              const std::shared_ptr<Buffer>& batch,
+              size_t* out_payload_bytes = nullptr);
+
+  /**
+   * @brief Prepare()'s second stage on its own: compress a serialized payload
+   *        unless it is under the compression threshold.
+   *
+   * @return null if compression fails, having logged why.
+   */
+  std::shared_ptr<Buffer> Compress(std::shared_ptr<Buffer> buffer);
+
+  /**
+   * @brief Encode's last stage: encrypt a buffer Prepare() produced.
+   *
+   * The one order-sensitive stage, since the nonce is a per-stream counter, so
+   * it stays with whoever holds the encode claim.
+   *
+   * @param tail  bytes that follow `buffer` in the message, read in place by
+   *              the cipher, after PrepareHead() left them out.
+   * @return null if encryption fails, having logged why.
+   */
+  std::shared_ptr<Buffer> Seal(std::shared_ptr<Buffer> buffer, uint8_t stream,
+                               const char* tail = nullptr,
+                               size_t tail_size = 0);
+
   /**
    * @brief Wire bytes to payload: decrypt, then decompress.
    *
@@ -93,14 +159,21 @@ class MessagePipeline {
   DecodeStats Dispatch(const std::shared_ptr<Buffer>& payload,
                        PacketHandlerBase& handler);
 
-  ZNET_NODISCARD bool has_codec() const { return codec_ != nullptr; }
+  ZNET_NODISCARD bool has_codec() const {
+    return codec_view_.load(std::memory_order_acquire) != nullptr;
+  }
 
-  void SetCodec(std::shared_ptr<Codec> codec) { codec_ = std::move(codec); }
+  void SetCodec(std::shared_ptr<Codec> codec) {
+    codec_ = std::move(codec);
+    codec_view_.store(codec_.get(), std::memory_order_release);
+  }
 
   ZNET_NODISCARD CompressionType out_compression() const {
-    return out_compression_;
+    return out_compression_.load(std::memory_order_relaxed);
+  }
+  void SetOutCompression(CompressionType type) {
+    out_compression_.store(type, std::memory_order_relaxed);
   }
-  void SetOutCompression(CompressionType type) { out_compression_ = type; }
 
   /** @brief Messages below this many bytes skip compression entirely. */
   void SetCompressionThreshold(size_t bytes) { compression_threshold_ = bytes; }
@@ -122,8 +195,13 @@ class MessagePipeline {
  private:
   EncryptionLayer& encryption_;
   SessionId id_;
-  std::shared_ptr<Codec> codec_;
-  CompressionType out_compression_ = CompressionType::None;
+  std::shared_ptr<Codec> codec_;  // owns what codec_view_ points at
+  // what the encode path reads, so a sender preparing off the worker never
+  // touches the shared_ptr SetCodec() is writing
+  std::atomic<Codec*> codec_view_{nullptr};
+  // relaxed: a message compressed either way decodes, the receiver reads the
+  // type from its header
+  std::atomic<CompressionType> out_compression_{CompressionType::None};
   size_t compression_threshold_ = 128;
   bool dump_on_decode_failure_ = false;
 };
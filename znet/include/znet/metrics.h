@@ -32,6 +32,7 @@
 #include "znet/types.h"
 
 #include <cstdint>
+#include <vector>
 
 #ifndef ZNET_ENABLE_METRICS
 #define ZNET_ENABLE_METRICS 1
@@ -67,6 +68,10 @@ struct CommonMetrics {
    *         full. A SendPacket() that never reached the transport, such as one
    *         answered with Result::QueueFull, is not counted here. */
   uint64_t send_failures = 0;
+  /** @brief Sent messages that shared their encryption and transport frame
+   *         with others, per CommonOptions::coalesce_max_bytes. Against
+   *         messages_sent this is how much packing is happening. */
+  uint64_t coalesced_messages = 0;
   uint64_t invalid_frames = 0;  /**< Inbound frames that failed to decode. */
   uint64_t wire_bytes_sent = 0;  /**< Including transport framing. */
   uint64_t wire_bytes_received = 0;
@@ -75,10 +80,60 @@ struct CommonMetrics {
 
 /** @brief Counters only a TCP session reports. */
 struct TCPSessionMetrics {
-  uint64_t writes = 0;  /**< Send() calls that succeeded. */
+  /** @brief Gathered send syscalls that wrote anything. */
+  uint64_t writes = 0;
+  /** @brief Frames written whole, control frames included. Over writes, the
+   *         frames each syscall carried. */
+  uint64_t frames_sent = 0;
+  /** @brief Messages refused under SlowConsumerPolicy::Shed. */
+  uint64_t frames_shed = 0;
+  /** @brief Bytes waiting for the socket to turn writable. Sampled, not
+   *         accumulated. */
+  uint64_t queued_bytes = 0;
+  /** @brief Frames carrying a piece of a message too large for one. */
+  uint64_t fragments_sent = 0;
+  /** @brief Messages put back together from fragments, or read as one run
+   *         from SendFile(). */
+  uint64_t messages_reassembled = 0;
+  /** @brief File bytes the kernel copied to the socket with sendfile(). */
+  uint64_t file_bytes_sent = 0;
+  /** @brief MSG_ZEROCOPY sends the kernel reported done from the frames'
+   *         own pages. */
+  uint64_t zerocopy_completed = 0;
+  /** @brief MSG_ZEROCOPY sends the kernel reported it copied after all. */
+  uint64_t zerocopy_copied = 0;
   uint64_t reads = 0;  /**< Recv() calls that returned data. */
 };
 
+/** @brief Counters only a shared memory session reports. */
+struct SharedMemorySessionMetrics {
+  /** @brief Eventfd writes to wake the peer, which only happen after it
+   *         went to sleep on an empty or full ring. Over messages_sent,
+   *         how often the steady state was left. */
+  uint64_t wakeups_sent = 0;
+  /** @brief Times a send found the peer's ring full and had to wait. */
+  uint64_t ring_full = 0;
+  /** @brief Bytes waiting for room in the peer's ring. Sampled, not
+   *         accumulated. */
+  uint64_t queued_bytes = 0;
+  /** @brief Records carrying a piece of a message too large for one. */
+  uint64_t fragments_sent = 0;
+  /** @brief Messages put back together from fragments. */
+  uint64_t messages_reassembled = 0;
+};
+
+/** @brief Counters only an in-process session reports. */
+struct InProcessSessionMetrics {
+  /** @brief Times this side woke the peer's loop: when a message landed on
+   *         a queue it had emptied, or freed room a full one was waiting on. */
+  uint64_t wakeups_sent = 0;
+  /** @brief Times a send found the peer's queue full and had to wait. */
+  uint64_t queue_full = 0;
+  /** @brief Bytes waiting for room in the peer's queue. Sampled, not
+   *         accumulated. */
+  uint64_t queued_bytes = 0;
+};
+
 /** @brief Counters only a ZDT session reports. */
 struct ZDTSessionMetrics {
   uint64_t datagrams_sent = 0;
@@ -91,6 +146,11 @@ struct ZDTSessionMetrics {
   uint64_t duplicates_dropped = 0;  /**< Deduped by the receiver. */
   uint64_t inbound_dropped = 0;  /**< Inbox full. */
   uint64_t reassemblies_dropped = 0;  /**< Incomplete, timed out or over cap. */
+  /** @brief Unreliable messages replaced, unsent, by a newer one with the same
+   *         CoalesceKey. */
+  uint64_t messages_superseded = 0;
+  /** @brief Unreliable messages dropped unsent past their DeadlineKey. */
+  uint64_t messages_expired = 0;
   /** @brief Smoothed round-trip estimate. Sampled, not accumulated. */
   uint32_t srtt_us = 0;
   /**
@@ -126,6 +186,8 @@ struct SessionMetrics {
   CommonMetrics common;
   TCPSessionMetrics tcp;
   ZDTSessionMetrics zdt;
+  SharedMemorySessionMetrics shm;
+  InProcessSessionMetrics inproc;
 };
 
 /**
@@ -142,6 +204,43 @@ struct ZDTServerMetrics {
   uint64_t datagrams_unroutable = 0;  /**< Online datagram from an unknown peer. */
   /** @brief Dropped by the allow/deny lists or the attempt throttle. */
   uint64_t admission_rejected = 0;
+  /** @brief Sessions left on the shared socket because one of their own,
+   *         asked for by ZDTOptions::connected_sockets, could not be set up. */
+  uint64_t connected_sockets_failed = 0;
+};
+
+/**
+ * @brief How the listener's own tick keeps time. Filled only with
+ *        ServerOptions::measure_ticks, on any transport.
+ */
+struct TickMetrics {
+  uint64_t ticks = 0;
+  uint64_t overruns = 0;  /**< Ticks whose work left nothing to wait for. */
+  /** @brief Summed lateness of each wake past its tick's deadline. Divided by
+   *         ticks - overruns, the mean jitter. */
+  uint64_t jitter_total_us = 0;
+  uint64_t jitter_max_us = 0;
+  uint64_t wait_us = 0;  /**< Wall time spent waiting for the next tick. */
+  /** @brief CPU time spent in those waits, which is what
+   *         ServerOptions::tick_spin_budget costs. */
+  uint64_t wait_cpu_us = 0;
+};
+
+/** @brief One of the server's workers; see WorkerOptions. */
+struct WorkerMetrics {
+  bool running = false;  /**< Started; elastic workers may not be yet. */
+  uint64_t sessions = 0;  /**< Sampled, not accumulated. */
+  /** @brief Time spent in its sessions' Process(). Diff two samples for
+   *         its load over the time between them. */
+  uint64_t busy_us = 0;
+  uint64_t sessions_moved_in = 0;  /**< Taken from a busier worker. */
+  uint64_t sessions_moved_out = 0;  /**< Handed to a less busy worker. */
+  /** @brief Ticks whose sessions took longer than
+   *         WorkerOptions::tick_budget. */
+  uint64_t budget_overruns = 0;
+  /** @brief Times a session was left for the next tick with work still to
+   *         do, by the tick's budget or its own. */
+  uint64_t sessions_deferred = 0;
 };
 
 /** @brief Listener-scope counters, across every session it accepted. */
@@ -150,6 +249,9 @@ struct ServerMetrics {
   uint64_t connections_accepted = 0;
   uint64_t connections_active = 0;
   ZDTServerMetrics zdt;
+  TickMetrics tick;
+  /** @brief One per worker, in a fixed order. */
+  std::vector<WorkerMetrics> workers;
 };
 
 }  // namespace znet
@@ -105,6 +105,74 @@ class MpscQueue {
     return true;
   }
 
+  /**
+   * @brief Appends up to `count` values with a single claim on the cursor.
+   *
+   * Where Push() costs a CAS per item, this reserves a run of contiguous slots
+   * in one, so a producer with a burst pays for the contention once. Accepts
+   * the longest prefix that fits: slots free up in order, since the one
+   * consumer releases them in order, so "free" is itself a prefix of the ring
+   * and a binary search over it finds the run.
+   *
+   * @param make       called as make(i) for i in [0, accepted), in order, and
+   *                   returns the value for that slot. Called after the claim,
+   *                   so it should be cheap, a move or a copy of something
+   *                   already built: the consumer cannot pass a claimed slot
+   *                   until it is filled.
+   * @param out_queued as Push(), for the first of the batch.
+   * @return how many were accepted, zero when the ring is full.
+   */
+  template <typename MakeFn>
+  size_t PushBatch(size_t count, MakeFn&& make, size_t* out_queued = nullptr) {
+    if (count == 0) {
+      return 0;
+    }
+    size_t pos = enqueue_.value.load(std::memory_order_relaxed);
+    size_t accepted;
+    for (;;) {
+      const size_t sequence =
+          cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+      const size_t distance = sequence - pos;
+      if (distance > kBehind) {
+        return 0;  // full: not even the first slot is free
+      }
+      if (distance != 0) {
+        pos = enqueue_.value.load(std::memory_order_relaxed);
+        continue;
+      }
+      // the first slot is free; find the last free one within reach
+      size_t lo = 1;
+      size_t hi = count < capacity() ? count : capacity();
+      while (lo < hi) {
+        const size_t mid = lo + (hi - lo + 1) / 2;
+        const size_t at = pos + mid - 1;
+        if (cells_[at & mask_].sequence.load(std::memory_order_acquire) == at) {
+          lo = mid;
+        } else {
+          hi = mid - 1;
+        }
+      }
+      accepted = lo;
+      // seq_cst for the wake handshake, as in Push()
+      if (enqueue_.value.compare_exchange_weak(pos, pos + accepted,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    if (out_queued != nullptr) {
+      *out_queued = pos - dequeue_.value.load(std::memory_order_seq_cst);
+    }
+    // published in order, so the consumer drains the run front to back and
+    // stops at whichever slot is still being filled
+    for (size_t i = 0; i < accepted; i++) {
+      Cell* cell = &cells_[(pos + i) & mask_];
+      cell->value = make(i);
+      cell->sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return accepted;
+  }
+
   /** @brief Takes the oldest item. Consumer thread only. */
   bool Pop(T& out) {
     Cell* cell = NextReadable();
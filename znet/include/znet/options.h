@@ -43,8 +43,10 @@ struct CommonOptions {
   /**
    * @brief Drop a session that has heard nothing from its peer for this long.
    *
-   * Both transports implement it, each against its own receive timestamps.
-   * Zero disables it, leaving liveness to the OS and the peer.
+   * TCP and ZDT implement it, each against its own receive timestamps.
+   * Zero disables it, leaving liveness to the OS and the peer. A shared
+   * memory session ignores it: a quiet peer on the same host is still there,
+   * and one that exits closes the socket checked every keepalive_interval.
    */
   std::chrono::milliseconds idle_timeout{10000};
 
@@ -68,7 +70,8 @@ struct CommonOptions {
    * marks exactly one peer as the initiator, so the other one decides.
    *
    * Turn it off only on an already-trusted transport, or to measure what the
-   * crypto costs.
+   * crypto costs. Shared memory sessions read SharedMemoryOptions::encryption
+   * instead.
    */
   bool encryption = true;
 
@@ -111,6 +114,59 @@ struct CommonOptions {
    */
   size_t send_queue_capacity = 512;
 
+  /**
+   * @brief Serialize and compress on the thread calling SendPacket().
+   *
+   * By default SendPacket() only queues, and the session's worker (or a
+   * client's encoder thread) runs the whole send pipeline. When many threads
+   * feed sessions that share one worker, that worker becomes the bottleneck.
+   * With this set the caller runs the codec and compression itself and queues
+   * the bytes, spreading that cost over the producing threads. Encryption
+   * stays with the drain, because its nonce order has to match the queue's.
+   *
+   * The codec's serializers are then called from several threads at once and
+   * must tolerate it, and SetCodec() has to have run before anything sends;
+   * once the session is ready an installed codec can no longer be replaced.
+   * SetOutCompression() stays safe from any thread and applies from the next
+   * packet prepared.
+   * A packet that fails to serialize is answered with Result::Failure rather
+   * than logged and dropped later, and a QueueFull refusal throws away the
+   * encoding work along with the slot it did not get.
+   */
+  bool encode_on_send = false;
+
+  /**
+   * @brief Pack consecutive queued packets into one message of up to this
+   *        many serialized bytes.
+   *
+   * Each message costs its own compression header, its own GCM tag and its
+   * own trip through the transport, which for a drain of small packets is
+   * most of the work. Packed, they are compressed and encrypted once, and
+   * compression gets to see a payload big enough to pay for itself. The
+   * receiver reads the frames back to back as it always has.
+   *
+   * Only what is already queued when the worker drains is packed; nothing is
+   * held back waiting for company, so a lone message leaves exactly as it
+   * would without this. Only transports with a single ordered stream pack at
+   * all (TCP today; ZDT fragments and acknowledges per message), and a
+   * transport may cap this lower to fit its own frame. Packets prepared by
+   * encode_on_send are already compressed and go out one by one. Zero
+   * disables it.
+   */
+  size_t coalesce_max_bytes = 2048;
+
+  /**
+   * @brief The longest the first packet of a packed message waits while the
+   *        ones behind it are serialized.
+   *
+   * Packing trades the first packet's latency for the batch's throughput, and
+   * with cheap serializers the trade is a few microseconds. This bounds it
+   * for expensive ones: once the message has been open this long it is sent
+   * as it stands and packing starts over. Zero packs only as far as the byte
+   * cap allows, however long that takes.
+   */
+  std::chrono::microseconds coalesce_max_delay{100};
+
   /**
    * @brief Log a hex dump of a decoded payload when a frame in it fails to
    *        decode.
@@ -234,6 +290,23 @@ struct ZDTOptions {
   int socket_recv_buffer = 4 * 1024 * 1024;
   /** @brief SO_SNDBUF, on the same terms as socket_recv_buffer. */
   int socket_send_buffer = 4 * 1024 * 1024;
+  /**
+   * @brief Gives each session a server accepts a UDP socket of its own,
+   *        bound to the server's port with SO_REUSEPORT and connect()ed to
+   *        the peer.
+   *
+   * The kernel then sorts datagrams by peer, so the receive thread and its
+   * route table drop out of the data path: each worker sleeps on its own
+   * sessions' sockets and reads them itself, and a send names no address
+   * for the kernel to route. The shared socket still takes handshakes.
+   *
+   * Costs a descriptor per session, and lets any process of the same user
+   * bind the port too. The per-session sockets keep the OS's default buffer
+   * sizes rather than the two above. A session whose socket cannot be set
+   * up stays on the shared one. Linux only, and read on the server only: a
+   * client always connect()s its socket once the handshake is done.
+   */
+  bool connected_sockets = false;
 
   // the three below bound a flooding peer and an application that outruns the
   // link; each is a hard cap after which traffic is dropped or refused
@@ -260,6 +333,133 @@ struct ZDTOptions {
   size_t max_reassemblies = 256;
 };
 
+/** @brief What a TCP session does with a peer that stops reading. */
+enum class SlowConsumerPolicy : uint8_t {
+  /** @brief Close the connection, resetting rather than lingering. */
+  Disconnect,
+  /** @brief Drop whole new messages until the backlog drains, and stay
+   * connected. For traffic where only the latest state matters. */
+  Shed,
+};
+
+/** @brief TCP tunables. */
+struct TCPOptions {
+  /**
+   * @brief Encoded bytes a session may hold back while its socket is full.
+   *
+   * A flush writes what the socket takes and keeps the rest, rather than
+   * waiting on a peer that stopped reading while every other session on the
+   * worker waits with it. The backlog goes out when the socket turns writable
+   * again. This bounds it: a message that would take the backlog past it
+   * triggers slow_consumer instead. Zero lets the backlog grow without
+   * limit.
+   */
+  size_t send_high_water = 4u * 1024u * 1024u;
+  /** @brief What crossing send_high_water costs the peer. */
+  SlowConsumerPolicy slow_consumer = SlowConsumerPolicy::Disconnect;
+  /**
+   * @brief Largest message a peer may send in fragments.
+   *
+   * A message too large for one frame arrives in pieces and is reassembled
+   * into a single buffer; this bounds that buffer, so a peer cannot make the
+   * session hold more by never sending the last piece. A message that
+   * outgrows it closes the connection.
+   */
+  size_t max_reassembly_bytes = 16u * 1024u * 1024u;
+  /**
+   * @brief Smallest gathered send that goes out with MSG_ZEROCOPY, or zero
+   *        to always copy.
+   *
+   * The kernel then sends from the frames' own pages instead of copying
+   * them, and they are held until it reports the send done. That
+   * notification costs about what a copy of ten kilobytes does, so below
+   * that a copy is cheaper. Linux only. Where the kernel copies anyway, as
+   * it does over loopback, the session goes back to plain sends after the
+   * first such report.
+   */
+  size_t zerocopy_threshold = 0;
+};
+
+/** @brief Shared memory tunables, for ConnectionType::SharedMemory. */
+struct SharedMemoryOptions {
+  /**
+   * @brief Bytes in each direction's ring, rounded up to a power of two.
+   *
+   * The accepting side's value is the one used; the connecting side maps
+   * whatever it is handed. A message larger than a quarter of the ring
+   * crosses in fragments, so this bounds how far a writer runs ahead of its
+   * reader, not how large a message may be.
+   */
+  size_t ring_bytes = 1024u * 1024u;
+  /**
+   * @brief Whether accepted sessions run the key exchange. Stands in for
+   *        CommonOptions::encryption, which these sessions ignore.
+   *
+   * Off, unlike over a socket: the only other party to the bytes is a
+   * process on the same host that can already read the mapping, so
+   * encrypting them guards against no one. Read on the accepting side only.
+   */
+  bool encryption = false;
+  /**
+   * @brief Encoded bytes a session may hold back while the peer's ring is
+   *        full. Past it the session closes; zero lets the backlog grow
+   *        without limit.
+   */
+  size_t send_high_water = 4u * 1024u * 1024u;
+  /**
+   * @brief Largest message a peer may send in fragments. A message that
+   *        outgrows it closes the session.
+   */
+  size_t max_reassembly_bytes = 16u * 1024u * 1024u;
+};
+
+/** @brief Tunables for ConnectionType::InProcess. */
+struct InProcessOptions {
+  /**
+   * @brief Messages each direction's queue holds, rounded up to a power of
+   *        two. The accepting side's value is the one used.
+   *
+   * A sender finding it full keeps the rest in a backlog of its own until
+   * the reader catches up, so this bounds the lock-free part, not what may be
+   * sent.
+   */
+  size_t queue_capacity = 4096;
+  /**
+   * @brief Encoded bytes a session may hold back while the peer's queue is
+   *        full. Past it the session closes; zero lets the backlog grow
+   *        without limit.
+   */
+  size_t send_high_water = 4u * 1024u * 1024u;
+};
+
+/** @brief Options for the byte streams of PeerSession::OpenStream(). */
+struct StreamOptions {
+  /**
+   * @brief Largest piece a stream is cut into.
+   *
+   * Each chunk is one reliable message, so this is what the transport
+   * fragments and reassembles at a time, however large the whole transfer.
+   * The default is a dozen datagrams on a typical path, well inside ZDT's
+   * fragment limit even at the smallest MTU it probes. Clamped to 64 KiB.
+   */
+  size_t chunk_bytes = 16u * 1024u;
+  /**
+   * @brief Bytes a peer may send on one stream ahead of what this side has
+   *        delivered.
+   *
+   * The receive half of flow control: credit is granted as chunks are
+   * handed to the stream callback, so a sender never runs further ahead than
+   * this however fast it writes. Never below kStreamInitialCredit, which a
+   * sender may use before the first grant arrives.
+   */
+  size_t window_bytes = 1024u * 1024u;
+  /**
+   * @brief Streams a peer may have open toward this side at once. A chunk
+   *        opening one more closes the session.
+   */
+  size_t max_inbound = 64;
+};
+
 /**
  * @brief Per-session options. A server applies these to every session it
  * accepts, a client to its own.
@@ -267,6 +467,92 @@ struct ZDTOptions {
 struct SessionOptions {
   CommonOptions common;
   ZDTOptions zdt;
+  TCPOptions tcp;
+  SharedMemoryOptions shm;
+  InProcessOptions inproc;
+  StreamOptions stream;
+};
+
+/** @brief How a server's sockets are driven. */
+enum class IoBackend : uint8_t {
+  /** @brief Readiness polling plus a system call per read and write. */
+  Readiness,
+  /**
+   * @brief One io_uring per worker: multishot accept and receive into
+   * provided buffers, linked sends, and each tick's submissions handed over
+   * in one batch. Linux 6.0 on, TCP only. A TCP server on an older kernel
+   * warns and uses Readiness; a ZDT server refuses it, and its Bind()
+   * returns Result::InvalidBackend.
+   */
+  IoUring,
+};
+
+/** @brief Who runs a Server's or Client's loop. */
+enum class DriveMode : uint8_t {
+  /** @brief Its own threads: the listener, the workers, the client's loop. */
+  Threads,
+  /**
+   * @brief The application's thread. Nothing is spawned; the application
+   * waits on poll_fd() with the rest of its descriptors, or in PollOnce(),
+   * and calls Process() when it turns readable. TCP and shared memory
+   * servers; TCP, shared memory and ZDT clients. The descriptor is Linux
+   * only; elsewhere PollOnce() still works.
+   */
+  Manual,
+};
+
+/**
+ * @brief The server's worker threads, which drive its sessions once their
+ *        handshakes are done.
+ */
+struct WorkerOptions {
+  /** @brief How many. Zero is one per CPU in `cpus`, or with `cpus` empty,
+   *         std::thread::hardware_concurrency(). */
+  uint32_t count = 0;
+  /**
+   * @brief CPUs to pin workers to, worker i on cpus[i % cpus.size()].
+   *
+   * Empty leaves placement to the OS, which may move a worker between cores
+   * and across caches that share nothing. Linux only; elsewhere the server
+   * warns and leaves them unpinned, as it does a CPU it cannot pin to.
+   */
+  std::vector<uint32_t> cpus;
+  /**
+   * @brief Start workers only as sessions need them, rather than all at
+   *        construction.
+   *
+   * A new session goes to the emptiest running worker, and a worker is
+   * started only when that one already holds `elastic_threshold` sessions,
+   * so a small service runs on the few it needs. A worker left without
+   * sessions parks: it sleeps with no tick until it is given one.
+   */
+  bool elastic = false;
+  /** @brief Sessions per running worker before elastic starts another. */
+  uint32_t elastic_threshold = 64;
+  /**
+   * @brief How often the server compares how long each worker spent in its
+   *        sessions' Process(), and has the busiest hand some of its
+   *        costliest sessions to the least busy. Zero never moves a session
+   *        after it is placed.
+   *
+   * A move happens only when the gap is over a twentieth of the interval,
+   * so an idle or even server never moves anything. Sessions whose I/O is
+   * their worker's own (IoBackend::IoUring, ZDTOptions::connected_sockets)
+   * never move.
+   */
+  std::chrono::milliseconds rebalance_interval{1000};
+  /**
+   * @brief How long one worker tick may spend dispatching its sessions'
+   *        messages. Zero leaves each session to its own message bound.
+   *
+   * Shared out by deficit round robin on handler time: each session with
+   * work is credited an equal slice per tick, spends it in Process(), and
+   * carries what it overspent into the next, so a session with costly
+   * handlers runs less often rather than longer. One the tick ran out
+   * before, or that ran out of credit itself, is deferred and runs first on
+   * the next tick. See WorkerMetrics::budget_overruns and sessions_deferred.
+   */
+  std::chrono::microseconds tick_budget{0};
 };
 
 /** @brief Listener-scope options: things that exist before any session does. */
@@ -302,6 +588,24 @@ struct ServerOptions {
   uint32_t max_attempts_per_source = 0;
   /** @brief The window max_attempts_per_source is counted over. */
   std::chrono::milliseconds attempt_window{10000};
+  /** @brief See IoBackend. ZDT ignores it. */
+  IoBackend io_backend = IoBackend::Readiness;
+  /** @brief See WorkerOptions. */
+  WorkerOptions workers;
+
+  /**
+   * @brief How much of the end of each listener tick is spun rather than
+   *        slept; see Scheduler::SetSpinBudget().
+   *
+   * The listener accepts, promotes handshaken sessions and sweeps dead ones
+   * on that tick, so lateness there only delays those. Zero, the default,
+   * never spins; a host that wants ticks on time to the microsecond can buy
+   * it with a budget a little above its timer slack.
+   */
+  std::chrono::microseconds tick_spin_budget{0};
+  /** @brief Fills ServerMetrics::tick, to see what tick_spin_budget buys and
+   *         costs. A few clock reads per listener tick. */
+  bool measure_ticks = false;
 };
 
 }  // namespace znet
@@ -19,21 +19,31 @@
 #ifndef ZNET_OUTBOUND_QUEUE_H_
 #define ZNET_OUTBOUND_QUEUE_H_
 
+#include "znet/buffer.h"
 #include "znet/compat.h"
 #include "znet/mpsc_queue.h"
 #include "znet/packet.h"
 #include "znet/send_options.h"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace znet {
 
 /**
  * @brief Packets waiting to be encoded, and the arbitration over who encodes.
  *
+ * @par Order
+ * Drained by PriorityKey, highest first, and in send order among equal
+ * priorities. Priority never reorders an ordered channel: a packet carries its
+ * priority back to the ordered packets sent before it on its channel, so they
+ * move ahead together. See PriorityKey for what that does per transport.
+ *
  * @par Threading
  * Push() is callable from any thread. Drain() may be called from any thread and
  * only one succeeds at a time; the rest return immediately rather than waiting,
@@ -44,6 +54,14 @@ class OutboundQueue {
   struct Item {
     std::shared_ptr<Packet> packet;
     SendOptions options;
+    // set instead of `packet` when the sender already serialized and
+    // compressed it (CommonOptions::encode_on_send), leaving only encryption
+    std::shared_ptr<Buffer> prepared;
+    // the serialized size of `prepared`, carried here because the metrics it
+    // feeds belong to whoever drains
+    size_t payload_bytes = 0;
+    // the priority it drains at; the queue's own, set as a run is taken
+    uint8_t rank = 0;
   };
 
   explicit OutboundQueue(size_t capacity) : queue_(capacity) {}
@@ -61,8 +79,16 @@ class OutboundQueue {
    *         caller still owns the packet and may retry.
    */
   bool Push(std::shared_ptr<Packet> packet, SendOptions options) {
+    return Push(Item{std::move(packet), options, nullptr, 0});
+  }
+
+  /**
+   * @brief Queues an item built by the caller, such as one already carrying
+   *        its prepared bytes. Same contract as the packet overload.
+   */
+  bool Push(Item item) {
     size_t queued = 0;
-    if (!queue_.Push(Item{std::move(packet), options}, &queued)) {
+    if (!queue_.Push(std::move(item), &queued)) {
       return false;
     }
     if (queued == 0 && wake_) {
@@ -71,6 +97,26 @@ class OutboundQueue {
     return true;
   }
 
+  /**
+   * @brief Queues a run of items with one reservation and at most one wake.
+   *
+   * @param make called as make(i) for each accepted index, in order, and
+   *        returns the Item. See MpscQueue::PushBatch for why it should be
+   *        cheap.
+   * @return how many of the first `count` were queued. The rest were not, and
+   *         their caller still owns them.
+   */
+  template <typename MakeFn>
+  size_t PushBatch(size_t count, MakeFn&& make) {
+    size_t queued = 0;
+    const size_t accepted =
+        queue_.PushBatch(count, std::forward<MakeFn>(make), &queued);
+    if (accepted != 0 && queued == 0 && wake_) {
+      wake_();
+    }
+    return accepted;
+  }
+
   /**
    * @brief Encodes everything queued, if this thread wins the claim.
    *
@@ -83,22 +129,38 @@ class OutboundQueue {
    */
   template <typename EncodeFn>
   bool Drain(EncodeFn&& encode) {
+    return Drain(std::forward<EncodeFn>(encode), []() {});
+  }
+
+  /**
+   * @brief Drain(), then `finish` once the queue runs dry, still under the
+   *        claim.
+   *
+   * For an encoder that holds work back across items, packing several into
+   * one message, and has to let go of it before another thread can take the
+   * claim.
+   */
+  template <typename EncodeFn, typename FinishFn>
+  bool Drain(EncodeFn&& encode, FinishFn&& finish) {
     // whoever takes the claim encodes; whoever does not returns rather than
     // waiting, so no thread blocks here.
     if (encoding_.exchange(true, std::memory_order_acquire)) {
       return false;
     }
     bool encoded = false;
-    // one at a time, so the slot is free before the encode starts and a
-    // producer gets it back sooner. The loop runs until the queue is empty, so
-    // anything queued while it works still goes out before the claim is
-    // released.
-    Item item;
-    while (queue_.Pop(item)) {
-      if (encode(item)) {
-        encoded = true;
+    // a run at a time, taken off the queue before any of it is encoded, so
+    // the slots are free for producers sooner and the run can be put in
+    // priority order. The loop runs until the queue is empty, so anything
+    // queued while it works still goes out before the claim is released.
+    while (TakeRun()) {
+      for (Item& item : run_) {
+        if (encode(item)) {
+          encoded = true;
+        }
       }
     }
+    run_.clear();  // the packets, not the vector's storage
+    finish();
     encoding_.store(false, std::memory_order_release);
     // a packet pushed between the last Pop() and the release raised no wake of
     // its own, its producer having seen a non-zero count, so nudge here rather
@@ -144,6 +206,54 @@ class OutboundQueue {
   ZNET_NODISCARD size_t capacity() const { return queue_.capacity(); }
 
  private:
+  // Pops up to kRunLength items into run_, highest rank first and in queue
+  // order among equals. False once there was nothing to pop.
+  bool TakeRun() {
+    run_.clear();
+    bool mixed = false;
+    Item item;
+    while (run_.size() < kRunLength && queue_.Pop(item)) {
+      mixed = mixed || (!run_.empty() && Priority(item) != Priority(run_[0]));
+      run_.push_back(std::move(item));
+    }
+    if (mixed) {
+      RankRun();
+      // stable, so equal ranks keep their send order
+      std::stable_sort(run_.begin(), run_.end(),
+                       [](const Item& a, const Item& b) {
+                         return a.rank > b.rank;
+                       });
+    }
+    return !run_.empty();
+  }
+
+  // An ordered packet ranks at the highest priority of the ordered packets
+  // behind it on its channel, its own included, so an urgent one takes those
+  // ahead of it along instead of overtaking them. Ranks never rise along a
+  // channel that way, which is what keeps the sort from reordering it. An
+  // unordered packet promises no order and ranks at its own priority.
+  void RankRun() {
+    std::array<uint8_t, 256> behind{};  // per channel, walking back
+    for (auto it = run_.rbegin(); it != run_.rend(); ++it) {
+      if (!it->options.GetOr<OrderedKey>(true)) {
+        it->rank = Priority(*it);
+        continue;
+      }
+      uint8_t& carried = behind[it->options.GetOr<ChannelKey>(0)];
+      carried = std::max(carried, Priority(*it));
+      it->rank = carried;
+    }
+  }
+
+  static uint8_t Priority(const Item& item) {
+    return item.options.GetOr<PriorityKey>(0);
+  }
+
+  // how far ahead a drain looks for something more urgent. Each run is sorted
+  // on its own, so past this a high priority waits for the run in front of it;
+  // bounded so one drain does not hold a whole queue's worth of packets.
+  static constexpr size_t kRunLength = 256;
+
   // queue depth up to which the worker encodes even when a dedicated encoder
   // exists. One message is the latency case, and handing it to another thread
   // costs a wake to save nothing.
@@ -156,6 +266,9 @@ class OutboundQueue {
   // taken returns rather than waiting. Keeps message order defined while
   // letting any thread encode.
   std::atomic<bool> encoding_{false};
+  // the run being encoded; only touched under the claim. Kept, so a drain
+  // reuses its storage.
+  std::vector<Item> run_;
   std::atomic<bool> has_encoder_{false};
   std::function<void()> wake_;
 };
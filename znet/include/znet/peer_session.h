@@ -15,18 +15,29 @@
 #include "znet/compat.h"
 #include "znet/compression.h"
 #include "znet/encryption.h"
+#include "znet/file_transfer.h"
 #include "znet/message_pipeline.h"
 #include "znet/options.h"
 #include "znet/outbound_queue.h"
 #include "znet/packet_handler.h"
 #include "znet/send_options.h"
+#include "znet/stream.h"
 #include "znet/task.h"
 #include "znet/transport.h"
 
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace znet {
 
+/** @brief One entry of a PeerSession::SendPackets() batch. */
+struct OutgoingPacket {
+  std::shared_ptr<Packet> packet;
+  SendOptions options;
+};
+
 /**
  * @class PeerSession
  * @brief Represents a network session between a local and remote peer.
@@ -37,9 +48,15 @@ namespace znet {
  *
  * @par Threading
  * SendPacket() may be called from any thread and only queues. The codec, the
- * handler and the compression and encryption state belong to the worker
- * driving Process(), which is where queued packets are encoded, so SetCodec(),
- * SetHandler() and SetOutCompression() belong in an event or packet handler.
+ * handler and the encryption state belong to the worker driving Process(),
+ * which is where queued packets are encoded, so SetCodec() and SetHandler()
+ * belong in an event or packet handler. SetOutCompression() may be called from
+ * any thread and applies from the next packet encoded.
+ *
+ * CommonOptions::encode_on_send moves serialization and compression onto the
+ * sending thread; encryption stays with the worker either way. The codec is
+ * then read by every sender, so SetCodec() installs it once, in the connect
+ * event, and refuses to replace it after that.
  *
  * The class does not allow copy or move semantics to ensure each session
  * instance is unique.
@@ -68,6 +85,19 @@ class PeerSession {
    */
   bool Process();
 
+  /**
+   * @brief Process(), but handing the worker back once dispatching has taken
+   *        `budget`. Internal: a server worker sharing its tick out.
+   *
+   * Checked after each message, so at least one is delivered however long
+   * it takes. A zero budget falls back to the kMaxReceivesPerProcess bound.
+   * Upkeep, grants, file pumping and the outbound drain still run in full.
+   *
+   * @param out_cut_short set to whether the budget ran out with the receive
+   *                      loop still delivering. Pass null to skip it.
+   */
+  bool Process(std::chrono::nanoseconds budget, bool* out_cut_short);
+
   /**
    * @brief Ends the session. Safe from any thread and idempotent; the second
    *        call reports AlreadyDisconnected.
@@ -114,6 +144,8 @@ class PeerSession {
    * Queues and returns; the worker encodes and sends within the same tick.
    * Nothing here locks or encodes, so a caller is never held up by a worker.
    * Fire and forget: a packet that fails to encode is logged and dropped.
+   * With CommonOptions::encode_on_send the packet is serialized and
+   * compressed here first, and the worker only encrypts and sends it.
    *
    * @param packet The packet to send.
    * @param options Per-message delivery options. Ignored by TCP.
@@ -121,10 +153,100 @@ class PeerSession {
    *         signal: the caller still holds the packet and may retry.
    *         NotConnected means the session died, NotReady that the handshake
    *         has not settled, InvalidArgument a null packet. Refusal always
-   *         happens before encoding, so nothing is lost.
+   *         happens before encoding, so nothing is lost. Failure only
+   *         with encode_on_send, when the packet could not be serialized.
    */
   Result SendPacket(std::shared_ptr<Packet> packet, SendOptions options = {});
 
+  /**
+   * @brief Queues a batch of packets at once. Callable from any thread.
+   *
+   * What a game tick that emits dozens of packets to one session wants: the
+   * whole run is reserved in the queue with one atomic claim and wakes the
+   * worker at most once, where a SendPacket() per packet pays for each.
+   *
+   * Acceptance is a prefix. Under backpressure the first `*out_accepted`
+   * packets are queued in order and the rest are not, so the caller retries
+   * from that index and order is preserved either way.
+   *
+   * @param packets     the batch, sent in order.
+   * @param count       how many entries `packets` holds.
+   * @param out_accepted optionally receives how many were queued.
+   * @return Result::Success when all were queued, QueueFull when only a prefix
+   *         was. NotConnected, NotReady and InvalidArgument (any null packet)
+   *         refuse the whole batch, as SendPacket() would each packet. With
+   *         encode_on_send, Failure when a packet could not be serialized; the
+   *         packets before it are still queued.
+   */
+  Result SendPackets(const OutgoingPacket* packets, size_t count,
+                     size_t* out_accepted = nullptr);
+
+  /**
+   * @brief The same, for any contiguous container of OutgoingPacket: a
+   *        std::vector, a std::array, or a std::span on C++20.
+   */
+  template <typename Container>
+  Result SendPackets(const Container& packets,
+                     size_t* out_accepted = nullptr) {
+    return SendPackets(packets.data(), packets.size(), out_accepted);
+  }
+
+  /**
+   * @brief Opens a stream for a transfer too large to send as one message.
+   *        Callable from any thread.
+   *
+   * What is written to the returned writer is cut into
+   * StreamOptions::chunk_bytes chunks and sent as reliable ordered messages
+   * on `channel`, so the transport never fragments or holds more than one
+   * chunk at a time, and the peer's credit keeps the sender at most
+   * StreamOptions::window_bytes ahead of what the peer's application has
+   * taken. The peer receives the chunks, in order, through its stream
+   * callback.
+   *
+   * Chunks travel through the session's codec like any packet, so both ends
+   * need one installed; any codec will do, the stream messages are built in.
+   * Streams on one channel share its ordering, so a bulk transfer belongs on
+   * a channel of its own.
+   */
+  std::shared_ptr<StreamWriter> OpenStream(uint8_t channel = 0);
+
+  /**
+   * @brief Installs the callback every inbound stream chunk is delivered to,
+   *        in order per stream. Same contract as SetHandler(): set it in the
+   *        connect event. Chunks arriving without one are dropped, though
+   *        still credited, so a sender is never left waiting on them.
+   */
+  void SetStreamCallback(std::function<void(const StreamChunk&)> callback) {
+    stream_callback_ = std::move(callback);
+  }
+
+  /**
+   * @brief Sends `length` bytes of the file at `path` from `offset` as a
+   *        stream on channel 0. Callable from any thread.
+   *
+   * The file is mapped, not read: on an unencrypted TCP session the kernel
+   * copies it to the socket with sendfile(), one call per chunk of
+   * StreamOptions::chunk_bytes, and otherwise the cipher, or the transport's
+   * own buffer, reads it straight from the mapping. The
+   * worker keeps writing it as the peer's credit allows, and `on_event`
+   * receives a FileTransferProgressEvent as it goes and one
+   * FileTransferCompletedEvent at the end, on the worker's thread.
+   *
+   * The peer receives it through its stream callback like any stream.
+   * Changing the file while it is sent changes what the peer receives.
+   *
+   * @param out_stream optionally receives the stream's id, which the events
+   *        and the peer's chunks carry.
+   * @return Result::Success once the transfer is under way. CannotOpenFile
+   *         when the file cannot be opened or mapped, InvalidArgument for an
+   *         offset past its end, NotConnected or NotReady as for
+   *         SendPacket().
+   */
+  Result SendFile(const std::string& path, uint64_t offset = 0,
+                  uint64_t length = kToEndOfFile,
+                  EventCallbackFn on_event = nullptr,
+                  StreamId* out_stream = nullptr);
+
   /**
    * @brief Encodes and sends whatever SendPacket() has queued.
    *
@@ -148,12 +270,31 @@ class PeerSession {
     outbound_.SetHasDedicatedEncoder(has_encoder);
   }
 
+  // how many messages a session holds while it has no codec to decode them
+  // with; past it they are dropped. The gap is the connect event, so it only
+  // has to cover what a peer sends in the first moments.
+  static constexpr size_t kMaxHeldMessages = 64;
+
   /**
    * @brief Installs the codec that frames and identifies this session's
-   *        packets. Set it in the connect event, before the first packet
-   *        arrives; it belongs to the worker thread after that.
+   *        packets. Set it in the connect event; it belongs to the worker
+   *        thread after that.
+   *
+   * The peer may already be sending by then: its side can be ready, and
+   * talking, before this one has finished the handshake. Messages that arrive
+   * while there is no codec are held, up to kMaxHeldMessages, and delivered in
+   * order once one is installed.
+   *
+   * With CommonOptions::encode_on_send a ready session's codec is in use on
+   * every sending thread, so one already installed is kept and the call is
+   * logged and ignored.
    */
   void SetCodec(std::shared_ptr<Codec> codec) {
+    if (options_.common.encode_on_send && IsReady() && pipeline_.has_codec()) {
+      ZNET_LOG_ERROR("Session {} sends with encode_on_send, so its codec cannot "
+                     "be replaced once ready; keeping the current one.", id_);
+      return;
+    }
     pipeline_.SetCodec(std::move(codec));
   }
 
@@ -196,6 +337,38 @@ class PeerSession {
     outbound_.SetWakeCallback(std::move(wake));
   }
 
+  /**
+   * @brief Passes the I/O of the worker about to drive the session on to
+   *        its transport. See TransportLayer::BindWorkerIo. Set by the
+   *        server with the wake callback, and like it never replaced.
+   */
+  void BindWorkerIo(const std::shared_ptr<WorkerIo>& io) {
+    if (transport_layer_) {
+      transport_layer_->BindWorkerIo(io);
+    }
+  }
+
+  /**
+   * @brief Registers what tells the owning worker this session has work:
+   *        its transport's arrivals, a Close() or a SendFile() from another
+   *        thread. Set by the server after BindWorkerIo(), and like it never
+   *        replaced. See TransportLayer::SetReadyCallback.
+   *
+   * Sends still go through SetWakeCallback(), which the server may point at
+   * the same function.
+   *
+   * @return false when the transport cannot announce its work, and the
+   *         session has to be driven every tick.
+   */
+  bool SetReadyCallback(std::function<void()> ready);
+
+  /**
+   * @brief When Process() next has something to do that nothing will
+   *        announce. TimePoint::min() when it has work now. Call it from
+   *        the thread that drives Process(), after Process().
+   */
+  ZNET_NODISCARD std::chrono::steady_clock::time_point NextDeadline();
+
   /**
    * @brief Associates user-defined data with the PeerSession.
    *
@@ -226,6 +399,10 @@ class PeerSession {
     return std::chrono::steady_clock::now() - connect_time_;
   }
 
+  /**
+   * @brief Compresses outgoing messages with `type` from the next one encoded.
+   *        Safe from any thread, encode_on_send or not.
+   */
   void SetOutCompression(CompressionType type) {
     pipeline_.SetOutCompression(type);
     ZNET_LOG_INFO("Set out compression to {} for {}", GetCompressionTypeString(type), id_);
@@ -340,8 +517,9 @@ class PeerSession {
     negotiated_compression_ = type;
   }
 
-  // how many messages one Process() call will deliver before yielding, so a
-  // session under load cannot monopolize the worker it shares with others.
+  // how many messages one Process() call without a budget will deliver
+  // before yielding, so a session under load cannot monopolize the worker it
+  // shares with others.
   static constexpr uint32_t kMaxReceivesPerProcess = 256;
 
 
@@ -355,6 +533,95 @@ class PeerSession {
    */
   bool EncodeAndSend(const std::shared_ptr<Packet>& packet, SendOptions options);
 
+  /**
+   * @brief The tail of EncodeAndSend(): encrypt prepared bytes and hand them
+   *        to the transport. Under the encode claim, for the same reason.
+   */
+  bool SealAndSend(std::shared_ptr<Buffer> buffer, size_t payload_bytes,
+                   SendOptions options, uint32_t messages = 1);
+
+  /**
+   * @brief Sends a chunk of a mapped file without gathering it into a buffer
+   *        first. Under the encode claim.
+   */
+  bool SendFileChunk(const std::shared_ptr<Packet>& packet,
+                     StreamChunkPacket& chunk, SendOptions options);
+
+  /** @brief OpenStream() with its chunk size given rather than configured. */
+  std::shared_ptr<StreamWriter> OpenStream(uint8_t channel, size_t chunk_bytes);
+
+  /** @brief Drives the file transfers, dropping those that are over. */
+  void PumpFiles();
+
+  /** @brief Tells the owning worker, if it asked to be told, that the
+   *         session has work. Any thread. */
+  void NotifyReady() {
+    if (ready_) {
+      ready_();
+    }
+  }
+
+  /**
+   * @brief Serialized packets waiting to be compressed and sealed as one
+   *        message. See CommonOptions::coalesce_max_bytes.
+   */
+  struct Batch {
+    std::shared_ptr<Buffer> buffer;
+    size_t payload_bytes = 0;
+    uint32_t messages = 0;
+    uint8_t stream = 0;
+    SendOptions options;
+    std::chrono::steady_clock::time_point opened;
+  };
+
+  /**
+   * @brief Packs `item` into batch_, sealing the batch first or after as the
+   *        byte cap and the latency bound require.
+   *
+   * @return false if the item cannot be packed and has to be sent on its own.
+   */
+  bool Coalesce(const OutboundQueue::Item& item);
+
+  /** @brief Compresses, seals and sends batch_, if it holds anything. */
+  void SealBatch();
+
+  /**
+   * @brief What Process() dispatches into: stream messages are taken here,
+   *        everything else goes on to the application's handler.
+   */
+  class Dispatcher : public PacketHandlerBase {
+   public:
+    explicit Dispatcher(PeerSession& session) : session_(session) {}
+    void Handle(std::shared_ptr<Packet> packet) override;
+
+   private:
+    PeerSession& session_;
+  };
+
+  /** @brief A stream the peer is writing to this side. Worker only. */
+  struct InboundStream {
+    uint8_t channel = 0;
+    uint64_t next_offset = 0;
+    // what the peer has been allowed to write up to
+    uint64_t granted = kStreamInitialCredit;
+    // a grant the send queue refused, retried from Process()
+    bool grant_pending = false;
+  };
+
+  void OnStreamChunk(const StreamChunkPacket& packet);
+  void OnStreamCredit(const StreamCreditPacket& packet);
+  /** @brief Extends the peer's credit once it has used half its window. */
+  void MaybeGrant(StreamId id, InboundStream& stream);
+  /** @brief Closes a session whose peer broke the stream protocol. */
+  void StreamViolation(StreamId id, const char* what);
+  /**
+   * @brief Dispatches one decrypted message through the codec.
+   *
+   * @return false once it has closed the session for too many undecodable
+   *         frames.
+   */
+  bool Deliver(const std::shared_ptr<Buffer>& buffer);
+
  protected:
   SessionId id_;
   std::shared_ptr<InetAddress> local_address_;
@@ -380,12 +647,33 @@ class PeerSession {
   // touched only by the thread that drives this session, like metrics_, but
   // lives outside the metrics build flag: the close threshold depends on it
   uint64_t invalid_frames_ = 0;
+  // what arrived while there was no codec, oldest first; see SetCodec(). The
+  // driving thread's, like the codec
+  std::vector<std::shared_ptr<Buffer>> held_;
   std::shared_ptr<void> user_ptr_;
   Task task_;
 
   // the thread boundary on the send path: the queue, the encode claim and the
   // rule for who takes it
   OutboundQueue outbound_;
+  // shared with every writer OpenStream() returned; see detail::StreamLink
+  std::shared_ptr<detail::StreamLink> stream_link_{
+      std::make_shared<detail::StreamLink>()};
+  // the rest of the stream state belongs to the thread that drives Process()
+  Dispatcher dispatcher_{*this};
+  std::function<void(const StreamChunk&)> stream_callback_;
+  std::unordered_map<StreamId, InboundStream> inbound_streams_;
+  bool grants_pending_ = false;
+  // added from any thread, driven by the worker. has_files_ spares the
+  // worker the lock while there are none.
+  std::mutex files_mutex_;
+  std::vector<std::unique_ptr<detail::FileTransfer>> files_;
+  std::atomic_bool has_files_{false};
+  // see SetReadyCallback(); empty for a session driven every tick
+  std::function<void()> ready_;
+  // under the encode claim like the rest of the drain, and empty whenever the
+  // claim is released
+  Batch batch_;
 #if ZNET_ENABLE_METRICS
   // touched only by the thread that drives this session
   SessionMetrics metrics_;
@@ -14,30 +14,60 @@
 
 #include "znet/compat.h"
 #include <chrono>
+#include <cstdint>
 
 #ifndef ZNET_PREFER_STD_SLEEP
 #define ZNET_PREFER_STD_SLEEP 0
 #endif
 
 /*
- * By default, this class will use precise sleep; this could result in more
- * CPU usage but much more precise timing. To disable precise sleep, enable
- * ZNET_PREFER_STD_SLEEP.
+ * Wait() sleeps to an absolute deadline, one tick after the last, so a late
+ * wake does not push every later tick back with it. The kernel's timer slack
+ * decides how late; a spin budget trades CPU for precision by sleeping only
+ * until that much before the deadline and spinning the rest. The default
+ * spins nothing. ZNET_PREFER_STD_SLEEP ignores any budget, for builds that
+ * must never spin.
  */
 class Scheduler {
  public:
-  using Clock = std::chrono::high_resolution_clock;
+  using Clock = std::chrono::steady_clock;
   using TimePoint = std::chrono::time_point<Clock>;
   using Duration = std::chrono::microseconds;
 
+  /** @brief What Wait() did since SetMeasureWaits(true). */
+  struct WaitStats {
+    uint64_t ticks = 0;     /**< Wait() calls. */
+    uint64_t overruns = 0;  /**< Ticks whose work left nothing to wait for. */
+    Duration waited{};      /**< Wall time spent inside Wait(). */
+    /** @brief This thread's CPU time inside Wait(): the spin, mostly. */
+    Duration wait_cpu{};
+    /** @brief Summed lateness of each wake past its deadline. */
+    Duration jitter_total{};
+    Duration jitter_max{};
+  };
+
   Scheduler(uint16_t tps);
   ~Scheduler();
 
   void SetTicksPerSecond(uint16_t tps);
 
+  /**
+   * @brief How much of the end of each Wait() is spun rather than slept.
+   *
+   * Zero sleeps the whole way and wakes as late as the kernel's timer slack,
+   * tens of microseconds on an idle Linux host. A budget just above that
+   * wakes on time, at the cost of spinning it every tick.
+   */
+  void SetSpinBudget(Duration budget) { spin_budget_ = budget; }
+
+  /** @brief Starts or stops filling wait_stats(). Costs two clock reads and
+   *         two thread-CPU reads per Wait(). */
+  void SetMeasureWaits(bool measure) { measure_ = measure; }
+
   void Start();
   void End();
 
+  /** @brief Sleeps out the rest of the tick. */
   void Wait();
 
   /**
@@ -51,13 +81,25 @@ class Scheduler {
                                             : Duration::zero();
   }
 
+  ZNET_NODISCARD const WaitStats& wait_stats() const { return stats_; }
+
+  /** @brief Sleeps until `deadline`, spinning for the last `spin` of it.
+   *         Returns at once for a deadline already past. */
+  static void SleepUntil(TimePoint deadline, Duration spin);
+
+  /** @brief Sleeps for `duration`, spinning the last 200 microseconds. */
   static void PreciseSleep(Duration duration);
  private:
 
   TimePoint start_time_;
   TimePoint end_time_;
-  Duration delta_time_;
+  // what the last Wait() slept to; the next tick's deadline follows it
+  TimePoint deadline_{};
+  Duration delta_time_{};
   Duration target_delta_time_;
+  Duration spin_budget_{0};
+  bool measure_ = false;
+  WaitStats stats_;
   uint16_t tps_{};
 };
 
@@ -15,11 +15,14 @@
 // ignores the rest, silently. Nothing is rejected or logged, so an option a
 // transport does not implement is inert rather than an error, and no call site
 // on the wrong transport will tell you. Which transports honor a given option
-// is documented on that option's own Key below. Today all of them are ZDT-only.
+// is documented on that option's own Key below. All but PriorityKey are
+// ZDT-only.
 //
 // Adding an option: a Key struct with the next free id, a field in
 // SendOptionsInit and one in SendOptions::Data, both in id order, a builder,
-// and a Get() specialization. Then say on the Key which transports honor it,
+// and a Get() specialization. An option whose every value means something,
+// so that no default could stand in for "unset", stays out of SendOptionsInit
+// and is only reachable through its builder. Then say on the Key which transports honor it,
 // and what the ones that do not do instead, since that differs per option and
 // is the part callers get wrong.
 //
@@ -34,6 +37,7 @@
 #define ZNET_SEND_OPTIONS_H_
 
 #include "znet/compat.h"
+#include <chrono>
 #include <cstdint>
 #include <type_traits>
 
@@ -74,13 +78,78 @@ struct OrderedKey  { using type = bool; static constexpr int id = 1; };
  * a nonce sequence and a replay window per channel too. See
  * TransportLayer::OrderingDomain().
  *
- * TCP has one stream and ignores it, which collapses traffic you had
- * deliberately separated back onto a single ordered pipe. That is the one case
+ * TCP has one stream and ignores it past the session's priority order (see
+ * PriorityKey), which collapses traffic you had deliberately separated back
+ * onto a single ordered pipe. That is the one case
  * where ignoring an option changes throughput rather than just semantics: a
  * bulk transfer and chat share a channel again, and head-of-line block each
  * other.
  */
 struct ChannelKey  { using type = uint8_t; static constexpr int id = 2; };
+/**
+ * @brief How urgent the message is, higher first. Default 0.
+ *
+ * **Transports:** all, at the session's queue; ZDT again at its send window.
+ *
+ * Every session orders what it has queued by priority before encoding it, so
+ * a message sent behind a run of lower-priority ones on other channels is
+ * encoded ahead of them. On its own channel it never overtakes an ordered
+ * message sent before it: it takes those along ahead of the rest instead.
+ * Unordered messages are free to move on their own. That alone is what TCP
+ * gets, since its one stream sends in the order the session encodes, so on
+ * TCP too the channel is what separates traffic priority may reorder.
+ *
+ * ZDT also weighs its channels against each other by it when the send window
+ * is short: each channel's backlog gets a share of the bytes sent in
+ * proportion to `priority + 1` of the message at its head, so a channel at
+ * 255 moves 256 times the bytes of one at 0 while both have a backlog, and
+ * neither is ever starved.
+ *
+ * Within one channel ZDT keeps its backlog in encode order, because the
+ * channel is also the replay window of an encrypted session. A message that
+ * must overtake a bulk transfer belongs on a channel of its own.
+ *
+ * Messages of equal priority keep their send order, and an ordered channel
+ * keeps its send order whatever the priorities on it, so OrderedKey means
+ * send order on every transport.
+ */
+struct PriorityKey { using type = uint8_t; static constexpr int id = 3; };
+/**
+ * @brief Lets a newer message replace a queued one with the same key. No
+ *        default: unset, nothing is replaced.
+ *
+ * **Transports:** ZDT only, and only for unreliable messages.
+ *
+ * While ZDT's send window is shut, an unreliable message sent with this key
+ * takes the place of an older one on the same channel with the same key that
+ * is still waiting to go, so only the latest position or snapshot for a given
+ * entity is ever put on the wire. The newer message keeps the older one's
+ * place in the queue, and counts in ZDTSessionMetrics::messages_superseded.
+ * Keys are scoped per channel, and one already sent is never recalled.
+ *
+ * Not TCP-style packing of small frames, which CommonOptions::coalesce_max_bytes
+ * controls: that merges messages, this discards all but the newest.
+ *
+ * Reliable messages ignore it: the peer was promised each of them. TCP and the
+ * local transports send every message, as does the session's own queue, which
+ * only a ZDT window ever backs up far enough to matter.
+ */
+struct CoalesceKey { using type = uint32_t; static constexpr int id = 4; };
+/**
+ * @brief How long an unreliable message may wait to be sent before it is
+ *        dropped instead. No default: unset, it waits as long as it takes.
+ *
+ * **Transports:** ZDT only, and only for unreliable messages.
+ *
+ * Counted from when ZDT takes the message off the session's queue, which is
+ * within a tick of the send unless the session itself is backed up. A message
+ * still queued past it is dropped rather than sent and counts in
+ * ZDTSessionMetrics::messages_expired, so a saturated link spends its bytes on
+ * what is still worth reading. One already on the wire is not recalled.
+ *
+ * Reliable messages ignore it, as do TCP and the local transports.
+ */
+struct DeadlineKey { using type = std::chrono::milliseconds; static constexpr int id = 5; };
 
 /**
  * @brief Plain-field mirror of SendOptions, for designated initializers.
@@ -92,23 +161,27 @@ struct ChannelKey  { using type = uint8_t; static constexpr int id = 2; };
  *
  * One field per Key, in id order. A new option adds a field here too, and the
  * order must keep matching, since designated initializers require it.
+ * CoalesceKey and DeadlineKey have none: their zero values would coalesce and
+ * expire every message, so they are set with the builders only.
  */
 struct SendOptionsInit {
   bool reliable = true;
   bool ordered = true;
   uint8_t channel = 0;
+  uint8_t priority = 0;
 };
 
 /**
- * @brief Per-message delivery options: reliability, ordering and channel.
+ * @brief Per-message delivery options: reliability, ordering, channel,
+ *        priority, coalescing and a deadline.
  *
- * Passed to PeerSession::SendPacket(). **Every option is currently ZDT-only**,
- * as documented on each Key. On a TCP session the whole object is ignored,
- * silently.
+ * Passed to PeerSession::SendPacket(). **Every option but the priority is
+ * ZDT-only**, as documented on each Key. On a TCP session the rest are
+ * ignored, silently.
  *
  * An option left unset is not the same as one set to its default value: the
  * transport supplies its own default for anything unset, which for ZDT is
- * reliable, ordered, channel 0.
+ * reliable, ordered, channel 0, priority 0, never coalesced and no deadline.
  *
  * Build the handful your application needs once, as constants, and pass those
  * to every send. Every builder is constexpr, so a namespace-scope constant is
@@ -124,7 +197,7 @@ class SendOptions {
   constexpr SendOptions() = default;
 
   /**
-   * @brief Sets all three options at once from a SendOptionsInit.
+   * @brief Sets every option at once from a SendOptionsInit.
    *
    * Written with designated initializers, which are **C++20**:
    * @code
@@ -136,13 +209,13 @@ class SendOptions {
    * the recommended spelling; this constructor stays for code that prefers
    * designators on a C++20 build.
    *
-   * Unlike the default constructor this marks all three as set, so none of them
+   * Unlike the default constructor this marks all of them as set, so none
    * falls back to the transport's default.
    */
   constexpr explicit SendOptions(const SendOptionsInit& init)
       : bitmask_((1u << ReliableKey::id) | (1u << OrderedKey::id) |
-                 (1u << ChannelKey::id)),
-        data_{init.reliable, init.ordered, init.channel} {}
+                 (1u << ChannelKey::id) | (1u << PriorityKey::id)),
+        data_{init.reliable, init.ordered, init.channel, init.priority} {}
 
   /**
    * @brief Returns a copy with reliability set, marking it explicitly chosen.
@@ -152,20 +225,64 @@ class SendOptions {
    * @endcode
    */
   ZNET_NODISCARD constexpr SendOptions Reliable(bool value) const {
-    return SendOptions(bitmask_ | (1u << ReliableKey::id),
-                       Data{value, data_.ordered, data_.channel});
+    Data data = data_;
+    data.reliable = value;
+    return SendOptions(bitmask_ | (1u << ReliableKey::id), data);
   }
 
   /** @brief Returns a copy with ordering set, marking it explicitly chosen. */
   ZNET_NODISCARD constexpr SendOptions Ordered(bool value) const {
-    return SendOptions(bitmask_ | (1u << OrderedKey::id),
-                       Data{data_.reliable, value, data_.channel});
+    Data data = data_;
+    data.ordered = value;
+    return SendOptions(bitmask_ | (1u << OrderedKey::id), data);
   }
 
   /** @brief Returns a copy with the channel set, marking it explicitly chosen. */
   ZNET_NODISCARD constexpr SendOptions Channel(uint8_t value) const {
-    return SendOptions(bitmask_ | (1u << ChannelKey::id),
-                       Data{data_.reliable, data_.ordered, value});
+    Data data = data_;
+    data.channel = value;
+    return SendOptions(bitmask_ | (1u << ChannelKey::id), data);
+  }
+
+  /**
+   * @brief Returns a copy with the priority set, marking it explicitly chosen.
+   *
+   * @code
+   * constexpr SendOptions kCritical = SendOptions().Channel(2).Priority(200);
+   * @endcode
+   */
+  ZNET_NODISCARD constexpr SendOptions Priority(uint8_t value) const {
+    Data data = data_;
+    data.priority = value;
+    return SendOptions(bitmask_ | (1u << PriorityKey::id), data);
+  }
+
+  /**
+   * @brief Returns a copy with the coalescing key set, marking it explicitly
+   *        chosen.
+   *
+   * @code
+   * session->SendPacket(position, kPosition.Coalesce(entity_id));
+   * @endcode
+   */
+  ZNET_NODISCARD constexpr SendOptions Coalesce(uint32_t value) const {
+    Data data = data_;
+    data.coalesce = value;
+    return SendOptions(bitmask_ | (1u << CoalesceKey::id), data);
+  }
+
+  /**
+   * @brief Returns a copy with the deadline set, marking it explicitly chosen.
+   *
+   * @code
+   * constexpr SendOptions kPosition = SendOptions().Reliable(false).Channel(1)
+   *                                       .Deadline(std::chrono::milliseconds(100));
+   * @endcode
+   */
+  ZNET_NODISCARD constexpr SendOptions Deadline(std::chrono::milliseconds value) const {
+    Data data = data_;
+    data.deadline = value;
+    return SendOptions(bitmask_ | (1u << DeadlineKey::id), data);
   }
 
   /**
@@ -174,7 +291,8 @@ class SendOptions {
    * The mutating counterpart of the builders above, for the rare case where an
    * option is decided at runtime rather than baked into a constant.
    *
-   * @tparam Key ReliableKey, OrderedKey or ChannelKey.
+   * @tparam Key ReliableKey, OrderedKey, ChannelKey, PriorityKey, CoalesceKey
+   *         or DeadlineKey.
    * @code
    * SendOptions opts;
    * opts.Set<ReliableKey>(false);
@@ -203,6 +321,9 @@ class SendOptions {
     bool reliable = true;
     bool ordered = true;
     uint8_t channel = 0;
+    uint8_t priority = 0;
+    uint32_t coalesce = 0;
+    std::chrono::milliseconds deadline{0};
   };
 
   constexpr SendOptions(uint32_t bitmask, const Data& data)
@@ -226,6 +347,9 @@ class SendOptions {
 template <> constexpr const bool& SendOptions::Get<ReliableKey>() const { return data_.reliable; }
 template <> constexpr const bool& SendOptions::Get<OrderedKey>()  const { return data_.ordered;  }
 template <> constexpr const uint8_t& SendOptions::Get<ChannelKey>() const { return data_.channel; }
+template <> constexpr const uint8_t& SendOptions::Get<PriorityKey>() const { return data_.priority; }
+template <> constexpr const uint32_t& SendOptions::Get<CoalesceKey>() const { return data_.coalesce; }
+template <> constexpr const std::chrono::milliseconds& SendOptions::Get<DeadlineKey>() const { return data_.deadline; }
 
 }  // namespace znet
 
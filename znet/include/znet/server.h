@@ -12,14 +12,22 @@
 #define ZNET_SERVER_H_
 
 #include "znet/compat.h"
+#include "znet/detail/slot_map.h"
+#include "znet/detail/timer_wheel.h"
 #include "znet/interface.h"
 #include "znet/logger.h"
+#include "znet/manual_poller.h"
+#include "znet/mpsc_queue.h"
 #include "znet/options.h"
 #include "znet/peer_session.h"
 #include "znet/scheduler.h"
 #include "znet/task.h"
+#include "znet/worker_io.h"
 #include "znet/worker_signal.h"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace znet {
 
 namespace backends {
@@ -44,6 +52,9 @@ struct ServerConfig {
   ConnectionType connection_type = ConnectionType::ZDT;
   ServerOptions options;         // the listener itself
   SessionOptions child_options;  // every session the listener accepts
+  /** @brief Manual runs the listener and one worker on the thread calling
+   * Process(), and ignores options.workers; see DriveMode. */
+  DriveMode drive = DriveMode::Threads;
 };
 
 /**
@@ -53,8 +64,8 @@ struct ServerConfig {
  */
 class Server : public Interface {
  public:
-  using SessionMap = std::unordered_map<std::shared_ptr<InetAddress>,
-                                        std::shared_ptr<PeerSession>>;
+  /** @brief Sessions packed for a tick's walk; see detail::SlotMap. */
+  using SessionSlots = detail::SlotMap<std::shared_ptr<PeerSession>>;
 
   explicit Server(const ServerConfig& config);
   Server(const Server&) = delete;
@@ -148,43 +159,204 @@ class Server : public Interface {
    */
   ZNET_NODISCARD ServerMetrics metrics() const;
 
+  /**
+   * @brief The connected session with this id, or null.
+   *
+   * Finds a session from the IncomingClientConnectedEvent that announced it
+   * until just before the disconnect event that retires it, so an application keyed on
+   * SessionId need not keep a map of its own. Thread-safe, and a constant
+   * time lookup under a lock held for nothing longer.
+   */
+  ZNET_NODISCARD std::shared_ptr<PeerSession> FindSession(SessionId id) const;
+
+  /**
+   * @brief Under DriveMode::Manual, one round of everything the server's
+   *        threads would do: accept, advance handshakes, and run the
+   *        sessions with work or a deadline due. Never blocks.
+   *
+   * Call it from one thread, the one events are then dispatched on, when
+   * poll_fd() turns readable or PollOnce() returns. Stop() is seen here:
+   * the call that notices it tears the server down and fires the shutdown
+   * event.
+   *
+   * @return false once the server is not listening, or has shut down.
+   */
+  bool Process();
+
+  /**
+   * @brief Under DriveMode::Manual, waits up to `timeout` for something to
+   *        do, or until the next session deadline if sooner, then
+   *        Process()es it. The whole loop for an application with nothing
+   *        else to wait on.
+   */
+  bool PollOnce(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Under DriveMode::Manual, a descriptor that turns readable when
+   *        Process() has work: for the application's own epoll or poll set.
+   *        Level-triggered, and cleared by Process(). -1 in thread mode, and
+   *        off Linux, where only PollOnce() can wait.
+   */
+  ZNET_NODISCARD int poll_fd() const { return poller_ ? poller_->fd() : -1; }
+
  private:
+  class ReadyQueue;
+  struct Scheduled;
+  struct TaskData;
+  struct WorkerState;
+
   /**
-   * @brief One worker's sessions, plus the size it publishes for the acceptor.
+   * @brief One worker's sessions, owned by that worker alone, plus the size
+   *        it publishes for everyone else.
+   *
+   * Other threads never touch the map. The acceptor, and a worker handing a
+   * session over, Hand() it in through a lock-free queue that the owner
+   * drains at the top of its tick, so placing a session never waits out
+   * another thread's tick.
    *
    * The published count is what lets the receive thread's wake callback skip
-   * idle workers, and SelectNextTask() pick the emptiest, without taking the
-   * lock. A stale read costs at most a spurious wake or a slightly worse
-   * placement, where locking per datagram would put the receive thread behind
-   * whichever worker is mid-tick. Every mutation goes through With(), which
-   * republishes it, so the two cannot drift.
+   * idle workers, and SelectNextTask() pick the emptiest, without asking the
+   * worker. It counts a session from the moment it is handed in until the
+   * worker erases it. A stale read costs at most a spurious wake or a
+   * slightly worse placement.
    */
   class SessionSet {
    public:
-    template <typename Fn>
-    void With(Fn&& fn) {
-      std::lock_guard<std::mutex> lock(mutex_);
-      fn(sessions_);
-      count_.store(sessions_.size(), std::memory_order_relaxed);
-    }
+    SessionSet() : inbox_(kInboxCapacity) {}
+
+    /** @brief Gives the worker `session`, scheduled by `entry`. Any thread. */
+    void Hand(std::shared_ptr<PeerSession> session,
+              std::shared_ptr<Scheduled> entry);
+
+    /**
+     * @brief Takes on everything handed in since the last call, appending
+     *        each one's entry to `arrived`. Owning worker only.
+     */
+    void Drain(std::vector<std::shared_ptr<Scheduled>>& arrived);
+
+    /** @brief Drops the session `entry` schedules. Owning worker only. */
+    void Erase(Scheduled& entry);
+
+    /** @brief The sessions taken on so far. Owning worker only. */
+    SessionSlots& owned() { return sessions_; }
 
     ZNET_NODISCARD size_t count() const {
       return count_.load(std::memory_order_relaxed);
     }
 
    private:
-    std::mutex mutex_;
-    SessionMap sessions_;
+    struct Arrival {
+      std::shared_ptr<PeerSession> session;
+      std::shared_ptr<Scheduled> entry;
+    };
+
+    // enough for a burst of accepts or a rebalance between two ticks; the
+    // overflow list behind it only takes what a full ring refuses
+    static constexpr size_t kInboxCapacity = 1024;
+
+    SessionSlots sessions_;
     std::atomic<size_t> count_{0};
+    MpscQueue<Arrival> inbox_;
+    std::atomic_bool overflowed_{false};
+    std::mutex overflow_mutex_;
+    std::vector<Arrival> overflow_;
+  };
+
+  /**
+   * @brief A session's place in its worker's schedule, and its deadline on
+   *        the worker's timer wheel.
+   *
+   * Shared by the worker, its ready queue and the callbacks the session
+   * holds, so whichever lets go last frees it. Holds the session weakly:
+   * the callbacks live inside it.
+   */
+  struct Scheduled : detail::TimerWheel::Node {
+    std::weak_ptr<PeerSession> session;
+    // where a wake goes. Only moved with home_mutex held, and wakes push
+    // with it held, so each lands on the worker that owns the session or
+    // on one that let go of it before the move queued it on the new one
+    std::mutex home_mutex;
+    std::shared_ptr<ReadyQueue> ready;
+    std::shared_ptr<WorkerSignal> signal;
+    // the worker that owns it. Another finding it in its queue drops it:
+    // that was a wake from before the session moved away
+    std::atomic<TaskData*> worker{nullptr};
+    // set by whoever queues it, cleared by the worker once Process() is done
+    // with it, so a burst of wakeups queues it once and the session's own
+    // sends during Process() queue it not at all
+    std::atomic_bool queued{true};
+    // the transport cannot announce its work, so the worker drives it every
+    // tick. Written before the worker first sees it.
+    bool polled = false;
+    // the rest belongs to the worker: whether it has taken the entry on, and
+    // the last pass that ran it, so one queued twice runs once
+    bool owned = false;
+    uint64_t pass = 0;
+    // its key in the worker's SessionSet, from when the worker drains it in
+    SessionSlots::Key slot = SessionSlots::kNullKey;
+    // time its Process() calls took in the worker's current one-second
+    // window, and in the last whole one, which is what a rebalance weighs
+    uint64_t cost_ns = 0;
+    uint64_t last_cost_ns = 0;
+    // its deficit-round-robin credit under WorkerOptions::tick_budget: what
+    // it may still spend, or while negative, what it overspent and is paying
+    // back a share per tick
+    int64_t deficit_ns = 0;
+  };
+
+  /** @brief Sessions that said they have work, for their worker to take. */
+  class ReadyQueue {
+   public:
+    void Push(std::shared_ptr<Scheduled> entry) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      entries_.push_back(std::move(entry));
+    }
+
+    /** @brief Appends everything queued to `out`. */
+    void TakeAll(std::vector<std::shared_ptr<Scheduled>>& out) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      out.insert(out.end(), std::make_move_iterator(entries_.begin()),
+                 std::make_move_iterator(entries_.end()));
+      entries_.clear();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Scheduled>> entries_;
   };
 
   // Not movable or copyable: it owns a thread, a mutex and a condition
   // variable. Held by unique_ptr in tasks_ so the vector never needs to be.
   struct TaskData {
+    // the backend's I/O for this worker, when it does its sessions' reading
+    // and writing; null otherwise. First, so it outlives the sessions whose
+    // transports refer to it.
+    std::shared_ptr<WorkerIo> io_;
     std::shared_ptr<WorkerSignal> signal_{std::make_shared<WorkerSignal>()};
+    // shared with every session's ready callback, which may outlive the worker
+    std::shared_ptr<ReadyQueue> ready_{std::make_shared<ReadyQueue>()};
     SessionSet sessions_;
+    // null until the worker is started; with WorkerOptions::elastic, that
+    // waits for the acceptor to need it
     std::unique_ptr<Task> task_;
     Scheduler scheduler_{120};
+    // the CPU the worker pins itself to, when WorkerOptions::cpus names one
+    bool pinned_ = false;
+    uint32_t cpu_ = 0;
+    // time spent in its sessions' Process(), summed. The listener diffs it
+    // to find the busiest worker, and metrics() reports it.
+    std::atomic<uint64_t> busy_ns_{0};
+    std::atomic<uint64_t> moved_in_{0};
+    std::atomic<uint64_t> moved_out_{0};
+    std::atomic<uint64_t> budget_overruns_{0};
+    std::atomic<uint64_t> sessions_deferred_{0};
+    // a rebalance the listener asked of this worker: narrow a gap of
+    // steal_gap_ns_ a second between it and steal_to_. Set with
+    // steal_pending_ clear, taken by the worker, then cleared.
+    std::mutex steal_mutex_;
+    TaskData* steal_to_ = nullptr;
+    uint64_t steal_gap_ns_ = 0;
+    std::atomic_bool steal_pending_{false};
 
     TaskData() = default;
     ~TaskData() {
@@ -197,6 +369,9 @@ class Server : public Interface {
           task_->RequestStop();
         }
         signal_->cv.notify_all();
+        if (io_) {
+          io_->Wake();
+        }
         task_->Wait();
       }
     }
@@ -206,13 +381,50 @@ class Server : public Interface {
   };
 
   void MainProcessor();
-  /** @brief One worker's whole life: tick its sessions, sleep out the rest. */
+  /** @brief Runs `data`'s worker thread. The constructor and the acceptor
+   *  are the only callers, so no two ever race to start one. */
+  void StartWorker(TaskData& data);
+  /** @brief Copies the listener scheduler's wait stats out for metrics(). */
+  void PublishTickMetrics();
+  /**
+   * @brief Every WorkerOptions::rebalance_interval, asks the worker that
+   *        spent the most time in Process() to hand sessions to the one
+   *        that spent the least. Listener thread only.
+   */
+  void Rebalance();
+  /**
+   * @brief On `from`'s worker: moves `entry` and its session to `to`, which
+   *        takes it on as it would a new one.
+   */
+  void HandOff(TaskData& from, TaskData& to,
+               const std::shared_ptr<Scheduled>& entry,
+               const std::shared_ptr<PeerSession>& session);
+  /**
+   * @brief One worker's whole life: process the sessions that have work or
+   *        a deadline due, then sleep until the next one does.
+   *
+   * A session is only touched when its transport reports something, the
+   * application sends on it, or the deadline it gave last time comes up.
+   * Those whose transport cannot report anything are ticked as before.
+   */
   void WorkerLoop(TaskData& data);
+  /** @brief One pass of a worker's loop, between two of its sleeps. */
+  void RunWorkerPass(TaskData& data, WorkerState& state);
+  /** @brief How long the worker may sleep after a pass before it owes the
+   *         next one, should nothing wake it first. */
+  Scheduler::Duration NextWorkerWait(TaskData& data, WorkerState& state);
+  /** @brief Closes whatever a worker that is about to stop still holds. */
+  void CloseWorkerSessions(TaskData& data, WorkerState& state);
+  /** @brief MainProcessor()'s teardown, for DriveMode::Manual. Once. */
+  void ShutdownManual();
 
   void CheckNetwork();
   void ProcessSessions();
   /** @brief Drops dead sessions from `sessions`, then ticks the survivors. */
-  void CleanupAndProcessSessions(SessionMap& sessions);
+  void CleanupAndProcessSessions(SessionSlots& sessions);
+  /** @brief Tells the application a session it was given is gone, and
+   *         breaks its handler's hold on it. The caller drops it after. */
+  void RetireSession(const std::shared_ptr<PeerSession>& session);
   void DisconnectPending();
   void PromoteReady(std::shared_ptr<PeerSession> session);
   void SubmitSession(TaskData& data, std::shared_ptr<PeerSession> session);
@@ -228,10 +440,31 @@ class Server : public Interface {
   ServerConfig config_;
   bool shutdown_complete_ = false;
   Scheduler scheduler_{60};
+  // the listener's wait stats, copied out each tick with measure_ticks on so
+  // metrics() can read them from another thread
+  mutable std::mutex tick_mutex_;
+  TickMetrics tick_metrics_;
+  // the listener's view for Rebalance(): when it last ran, and each worker's
+  // busy_ns_ as it stood then
+  std::chrono::steady_clock::time_point last_rebalance_{};
+  std::vector<uint64_t> last_busy_ns_;
+  // false when any worker owns its sessions' I/O: a session bound to one
+  // worker's ring or poller cannot be driven by another
+  bool can_rebalance_ = false;
   Task task_;
+  // DriveMode::Manual: what the application waits on, and the state of the
+  // one worker whose passes it drives. Both null in thread mode.
+  std::shared_ptr<ManualPoller> poller_;
+  std::unique_ptr<WorkerState> manual_;
+  // between Listen() and the Process() that sees the server stopped
+  bool manual_running_ = false;
 
   std::vector<std::unique_ptr<TaskData>> tasks_;
-  SessionMap pending_sessions_;
+  SessionSlots pending_sessions_;
+  // every connected session by id, for FindSession(). Held weakly: the
+  // worker that owns a session decides when it goes.
+  mutable std::mutex directory_mutex_;
+  std::unordered_map<SessionId, std::weak_ptr<PeerSession>> directory_;
 };
 }  // namespace znet
 
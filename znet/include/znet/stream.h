@@ -0,0 +1,290 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// Byte streams over a session, for transfers too large to send as one message:
+// level downloads, replays, anything of tens of megabytes. A stream is cut into
+// chunks, each an ordinary reliable ordered message, so no transport ever holds
+// more than one chunk in reassembly, and the receiver's credit bounds how far
+// the sender may run ahead of what the application has consumed.
+//
+
+#ifndef ZNET_STREAM_H_
+#define ZNET_STREAM_H_
+
+#include "znet/buffer.h"
+#include "znet/compat.h"
+#include "znet/detail/mapped_file.h"
+#include "znet/packet.h"
+#include "znet/packet_serializer.h"
+#include "znet/types.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace znet {
+
+class PeerSession;
+
+/** @brief Names a stream within one direction of one session. */
+using StreamId = uint32_t;
+
+/**
+ * @brief Bytes a sender may write on a new stream before the receiver has
+ *        granted any. Lets a transfer start without a round trip; every
+ *        receiver accepts at least this much.
+ */
+ZNET_INLINE_CONSTEXPR uint64_t kStreamInitialCredit = 256u * 1024u;
+
+/** @brief Largest chunk StreamOptions::chunk_bytes may ask for. */
+ZNET_INLINE_CONSTEXPR size_t kStreamMaxChunkBytes = 64u * 1024u;
+
+/**
+ * @brief One piece of a stream, in order, as the stream callback sees it.
+ *
+ * `data` points into the decoded message and is valid only for the duration
+ * of the callback; copy out what has to outlive it.
+ */
+struct StreamChunk {
+  StreamId stream_id = 0;
+  uint8_t channel = 0;
+  /** @brief Where `data` starts within the stream. */
+  uint64_t offset = 0;
+  const char* data = nullptr;
+  size_t size = 0;
+  /** @brief The writer finished; nothing follows on this stream. */
+  bool last = false;
+};
+
+// the wire messages. Reserved ids below the handshake's, registered by every
+// Codec, so a stream needs nothing from the application's codec.
+class StreamChunkPacket : public Packet {
+ public:
+  StreamChunkPacket() : Packet(GetPacketId()) {}
+
+  static PacketId GetPacketId() { return static_cast<PacketId>(-4); }
+
+  StreamId stream_id = 0;
+  uint8_t channel = 0;
+  bool last = false;
+  uint64_t offset = 0;
+  std::string data;
+  // instead of `data`, for a chunk of a file: `file_size` bytes from
+  // `file_position` within the mapping, copied out only when the frame is
+  // built, if at all
+  std::shared_ptr<detail::MappedFile> file;
+  uint64_t file_position = 0;
+  uint32_t file_size = 0;
+  // set by the session when the file's bytes go on the wire straight after
+  // the frame; the serializer then writes everything else
+  bool body_follows = false;
+
+  ZNET_NODISCARD const char* body() const {
+    return file ? file->data() + file_position : data.data();
+  }
+  ZNET_NODISCARD size_t body_size() const {
+    return file ? file_size : data.size();
+  }
+};
+
+class StreamChunkPacketSerializerV1
+    : public PacketSerializer<StreamChunkPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(
+      std::shared_ptr<StreamChunkPacket> packet,
+      std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteInt<uint32_t>(packet->stream_id);
+    buffer->WriteInt<uint8_t>(packet->channel);
+    buffer->WriteBool(packet->last);
+    buffer->WriteVarInt(packet->offset);
+    const size_t size = packet->body_size();
+    buffer->WriteInt<uint32_t>(static_cast<uint32_t>(size));
+    if (!packet->body_follows) {
+      buffer->Write(packet->body(), size);
+    }
+    return buffer;
+  }
+
+  std::shared_ptr<StreamChunkPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<StreamChunkPacket>();
+    packet->stream_id = buffer->ReadInt<uint32_t>();
+    packet->channel = buffer->ReadInt<uint8_t>();
+    packet->last = buffer->ReadBool();
+    packet->offset = buffer->ReadVarInt<uint64_t>();
+    const size_t size = buffer->ReadInt<uint32_t>();
+    if (buffer->GetAndClearLastError() != BufferError::None ||
+        size > kStreamMaxChunkBytes || size > buffer->readable_bytes()) {
+      return nullptr;
+    }
+    packet->data.assign(buffer->read_cursor_data(), size);
+    buffer->SkipRead(size);
+    return packet;
+  }
+};
+
+// grants the sender of `stream_id` leave to write up to `limit` bytes into it
+class StreamCreditPacket : public Packet {
+ public:
+  StreamCreditPacket() : Packet(GetPacketId()) {}
+
+  static PacketId GetPacketId() { return static_cast<PacketId>(-5); }
+
+  StreamId stream_id = 0;
+  uint64_t limit = 0;
+};
+
+class StreamCreditPacketSerializerV1
+    : public PacketSerializer<StreamCreditPacket> {
+ public:
+  std::shared_ptr<Buffer> SerializeTyped(
+      std::shared_ptr<StreamCreditPacket> packet,
+      std::shared_ptr<Buffer> buffer) override {
+    buffer->WriteInt<uint32_t>(packet->stream_id);
+    buffer->WriteVarInt(packet->limit);
+    return buffer;
+  }
+
+  std::shared_ptr<StreamCreditPacket> DeserializeTyped(
+      std::shared_ptr<Buffer> buffer) override {
+    auto packet = std::make_shared<StreamCreditPacket>();
+    packet->stream_id = buffer->ReadInt<uint32_t>();
+    packet->limit = buffer->ReadVarInt<uint64_t>();
+    if (buffer->GetAndClearLastError() != BufferError::None) {
+      return nullptr;
+    }
+    return packet;
+  }
+};
+
+class StreamWriter;
+
+namespace detail {
+
+class FileTransfer;
+
+/**
+ * @brief What a session's writers share with it.
+ *
+ * A writer may outlive its session, so it reaches the session only through
+ * this, and ~PeerSession clears `session` under the mutex before anything it
+ * points at is destroyed.
+ */
+struct StreamLink {
+  std::mutex mutex;
+  PeerSession* session = nullptr;
+  std::unordered_map<StreamId, std::weak_ptr<StreamWriter>> writers;
+  StreamId next_id = 1;
+};
+
+}  // namespace detail
+
+/**
+ * @brief The sending end of a stream. Returned by PeerSession::OpenStream().
+ *
+ * Write() cuts what it is given into chunks and queues them as reliable,
+ * ordered messages on the stream's channel, as far as the receiver's credit
+ * and the session's queue allow. Whatever it could not take is the caller's
+ * to offer again later; SetWritableCallback() says when that is worth trying.
+ *
+ * One thread writes to a stream at a time. Different streams, and other
+ * traffic on the same session, may be sent from any thread.
+ */
+class StreamWriter {
+ public:
+  StreamWriter(std::shared_ptr<detail::StreamLink> link, StreamId id,
+               uint8_t channel, size_t chunk_bytes);
+  /** @brief Finishes the stream if Finish() was not called. */
+  ~StreamWriter();
+  StreamWriter(const StreamWriter&) = delete;
+  StreamWriter& operator=(const StreamWriter&) = delete;
+
+  /**
+   * @brief Queues as much of `data` as credit and the session's queue allow.
+   *
+   * @param out_written optionally receives how many bytes were taken, always
+   *        a prefix of `data`.
+   * @return Result::Success when all of it was taken, QueueFull when only a
+   *         prefix was (including none), for the caller to retry the rest.
+   *         AlreadyClosed after Finish(), NotConnected once the session is
+   *         gone, NotReady before its handshake settles.
+   */
+  Result Write(const void* data, size_t size, size_t* out_written = nullptr);
+
+  /**
+   * @brief Ends the stream. The receiver sees a last chunk once everything
+   *        written before it has arrived.
+   *
+   * @return Result::Success, AlreadyClosed on a second call, or QueueFull
+   *         when the session's queue had no room, to be retried.
+   */
+  Result Finish();
+
+  /** @brief Bytes Write() could take right now as far as credit goes. */
+  ZNET_NODISCARD uint64_t writable_bytes() const {
+    const uint64_t limit = credit_.load(std::memory_order_acquire);
+    return limit > written_ ? limit - written_ : 0;
+  }
+
+  /** @brief Bytes queued so far. */
+  ZNET_NODISCARD uint64_t bytes_written() const { return written_; }
+
+  ZNET_NODISCARD StreamId id() const { return id_; }
+  ZNET_NODISCARD uint8_t channel() const { return channel_; }
+  ZNET_NODISCARD bool finished() const { return finished_; }
+
+  /**
+   * @brief Called from the session's worker whenever the receiver grants
+   *        more credit. Keep it short; it may call Write().
+   */
+  void SetWritableCallback(std::function<void()> callback);
+
+ private:
+  friend class PeerSession;
+  friend class detail::FileTransfer;
+
+  /** @brief Raises the credit limit. The session's worker, from a grant. */
+  void Grant(uint64_t limit);
+
+  /**
+   * @brief Write() for bytes of a mapped file, which the chunks point into
+   *        rather than copy.
+   */
+  Result WriteFile(const std::shared_ptr<detail::MappedFile>& file,
+                   uint64_t position, uint64_t size, uint64_t* out_written);
+
+  /**
+   * @brief The loop behind both writes: queues chunks of up to `size`
+   *        bytes while credit lasts, `fill` giving each its body.
+   */
+  template <typename FillFn>
+  Result WriteChunks(uint64_t size, uint64_t* out_taken, FillFn&& fill);
+
+  std::shared_ptr<detail::StreamLink> link_;
+  StreamId id_;
+  uint8_t channel_;
+  size_t chunk_bytes_;
+  // the writing thread's alone
+  uint64_t written_ = 0;
+  bool finished_ = false;
+  // raised by the worker, read by the writer
+  std::atomic<uint64_t> credit_{kStreamInitialCredit};
+  // guarded by link_->mutex, so a grant cannot race the callback's removal
+  std::function<void()> on_writable_;
+};
+
+}  // namespace znet
+
+#endif  // ZNET_STREAM_H_
@@ -15,8 +15,14 @@
 #include "znet/buffer.h"
 #include "znet/close_options.h"
 #include "znet/compat.h"
+#include "znet/detail/mapped_file.h"
 #include "znet/metrics.h"
 #include "znet/send_options.h"
+#include "znet/worker_io.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
 
 namespace znet {
 
@@ -26,8 +32,10 @@ namespace znet {
  * @par Threading
  * Every method belongs to the worker driving the owning session's Process(), so
  * a transport needs no locking of its own. The exceptions are Close(), callable
- * from the application's thread, and ZDT's OnDatagram(), called by its receive
- * thread; both say so at their declarations.
+ * from the application's thread, ZDT's OnDatagram(), called by its receive
+ * thread, a Flush() a transport declares thread-safe, and the ready callback
+ * a transport fires from wherever it learns of work; each says so at its
+ * declaration.
  */
 class TransportLayer {
  public:
@@ -40,6 +48,29 @@ class TransportLayer {
   /** @brief Hands one encoded message to the transport. Worker thread only. */
   virtual bool Send(std::shared_ptr<Buffer> buffer, SendOptions options = {}) = 0;
 
+  /**
+   * @brief Sends `head` followed by `size` bytes of `file` from `position`
+   *        within its mapping, as one message. Worker thread only.
+   *
+   * Only ever handed unencrypted messages, whose file bytes need no work
+   * before the wire. The default copies them straight from the mapping in
+   * behind `head`; a stream transport can leave the copy to the kernel.
+   */
+  virtual bool SendFile(std::shared_ptr<Buffer> head,
+                        const std::shared_ptr<detail::MappedFile>& file,
+                        uint64_t position, size_t size,
+                        SendOptions options = {}) {
+    head->Write(file->data() + static_cast<size_t>(position), size);
+    return Send(std::move(head), options);
+  }
+
+  /**
+   * @brief Largest message SendFile() sends without copying its file bytes,
+   *        or zero when it always copies them. A sender that wants the
+   *        kernel's copy sizes its file chunks to fit.
+   */
+  virtual size_t FileFrameLimit() const { return 0; }
+
   /**
    * @brief Which independently-ordered stream `options` selects. Defaults to a
    *        single stream, correct for one ordered pipe.
@@ -56,6 +87,17 @@ class TransportLayer {
     return 0;
   }
 
+  /**
+   * @brief Largest serialized payload worth packing several messages into, or
+   *        zero if this transport wants them one at a time.
+   *
+   * Nonzero only for a transport that treats every message within one
+   * ordering domain alike, so that messages sharing a Send() lose nothing by
+   * sharing its options. It leaves room below its own frame limit for
+   * compression and encryption to grow the payload.
+   */
+  virtual size_t CoalesceLimit() const { return 0; }
+
   /** @brief Shuts the transport down. Callable from any thread. */
   virtual Result Close(CloseOptions options = {}) = 0;
 
@@ -76,6 +118,16 @@ class TransportLayer {
    */
   virtual void Flush() = 0;
 
+  /**
+   * @brief Whether Flush() may also run on whichever thread drains the
+   *        session's queue, not only on the worker.
+   *
+   * A session whose queue is drained by a dedicated encoder then flushes
+   * straight after the drain. Otherwise the frames wait for the worker, which
+   * may be asleep on the socket rather than on anything the encoder can wake.
+   */
+  virtual bool FlushIsThreadSafe() const { return false; }
+
   /**
    * @brief Copies this transport's counters into `out`.
    *
@@ -85,6 +137,43 @@ class TransportLayer {
    * @param out Destination, which the caller may have pre-filled.
    */
   virtual void FillMetrics(SessionMetrics& out) const { (void)out; }
+
+  /**
+   * @brief Hands the transport the I/O of the worker about to drive it, for
+   *        a backend whose worker does the reading and writing. Called once,
+   *        before the worker's first tick. Everything else ignores it.
+   */
+  virtual void BindWorkerIo(const std::shared_ptr<WorkerIo>& io) { (void)io; }
+
+  /**
+   * @brief Asks the transport to call `ready` whenever it gets work its
+   *        owner cannot see coming: inbound data, room for a backlog, the
+   *        peer going away. Called once, after BindWorkerIo().
+   *
+   * `ready` may run on any thread, the worker's own included, and must be
+   * cheap. Together with NextDeadline() it lets a worker leave the session
+   * alone until one or the other says otherwise.
+   *
+   * @return false when the transport cannot tell, which is the default; its
+   *         owner then has to drive it every tick.
+   */
+  virtual bool SetReadyCallback(std::function<void()> ready) {
+    (void)ready;
+    return false;
+  }
+
+  /**
+   * @brief When Update() next has something to do that no ready callback
+   *        will announce: a retransmit, a keepalive, an idle timeout.
+   *        Worker thread only.
+   *
+   * TimePoint::min() when it has work now, including anything Receive()
+   * still holds; TimePoint::max() when only the peer or a send can give it
+   * any. Early is harmless, late is a missed timer.
+   */
+  virtual std::chrono::steady_clock::time_point NextDeadline() {
+    return std::chrono::steady_clock::time_point::min();
+  }
 };
 
 }
@@ -64,7 +64,8 @@ enum class Result {
   PeerNotFound,
   NotReady,
   QueueFull,
-  InvalidArgument
+  InvalidArgument,
+  CannotOpenFile
 };
 
 inline std::string GetResultString(Result result) {
@@ -123,6 +124,8 @@ inline std::string GetResultString(Result result) {
       return "QueueFull";
     case Result::InvalidArgument:
       return "InvalidArgument";
+    case Result::CannotOpenFile:
+      return "CannotOpenFile";
     default:
       return "Unknown";
   }
@@ -131,6 +134,8 @@ inline std::string GetResultString(Result result) {
 enum class ConnectionType {
   TCP,
   ZDT,  // znet Datagram Transport (reliable UDP with channels)
+  SharedMemory,  // rings in memory shared with a process on the same host
+  InProcess,  // queues between a client and server in this process
   //ENet,
   //QUIC
 };
@@ -141,6 +146,10 @@ inline std::string GetConnectionTypeString(ConnectionType type) {
       return "TCP";
     case ConnectionType::ZDT:
       return "ZDT";
+    case ConnectionType::SharedMemory:
+      return "SharedMemory";
+    case ConnectionType::InProcess:
+      return "InProcess";
     default:
       return "Unknown";
   }
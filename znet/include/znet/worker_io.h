@@ -0,0 +1,49 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+//
+// What a server worker sleeps on when its backend does the I/O for it rather
+// than leaving each transport a socket to read. The worker waits here instead
+// of on its WorkerSignal, and the I/O completes while it does.
+//
+
+#ifndef ZNET_WORKER_IO_H_
+#define ZNET_WORKER_IO_H_
+
+#include <chrono>
+
+namespace znet {
+
+class WorkerIo {
+ public:
+  virtual ~WorkerIo() = default;
+
+  /**
+   * @brief Submits what the last tick queued, then waits up to `timeout` for
+   *        any of it to complete, or for Wake(). Worker thread only.
+   *
+   * @return whether anything completed, which is a reason to tick now.
+   */
+  virtual bool Poll(std::chrono::nanoseconds timeout) = 0;
+
+  /** @brief Ends a Poll() early. Callable from any thread. */
+  virtual void Wake() = 0;
+
+  /**
+   * @brief Worker thread, once it has closed its sessions and before it
+   *        exits: gives their closes up to `grace` to finish what they left
+   *        in flight, then lets go of every socket.
+   */
+  virtual void Shutdown(std::chrono::milliseconds grace) = 0;
+};
+
+}  // namespace znet
+
+#endif  // ZNET_WORKER_IO_H_
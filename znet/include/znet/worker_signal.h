@@ -23,6 +23,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
 
@@ -39,6 +40,9 @@ struct WorkerSignal {
   // and setting the flag would skip the rest of the tick and spin for as long
   // as the session had traffic.
   std::atomic<std::thread::id> owner{};
+  // for a loop that sleeps on something other than cv, the call that
+  // interrupts it. Set before the loop starts and never replaced.
+  std::function<void()> on_raise;
 
   /**
    * @brief Ends the sleep unless called from the loop's own thread.
@@ -57,6 +61,9 @@ struct WorkerSignal {
       woken.store(true, std::memory_order_relaxed);
     }
     cv.notify_one();
+    if (on_raise) {
+      on_raise();
+    }
   }
 };
 
@@ -19,10 +19,12 @@
 
 #include "znet/buffer.h"
 #include "znet/client.h"
+#include "znet/client_pool.h"
 #include "znet/client_events.h"
 #include "znet/codec.h"
 #include "znet/error.h"
 #include "znet/event.h"
+#include "znet/file_transfer.h"
 #include "znet/inet_addr.h"
 #include "znet/init.h"
 #include "znet/logger.h"
@@ -33,6 +35,7 @@
 #include "znet/peer_session.h"
 #include "znet/server.h"
 #include "znet/server_events.h"
+#include "znet/stream.h"
 #include "znet/types.h"
 
 #endif  // ZNET_ZNET_H_
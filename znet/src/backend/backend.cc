@@ -9,7 +9,10 @@
 //
 
 #include "znet/backends/backend.h"
+#include "znet/backends/inproc.h"
+#include "znet/backends/shm.h"
 #include "znet/backends/tcp.h"
+#include "znet/backends/tcp_uring.h"
 #include "znet/backends/zdt.h"
 #include "znet/logger.h"
 
@@ -30,6 +33,23 @@ bool RefusedByZDT(const std::shared_ptr<InetAddress>& address) {
   return false;
 }
 
+// shared memory meets its peer on a Unix path and nowhere else
+bool RefusedBySharedMemory(const std::shared_ptr<InetAddress>& address) {
+#if ZNET_HAS_SHARED_MEMORY
+  if (!address || address->ipv() != InetProtocolVersion::Unix) {
+    ZNET_LOG_ERROR(
+        "Shared memory sessions rendezvous on a unix: path, not {}.",
+        address ? address->readable() : std::string("nothing"));
+    return true;
+  }
+  return false;
+#else
+  (void)address;
+  ZNET_LOG_ERROR("Shared memory sessions are only available on Linux.");
+  return true;
+#endif
+}
+
 }  // namespace
 
 std::unique_ptr<ClientBackend> CreateClientFromType(
@@ -44,13 +64,35 @@ std::unique_ptr<ClientBackend> CreateClientFromType(
     }
     return std::make_unique<ZDTClientBackend>(server_address, options);
   }
+  if (type == ConnectionType::SharedMemory) {
+    if (RefusedBySharedMemory(server_address)) {
+      return nullptr;
+    }
+#if ZNET_HAS_SHARED_MEMORY
+    return std::make_unique<SharedMemoryClientBackend>(server_address, options);
+#endif
+  }
+  if (type == ConnectionType::InProcess) {
+    return std::make_unique<InProcessClientBackend>(server_address, options);
+  }
   return nullptr;
 }
 
 std::unique_ptr<ServerBackend> CreateServerFromType(
     ConnectionType type, std::shared_ptr<InetAddress> bind_address,
     const SessionOptions& child_options, const ServerOptions& server_options) {
+  const bool uring = server_options.io_backend == IoBackend::IoUring;
   if (type == ConnectionType::TCP) {
+    if (uring) {
+#if ZNET_HAS_IO_URING
+      if (detail::Uring::Supported()) {
+        return std::make_unique<UringTCPServerBackend>(
+            bind_address, child_options, server_options);
+      }
+#endif
+      ZNET_LOG_WARN("io_uring is unavailable here; the TCP server falls back "
+                    "to readiness polling.");
+    }
     return std::make_unique<TCPServerBackend>(bind_address, child_options,
                                               server_options);
   }
@@ -58,9 +100,38 @@ std::unique_ptr<ServerBackend> CreateServerFromType(
     if (RefusedByZDT(bind_address)) {
       return nullptr;
     }
+    if (uring) {
+      // refused rather than ignored: a server asked for the ring and handed
+      // readiness polling would be measured as if it were the ring
+      ZNET_LOG_ERROR("ZDT has no io_uring backend; use IoBackend::Readiness, "
+                     "or ZDTOptions::connected_sockets for a socket per "
+                     "session.");
+      return nullptr;
+    }
     return std::make_unique<ZDTServerBackend>(bind_address, child_options,
                                               server_options);
   }
+  if (type == ConnectionType::SharedMemory) {
+    if (RefusedBySharedMemory(bind_address)) {
+      return nullptr;
+    }
+    if (uring) {
+      ZNET_LOG_WARN("Shared memory has no io_uring backend; ignoring "
+                    "io_backend.");
+    }
+#if ZNET_HAS_SHARED_MEMORY
+    return std::make_unique<SharedMemoryServerBackend>(
+        bind_address, child_options, server_options);
+#endif
+  }
+  if (type == ConnectionType::InProcess) {
+    if (uring) {
+      ZNET_LOG_WARN("In-process sessions make no system calls to hand to "
+                    "io_uring; ignoring io_backend.");
+    }
+    return std::make_unique<InProcessServerBackend>(
+        bind_address, child_options, server_options);
+  }
   return nullptr;
 }
 
@@ -0,0 +1,470 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/backends/inproc.h"
+
+#include "znet/inet_addr.h"
+#include "znet/logger.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace znet {
+namespace backends {
+
+namespace {
+
+// every listening in-process server, by its bound address as text. The lock
+// is held across a client's Offer(), which is what keeps a server being
+// closed from being destroyed under it.
+struct Registry {
+  std::mutex mutex;
+  std::unordered_map<std::string, InProcessServerBackend*> servers;
+};
+
+Registry& GetRegistry() {
+  // leaked so a server closed during static destruction still finds it
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+// the made-up ports in-process endpoints are known by, for both a server
+// bound to port zero and every client. Wraps after 65535 connections; a map
+// key colliding with one that old is still alive is a theoretical concern.
+PortNumber NextPort() {
+  static std::atomic<uint16_t> next{0};
+  PortNumber port;
+  do {
+    port = next.fetch_add(1, std::memory_order_relaxed);
+  } while (port == 0);
+  return port;
+}
+
+}  // namespace
+
+void InProcessLink::SetWake(bool accepting, std::function<void()> wake) {
+  std::lock_guard<std::mutex> lock(wake_mutex_);
+  (accepting ? wake_accepting_ : wake_connecting_) = std::move(wake);
+}
+
+void InProcessLink::Wake(bool accepting) {
+  std::lock_guard<std::mutex> lock(wake_mutex_);
+  const std::function<void()>& wake =
+      accepting ? wake_accepting_ : wake_connecting_;
+  if (wake) {
+    wake();
+  }
+}
+
+InProcessTransportLayer::InProcessTransportLayer(
+    std::shared_ptr<InProcessLink> link, bool accepting,
+    std::function<void()> wake, InProcessOptions inproc)
+    : link_(std::move(link)),
+      accepting_(accepting),
+      inbound_(accepting ? link_->to_accepting : link_->to_connecting),
+      outbound_(accepting ? link_->to_connecting : link_->to_accepting),
+      send_high_water_(inproc.send_high_water) {
+  link_->SetWake(accepting_, std::move(wake));
+}
+
+InProcessTransportLayer::~InProcessTransportLayer() {
+  CloseOptions options;
+  options.Set<NoLingerKey>(true);
+  Close(options);
+  // whatever the callback reaches may be going away with this side
+  link_->SetWake(accepting_, nullptr);
+}
+
+std::shared_ptr<Buffer> InProcessTransportLayer::Receive() {
+  if (IsClosed()) {
+    return nullptr;
+  }
+  // read first: the writer pushes everything before it sets the flag, so an
+  // empty queue after seeing it really is the end
+  const bool peer_closed = inbound_.closed.load(std::memory_order_acquire);
+  std::shared_ptr<Buffer> message;
+  if (!inbound_.queue.Pop(message)) {
+    if (peer_closed) {
+      Close();
+    }
+    return nullptr;
+  }
+  ZNET_METRIC(wire_bytes_received_ += message->readable_bytes());
+  if (inbound_.writer_blocked.load(std::memory_order_relaxed) &&
+      inbound_.writer_blocked.exchange(false, std::memory_order_acq_rel)) {
+    WakePeer();
+  }
+  return message;
+}
+
+bool InProcessTransportLayer::Send(std::shared_ptr<Buffer> buffer,
+                                   SendOptions options) {
+  (void)options;  // one queue each way: no channels, no ordering to choose
+  if (IsClosed()) {
+    ZNET_LOG_WARN("Tried to send a packet to a closed connection, dropping packet!");
+    return false;
+  }
+  const size_t size = buffer->readable_bytes();
+  if (size == 0) {
+    return false;
+  }
+  bool over = false;
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    // the steady state: nothing waiting ahead of it and room in the queue
+    if (pending_.empty() && Offer(buffer)) {
+      return true;
+    }
+    const size_t queued = pending_bytes_.load(std::memory_order_relaxed);
+    if (send_high_water_ != 0 && !pending_.empty() &&
+        queued + size > send_high_water_) {
+      over = true;
+    } else {
+      pending_.push_back(std::move(buffer));
+      pending_bytes_.store(queued + size, std::memory_order_relaxed);
+      ZNET_METRIC(queue_full_.fetch_add(1, std::memory_order_relaxed));
+      WritePending();
+    }
+  }
+  if (over) {
+    ZNET_LOG_WARN("In-process: closing, the peer fell {} bytes behind.",
+                  pending_bytes_.load(std::memory_order_relaxed));
+    CloseOptions close_options;
+    close_options.Set<NoLingerKey>(true);
+    Close(close_options);
+    return false;
+  }
+  return true;
+}
+
+bool InProcessTransportLayer::Offer(const std::shared_ptr<Buffer>& buffer) {
+  const size_t size = buffer->readable_bytes();
+  size_t queued = 0;
+  // a copy, not a move: Push() takes its argument by value and a full queue
+  // would drop it
+  if (!outbound_.queue.Push(buffer, &queued)) {
+    return false;
+  }
+  ZNET_METRIC(wire_bytes_sent_.fetch_add(size, std::memory_order_relaxed));
+  if (queued == 0 ||
+      (outbound_.reader_behind.load(std::memory_order_relaxed) &&
+       outbound_.reader_behind.exchange(false, std::memory_order_acq_rel))) {
+    WakePeer();
+  }
+  return true;
+}
+
+void InProcessTransportLayer::WritePending() {
+  while (!pending_.empty()) {
+    if (!Offer(pending_.front())) {
+      // ask the reader's next pop for a wakeup, then look once more in case
+      // it drained the queue before it could see the request
+      outbound_.writer_blocked.store(true, std::memory_order_seq_cst);
+      if (!Offer(pending_.front())) {
+        break;
+      }
+    }
+    pending_bytes_.store(pending_bytes_.load(std::memory_order_relaxed) -
+                             pending_.front()->readable_bytes(),
+                         std::memory_order_relaxed);
+    pending_.pop_front();
+  }
+}
+
+bool InProcessTransportLayer::SetReadyCallback(std::function<void()> ready) {
+  link_->SetWake(accepting_, std::move(ready));
+  return true;
+}
+
+std::chrono::steady_clock::time_point InProcessTransportLayer::NextDeadline() {
+  using TimePoint = std::chrono::steady_clock::time_point;
+  // a closed peer with nothing left queued still needs a Receive() to notice
+  if (IsClosed() || !inbound_.queue.Empty() ||
+      inbound_.closed.load(std::memory_order_acquire) ||
+      pending_bytes_.load(std::memory_order_relaxed) != 0) {
+    return TimePoint::min();
+  }
+  return TimePoint::max();
+}
+
+void InProcessTransportLayer::WakePeer() {
+  link_->Wake(!accepting_);
+  ZNET_METRIC(wakeups_sent_.fetch_add(1, std::memory_order_relaxed));
+}
+
+void InProcessTransportLayer::Flush() {
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!pending_.empty()) {
+      WritePending();
+    }
+  }
+  // the session stops reading after a bounded number of messages, and a
+  // queue that never went empty gives the writer no reason to wake this
+  // side. The flag has its next push do it; a writer already done leaves
+  // the rest to the next tick.
+  if (!IsClosed() && !inbound_.queue.Empty()) {
+    inbound_.reader_behind.store(true, std::memory_order_release);
+  }
+}
+
+void InProcessTransportLayer::Update() {
+  if (IsClosed()) {
+    return;
+  }
+  // a backlog whose wakeup was missed still drains at tick pace
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  if (!pending_.empty()) {
+    WritePending();
+  }
+}
+
+void InProcessTransportLayer::FillMetrics(SessionMetrics& out) const {
+#if ZNET_ENABLE_METRICS
+  out.inproc.wakeups_sent = wakeups_sent_.load(std::memory_order_relaxed);
+  out.inproc.queue_full = queue_full_.load(std::memory_order_relaxed);
+  out.inproc.queued_bytes = pending_bytes_.load(std::memory_order_relaxed);
+  out.common.wire_bytes_sent = wire_bytes_sent_.load(std::memory_order_relaxed);
+  out.common.wire_bytes_received = wire_bytes_received_;
+#else
+  (void)out;
+#endif
+}
+
+Result InProcessTransportLayer::Close(CloseOptions options) {
+  if (is_closed_.exchange(true, std::memory_order_acq_rel)) {
+    return Result::AlreadyDisconnected;
+  }
+  if (!options.GetOr<NoLingerKey>(false)) {
+    // hand over what fits, as a socket would; only if no writer is mid-push,
+    // since this thread must not wait behind it
+    std::unique_lock<std::mutex> lock(write_mutex_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      WritePending();
+    }
+  }
+  // after the last push, so the peer reads everything before the end. Its
+  // loop may be asleep with nothing else coming to wake it.
+  outbound_.closed.store(true, std::memory_order_release);
+  WakePeer();
+  return Result::Success;
+}
+
+InProcessClientBackend::InProcessClientBackend(
+    std::shared_ptr<InetAddress> server_address, const SessionOptions& options)
+    : options_(options), server_address_(std::move(server_address)) {}
+
+InProcessClientBackend::~InProcessClientBackend() {
+  ZNET_LOG_DEBUG("Destructor of the in-process client backend is called.");
+  Close();
+}
+
+Result InProcessClientBackend::Bind() {
+  if (local_address_) {
+    return Result::Success;
+  }
+  local_address_ = std::make_shared<InetAddressIPv4>("127.0.0.1", NextPort());
+  return Result::Success;
+}
+
+Result InProcessClientBackend::Bind(const std::string& ip, PortNumber port) {
+  (void)ip;
+  (void)port;
+  return Bind();
+}
+
+Result InProcessClientBackend::Connect() {
+  if (client_session_ && client_session_->IsAlive()) {
+    return Result::AlreadyConnected;
+  }
+  if (!server_address_ || !server_address_->is_valid()) {
+    return Result::InvalidRemoteAddress;
+  }
+  if (!local_address_) {
+    ZNET_LOG_ERROR("Cannot connect because the client is not bound, make sure to call Bind() first.");
+    return Result::CannotBind;
+  }
+  std::shared_ptr<InProcessLink> link;
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto it = registry.servers.find(server_address_->readable());
+    if (it != registry.servers.end()) {
+      link = it->second->Offer(local_address_);
+    }
+  }
+  if (!link) {
+    ZNET_LOG_ERROR("No in-process server is listening on {}.",
+                   server_address_->readable());
+    return Result::ConnectionRefused;
+  }
+  client_session_ = std::make_shared<PeerSession>(
+      local_address_, server_address_,
+      std::make_unique<InProcessTransportLayer>(link, /*accepting=*/false,
+                                                on_data_, options_.inproc),
+      ConnectionType::InProcess, true, /*self_managed=*/false, options_);
+  return Result::Success;
+}
+
+Result InProcessClientBackend::Close() {
+  if (!client_session_) {
+    return Result::AlreadyClosed;
+  }
+  return client_session_->Close();
+}
+
+bool InProcessClientBackend::IsAlive() {
+  return client_session_ && client_session_->IsAlive();
+}
+
+InProcessServerBackend::InProcessServerBackend(
+    std::shared_ptr<InetAddress> bind_address,
+    const SessionOptions& child_options, const ServerOptions& server_options)
+    : bind_address_(std::move(bind_address)), child_options_(child_options) {
+  // the one that applies, max_connections, is enforced by the server
+  (void)server_options;
+}
+
+InProcessServerBackend::~InProcessServerBackend() {
+  ZNET_LOG_DEBUG("Destructor of the in-process server backend is called.");
+  Close();
+  StopReceiving();
+}
+
+Result InProcessServerBackend::Bind() {
+  if (registered_) {
+    return Result::AlreadyBound;
+  }
+  if (!bind_address_ || !bind_address_->is_valid()) {
+    return Result::InvalidAddress;
+  }
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (bind_address_->ipv() != InetProtocolVersion::Unix &&
+      bind_address_->port() == 0) {
+    // a made-up port no other in-process server holds; there is no kernel
+    // to assign one
+    std::shared_ptr<InetAddress> assigned;
+    do {
+      assigned = bind_address_->WithPort(NextPort());
+    } while (registry.servers.count(assigned->readable()) != 0);
+    bind_address_ = assigned;
+  }
+  if (!registry.servers.emplace(bind_address_->readable(), this).second) {
+    ZNET_LOG_ERROR("An in-process server is already bound to {}.",
+                   bind_address_->readable());
+    return Result::CannotBind;
+  }
+  registered_ = true;
+  return Result::Success;
+}
+
+Result InProcessServerBackend::Listen() {
+  if (!registered_) {
+    return Result::NotBound;
+  }
+  if (listening_.exchange(true)) {
+    return Result::AlreadyListening;
+  }
+  return Result::Success;
+}
+
+void InProcessServerBackend::Unregister() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (registered_) {
+    registry.servers.erase(bind_address_->readable());
+    registered_ = false;
+  }
+}
+
+Result InProcessServerBackend::Close() {
+  Unregister();
+  const bool was_listening = listening_.exchange(false);
+  std::deque<Offered> refused;
+  {
+    std::lock_guard<std::mutex> lock(offered_mutex_);
+    refused.swap(offered_);
+  }
+  // connections never accepted end as a refused TCP connect would
+  for (Offered& offered : refused) {
+    offered.link->to_connecting.closed.store(true, std::memory_order_release);
+    offered.link->Wake(false);
+  }
+  return was_listening ? Result::Success : Result::AlreadyClosed;
+}
+
+std::shared_ptr<InProcessLink> InProcessServerBackend::Offer(
+    std::shared_ptr<InetAddress> remote) {
+  if (!listening_.load()) {
+    return nullptr;
+  }
+  auto link = std::make_shared<InProcessLink>(child_options_.inproc.queue_capacity);
+  std::lock_guard<std::mutex> lock(offered_mutex_);
+  offered_.push_back(Offered{link, std::move(remote)});
+  return link;
+}
+
+std::shared_ptr<PeerSession> InProcessServerBackend::Accept() {
+  Offered offered;
+  {
+    std::lock_guard<std::mutex> lock(offered_mutex_);
+    if (offered_.empty() || stopped_) {
+      return nullptr;
+    }
+    offered = std::move(offered_.front());
+    offered_.pop_front();
+    accepted_.erase(std::remove_if(accepted_.begin(), accepted_.end(),
+                                   [](const std::weak_ptr<InProcessLink>& link) {
+                                     return link.expired();
+                                   }),
+                    accepted_.end());
+    accepted_.push_back(offered.link);
+  }
+  auto transport = std::make_unique<InProcessTransportLayer>(
+      offered.link, /*accepting=*/true, on_data_, child_options_.inproc);
+  return std::make_shared<PeerSession>(bind_address_, offered.remote_address,
+                                       std::move(transport),
+                                       ConnectionType::InProcess,
+                                       /*is_initiator=*/false,
+                                       /*self_managed=*/false, child_options_);
+}
+
+void InProcessServerBackend::AcceptAndReject() {
+  Offered offered;
+  {
+    std::lock_guard<std::mutex> lock(offered_mutex_);
+    if (offered_.empty()) {
+      return;
+    }
+    offered = std::move(offered_.front());
+    offered_.pop_front();
+  }
+  offered.link->to_connecting.closed.store(true, std::memory_order_release);
+  offered.link->Wake(false);
+}
+
+void InProcessServerBackend::StopReceiving() {
+  std::vector<std::weak_ptr<InProcessLink>> accepted;
+  {
+    std::lock_guard<std::mutex> lock(offered_mutex_);
+    stopped_ = true;
+    accepted.swap(accepted_);
+  }
+  for (const std::weak_ptr<InProcessLink>& weak : accepted) {
+    if (auto link = weak.lock()) {
+      link->SetWake(true, nullptr);
+    }
+  }
+}
+
+}  // namespace backends
+}  // namespace znet
@@ -0,0 +1,671 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/backends/shm.h"
+
+#if ZNET_HAS_SHARED_MEMORY
+
+#include "znet/detail/socket_ops.h"
+#include "znet/error.h"
+#include "znet/logger.h"
+#include "znet/util.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace znet {
+namespace backends {
+
+namespace {
+
+// what the server writes once, alongside the descriptors, before the socket
+// goes quiet
+struct Hello {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_bytes;
+};
+
+constexpr uint32_t kHelloMagic = 0x7A73686Du;  // "zshm"
+constexpr uint32_t kHelloVersion = 1;
+// the memfd, then the connecting side's eventfd, then the accepting side's
+constexpr size_t kHelloDescriptors = 3;
+
+constexpr size_t kMinRingBytes = 4096;
+constexpr size_t kMaxRingBytes = size_t{1} << 30;
+
+size_t RingCapacity(size_t requested) {
+  size_t capacity = kMinRingBytes;
+  while (capacity < requested && capacity < kMaxRingBytes) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+size_t RegionSize(size_t ring_bytes) {
+  return 2 * detail::ShmRing::RegionSize(ring_bytes);
+}
+
+void CloseDescriptor(int* fd) {
+  if (*fd >= 0) {
+    close(*fd);
+    *fd = -1;
+  }
+}
+
+SessionOptions WithSharedMemoryEncryption(SessionOptions options) {
+  options.common.encryption = options.shm.encryption;
+  return options;
+}
+
+
+}  // namespace
+
+bool OfferChannel(SocketHandle socket, size_t ring_bytes,
+                  SharedMemoryChannel* out) {
+  const size_t capacity = RingCapacity(ring_bytes);
+  const size_t region_size = RegionSize(capacity);
+  int memory = memfd_create("znet-shm", MFD_CLOEXEC);
+  if (memory < 0) {
+    ZNET_LOG_ERROR("Shared memory: memfd_create failed: {}", GetLastErrorInfo());
+    return false;
+  }
+  int wake_connecting = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  int wake_accepting = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  void* region = MAP_FAILED;
+  bool sent = false;
+  if (wake_connecting >= 0 && wake_accepting >= 0 &&
+      ftruncate(memory, static_cast<off_t>(region_size)) == 0) {
+    region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  memory, 0);
+  }
+  if (region != MAP_FAILED) {
+    detail::ShmRing ring;
+    ring.Attach(region, capacity);
+    ring.Initialize();
+    ring.Attach(static_cast<char*>(region) +
+                    detail::ShmRing::RegionSize(capacity),
+                capacity);
+    ring.Initialize();
+
+    Hello hello{kHelloMagic, kHelloVersion, capacity};
+    iovec payload{&hello, sizeof(hello)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kHelloDescriptors)] = {};
+    msghdr message{};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* rights = CMSG_FIRSTHDR(&message);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int) * kHelloDescriptors);
+    const int descriptors[kHelloDescriptors] = {memory, wake_connecting,
+                                                wake_accepting};
+    std::memcpy(CMSG_DATA(rights), descriptors, sizeof(descriptors));
+    // a fresh connection's buffer takes a few dozen bytes whatever it is
+    // set to, so a short or refused send here means the peer is gone
+    sent = sendmsg(socket, &message, MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(sizeof(hello));
+  }
+  if (!sent) {
+    ZNET_LOG_ERROR("Shared memory: could not hand a connection its rings: {}",
+                   GetLastErrorInfo());
+    if (region != MAP_FAILED) {
+      munmap(region, region_size);
+    }
+    CloseDescriptor(&memory);
+    CloseDescriptor(&wake_connecting);
+    CloseDescriptor(&wake_accepting);
+    return false;
+  }
+  // the mapping keeps the memory alive; the peer has its own descriptor
+  CloseDescriptor(&memory);
+  out->socket = socket;
+  out->region = region;
+  out->region_size = region_size;
+  out->ring_bytes = capacity;
+  out->wake_self = wake_accepting;
+  out->wake_peer = wake_connecting;
+  out->accepting = true;
+  return true;
+}
+
+bool JoinChannel(SocketHandle socket, std::chrono::milliseconds timeout,
+                 SharedMemoryChannel* out) {
+  pollfd entry{};
+  entry.fd = socket;
+  entry.events = POLLIN;
+  if (poll(&entry, 1, static_cast<int>(timeout.count())) <= 0) {
+    ZNET_LOG_ERROR("Shared memory: the server sent no rings within {} ms.",
+                   timeout.count());
+    return false;
+  }
+  Hello hello{};
+  iovec payload{&hello, sizeof(hello)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kHelloDescriptors)] = {};
+  msghdr message{};
+  message.msg_iov = &payload;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  const ssize_t received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+  int descriptors[kHelloDescriptors] = {-1, -1, -1};
+  const cmsghdr* rights = CMSG_FIRSTHDR(&message);
+  if (rights && rights->cmsg_level == SOL_SOCKET &&
+      rights->cmsg_type == SCM_RIGHTS &&
+      rights->cmsg_len == CMSG_LEN(sizeof(descriptors))) {
+    std::memcpy(descriptors, CMSG_DATA(rights), sizeof(descriptors));
+  }
+  int& memory = descriptors[0];
+  int& wake_connecting = descriptors[1];
+  int& wake_accepting = descriptors[2];
+  const auto fail = [&](const char* why) {
+    ZNET_LOG_ERROR("Shared memory: refusing the server's rings: {}.", why);
+    CloseDescriptor(&memory);
+    CloseDescriptor(&wake_connecting);
+    CloseDescriptor(&wake_accepting);
+    return false;
+  };
+  if (received != static_cast<ssize_t>(sizeof(hello)) || memory < 0 ||
+      wake_connecting < 0 || wake_accepting < 0) {
+    return fail("the hello was cut short");
+  }
+  if (hello.magic != kHelloMagic || hello.version != kHelloVersion) {
+    return fail("not a znet shared memory server");
+  }
+  const size_t capacity = static_cast<size_t>(hello.ring_bytes);
+  if (capacity < kMinRingBytes || capacity > kMaxRingBytes ||
+      (capacity & (capacity - 1)) != 0) {
+    return fail("the ring size is out of range");
+  }
+  // the server sized the memfd; a smaller one would fault mid-copy
+  const size_t region_size = RegionSize(capacity);
+  struct stat status{};
+  if (fstat(memory, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < region_size) {
+    return fail("the memory is smaller than its rings");
+  }
+  void* region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, memory, 0);
+  if (region == MAP_FAILED) {
+    return fail("it could not be mapped");
+  }
+  CloseDescriptor(&memory);
+  out->socket = socket;
+  out->region = region;
+  out->region_size = region_size;
+  out->ring_bytes = capacity;
+  out->wake_self = wake_connecting;
+  out->wake_peer = wake_accepting;
+  out->accepting = false;
+  return true;
+}
+
+SharedMemoryTransportLayer::SharedMemoryTransportLayer(
+    SharedMemoryChannel channel, CommonOptions common, SharedMemoryOptions shm)
+    : channel_(channel),
+      // a quarter of the ring, so a large message streams through in
+      // pieces the reader can take while the writer fills the rest
+      max_record_(channel.ring_bytes / 4),
+      liveness_interval_(common.keepalive_interval),
+      last_liveness_check_(std::chrono::steady_clock::now()),
+      max_reassembly_bytes_(shm.max_reassembly_bytes),
+      send_high_water_(shm.send_high_water) {
+  char* first = static_cast<char*>(channel_.region);
+  char* second = first + detail::ShmRing::RegionSize(channel_.ring_bytes);
+  outbound_.Attach(channel_.accepting ? first : second, channel_.ring_bytes);
+  inbound_.Attach(channel_.accepting ? second : first, channel_.ring_bytes);
+}
+
+SharedMemoryTransportLayer::~SharedMemoryTransportLayer() {
+  // the peer keeps its own mapping; the memory goes once both are gone
+  munmap(channel_.region, channel_.region_size);
+  CloseDescriptor(&channel_.wake_self);
+  CloseDescriptor(&channel_.wake_peer);
+  CloseSocket(channel_.socket);
+  channel_.socket = kSocketInvalid;
+}
+
+std::shared_ptr<Buffer> SharedMemoryTransportLayer::Receive() {
+  if (IsClosed()) {
+    return nullptr;
+  }
+  for (;;) {
+    // read first: everything written before the close was published before
+    // the flag, so an empty ring after seeing it really is the end
+    const bool peer_closed = inbound_.closed();
+    uint32_t prefix = 0;
+    bool corrupt = false;
+    if (!inbound_.Front(&prefix, &corrupt)) {
+      if (corrupt) {
+        ZNET_LOG_ERROR("Shared memory: the peer's ring is corrupt, closing.");
+        Close();
+        return nullptr;
+      }
+      if (peer_closed) {
+        Close();
+        return nullptr;
+      }
+      if (inbound_.ParkReader()) {
+        unread_.store(false, std::memory_order_relaxed);
+        return nullptr;
+      }
+      continue;  // a record landed while parking
+    }
+    const bool more = (prefix & kMoreFragments) != 0;
+    const size_t size = prefix & ~kMoreFragments;
+    if (size == 0 || size > max_record_) {
+      ZNET_LOG_ERROR("Shared memory: received an invalid record length {}, "
+                     "closing!", size);
+      Close();
+      return nullptr;
+    }
+    std::shared_ptr<Buffer> message;
+    if (!more && !reassembling_) {
+      message = std::make_shared<Buffer>();
+      message->ReserveExact(size);
+      if (!inbound_.Take(message->write_cursor_data(), size)) {
+        ZNET_LOG_ERROR("Shared memory: a record overran the peer's ring, "
+                       "closing.");
+        Close();
+        return nullptr;
+      }
+      message->CommitWrite(size);
+    } else {
+      message = Reassemble(static_cast<uint32_t>(size), !more);
+      if (IsClosed()) {
+        return nullptr;
+      }
+    }
+    ZNET_METRIC(metrics_.common.wire_bytes_received +=
+                detail::ShmRing::kPrefixSize + size);
+    if (inbound_.TakeWriterPark()) {
+      Signal(channel_.wake_peer);
+    }
+    if (message) {
+      unread_.store(true, std::memory_order_relaxed);
+      return message;
+    }
+  }
+}
+
+std::shared_ptr<Buffer> SharedMemoryTransportLayer::Reassemble(uint32_t size,
+                                                               bool last) {
+  if (!reassembling_) {
+    reassembly_ = std::make_shared<Buffer>();
+    reassembling_ = true;
+  }
+  if (max_reassembly_bytes_ != 0 &&
+      reassembly_->readable_bytes() + size > max_reassembly_bytes_) {
+    ZNET_LOG_ERROR("Shared memory: closing, a message outgrew the {} byte "
+                   "reassembly limit.", max_reassembly_bytes_);
+    reassembling_ = false;
+    reassembly_ = nullptr;
+    Close();
+    return nullptr;
+  }
+  reassembly_->ReserveIncremental(size);
+  if (!inbound_.Take(reassembly_->write_cursor_data(), size)) {
+    ZNET_LOG_ERROR("Shared memory: a record overran the peer's ring, closing.");
+    Close();
+    return nullptr;
+  }
+  reassembly_->CommitWrite(size);
+  if (!last) {
+    return nullptr;
+  }
+  reassembling_ = false;
+  ZNET_METRIC(metrics_.shm.messages_reassembled++);
+  return std::move(reassembly_);
+}
+
+bool SharedMemoryTransportLayer::Send(std::shared_ptr<Buffer> buffer,
+                                      SendOptions options) {
+  (void)options;  // one ring each way: no channels, no ordering to choose
+  if (IsClosed()) {
+    ZNET_LOG_WARN("Tried to send a packet to a closed connection, dropping packet!");
+    return false;
+  }
+  const size_t size = buffer->readable_bytes();
+  if (size == 0) {
+    return false;
+  }
+  bool over = false;
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    // the steady state: nothing waiting ahead of it and room in the ring
+    if (pending_.empty() && size <= max_record_ &&
+        outbound_.TryWrite(static_cast<uint32_t>(size),
+                           buffer->read_cursor_data(), size)) {
+      ZNET_METRIC(metrics_.common.wire_bytes_sent +=
+                  detail::ShmRing::kPrefixSize + size);
+      if (outbound_.TakeReaderPark()) {
+        Signal(channel_.wake_peer);
+      }
+      return true;
+    }
+    const size_t queued = pending_bytes_.load(std::memory_order_relaxed);
+    if (send_high_water_ != 0 && !pending_.empty() &&
+        queued + size > send_high_water_) {
+      over = true;
+    } else {
+      pending_.push_back(PendingMessage{std::move(buffer), 0});
+      pending_bytes_.store(queued + size, std::memory_order_relaxed);
+      WritePending();
+    }
+  }
+  if (over) {
+    ZNET_LOG_WARN("Shared memory: closing, the peer fell {} bytes behind.",
+                  pending_bytes_.load(std::memory_order_relaxed));
+    CloseOptions close_options;
+    close_options.Set<NoLingerKey>(true);
+    Close(close_options);
+    return false;
+  }
+  return true;
+}
+
+void SharedMemoryTransportLayer::WritePending() {
+  bool wrote = false;
+  while (!pending_.empty()) {
+    PendingMessage& message = pending_.front();
+    const size_t left = message.buffer->readable_bytes() - message.offset;
+    const size_t chunk = std::min(left, max_record_);
+    const bool more = chunk < left;
+    const uint32_t prefix =
+        static_cast<uint32_t>(chunk) | (more ? kMoreFragments : 0u);
+    if (!outbound_.TryWrite(
+            prefix, message.buffer->read_cursor_data() + message.offset,
+            chunk)) {
+      if (outbound_.ParkWriter(chunk)) {
+        // the reader wakes this side once it has taken enough
+        ZNET_METRIC(metrics_.shm.ring_full++);
+        break;
+      }
+      continue;  // room appeared while parking
+    }
+    wrote = true;
+    ZNET_METRIC(metrics_.common.wire_bytes_sent +=
+                detail::ShmRing::kPrefixSize + chunk);
+    if (more || message.offset != 0) {
+      ZNET_METRIC(metrics_.shm.fragments_sent++);
+    }
+    pending_bytes_.store(pending_bytes_.load(std::memory_order_relaxed) - chunk,
+                         std::memory_order_relaxed);
+    if (more) {
+      message.offset += chunk;
+    } else {
+      pending_.pop_front();
+    }
+  }
+  if (wrote && outbound_.TakeReaderPark()) {
+    Signal(channel_.wake_peer);
+  }
+}
+
+void SharedMemoryTransportLayer::Signal(int wake) {
+  const uint64_t one = 1;
+  // only fails on an overflowing counter, which still wakes the reader
+  (void)!write(wake, &one, sizeof(one));
+  ZNET_METRIC(metrics_.shm.wakeups_sent++);
+}
+
+void SharedMemoryTransportLayer::Flush() {
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!pending_.empty()) {
+      WritePending();
+    }
+  }
+  // the session stops reading after a bounded number of messages, and with
+  // records still in the ring this side never parked, so nothing else would
+  // wake it for the rest. Once per stop, not once per flush.
+  if (unread_.exchange(false, std::memory_order_relaxed) && !IsClosed() &&
+      !inbound_.empty()) {
+    Signal(channel_.wake_self);
+  }
+}
+
+void SharedMemoryTransportLayer::Update() {
+  if (IsClosed()) {
+    return;
+  }
+  {
+    // a backlog the peer's wakeup was lost for still drains at tick pace
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!pending_.empty()) {
+      WritePending();
+    }
+  }
+  if (liveness_interval_.count() <= 0) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_liveness_check_ < liveness_interval_) {
+    return;
+  }
+  last_liveness_check_ = now;
+  // nothing is ever sent on the socket after the rendezvous, so a read
+  // either would block or reports the peer gone, crashed or not
+  char byte;
+  const ssize_t received =
+      recv(channel_.socket, &byte, sizeof(byte), MSG_DONTWAIT);
+  if (received == 0 ||
+      (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    ZNET_LOG_DEBUG("Shared memory: the peer's socket closed.");
+    // whatever the peer wrote before it went is still readable
+    if (inbound_.empty()) {
+      Close();
+    } else {
+      inbound_.MarkClosed();
+    }
+  }
+}
+
+bool SharedMemoryTransportLayer::SetReadyCallback(
+    std::function<void()> ready) {
+  if (!ready_) {
+    return false;
+  }
+  ready_->Arm(std::move(ready));
+  return true;
+}
+
+std::chrono::steady_clock::time_point
+SharedMemoryTransportLayer::NextDeadline() {
+  using TimePoint = std::chrono::steady_clock::time_point;
+  // the eventfd is only written to a side that parked on an empty ring, and
+  // one that stopped early never did
+  if (IsClosed() || pending_bytes_.load(std::memory_order_relaxed) != 0 ||
+      !inbound_.empty()) {
+    return TimePoint::min();
+  }
+  if (liveness_interval_.count() <= 0) {
+    return TimePoint::max();
+  }
+  return last_liveness_check_ + liveness_interval_;
+}
+
+void SharedMemoryTransportLayer::FillMetrics(SessionMetrics& out) const {
+#if ZNET_ENABLE_METRICS
+  out.shm = metrics_.shm;
+  out.shm.queued_bytes = pending_bytes_.load(std::memory_order_relaxed);
+  out.common.wire_bytes_sent = metrics_.common.wire_bytes_sent;
+  out.common.wire_bytes_received = metrics_.common.wire_bytes_received;
+#else
+  (void)out;
+#endif
+}
+
+Result SharedMemoryTransportLayer::Close(CloseOptions options) {
+  if (is_closed_.exchange(true, std::memory_order_acq_rel)) {
+    return Result::AlreadyDisconnected;
+  }
+  if (!options.GetOr<NoLingerKey>(false)) {
+    // hand over what fits, as a socket would; only if no writer is
+    // mid-copy, since this thread must not wait behind it
+    std::unique_lock<std::mutex> lock(write_mutex_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      WritePending();
+    }
+  }
+  // after the last record, so the peer reads everything before the end. Its
+  // reader may be asleep with nothing else coming to wake it.
+  outbound_.MarkClosed();
+  Signal(channel_.wake_peer);
+  // the descriptors stay open until the destructor, as on TCP: a worker may
+  // still be inside Receive() on this ring
+  ShutdownSocket(channel_.socket);
+  return Result::Success;
+}
+
+SharedMemoryClientBackend::SharedMemoryClientBackend(
+    std::shared_ptr<InetAddress> server_address, const SessionOptions& options)
+    : options_(options), server_address_(std::move(server_address)) {}
+
+SharedMemoryClientBackend::~SharedMemoryClientBackend() {
+  ZNET_LOG_DEBUG("Destructor of the shared memory client backend is called.");
+  Close();
+  CloseSocket(client_socket_);
+}
+
+Result SharedMemoryClientBackend::Bind() {
+  if (!server_address_ || server_address_->ipv() != InetProtocolVersion::Unix) {
+    ZNET_LOG_ERROR("Shared memory meets its server on a unix: path.");
+    return Result::InvalidRemoteAddress;
+  }
+  if (IsValidSocketHandle(client_socket_)) {
+    return Result::Success;
+  }
+  client_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (!IsValidSocketHandle(client_socket_)) {
+    ZNET_LOG_ERROR("Error binding socket.");
+    return Result::CannotBind;
+  }
+  return Result::Success;
+}
+
+Result SharedMemoryClientBackend::Bind(const std::string& ip, PortNumber port) {
+  (void)ip;
+  (void)port;
+  return Bind();
+}
+
+Result SharedMemoryClientBackend::Connect() {
+  if (client_session_ && client_session_->IsAlive()) {
+    return Result::AlreadyConnected;
+  }
+  if (!server_address_ || !server_address_->is_valid()) {
+    return Result::InvalidRemoteAddress;
+  }
+  if (!IsValidSocketHandle(client_socket_)) {
+    ZNET_LOG_ERROR("Cannot connect because the client is not bound, make sure to call Bind() first.");
+    return Result::CannotBind;
+  }
+  if (connect(client_socket_, server_address_->handle_ptr(),
+              server_address_->addr_size()) < 0) {
+    ZNET_LOG_ERROR("Error connecting to server: {}", GetLastErrorInfo());
+    CloseSocket(client_socket_);
+    client_socket_ = kSocketInvalid;
+    return Result::Failure;
+  }
+  const std::chrono::milliseconds timeout =
+      options_.common.idle_timeout.count() > 0 ? options_.common.idle_timeout
+                                               : std::chrono::seconds(1);
+  SharedMemoryChannel channel;
+  if (!JoinChannel(client_socket_, timeout, &channel)) {
+    CloseSocket(client_socket_);
+    client_socket_ = kSocketInvalid;
+    return Result::Failure;
+  }
+  sockaddr_storage local_ss{};
+  socklen_t local_len = sizeof(local_ss);
+  if (getsockname(client_socket_, reinterpret_cast<sockaddr*>(&local_ss),
+                  &local_len) == 0) {
+    local_address_ = InetAddress::from(reinterpret_cast<sockaddr*>(&local_ss));
+  }
+  wait_fd_ = channel.wake_self;
+  if (poller_) {
+    poller_->Add(wait_fd_, poll_tag_);
+  }
+  client_session_ = std::make_shared<PeerSession>(
+      local_address_, server_address_,
+      std::make_unique<SharedMemoryTransportLayer>(channel, options_.common,
+                                                   options_.shm),
+      ConnectionType::SharedMemory, true, /*self_managed=*/false, options_);
+  // the transport owns the socket now
+  client_socket_ = kSocketInvalid;
+  return Result::Success;
+}
+
+Result SharedMemoryClientBackend::Close() {
+  if (!client_session_) {
+    return Result::AlreadyClosed;
+  }
+  return client_session_->Close();
+}
+
+bool SharedMemoryClientBackend::IsAlive() {
+  return client_session_ && client_session_->IsAlive();
+}
+
+void SharedMemoryClientBackend::WaitReadable(std::chrono::milliseconds timeout) {
+  if (wait_fd_ < 0 || !client_session_) {
+    std::this_thread::sleep_for(timeout);
+    return;
+  }
+  pollfd entry{};
+  entry.fd = wait_fd_;
+  entry.events = POLLIN;
+  if (poll(&entry, 1, static_cast<int>(timeout.count())) > 0 &&
+      (entry.revents & POLLIN) != 0) {
+    // re-arm; the caller's loop reads the rings next
+    uint64_t count;
+    (void)!read(wait_fd_, &count, sizeof(count));
+  }
+}
+
+SharedMemoryServerBackend::SharedMemoryServerBackend(
+    std::shared_ptr<InetAddress> bind_address,
+    const SessionOptions& child_options, const ServerOptions& server_options)
+    : TCPServerBackend(std::move(bind_address),
+                       WithSharedMemoryEncryption(child_options),
+                       server_options) {}
+
+std::unique_ptr<TransportLayer> SharedMemoryServerBackend::CreateTransport(
+    SocketHandle socket) {
+  SharedMemoryChannel channel;
+  if (!OfferChannel(socket, child_options_.shm.ring_bytes, &channel)) {
+    CloseSocket(socket);
+    return nullptr;
+  }
+  const int wake = channel.wake_self;
+  auto transport = std::make_unique<SharedMemoryTransportLayer>(
+      channel, child_options_.common, child_options_.shm);
+  auto ready = std::make_shared<ReadyWatch>();
+  transport->SetReadyWatch(ready);
+  // the eventfd, not the socket: nothing arrives on that after this
+  Watch(Watched{wake, std::make_shared<std::atomic_bool>(false),
+                std::move(ready), true});
+  return transport;
+}
+
+}  // namespace backends
+}  // namespace znet
+
+#endif  // ZNET_HAS_SHARED_MEMORY
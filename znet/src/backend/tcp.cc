@@ -38,18 +38,28 @@ inline bool WouldBlockOnSend() {
 #endif
 }
 
-// how long one wait for socket room lasts before the send loop rechecks whether
-// the session was closed underneath it
-constexpr int kSendStallWaitMs = 50;
+// what Send() sets aside below ZNET_MAX_BUFFER_SIZE for the frame, and again
+// below that for a packed payload's compression and encryption headers
+constexpr size_t kFrameHeaderBudget = 48;
+
+// a reassembly buffer past this is released with its message rather than
+// kept for the next one, so one outsized message does not pin its memory
+// for the rest of the connection
+constexpr size_t kMaxPooledReassembly = 256u * 1024u;
 
 }  // namespace
 
-TCPTransportLayer::TCPTransportLayer(SocketHandle socket, CommonOptions common)
+TCPTransportLayer::TCPTransportLayer(SocketHandle socket, CommonOptions common,
+                                     TCPOptions tcp)
     : socket_(socket),
       keepalive_interval_(common.keepalive_interval),
       idle_timeout_(common.idle_timeout),
       last_recv_(std::chrono::steady_clock::now()),
-      last_send_(std::chrono::steady_clock::now()) {
+      last_send_(std::chrono::steady_clock::now()),
+      send_high_water_(tcp.send_high_water),
+      slow_consumer_(tcp.slow_consumer),
+      max_reassembly_bytes_(tcp.max_reassembly_bytes),
+      zerocopy_threshold_(tcp.zerocopy_threshold) {
   // one reservation for the connection's lifetime; recv() is bounded by the
   // space left in it, so it never grows
   recv_buffer_.ReserveExact(ZNET_MAX_BUFFER_SIZE);
@@ -60,6 +70,15 @@ TCPTransportLayer::TCPTransportLayer(SocketHandle socket, CommonOptions common)
   setsockopt(socket_, SOL_SOCKET, SO_NOSIGPIPE,
              reinterpret_cast<const char*>(&no_sigpipe), sizeof(no_sigpipe));
 #endif
+#if ZNET_HAS_ZEROCOPY
+  if (zerocopy_threshold_ != 0 && !SocketEnableZeroCopy(socket_)) {
+    ZNET_LOG_DEBUG("TCP: socket {} refused SO_ZEROCOPY, sending copies: {}",
+                   socket_, GetLastErrorInfo());
+    zerocopy_threshold_ = 0;
+  }
+#else
+  zerocopy_threshold_ = 0;
+#endif
 }
 
 TCPTransportLayer::~TCPTransportLayer() {
@@ -78,9 +97,14 @@ std::shared_ptr<Buffer> TCPTransportLayer::Receive() {
 
   // ReadBuffer() compacted, so everything past the write cursor is free to
   // append into. A partial frame can never fill the reservation (see the
-  // oversize check), so there is always room to make progress.
-  ssize_t received = SocketRecv(socket_, recv_buffer_.write_cursor_data(),
-                                recv_buffer_.writable_bytes());
+  // oversize check), so there is always room to make progress. A run's body
+  // skips recv_buffer_ and lands in its message, which has room for all of
+  // it; ReadBuffer() left nothing of it behind.
+  const bool run = run_remaining_ != 0;
+  ssize_t received =
+      run ? ReadSome(reassembly_->write_cursor_data(), run_remaining_)
+          : ReadSome(recv_buffer_.write_cursor_data(),
+                     recv_buffer_.writable_bytes());
 
   if (received == 0) {
     Close();
@@ -91,6 +115,16 @@ std::shared_ptr<Buffer> TCPTransportLayer::Receive() {
     last_recv_ = std::chrono::steady_clock::now();
     ZNET_METRIC(metrics_.tcp.reads++);
     ZNET_METRIC(metrics_.common.wire_bytes_received += static_cast<uint64_t>(received));
+    if (run) {
+      reassembly_->CommitWrite(static_cast<size_t>(received));
+      run_remaining_ -= static_cast<size_t>(received);
+      if (run_remaining_ != 0) {
+        return nullptr;
+      }
+      reassembling_ = false;
+      ZNET_METRIC(metrics_.tcp.messages_reassembled++);
+      return reassembly_;
+    }
     recv_buffer_.CommitWrite(static_cast<size_t>(received));
     return ReadBuffer();
   }
@@ -122,28 +156,57 @@ std::shared_ptr<Buffer> TCPTransportLayer::Receive() {
   return nullptr;
 }
 
+ssize_t TCPTransportLayer::ReadSome(char* out, size_t size) {
+  return SocketRecv(socket_, out, size);
+}
+
 std::shared_ptr<Buffer> TCPTransportLayer::ReadBuffer() {
   // control frames are consumed in place, so this loops until it has a data
   // frame to hand up or runs out of complete frames. under two readable bytes
   // the length prefix itself is still in flight.
-  while (recv_buffer_.readable_bytes() >= 2) {
+  while (run_remaining_ != 0 || recv_buffer_.readable_bytes() >= 2) {
+    if (run_remaining_ != 0) {
+      // whatever of a run came in with the bytes before it
+      const size_t take =
+          std::min(run_remaining_, recv_buffer_.readable_bytes());
+      reassembly_->Write(recv_buffer_.read_cursor_data(), take);
+      recv_buffer_.SkipRead(take);
+      run_remaining_ -= take;
+      if (run_remaining_ != 0) {
+        break;  // the rest is read straight into it; see Receive()
+      }
+      reassembling_ = false;
+      ZNET_METRIC(metrics_.tcp.messages_reassembled++);
+      return reassembly_;
+    }
     const size_t frame_start = recv_buffer_.read_cursor();
     // a fixed big-endian uint16, which is the buffer's endianness: cheap to
     // parse, cheap to prepend, and a frame is bounded far below what it can
     // express
-    const size_t size = recv_buffer_.ReadInt<uint16_t>();
-    if (size + 2 > recv_buffer_.capacity()) {
+    const uint16_t prefix = recv_buffer_.ReadInt<uint16_t>();
+    const bool more = (prefix & kMoreFragments) != 0;
+    const size_t size = prefix & kMaxFrameLength;
+    if (size + 2 > recv_buffer_.capacity() || (more && size == 0)) {
       // could never be completed, let alone have been sent by Send(). this is
       // also what keeps a partial frame from deadlocking a full buffer: any
       // frame that passes always fits alongside its prefix, so recv() always
-      // has room to complete it.
-      ZNET_LOG_ERROR("Received an oversized frame length {}, closing!", size);
+      // has room to complete it. An empty fragment is refused too: Send()
+      // never splits one off.
+      ZNET_LOG_ERROR("Received an invalid frame length {}, closing!", prefix);
       Close();
       recv_buffer_.Reset();
       return nullptr;
     }
-    // a zero length is a control frame; its body is the one byte that follows
-    const size_t need = size == 0 ? 1 : size;
+    // a zero length is a control frame; its body is the one byte that
+    // follows, and a run's length after that
+    size_t need = size;
+    if (size == 0) {
+      need = recv_buffer_.readable_bytes() >= 1 &&
+                     static_cast<uint8_t>(*recv_buffer_.read_cursor_data()) ==
+                         kControlRun
+                 ? 5
+                 : 1;
+    }
     // a read can end anywhere, so the body may still be in flight. not a
     // framing error: rewind the prefix and let the next recv() complete it.
     if (recv_buffer_.readable_bytes() < need) {
@@ -151,19 +214,104 @@ std::shared_ptr<Buffer> TCPTransportLayer::ReadBuffer() {
       break;
     }
     if (size == 0) {
-      HandleControl(recv_buffer_.ReadInt<uint8_t>());
+      // control frames may fall between the fragments of a message
+      const uint8_t type = recv_buffer_.ReadInt<uint8_t>();
+      if (type == kControlRun) {
+        if (!StartRun(recv_buffer_.ReadInt<uint32_t>())) {
+          recv_buffer_.Reset();
+          return nullptr;
+        }
+        continue;
+      }
+      HandleControl(type);
       continue;
     }
-    auto frame =
-        std::make_shared<Buffer>(recv_buffer_.read_cursor_data(), size);
+    if (!more && !reassembling_) {
+      auto frame =
+          std::make_shared<Buffer>(recv_buffer_.read_cursor_data(), size);
+      recv_buffer_.SkipRead(size);
+      return frame;
+    }
+    auto message =
+        Reassemble(recv_buffer_.read_cursor_data(), size, /*last=*/!more);
     recv_buffer_.SkipRead(size);
-    return frame;
+    if (IsClosed()) {
+      recv_buffer_.Reset();
+      return nullptr;
+    }
+    if (message) {
+      return message;
+    }
   }
   // reclaim the consumed front so the next recv() appends after the tail
   recv_buffer_.Compact();
   return nullptr;
 }
 
+void TCPTransportLayer::StartReassembly() {
+  // the last message's buffer is reused only once the session is done with
+  // it; one it still holds is left to it
+  if (!reassembly_ || reassembly_.use_count() > 1 ||
+      reassembly_->capacity() > kMaxPooledReassembly) {
+    reassembly_ = std::make_shared<Buffer>();
+  } else {
+    reassembly_->Reset();
+  }
+  reassembling_ = true;
+}
+
+bool TCPTransportLayer::StartRun(size_t length) {
+  // a run is a whole message, so it cannot land between another's fragments
+  if (reassembling_ || length == 0) {
+    ZNET_LOG_ERROR("TCP: closing socket {}, received a malformed run of {} "
+                   "bytes.", socket_, length);
+    Close();
+    return false;
+  }
+  if (max_reassembly_bytes_ != 0 && length > max_reassembly_bytes_) {
+    ZNET_LOG_ERROR("TCP: closing socket {}, a message outgrew the {} byte "
+                   "reassembly limit.", socket_, max_reassembly_bytes_);
+    Close();
+    return false;
+  }
+  StartReassembly();
+  // room for all of it up front, so the body can be read straight in
+  reassembly_->ReserveExact(length);
+  if (reassembly_->writable_bytes() < length) {
+    ZNET_LOG_ERROR("TCP: closing socket {}, cannot allocate a {} byte "
+                   "message.", socket_, length);
+    reassembling_ = false;
+    reassembly_ = nullptr;
+    Close();
+    return false;
+  }
+  run_remaining_ = length;
+  return true;
+}
+
+std::shared_ptr<Buffer> TCPTransportLayer::Reassemble(const char* data,
+                                                      size_t size, bool last) {
+  if (!reassembling_) {
+    StartReassembly();
+  }
+  if (max_reassembly_bytes_ != 0 &&
+      reassembly_->readable_bytes() + size > max_reassembly_bytes_) {
+    ZNET_LOG_ERROR("TCP: closing socket {}, a message outgrew the {} byte "
+                   "reassembly limit.", socket_, max_reassembly_bytes_);
+    reassembling_ = false;
+    reassembly_ = nullptr;
+    Close();
+    return nullptr;
+  }
+  reassembly_->Write(data, size);
+  if (!last) {
+    return nullptr;
+  }
+  reassembling_ = false;
+  ZNET_METRIC(metrics_.tcp.messages_reassembled++);
+  return reassembly_;
+}
+
 void TCPTransportLayer::HandleControl(uint8_t type) {
   if (type == kControlPing) {
     SendControl(kControlPong);
@@ -174,53 +322,222 @@ void TCPTransportLayer::SendControl(uint8_t type) {
   if (IsClosed()) {
     return;
   }
-  Buffer frame;
-  frame.ReserveExact(3);
-  frame.WriteInt<uint8_t>(0);  // a zero uint16 length marks a control frame
-  frame.WriteInt<uint8_t>(0);
-  frame.WriteInt<uint8_t>(type);
-  WriteAll(frame);
+  auto frame = std::make_shared<Buffer>();
+  frame->ReserveExact(3);
+  frame->WriteInt<uint8_t>(0);  // a zero uint16 length marks a control frame
+  frame->WriteInt<uint8_t>(0);
+  frame->WriteInt<uint8_t>(type);
+  // not left for Flush(): a pong answers from inside Receive() and a ping
+  // from Update(), and neither is owed a flush afterwards. Queued data goes
+  // out in front of it, which keeps the stream in order.
+  PendingFrame pending{std::move(frame)};
+  if (!Enqueue(&pending, 1, /*control=*/true)) {
+    return;
+  }
+  bool written;
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    written = WritePending();
+  }
+  if (!written) {
+    Close();
+  }
 }
 
-bool TCPTransportLayer::WriteAll(Buffer& buffer) {
-  // one frame reaches the socket at a time, whoever produced it; see
-  // write_mutex_
-  std::lock_guard<std::mutex> lock(write_mutex_);
+bool TCPTransportLayer::WritePending() {
   // a length-prefixed stream cannot survive a dropped tail: the peer would read
-  // the next frame's bytes as this one's body, so a short send is retried
-  // rather than reported. The frame is the readable region: a buffer framed
-  // in place still carries unspent headroom in front of it.
-  const char* data = buffer.read_cursor_data();
-  size_t remaining = buffer.readable_bytes();
-  size_t offset = 0;
-  while (remaining > 0) {
-    // the application closes from its own thread, so the connection can die
-    // mid-frame. Send()'s check on the way in is not enough against a peer that
-    // stopped reading, since this loop would spin without ever noticing.
-    if (IsClosed()) {
-      return false;
+  // the next frame's bytes as this one's body, so a short send is resumed
+  // rather than reported, from wherever inside whichever frame it stopped.
+  // Each frame is its buffer's readable region: a buffer framed in place
+  // still carries unspent headroom in front of it.
+  bool intact = true;
+  if (!zerocopy_held_.empty()) {
+    ReapZeroCopy();
+  }
+  while (!pending_.empty()) {
+    ssize_t written = -1;
+    bool zerocopy = false;
+    const bool file = pending_.front().file != nullptr;
+    if (file) {
+#if ZNET_HAS_SENDFILE
+      // a file span goes on its own; the frames either side of it are
+      // gathered as usual
+      const PendingFrame& span = pending_.front();
+      written = SocketSendFile(socket_, span.file->descriptor(),
+                               span.file_offset + pending_offset_,
+                               span.file_size - pending_offset_);
+#endif
+    } else {
+      SocketIoSlice slices[kMaxGatherFrames];
+      size_t count = 0;
+      size_t bytes = 0;
+      for (auto it = pending_.begin(); it != pending_.end() && !it->file &&
+                                       count < kMaxGatherFrames;
+           ++it) {
+        const Buffer& frame = *it->buffer;
+        const size_t skip = count == 0 ? pending_offset_ : 0;
+        SetIoSlice(slices[count++], frame.read_cursor_data() + skip,
+                   frame.readable_bytes() - skip);
+        bytes += frame.readable_bytes() - skip;
+      }
+#if ZNET_HAS_ZEROCOPY
+      if (zerocopy_threshold_ != 0 && bytes >= zerocopy_threshold_) {
+        zerocopy = true;
+        written = SocketSendvZeroCopy(socket_, slices, count);
+        if (written < 0 && errno == ENOBUFS) {
+          // the socket's allowance for pinned pages is spent until
+          // completions come back; this gather pays for a copy instead
+          zerocopy = false;
+          written = SocketSendv(socket_, slices, count);
+        }
+      } else {
+        written = SocketSendv(socket_, slices, count);
+      }
+#else
+      written = SocketSendv(socket_, slices, count);
+#endif
+    }
+    if (written > 0 && zerocopy) {
+      // every frame the kernel took any of is read from its pages until the
+      // completion comes back, so each is held until then whatever happens
+      // to pending_
+      ZeroCopySend send{zerocopy_next_id_++, {}};
+      size_t covered = 0;
+      for (auto it = pending_.begin();
+           covered < static_cast<size_t>(written); ++it) {
+        covered += it->buffer->readable_bytes() -
+                   (it == pending_.begin() ? pending_offset_ : 0);
+        send.buffers.push_back(it->buffer);
+      }
+      zerocopy_held_.push_back(std::move(send));
     }
-    ssize_t written = SocketSend(socket_, data + offset, remaining);
     if (written > 0) {
-      offset += static_cast<size_t>(written);
-      remaining -= static_cast<size_t>(written);
+      ZNET_METRIC(metrics_.tcp.writes++);
+      ZNET_METRIC(metrics_.common.wire_bytes_sent +=
+                  static_cast<uint64_t>(written));
+      if (file) {
+        ZNET_METRIC(metrics_.tcp.file_bytes_sent +=
+                    static_cast<uint64_t>(written));
+      }
+      // walk the frames the kernel took; the last may have gone in part
+      size_t taken = static_cast<size_t>(written);
+      pending_bytes_.fetch_sub(taken, std::memory_order_relaxed);
+      while (taken > 0) {
+        const size_t rest = pending_.front().size() - pending_offset_;
+        if (taken < rest) {
+          pending_offset_ += taken;
+          break;
+        }
+        taken -= rest;
+        pending_offset_ = 0;
+        // a file span, or the head of a run, finishes the frame its header
+        // began, which was counted already
+        if (!pending_.front().file && !pending_.front().run_body) {
+          ZNET_METRIC(metrics_.tcp.frames_sent++);
+        }
+        pending_.pop_front();
+      }
+      last_send_ = std::chrono::steady_clock::now();
       continue;
     }
     if (written < 0 && WouldBlockOnSend()) {
-      if (!WaitUntilWritable(socket_, kSendStallWaitMs)) {
-        ZNET_LOG_ERROR("Waiting on a stalled socket failed: {}",
-                       GetLastErrorInfo());
-        return false;
-      }
-      continue;
+      // the peer is not keeping up. Waiting here would hold up every other
+      // session on this worker, so the rest stays queued for the reactor to
+      // report the socket writable again.
+      break;
     }
     ZNET_LOG_ERROR("Error sending packet to the server: {}", GetLastErrorInfo());
+    intact = false;
+    pending_.clear();
+    pending_offset_ = 0;
+    pending_bytes_.store(0, std::memory_order_relaxed);
+    break;
+  }
+  if (want_writable_) {
+    want_writable_->store(!pending_.empty(), std::memory_order_relaxed);
+  }
+  return intact;
+}
+
+void TCPTransportLayer::ReapZeroCopy() {
+#if ZNET_HAS_ZEROCOPY
+  uint32_t first = 0;
+  uint32_t last = 0;
+  bool copied = false;
+  while (!zerocopy_held_.empty() &&
+         SocketReadZeroCopyCompletion(socket_, &first, &last, &copied) == 1) {
+    const uint32_t count = last - first + 1;
+    if (copied) {
+      ZNET_METRIC(metrics_.tcp.zerocopy_copied += count);
+      if (zerocopy_threshold_ != 0) {
+        // pinning pages for a copy costs more than the copy alone did
+        ZNET_LOG_DEBUG("TCP: socket {} copies zerocopy sends anyway, "
+                       "sending copies.", socket_);
+        zerocopy_threshold_ = 0;
+      }
+    } else {
+      ZNET_METRIC(metrics_.tcp.zerocopy_completed += count);
+    }
+    // ids count up from zero and wrap, and a completion may cover several
+    zerocopy_held_.erase(
+        std::remove_if(zerocopy_held_.begin(), zerocopy_held_.end(),
+                       [first, count](const ZeroCopySend& send) {
+                         return static_cast<uint32_t>(send.id - first) < count;
+                       }),
+        zerocopy_held_.end());
+  }
+#endif
+}
+
+bool TCPTransportLayer::Enqueue(PendingFrame* frames, size_t count,
+                                bool control) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < count; i++) {
+    bytes += frames[i].size();
+  }
+  bool written = true;
+  bool over = false;
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const size_t queued = pending_bytes_.load(std::memory_order_relaxed);
+    if (!control && send_high_water_ != 0 &&
+        queued + bytes > send_high_water_) {
+      over = true;
+      if (slow_consumer_ == SlowConsumerPolicy::Shed) {
+        ZNET_METRIC(metrics_.tcp.frames_shed++);
+      }
+    } else {
+      // a message's fragments are queued under one lock, so a ping from the
+      // worker can fall between them but never a frame of another message
+      for (size_t i = 0; i < count; i++) {
+        pending_.push_back(std::move(frames[i]));
+      }
+      pending_bytes_.store(queued + bytes, std::memory_order_relaxed);
+      // past one gather the syscalls stop getting fewer, and the queue would
+      // only keep growing between flushes
+      if (pending_.size() >= kMaxGatherFrames) {
+        written = WritePending();
+      }
+    }
+  }
+  if (over) {
+    if (slow_consumer_ == SlowConsumerPolicy::Shed) {
+      // whole messages only, so the stream stays parseable: what is dropped
+      // never had a byte written
+      return false;
+    }
+    ZNET_LOG_WARN("TCP: closing socket {}, the peer fell {} bytes behind.",
+                  socket_, pending_bytes_.load(std::memory_order_relaxed));
+    CloseOptions options;
+    options.Set<NoLingerKey>(true);
+    Close(options);
     return false;
   }
-  last_send_ = std::chrono::steady_clock::now();
-  ZNET_METRIC(metrics_.tcp.writes++);
-  ZNET_METRIC(metrics_.common.wire_bytes_sent += buffer.size());
-  return true;
+  if (!written) {
+    // the peer may hold half a frame; nothing sent after it could be read
+    Close();
+  }
+  return written;
 }
 
 bool TCPTransportLayer::Send(std::shared_ptr<Buffer> buffer, SendOptions options) {
@@ -230,8 +547,7 @@ bool TCPTransportLayer::Send(std::shared_ptr<Buffer> buffer, SendOptions options
     return false;
   }
 
-  const size_t header = 48; // usually smaller than this
-  const size_t limit = ZNET_MAX_BUFFER_SIZE - header;
+  const size_t limit = ZNET_MAX_BUFFER_SIZE - kFrameHeaderBudget;
   // the message starts at the read cursor: the send pipeline reserves headroom
   const size_t payload_size = buffer->readable_bytes();
   if (payload_size == 0) {
@@ -242,43 +558,136 @@ bool TCPTransportLayer::Send(std::shared_ptr<Buffer> buffer, SendOptions options
   }
   size_t new_size = payload_size + 2;
   // intentionally >= limit, not > limit
-  if (new_size >= limit || payload_size > 0xFFFF) {
-    // ReadBuffer() reassembles within one frame buffer, so anything this large
-    // could be sent but never read back
-    ZNET_LOG_ERROR("Tried to send buffer size {} but the limit is {}, dropping packet!",
-                   new_size, limit);
-    return false;
+  if (new_size >= limit || payload_size > kMaxFrameLength) {
+    // ReadBuffer() completes a frame within one receive buffer, so anything
+    // this large goes out in fragments the peer puts back together
+    return SendFragmented(*buffer);
   }
 
-  // straight to the socket: the session already queued on the caller's behalf,
-  // so there is nothing left to hand off. The frame goes in place when the
-  // pipeline left headroom; only a foreign buffer costs a copy.
+  // queued, not written: the session drains its whole queue and then flushes,
+  // so the frames of one drain leave in a single gathered send, and a full
+  // socket keeps them here instead of stalling the worker. The frame goes in
+  // place when the pipeline left headroom; only a foreign buffer costs a
+  // copy.
   const uint8_t high = static_cast<uint8_t>(payload_size >> 8);
   const uint8_t low = static_cast<uint8_t>(payload_size & 0xFF);
   if (buffer->read_cursor() >= 2) {
     buffer->PrependInt8(low);
     buffer->PrependInt8(high);
-    if (!WriteAll(*buffer)) {
-      ZNET_LOG_ERROR("TCPTransport::WriteAll failed, socket={}", socket_);
-      return false;
-    }
-    return true;
+    PendingFrame frame{std::move(buffer)};
+    return Enqueue(&frame, 1, /*control=*/false);
+  }
+  auto framed = std::make_shared<Buffer>();
+  framed->ReserveExact(new_size);
+  framed->WriteInt<uint8_t>(high);
+  framed->WriteInt<uint8_t>(low);
+  framed->Write(buffer->read_cursor_data(), payload_size);
+  PendingFrame frame{std::move(framed)};
+  return Enqueue(&frame, 1, /*control=*/false);
+}
+
+bool TCPTransportLayer::SendFile(
+    std::shared_ptr<Buffer> head,
+    const std::shared_ptr<detail::MappedFile>& file, uint64_t position,
+    size_t size, SendOptions options) {
+#if ZNET_HAS_SENDFILE
+  const size_t payload_size = head->readable_bytes() + size;
+  // the message goes as one run, so the file's bytes are never cut into
+  // frames: the header is gathered with whatever else is queued, and the span
+  // is one sendfile(). Past the run limit it is copied into fragments like
+  // any large message.
+  if (!IsClosed() && size != 0 && file->descriptor() >= 0 &&
+      payload_size <= FileFrameLimit()) {
+    // its own small buffer rather than the head's headroom, which the
+    // pipeline sized for a frame prefix
+    auto run = std::make_shared<Buffer>(Endianness::BigEndian);
+    run->ReserveExact(kRunHeaderSize);
+    run->WriteInt<uint8_t>(0);  // a zero length marks a control frame
+    run->WriteInt<uint8_t>(0);
+    run->WriteInt<uint8_t>(kControlRun);
+    run->WriteInt<uint32_t>(static_cast<uint32_t>(payload_size));
+    PendingFrame frames[3];
+    frames[0].buffer = std::move(run);
+    frames[1].buffer = std::move(head);
+    frames[1].run_body = true;
+    frames[2].file = file;
+    frames[2].file_offset = file->offset() + position;
+    frames[2].file_size = size;
+    return Enqueue(frames, 3, /*control=*/false);
+  }
+#endif
+  return TransportLayer::SendFile(std::move(head), file, position, size,
+                                  options);
+}
+
+bool TCPTransportLayer::SendFragmented(const Buffer& buffer) {
+  const size_t payload_size = buffer.readable_bytes();
+  // each fragment is a frame of its own and answers to the same limit
+  const size_t chunk = std::min(
+      ZNET_MAX_BUFFER_SIZE - kFrameHeaderBudget - 3, size_t{kMaxFrameLength});
+  const size_t count = (payload_size + chunk - 1) / chunk;
+  const size_t framed_size = payload_size + 2 * count;
+  if (send_high_water_ != 0 && framed_size > send_high_water_) {
+    // could never be admitted whole, and refusing it here spares the
+    // connection the slow_consumer verdict meant for a peer that stalls
+    ZNET_LOG_ERROR("Tried to send buffer size {} but the send backlog holds "
+                   "at most {}, dropping packet!", framed_size,
+                   send_high_water_);
+    return false;
+  }
+  std::vector<PendingFrame> frames;
+  frames.reserve(count);
+  const char* data = buffer.read_cursor_data();
+  for (size_t offset = 0; offset < payload_size; offset += chunk) {
+    const size_t size = std::min(chunk, payload_size - offset);
+    const bool last = offset + size == payload_size;
+    const uint16_t prefix = static_cast<uint16_t>(
+        size | (last ? 0u : static_cast<size_t>(kMoreFragments)));
+    auto frame = std::make_shared<Buffer>();
+    frame->ReserveExact(size + 2);
+    frame->WriteInt<uint8_t>(static_cast<uint8_t>(prefix >> 8));
+    frame->WriteInt<uint8_t>(static_cast<uint8_t>(prefix & 0xFF));
+    frame->Write(data + offset, size);
+    frames.push_back(PendingFrame{std::move(frame)});
   }
-  Buffer framed;
-  framed.ReserveExact(new_size);
-  framed.WriteInt<uint8_t>(high);
-  framed.WriteInt<uint8_t>(low);
-  framed.Write(buffer->read_cursor_data(), payload_size);
-  if (!WriteAll(framed)) {
-    ZNET_LOG_ERROR("TCPTransport::WriteAll failed, socket={}", socket_);
+  if (!Enqueue(frames.data(), frames.size(), /*control=*/false)) {
     return false;
   }
+  ZNET_METRIC(metrics_.tcp.fragments_sent += count);
   return true;
 }
 
-// nothing to do: Send() writes straight to the socket, and the kernel owns
-// retransmit and pacing.
-void TCPTransportLayer::Flush() {}
+size_t TCPTransportLayer::FileFrameLimit() const {
+#if ZNET_HAS_SENDFILE
+  // one run, however many frames' worth it holds
+  return kMaxRunLength;
+#else
+  return 0;
+#endif
+}
+
+size_t TCPTransportLayer::CoalesceLimit() const {
+  // one ordered stream that ignores SendOptions, so any run of messages can
+  // share a frame
+  return ZNET_MAX_BUFFER_SIZE - 2 * kFrameHeaderBudget;
+}
+
+// the kernel owns retransmit and pacing; all that is left is handing it what
+// Send() queued
+void TCPTransportLayer::Flush() {
+  bool written;
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (pending_.empty()) {
+      return;
+    }
+    written = WritePending();
+  }
+  if (!written) {
+    ZNET_LOG_ERROR("TCPTransport flush failed, socket={}", socket_);
+    Close();
+  }
+}
 
 void TCPTransportLayer::Update() {
   if (IsClosed()) {
@@ -290,6 +699,16 @@ void TCPTransportLayer::Update() {
     Close();
     return;
   }
+#if ZNET_HAS_ZEROCOPY
+  {
+    // completions queue up on the socket between sends, and each holds a
+    // gather's buffers until it is read
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!zerocopy_held_.empty()) {
+      ReapZeroCopy();
+    }
+  }
+#endif
   if (keepalive_interval_.count() > 0) {
     std::chrono::steady_clock::time_point last_send;
     {
@@ -302,9 +721,41 @@ void TCPTransportLayer::Update() {
   }
 }
 
+bool TCPTransportLayer::SetReadyCallback(std::function<void()> ready) {
+  if (!ready_) {
+    return false;
+  }
+  ready_->Arm(std::move(ready));
+  return true;
+}
+
+std::chrono::steady_clock::time_point TCPTransportLayer::NextDeadline() {
+  using TimePoint = std::chrono::steady_clock::time_point;
+  if (IsClosed()) {
+    return TimePoint::min();
+  }
+  TimePoint next = TimePoint::max();
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    // a backlog drains at flush pace when the socket's writability is missed,
+    // and completions pile up on the socket without waking anything
+    if (!pending_.empty() || !zerocopy_held_.empty()) {
+      return TimePoint::min();
+    }
+    if (keepalive_interval_.count() > 0) {
+      next = last_send_ + keepalive_interval_;
+    }
+  }
+  if (idle_timeout_.count() > 0) {
+    next = std::min(next, last_recv_ + idle_timeout_);
+  }
+  return next;
+}
+
 void TCPTransportLayer::FillMetrics(SessionMetrics& out) const {
 #if ZNET_ENABLE_METRICS
   out.tcp = metrics_.tcp;
+  out.tcp.queued_bytes = pending_bytes_.load(std::memory_order_relaxed);
   out.common.wire_bytes_sent = metrics_.common.wire_bytes_sent;
   out.common.wire_bytes_received = metrics_.common.wire_bytes_received;
 #else
@@ -319,6 +770,14 @@ Result TCPTransportLayer::Close(CloseOptions options) {
   if (options.GetOr<NoLingerKey>(false)) {
     linger l; l.l_onoff = 1; l.l_linger = 0;
     setsockopt(socket_, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&l), sizeof(l));
+  } else {
+    // frames a handler queued before closing would have been on the wire
+    // already when Send() wrote through, so hand over what the socket takes.
+    // Only if no flush is mid-write: this thread must not wait behind it.
+    std::unique_lock<std::mutex> lock(write_mutex_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      WritePending();
+    }
   }
   // shut down but leave the descriptor open. the application closes from its
   // own thread while a worker may be inside recv() here, and close() would free
@@ -432,9 +891,16 @@ Result TCPClientBackend::Connect() {
   }
 
   wait_socket_ = client_socket_;
+  if (poller_) {
+    poller_->Add(wait_socket_, poll_tag_);
+  }
+  auto transport = std::make_unique<TCPTransportLayer>(
+      client_socket_, options_.common, options_.tcp);
+  want_writable_ = std::make_shared<std::atomic_bool>(false);
+  transport->SetWritableWatch(want_writable_);
   client_session_ =
       std::make_shared<PeerSession>(local_address_, server_address_,
-                                    std::make_unique<TCPTransportLayer>(client_socket_, options_.common), ConnectionType::TCP, true,
+                                    std::move(transport), ConnectionType::TCP, true,
                                     /*self_managed=*/false, options_);
   // the transport owns the descriptor now, so dropping our copy keeps
   // CleanupSocket() from closing whatever later reused that number
@@ -465,6 +931,10 @@ void TCPClientBackend::WaitReadable(std::chrono::milliseconds timeout) {
   pollfd entry{};
   entry.fd = wait_socket_;
   entry.events = POLLIN;
+  if (want_writable_ && want_writable_->load(std::memory_order_relaxed)) {
+    // room for the transport's backlog, which the caller's loop flushes
+    entry.events = static_cast<short>(entry.events | POLLOUT);
+  }
 #ifdef ZNET_TARGET_WIN
   WSAPoll(&entry, 1, static_cast<INT>(timeout.count()));
 #else
@@ -576,10 +1046,20 @@ Result TCPServerBackend::Listen() {
     return Result::CannotListen;
   }
   is_listening_ = true;
-  poll_task_.Run([this]() { PollLoop(); });
+  StartWatching();
   return Result::Success;
 }
 
+void TCPServerBackend::StartWatching() {
+  if (poller_) {
+    // the application's loop waits in its place, and accepts when this is
+    // readable
+    poller_->Add(server_socket_);
+    return;
+  }
+  poll_task_.Run([this]() { PollLoop(); });
+}
+
 void TCPServerBackend::StopReceiving() {
   poll_task_.RequestStop();
   poll_task_.Wait();
@@ -587,59 +1067,99 @@ void TCPServerBackend::StopReceiving() {
 
 void TCPServerBackend::PollLoop() {
   while (!poll_task_.IsStopRequested()) {
-    std::vector<pollfd> fds;
-    {
-      std::lock_guard<std::mutex> lock(poll_mutex_);
-      fds.reserve(polled_.size());
-      for (SocketHandle handle : polled_) {
-        pollfd entry{};
-        entry.fd = handle;
-        entry.events = POLLIN;
-        fds.push_back(entry);
+    if (PollOnce(10)) {
+      // level-triggered: the bytes stay readable until a worker drains them,
+      // so pause rather than re-fire the wake in a tight loop. Short, because
+      // this pause is also the floor under back-to-back round trips.
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  }
+}
+
+bool TCPServerBackend::PollOnce(int timeout_ms) {
+  std::vector<pollfd> fds;
+  std::vector<bool> counters;
+  std::vector<std::shared_ptr<ReadyWatch>> hooks;
+  {
+    std::lock_guard<std::mutex> lock(poll_mutex_);
+    fds.reserve(polled_.size());
+    hooks.reserve(polled_.size());
+    for (const Watched& watched : polled_) {
+      pollfd entry{};
+      entry.fd = watched.socket;
+      entry.events = POLLIN;
+      if (watched.want_writable->load(std::memory_order_relaxed)) {
+        entry.events = static_cast<short>(entry.events | POLLOUT);
       }
+      fds.push_back(entry);
+      counters.push_back(watched.counter);
+      hooks.push_back(watched.ready);
     }
-    if (fds.empty()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
+  }
+  if (fds.empty()) {
+    if (timeout_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
     }
+    return false;
+  }
 #ifdef ZNET_TARGET_WIN
-    const int ready = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), 10);
+  const int ready = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeout_ms);
 #else
-    const int ready = poll(fds.data(), static_cast<nfds_t>(fds.size()), 10);
+  const int ready = poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms);
 #endif
-    if (ready <= 0) {
+  if (ready <= 0) {
+    return false;
+  }
+  // a session a worker owns is told directly, and only a fire nothing
+  // armed yet falls back to waking every worker
+  bool fired = false;
+  bool wake = false;
+  std::vector<SocketHandle> dead;
+  for (size_t i = 0; i < fds.size(); i++) {
+    const pollfd& entry = fds[i];
+    if ((entry.revents & POLLNVAL) != 0) {
+      // the transport closed the descriptor; stop watching the number
+      // before something else in the process reuses it
+      dead.push_back(entry.fd);
       continue;
     }
-    bool wake = false;
-    std::vector<SocketHandle> dead;
-    for (const pollfd& entry : fds) {
-      if ((entry.revents & POLLNVAL) != 0) {
-        // the transport closed the descriptor; stop watching the number
-        // before something else in the process reuses it
-        dead.push_back(entry.fd);
-        continue;
-      }
-      if ((entry.revents & (POLLIN | POLLERR | POLLHUP)) != 0) {
-        wake = true;  // data, or a close the worker has to notice
+    // data, room for a backlog, or a close the worker has to notice
+    if ((entry.revents & (POLLIN | POLLOUT | POLLERR | POLLHUP)) != 0) {
+      fired = true;
+      if (!hooks[i] || !hooks[i]->Fire()) {
+        wake = true;
       }
     }
-    if (!dead.empty()) {
-      std::lock_guard<std::mutex> lock(poll_mutex_);
-      polled_.erase(std::remove_if(polled_.begin(), polled_.end(),
-                                   [&dead](SocketHandle handle) {
-                                     return std::find(dead.begin(), dead.end(),
-                                                      handle) != dead.end();
-                                   }),
-                    polled_.end());
-    }
-    if (wake && on_data_) {
-      on_data_();
-      // level-triggered: the bytes stay readable until a worker drains them,
-      // so pause rather than re-fire the wake in a tight loop. Short, because
-      // this pause is also the floor under back-to-back round trips.
-      std::this_thread::sleep_for(std::chrono::microseconds(200));
+#ifndef ZNET_TARGET_WIN
+    if (counters[i] && (entry.revents & POLLIN) != 0) {
+      uint64_t count;
+      (void)!read(entry.fd, &count, sizeof(count));
     }
+#endif
+  }
+  if (!dead.empty()) {
+    std::lock_guard<std::mutex> lock(poll_mutex_);
+    polled_.erase(std::remove_if(polled_.begin(), polled_.end(),
+                                 [&dead](const Watched& watched) {
+                                   return std::find(dead.begin(), dead.end(),
+                                                    watched.socket) !=
+                                          dead.end();
+                                 }),
+                  polled_.end());
   }
+  if (wake && on_data_) {
+    on_data_();
+  }
+  return fired;
+}
+
+void TCPServerBackend::Watch(Watched watched) {
+  if (poller_) {
+    // the driving thread's own wait, level-triggered like the poll above
+    poller_->Add(watched.socket);
+  }
+  std::lock_guard<std::mutex> lock(poll_mutex_);
+  polled_.push_back(std::move(watched));
 }
 
 Result TCPServerBackend::Close() {
@@ -683,7 +1203,7 @@ std::shared_ptr<PeerSession> TCPServerBackend::Accept() {
       if (!is_listening_) {
         return nullptr;
       }
-      client_socket = accept(server_socket_, reinterpret_cast<sockaddr*>(&client_address), &addr_len);
+      client_socket = AcceptSocket(&client_address, &addr_len);
     }
     if (!IsValidSocketHandle(client_socket)) {
       return nullptr;
@@ -709,19 +1229,37 @@ std::shared_ptr<PeerSession> TCPServerBackend::Accept() {
       CloseSocket(client_socket);
       continue;
     }
-    {
-      // watched from here on, so inbound data wakes a worker instead of
-      // waiting out its tick
-      std::lock_guard<std::mutex> lock(poll_mutex_);
-      polled_.push_back(client_socket);
+    std::unique_ptr<TransportLayer> transport = CreateTransport(client_socket);
+    if (!transport) {
+      continue;
     }
     return std::make_shared<PeerSession>(bind_address_, remote_address,
-                                      std::make_unique<TCPTransportLayer>(client_socket, child_options_.common), ConnectionType::TCP,
+                                      std::move(transport), connection_type(),
                                       /*is_initiator=*/false,
                                       /*self_managed=*/false, child_options_);
   }
 }
 
+SocketHandle TCPServerBackend::AcceptSocket(sockaddr_storage* out_address,
+                                            socklen_t* out_length) {
+  return accept(server_socket_, reinterpret_cast<sockaddr*>(out_address),
+                out_length);
+}
+
+std::unique_ptr<TransportLayer> TCPServerBackend::CreateTransport(
+    SocketHandle socket) {
+  auto transport = std::make_unique<TCPTransportLayer>(
+      socket, child_options_.common, child_options_.tcp);
+  auto want_writable = std::make_shared<std::atomic_bool>(false);
+  transport->SetWritableWatch(want_writable);
+  auto ready = std::make_shared<ReadyWatch>();
+  transport->SetReadyWatch(ready);
+  // watched from here on, so inbound data, or room for a backlog, wakes a
+  // worker instead of waiting out its tick
+  Watch(Watched{socket, std::move(want_writable), std::move(ready), false});
+  return transport;
+}
+
 void TCPServerBackend::AcceptAndReject() {
   sockaddr_storage client_address{};
   socklen_t addr_len = sizeof(client_address);
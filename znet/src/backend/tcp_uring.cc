@@ -0,0 +1,789 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/backends/tcp_uring.h"
+
+#if ZNET_HAS_IO_URING
+
+#include "znet/detail/socket_ops.h"
+#include "znet/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace znet {
+namespace backends {
+
+namespace {
+
+// submissions per worker ring. A tick queues at most a receive and a send
+// chain per session, and a full queue is submitted early rather than refused.
+constexpr unsigned kRingEntries = 1024;
+
+// the provided buffers every receive on a worker lands in. Each is copied
+// out and handed back as soon as its completion is reaped, so this bounds
+// what one reap takes in, not what a socket may have outstanding.
+constexpr uint16_t kBufferGroup = 0;
+constexpr uint16_t kBufferCount = 256;
+constexpr uint32_t kBufferSize = 8192;
+
+// unread bytes a channel holds before its receive is cancelled, and left so
+// until the transport catches up. The readiness backend gets this for free
+// by not reading the socket.
+constexpr size_t kInboxLimit = 1024 * 1024;
+
+// the low bits of a completion's user_data say what it completes; the rest
+// is the channel's id
+constexpr uint64_t kOpWake = 0;
+constexpr uint64_t kOpRecv = 1;
+constexpr uint64_t kOpSend = 2;
+constexpr uint64_t kOpCancel = 3;
+
+uint64_t Tag(uint64_t id, uint64_t op) { return id << 2 | op; }
+
+}  // namespace
+
+UringWorker::UringWorker()
+    : wake_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+  if (wake_fd_ < 0) {
+    ZNET_LOG_ERROR("io_uring: cannot create a worker's wake descriptor: {}",
+                   std::strerror(errno));
+  }
+}
+
+UringWorker::~UringWorker() {
+  // every transport is gone, or it would still hold this worker
+  for (auto& item : channels_) {
+    CloseSocket(item.second->socket);
+    item.second->socket = kSocketInvalid;
+  }
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+  }
+}
+
+std::shared_ptr<UringChannel> UringWorker::Attach(
+    SocketHandle socket, UringTCPTransportLayer* transport,
+    std::shared_ptr<ReadyWatch> ready) {
+  auto channel = std::make_shared<UringChannel>();
+  channel->socket = socket;
+  channel->transport = transport;
+  channel->ready = std::move(ready);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channel->id = next_id_++;
+    attach_queue_.push_back(channel);
+  }
+  Wake();
+  return channel;
+}
+
+void UringWorker::Request(const std::shared_ptr<UringChannel>& channel) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back(channel);
+  }
+  Wake();
+}
+
+void UringWorker::Release(const std::shared_ptr<UringChannel>& channel) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channel->transport = nullptr;
+    channel->released.store(true, std::memory_order_relaxed);
+    requests_.push_back(channel);
+  }
+  Wake();
+}
+
+void UringWorker::Wake() {
+  const uint64_t one = 1;
+  // a full counter already means a wake is pending
+  const ssize_t written = write(wake_fd_, &one, sizeof(one));
+  (void)written;
+}
+
+bool UringWorker::InitRing() {
+  ring_ = std::make_unique<detail::Uring>();
+  if (!ring_->Init(kRingEntries) ||
+      !ring_->SetupBuffers(kBufferGroup, kBufferCount, kBufferSize)) {
+    ZNET_LOG_ERROR("io_uring: a worker cannot set up its ring; the sessions "
+                   "handed to it will be closed.");
+    ring_ = nullptr;
+    ring_failed_ = true;
+    return false;
+  }
+  owner_ = std::this_thread::get_id();
+  ring_ready_.store(true, std::memory_order_release);
+  return true;
+}
+
+bool UringWorker::Poll(std::chrono::nanoseconds timeout) {
+  std::vector<std::shared_ptr<UringChannel>> attached;
+  std::vector<std::shared_ptr<UringChannel>> requests;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    attached.swap(attach_queue_);
+    requests.swap(requests_);
+  }
+  // created with the first socket, and so on this thread: a worker that
+  // never drives a session never pays for a ring and its buffers
+  if (!ring_ && !ring_failed_ && !attached.empty()) {
+    InitRing();
+  }
+  const bool handed = !attached.empty() || !requests.empty();
+  for (auto& channel : attached) {
+    channels_[channel->id] = channel;
+    if (ring_) {
+      ArmReceive(*channel);
+    } else {
+      channel->error = EIO;
+    }
+  }
+  for (auto& channel : requests) {
+    Attend(channel);
+  }
+  if (!ring_) {
+    return SleepWithoutRing(handed ? std::chrono::nanoseconds::zero()
+                                   : timeout) ||
+           handed;
+  }
+
+  if (!wake_armed_) {
+    ArmWake();
+  }
+  // bytes a transport has yet to read are ticked for at once, as the poll
+  // thread wakes a worker for a socket that stays readable
+  const bool busy = handed || unread_;
+  unread_ = false;
+  ring_->Submit();
+  ring_->Wait(busy ? std::chrono::nanoseconds::zero() : timeout);
+  const size_t completed =
+      ring_->Reap([this](const io_uring_cqe& cqe) { Dispatch(cqe); });
+  return completed > 0 || busy;
+}
+
+void UringWorker::Shutdown(std::chrono::milliseconds grace) {
+  const auto deadline = std::chrono::steady_clock::now() + grace;
+  for (;;) {
+    Poll(std::chrono::milliseconds(10));
+    bool busy = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy = !attach_queue_.empty() || !requests_.empty();
+    }
+    for (auto& item : channels_) {
+      busy = busy || item.second->sends_in_flight > 0;
+    }
+    if (!busy || std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+  }
+  // nothing will reap for them past here, so the sockets go now. A session
+  // the application still holds reads as failed from here on.
+  ring_ = nullptr;
+  ring_ready_.store(false, std::memory_order_release);
+  ring_failed_ = true;
+  for (auto& item : channels_) {
+    UringChannel& channel = *item.second;
+    ShutdownSocket(channel.socket);
+    CloseSocket(channel.socket);
+    channel.socket = kSocketInvalid;
+    channel.sends_in_flight = 0;
+    channel.recv_armed = false;
+    if (channel.error == 0) {
+      channel.error = ENOTCONN;
+    }
+  }
+  channels_.clear();
+}
+
+bool UringWorker::SleepWithoutRing(std::chrono::nanoseconds timeout) {
+  pollfd entry{};
+  entry.fd = wake_fd_;
+  entry.events = POLLIN;
+  // rounded up, so a short wait is not a busy one
+  const auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+      timeout + std::chrono::milliseconds(1) - std::chrono::nanoseconds(1));
+  if (poll(&entry, 1, static_cast<int>(millis.count())) <= 0) {
+    return false;
+  }
+  uint64_t value = 0;
+  const ssize_t read_bytes = read(wake_fd_, &value, sizeof(value));
+  (void)read_bytes;
+  return true;
+}
+
+io_uring_sqe* UringWorker::Sqe() {
+  io_uring_sqe* sqe = ring_->NextSqe();
+  if (sqe == nullptr) {
+    ring_->Submit();
+    sqe = ring_->NextSqe();
+  }
+  return sqe;
+}
+
+void UringWorker::ArmWake() {
+  io_uring_sqe* sqe = Sqe();
+  if (sqe == nullptr) {
+    return;
+  }
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = wake_fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&wake_value_);
+  sqe->len = sizeof(wake_value_);
+  sqe->user_data = Tag(0, kOpWake);
+  wake_armed_ = true;
+}
+
+void UringWorker::ArmReceive(UringChannel& channel) {
+  io_uring_sqe* sqe = Sqe();
+  if (sqe == nullptr) {
+    channel.error = EBUSY;
+    return;
+  }
+  // armed once: it keeps completing, a buffer each time, until the socket
+  // ends, fails, or the buffers run out
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = channel.socket;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = Tag(channel.id, kOpRecv);
+  channel.recv_armed = true;
+}
+
+void UringWorker::ResumeReceive(UringChannel& channel) {
+  if (!OnOwnerThread() || !channel.recv_paused) {
+    return;
+  }
+  channel.recv_paused = false;
+  // a cancel still in flight leaves it armed; its completion re-arms
+  if (!channel.recv_armed && channel.error == 0 && !channel.eof &&
+      !channel.shut) {
+    ArmReceive(channel);
+  }
+}
+
+void UringWorker::SubmitSends(UringChannel& channel) {
+  using Transport = UringTCPTransportLayer;
+  // laid out only once iov stops growing, since each points into it
+  channel.msgs.assign(
+      (channel.iov.size() + Transport::kFramesPerSend - 1) /
+          Transport::kFramesPerSend,
+      msghdr{});
+  for (size_t i = 0; i < channel.msgs.size(); i++) {
+    const size_t first = i * Transport::kFramesPerSend;
+    channel.msgs[i].msg_iov = &channel.iov[first];
+    channel.msgs[i].msg_iovlen = std::min(size_t{Transport::kFramesPerSend},
+                                          channel.iov.size() - first);
+  }
+  const size_t count = channel.msgs.size();
+  // a chain has to reach the kernel in one submission to stay linked
+  if (ring_->space() < count) {
+    ring_->Submit();
+  }
+  for (size_t i = 0; i < count; i++) {
+    io_uring_sqe* sqe = Sqe();
+    if (sqe == nullptr) {
+      channel.error = EBUSY;
+      return;
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = channel.socket;
+    sqe->addr = reinterpret_cast<uint64_t>(&channel.msgs[i]);
+    sqe->len = 1;
+    // a short write would tear a frame, so each send finishes or fails whole,
+    // and the link keeps the next from starting before it does
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    if (i + 1 < count) {
+      sqe->flags = IOSQE_IO_LINK;
+    }
+    sqe->user_data = Tag(channel.id, kOpSend);
+    channel.sends_in_flight++;
+  }
+}
+
+void UringWorker::Dispatch(const io_uring_cqe& cqe) {
+  if (cqe.user_data == detail::Uring::kInternal) {
+    // a buffer given back that the kernel refused; it stays out of the group
+    return;
+  }
+  const uint64_t op = cqe.user_data & 3;
+  if (op == kOpWake) {
+    wake_armed_ = false;
+    return;
+  }
+  if (op == kOpCancel) {
+    return;
+  }
+  auto it = channels_.find(cqe.user_data >> 2);
+  if (it == channels_.end()) {
+    // a receive of a channel already forgotten can still hold a buffer
+    if ((cqe.flags & IORING_CQE_F_BUFFER) != 0) {
+      ring_->RecycleBuffer(
+          static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+    }
+    return;
+  }
+  const std::shared_ptr<UringChannel> channel = it->second;
+  if (op == kOpRecv) {
+    OnReceive(*channel, cqe);
+  } else {
+    OnSend(*channel, cqe);
+  }
+  if (channel->released.load(std::memory_order_relaxed) ||
+      channel->shutdown_requested.load(std::memory_order_relaxed)) {
+    Attend(channel);
+  } else if (channel->ready && (op == kOpRecv || channel->error != 0)) {
+    // bytes, an end or a failure the session has yet to see; a send that
+    // went through is followed up by OnSent() already. Not armed yet only
+    // before the worker has the session, whose first tick reads them anyway.
+    channel->ready->Fire();
+  }
+}
+
+void UringWorker::OnReceive(UringChannel& channel, const io_uring_cqe& cqe) {
+  if ((cqe.flags & IORING_CQE_F_BUFFER) != 0) {
+    const auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (cqe.res > 0 && !channel.released.load(std::memory_order_relaxed)) {
+      if (channel.inbox_offset * 2 >= channel.inbox.size()) {
+        // at least half of it read; cheaper to move the rest down than to
+        // keep growing behind it
+        channel.inbox.erase(
+            channel.inbox.begin(),
+            channel.inbox.begin() +
+                static_cast<std::ptrdiff_t>(channel.inbox_offset));
+        channel.inbox_offset = 0;
+      }
+      const char* data = ring_->buffer(id);
+      channel.inbox.insert(channel.inbox.end(), data,
+                           data + static_cast<size_t>(cqe.res));
+    }
+    ring_->RecycleBuffer(id);
+  }
+  if (cqe.res == 0) {
+    channel.eof = true;
+  } else if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED &&
+             channel.error == 0) {
+    channel.error = -cqe.res;
+  }
+  if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+    channel.recv_armed = false;
+    // out of buffers, or ended by the kernel for its own reasons: the socket
+    // still has a reader, so it gets a new receive
+    if (!channel.eof && channel.error == 0 && !channel.recv_paused &&
+        !channel.shut && !channel.released.load(std::memory_order_relaxed)) {
+      ArmReceive(channel);
+    }
+    return;
+  }
+  if (!channel.recv_paused &&
+      channel.inbox.size() - channel.inbox_offset > kInboxLimit) {
+    channel.recv_paused = true;
+    io_uring_sqe* sqe = Sqe();
+    if (sqe != nullptr) {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = Tag(channel.id, kOpRecv);
+      sqe->user_data = Tag(channel.id, kOpCancel);
+    }
+  }
+}
+
+void UringWorker::OnSend(UringChannel& channel, const io_uring_cqe& cqe) {
+  channel.sends_in_flight--;
+  if (cqe.res < 0) {
+    // the rest of a failed chain is cancelled; the first error is the one
+    if (channel.error == 0) {
+      channel.error = -cqe.res;
+    }
+  } else {
+    channel.send_bytes += static_cast<size_t>(cqe.res);
+  }
+  if (channel.sends_in_flight > 0) {
+    return;
+  }
+  if (channel.error == 0 && channel.send_bytes != channel.send_expected) {
+    channel.error = EIO;
+  }
+  channel.held.clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (channel.transport != nullptr) {
+    channel.transport->OnSent(channel);
+  } else {
+    SendBacklog(channel);
+  }
+}
+
+void UringWorker::SendBacklog(UringChannel& channel) {
+  if (channel.backlog.empty() || channel.error != 0 || channel.shut ||
+      channel.sends_in_flight > 0) {
+    if (channel.sends_in_flight == 0) {
+      channel.backlog.clear();
+      channel.backlog_held.clear();
+    }
+    return;
+  }
+  const size_t limit = UringTCPTransportLayer::kMaxChainSends *
+                       UringTCPTransportLayer::kFramesPerSend;
+  channel.iov.clear();
+  channel.send_frames = 0;
+  channel.send_file_bytes = 0;
+  channel.send_expected = 0;
+  channel.send_bytes = 0;
+  while (!channel.backlog.empty() && channel.iov.size() < limit) {
+    channel.send_expected += channel.backlog.front().iov_len;
+    channel.iov.push_back(channel.backlog.front());
+    channel.backlog.pop_front();
+  }
+  SubmitSends(channel);
+}
+
+void UringWorker::Attend(const std::shared_ptr<UringChannel>& channel) {
+  if (channels_.find(channel->id) == channels_.end()) {
+    return;
+  }
+  // a send chain still reads its frames; its completion comes back here
+  if (channel->sends_in_flight > 0) {
+    return;
+  }
+  if (channel->shutdown_requested.load(std::memory_order_relaxed) &&
+      !channel->shut) {
+    if (ring_ && channel->error == 0) {
+      // what the session queued before it closed goes out first, as it
+      // would have through a socket that took it
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (channel->transport != nullptr) {
+        channel->transport->FlushFromWorker();
+      } else {
+        SendBacklog(*channel);
+      }
+    }
+    if (channel->sends_in_flight > 0) {
+      return;
+    }
+    ShutdownSocket(channel->socket);
+    channel->shut = true;
+  }
+  if (!channel->released.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (!channel->shut) {
+    ShutdownSocket(channel->socket);
+    channel->shut = true;
+  }
+  if (channel->recv_armed && ring_) {
+    if (!channel->cancelling) {
+      io_uring_sqe* sqe = Sqe();
+      if (sqe != nullptr) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = Tag(channel->id, kOpRecv);
+        sqe->user_data = Tag(channel->id, kOpCancel);
+        channel->cancelling = true;
+      }
+    }
+    // the receive's last completion comes back here
+    return;
+  }
+  CloseSocket(channel->socket);
+  channel->socket = kSocketInvalid;
+  channels_.erase(channel->id);
+}
+
+UringTCPTransportLayer::UringTCPTransportLayer(SocketHandle socket,
+                                               CommonOptions common,
+                                               TCPOptions tcp)
+    : TCPTransportLayer(socket, common, tcp) {
+  // the ring's sends copy like send() does; MSG_ZEROCOPY's completions
+  // arrive on the socket's error queue, which nothing here reads
+  zerocopy_threshold_ = 0;
+}
+
+UringTCPTransportLayer::~UringTCPTransportLayer() {
+  if (channel_) {
+    if (channel_->shutdown_requested.load(std::memory_order_relaxed)) {
+      // closed, and what was queued before it still goes out; the session
+      // is often destroyed before the worker has had a tick to send it
+      std::lock_guard<std::mutex> lock(write_mutex_);
+      while (!pending_.empty()) {
+        channel_->backlog.push_back(
+            Slice(pending_.front(), pending_offset_, &channel_->backlog_held));
+        pending_offset_ = 0;
+        pending_.pop_front();
+      }
+    }
+    // the channel closes the descriptor once the kernel is done with it
+    worker_->Release(channel_);
+    socket_ = kSocketInvalid;
+  }
+}
+
+void UringTCPTransportLayer::BindWorkerIo(
+    const std::shared_ptr<WorkerIo>& io) {
+  auto worker = std::dynamic_pointer_cast<UringWorker>(io);
+  if (!worker) {
+    return;
+  }
+  // an encoder thread may be flushing the handshake's replies
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  worker_ = std::move(worker);
+  channel_ = worker_->Attach(socket_, this, ready_);
+}
+
+ssize_t UringTCPTransportLayer::ReadSome(char* out, size_t size) {
+  if (!channel_) {
+    return TCPTransportLayer::ReadSome(out, size);
+  }
+  UringChannel& channel = *channel_;
+  const size_t unread = channel.inbox.size() - channel.inbox_offset;
+  if (unread > 0) {
+    const size_t count = std::min(unread, size);
+    std::memcpy(out, channel.inbox.data() + channel.inbox_offset, count);
+    channel.inbox_offset += count;
+    if (channel.inbox_offset == channel.inbox.size()) {
+      channel.inbox.clear();
+      channel.inbox_offset = 0;
+      worker_->ResumeReceive(channel);
+    } else {
+      worker_->MarkUnread();
+    }
+    return static_cast<ssize_t>(count);
+  }
+  if (channel.error != 0) {
+    errno = channel.error;
+    return -1;
+  }
+  if (channel.eof) {
+    return 0;
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+iovec UringTCPTransportLayer::Slice(PendingFrame& frame, size_t offset,
+                                    std::vector<std::shared_ptr<void>>* held) {
+  iovec slice{};
+  if (frame.file) {
+    // straight from the mapping; the kernel copies it like any other bytes
+    const uint64_t within = frame.file_offset - frame.file->offset();
+    slice.iov_base = const_cast<char*>(
+        frame.file->data() + static_cast<size_t>(within) + offset);
+    slice.iov_len = frame.file_size - offset;
+    held->push_back(std::move(frame.file));
+  } else {
+    slice.iov_base =
+        const_cast<char*>(frame.buffer->read_cursor_data() + offset);
+    slice.iov_len = frame.buffer->readable_bytes() - offset;
+    held->push_back(std::move(frame.buffer));
+  }
+  return slice;
+}
+
+bool UringTCPTransportLayer::WritePending() {
+  if (!channel_) {
+    return TCPTransportLayer::WritePending();
+  }
+  if (!worker_->OnOwnerThread()) {
+    // only the worker submits to its ring; it flushes on its next tick
+    if (!pending_.empty()) {
+      worker_->Wake();
+    }
+    return true;
+  }
+  UringChannel& channel = *channel_;
+  if (channel.error != 0) {
+    errno = channel.error;
+    return false;
+  }
+  // one chain at a time, so the stream leaves in order; the next goes out
+  // from OnSent()
+  if (pending_.empty() || channel.sends_in_flight > 0 || channel.shut) {
+    return true;
+  }
+
+  const size_t limit = kMaxChainSends * kFramesPerSend;
+  channel.iov.clear();
+  channel.iov.reserve(std::min(pending_.size(), limit));
+  channel.send_frames = 0;
+  channel.send_expected = 0;
+  channel.send_file_bytes = 0;
+  channel.send_bytes = 0;
+  while (!pending_.empty() && channel.iov.size() < limit) {
+    PendingFrame& frame = pending_.front();
+    const bool file = frame.file != nullptr;
+    const iovec slice = Slice(frame, pending_offset_, &channel.held);
+    if (file) {
+      channel.send_file_bytes += slice.iov_len;
+    } else if (!frame.run_body) {
+      // a run's head finishes the frame its header began
+      channel.send_frames++;
+    }
+    channel.send_expected += slice.iov_len;
+    channel.iov.push_back(slice);
+    pending_offset_ = 0;
+    pending_.pop_front();
+  }
+  worker_->SubmitSends(channel);
+  return channel.error == 0;
+}
+
+void UringTCPTransportLayer::OnSent(const UringChannel& channel) {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  if (channel.error != 0) {
+    // the peer may hold part of a frame; nothing queued after it is
+    // readable. The next Receive() reports the error and closes.
+    pending_.clear();
+    pending_offset_ = 0;
+    pending_bytes_.store(0, std::memory_order_relaxed);
+    return;
+  }
+  pending_bytes_.fetch_sub(channel.send_expected, std::memory_order_relaxed);
+  ZNET_METRIC(metrics_.tcp.writes++);
+  ZNET_METRIC(metrics_.tcp.frames_sent += channel.send_frames);
+  ZNET_METRIC(metrics_.tcp.file_bytes_sent += channel.send_file_bytes);
+  ZNET_METRIC(metrics_.common.wire_bytes_sent += channel.send_expected);
+  last_send_ = std::chrono::steady_clock::now();
+  if (!pending_.empty()) {
+    WritePending();
+  }
+}
+
+void UringTCPTransportLayer::FlushFromWorker() {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  WritePending();
+}
+
+Result UringTCPTransportLayer::Close(CloseOptions options) {
+  if (!channel_) {
+    return TCPTransportLayer::Close(options);
+  }
+  if (is_closed_.exchange(true, std::memory_order_acq_rel)) {
+    return Result::AlreadyDisconnected;
+  }
+  if (options.GetOr<NoLingerKey>(false)) {
+    linger l; l.l_onoff = 1; l.l_linger = 0;
+    setsockopt(socket_, SOL_SOCKET, SO_LINGER,
+               reinterpret_cast<const char*>(&l), sizeof(l));
+    ShutdownSocket(socket_);
+  }
+  // otherwise the frames queued before closing still go out: the worker
+  // shuts the socket down once its sends drain. A shutdown here would cut
+  // off a chain the kernel has not finished.
+  channel_->shutdown_requested.store(true, std::memory_order_relaxed);
+  worker_->Request(channel_);
+  return Result::Success;
+}
+
+UringTCPServerBackend::UringTCPServerBackend(
+    std::shared_ptr<InetAddress> bind_address,
+    const SessionOptions& child_options, const ServerOptions& server_options)
+    : TCPServerBackend(std::move(bind_address), child_options,
+                       server_options) {}
+
+UringTCPServerBackend::~UringTCPServerBackend() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  DropAcceptRing();
+}
+
+Result UringTCPServerBackend::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DropAcceptRing();
+  }
+  return TCPServerBackend::Close();
+}
+
+std::shared_ptr<WorkerIo> UringTCPServerBackend::CreateWorkerIo() {
+  return std::make_shared<UringWorker>();
+}
+
+SocketHandle UringTCPServerBackend::AcceptSocket(sockaddr_storage* out_address,
+                                                 socklen_t* out_length) {
+  if (accept_failed_) {
+    return TCPServerBackend::AcceptSocket(out_address, out_length);
+  }
+  if (!accept_ring_) {
+    accept_ring_ = std::make_unique<detail::Uring>();
+    if (!accept_ring_->Init(64)) {
+      ZNET_LOG_WARN("io_uring: cannot set up the accept ring; accepting with "
+                    "accept() instead.");
+      accept_ring_ = nullptr;
+      accept_failed_ = true;
+      return TCPServerBackend::AcceptSocket(out_address, out_length);
+    }
+  }
+  if (!accept_armed_) {
+    io_uring_sqe* sqe = accept_ring_->NextSqe();
+    if (sqe != nullptr) {
+      sqe->opcode = IORING_OP_ACCEPT;
+      sqe->fd = server_socket_;
+      sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+      sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+      accept_armed_ = true;
+    }
+  }
+  if (accepted_.empty()) {
+    accept_ring_->Submit();
+    accept_ring_->Wait(std::chrono::nanoseconds::zero());
+    accept_ring_->Reap([this](const io_uring_cqe& cqe) {
+      if (cqe.res >= 0) {
+        accepted_.push_back(cqe.res);
+      } else if (cqe.res != -ECANCELED) {
+        ZNET_LOG_DEBUG("io_uring: accept failed: {}", std::strerror(-cqe.res));
+      }
+      if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+        accept_armed_ = false;
+      }
+    });
+  }
+  if (accepted_.empty()) {
+    return kSocketInvalid;
+  }
+  const SocketHandle socket = accepted_.front();
+  accepted_.pop_front();
+  // the multishot accept takes no address; a failure here leaves it empty,
+  // which Accept() refuses like any unreadable address
+  if (getpeername(socket, reinterpret_cast<sockaddr*>(out_address),
+                  out_length) != 0) {
+    *out_length = 0;
+  }
+  return socket;
+}
+
+std::unique_ptr<TransportLayer> UringTCPServerBackend::CreateTransport(
+    SocketHandle socket) {
+  auto transport = std::make_unique<UringTCPTransportLayer>(
+      socket, child_options_.common, child_options_.tcp);
+  // fired by the ring's worker, not a poll thread: with it the session is
+  // run when its socket completes something, where without it the worker
+  // would run every one of its sessions every tick
+  transport->SetReadyWatch(std::make_shared<ReadyWatch>());
+  return transport;
+}
+
+void UringTCPServerBackend::DropAcceptRing() {
+  // closing the ring cancels the accept
+  accept_ring_ = nullptr;
+  accept_armed_ = false;
+  for (SocketHandle socket : accepted_) {
+    CloseSocket(socket);
+  }
+  accepted_.clear();
+}
+
+}  // namespace backends
+}  // namespace znet
+
+#endif  // ZNET_HAS_IO_URING
@@ -77,141 +77,6 @@ Result ZDTClientBackend::Bind(const std::string& ip, PortNumber port) {
   return BindTo(*address);
 }
 
-Result ZDTClientBackend::Handshake(ZDTConnection& out) {
-  ZDTCookie cookie{};
-  uint32_t epoch = 0;
-  uint16_t negotiated_mtu = 0;
-  uint64_t server_guid = 0;
-  bool got_reply1 = false;
-
-  // replies land and are parsed here; reset per datagram, reserved once
-  Buffer reply(Endianness::BigEndian);
-  reply.ReserveExact(ZNET_MAX_BUFFER_SIZE);
-
-  // phase 1: OpenConnectionRequest1 -> OpenConnectionReply1, walking the MTU
-  // ladder. The request is padded to the candidate MTU so the padded datagram
-  // itself probes the path.
-  for (uint16_t rung : config_.mtu_ladder) {
-    for (int attempt = 0;
-         attempt < config_.handshake_retries_per_rung && !got_reply1; attempt++) {
-      // the rung is a link MTU; what goes in the datagram is the payload that
-      // fits inside it once the IP and UDP headers are accounted for
-      const uint16_t probe =
-          ZDTPayloadForLinkMTU(rung, server_address_->ipv());
-      Buffer request(Endianness::BigEndian);
-      WriteOfflineHeader(request, ZDTOfflineMsg::OpenConnectionRequest1);
-      request.WriteInt<uint8_t>(kZDTProtocolVersion);
-      if (request.size() < probe) {
-        std::vector<uint8_t> padding(probe - request.size(), 0);
-        request.Write(padding.data(), padding.size());
-      }
-      if (!socket_->SendTo(*server_address_, request.data(), request.size())) {
-        break;  // datagram too big for the path (DF set) -> drop to next rung
-      }
-
-      auto deadline = steady_clock::now() + config_.handshake_retransmit;
-      while (steady_clock::now() < deadline && !got_reply1) {
-        reply.Reset();
-        size_t len = 0;
-        std::shared_ptr<InetAddress> from;
-        RecvResult r = socket_->RecvFrom(reply.write_cursor_data(),
-                                         reply.writable_bytes(), len, from);
-        if (r == RecvResult::WouldBlock) {
-          std::this_thread::sleep_for(std::chrono::milliseconds(1));
-          continue;
-        }
-        if (r == RecvResult::Error) {
-          break;
-        }
-        reply.CommitWrite(len);
-        if (len == 0 ||
-            (static_cast<uint8_t>(reply.data()[0]) & kFlagOnline)) {
-          continue;
-        }
-        ZDTOfflineMsg id;
-        if (!ReadOfflineHeader(reply, id)) {
-          continue;
-        }
-        if (id == ZDTOfflineMsg::OpenConnectionReply1) {
-          server_guid = reply.ReadInt<uint64_t>();
-          negotiated_mtu = reply.ReadInt<uint16_t>();
-          uint8_t cookie_len = reply.ReadInt<uint8_t>();
-          if (cookie_len != kZDTCookieLen) {
-            continue;
-          }
-          reply.Read(cookie.data(), cookie.size());
-          epoch = reply.ReadInt<uint32_t>();
-          got_reply1 = true;
-        } else if (id == ZDTOfflineMsg::IncompatibleProtocolVersion) {
-          return Result::IncompatibleVersion;
-        } else if (id == ZDTOfflineMsg::NoFreeConnections) {
-          return Result::ServerFull;
-        }
-      }
-    }
-    if (got_reply1) {
-      break;
-    }
-  }
-  if (!got_reply1) {
-    return Result::Timeout;
-  }
-
-  // phase 2: OpenConnectionRequest2 (echo the cookie) -> OpenConnectionReply2.
-  for (int attempt = 0; attempt < config_.max_retries; attempt++) {
-    Buffer request(Endianness::BigEndian);
-    WriteOfflineHeader(request, ZDTOfflineMsg::OpenConnectionRequest2);
-    request.WriteInt<uint8_t>(static_cast<uint8_t>(cookie.size()));
-    request.Write(cookie.data(), cookie.size());
-    request.WriteInt<uint32_t>(epoch);
-    request.WriteInetAddress(*server_address_);
-    request.WriteInt<uint16_t>(negotiated_mtu);
-    request.WriteInt<uint64_t>(guid_);
-    socket_->SendTo(*server_address_, request.data(), request.size());
-
-    auto deadline = steady_clock::now() + config_.handshake_retransmit;
-    while (steady_clock::now() < deadline) {
-      reply.Reset();
-      size_t len = 0;
-      std::shared_ptr<InetAddress> from;
-      RecvResult r = socket_->RecvFrom(reply.write_cursor_data(),
-                                       reply.writable_bytes(), len, from);
-      if (r == RecvResult::WouldBlock) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        continue;
-      }
-      if (r == RecvResult::Error) {
-        break;
-      }
-      reply.CommitWrite(len);
-      if (len == 0 || (static_cast<uint8_t>(reply.data()[0]) & kFlagOnline)) {
-        continue;
-      }
-      ZDTOfflineMsg id;
-      if (!ReadOfflineHeader(reply, id)) {
-        continue;
-      }
-      if (id == ZDTOfflineMsg::OpenConnectionReply2) {
-        uint64_t reply_server_guid = reply.ReadInt<uint64_t>();
-        auto external = reply.ReadInetAddress();
-        uint16_t mtu = reply.ReadInt<uint16_t>();
-        (void)external;
-        out.mtu = mtu ? mtu : negotiated_mtu;
-        out.local_guid = guid_;
-        out.remote_guid = reply_server_guid ? reply_server_guid : server_guid;
-        return Result::Success;
-      }
-      if (id == ZDTOfflineMsg::IncompatibleProtocolVersion) {
-        return Result::IncompatibleVersion;
-      }
-      if (id == ZDTOfflineMsg::NoFreeConnections) {
-        return Result::ServerFull;
-      }
-    }
-  }
-  return Result::Timeout;
-}
-
 Result ZDTClientBackend::Connect() {
   if (client_session_ && client_session_->IsAlive()) {
     return Result::AlreadyConnected;
@@ -225,24 +90,26 @@ Result ZDTClientBackend::Connect() {
     return Result::CannotBind;
   }
   guid_ = GenerateGuid();
-  ZDTConnection connection;
-  Result result = Handshake(connection);
-  if (result != Result::Success) {
-    ZNET_LOG_ERROR("ZDT handshake with {} failed: {}", server_address_->readable(),
-                   GetResultString(result));
-    return result;
-  }
-  ZNET_LOG_DEBUG("ZDT connected to {} (mtu={})", server_address_->readable(),
-                 connection.mtu);
-  // the receive thread owns the socket from here, so the transport takes its
-  // datagrams from the inbox instead of polling alongside it
+  // the receive thread, or Pump(), owns the socket from here, so the
+  // transport takes its datagrams from the inbox, the handshake's replies
+  // included
   inbox_ = std::make_shared<ZDTInbox>();
   auto transport = std::make_unique<ZDTTransportLayer>(
       socket_, server_address_, config_, /*drains_own_socket=*/false, inbox_,
-      connection, session_options_.common);
+      ZDTConnection{}, session_options_.common);
+  // returns at once: the session's owner advances the handshake on its
+  // ticks, and a refusal or a timeout ends the session like a failed TCP one
+  transport->AwaitHandshake(std::make_unique<ZDTClientHandshake>(
+      socket_, server_address_, config_, guid_));
   client_session_ = std::make_shared<PeerSession>(
       local_address_, server_address_, std::move(transport), ConnectionType::ZDT,
       /*is_initiator=*/true, /*self_managed=*/false, session_options_);
+  if (poller_) {
+    // the caller's loop reads, in Pump(), whenever the poller says to
+    socket_->SetBlocking(false);
+    poller_->Add(socket_->handle(), poll_tag_);
+    return Result::Success;
+  }
   // blocking with a timeout: a datagram returns at once, and the timeout only
   // exists so the loop notices shutdown.
   socket_->SetBlocking(true);
@@ -270,19 +137,47 @@ void ZDTClientBackend::ReceiveLoop() {
     if (result == RecvResult::Error) {
       break;  // socket closed underneath us, shutdown is in progress
     }
-    if (len == 0 || !from) {
-      continue;
-    }
-    // one peer, so anything from elsewhere is noise on the port
-    if (!(*from == *server_address_)) {
-      continue;
-    }
-    scratch.CommitWrite(len);
-    inbox_->Push(Buffer(scratch.data(), scratch.size(), Endianness::BigEndian),
-                 config_.max_inbox_datagrams);
-    if (on_data_) {
-      on_data_();  // the session has work; do not make it wait out its tick
+    Deliver(scratch, len, from);
+  }
+}
+
+void ZDTClientBackend::Deliver(Buffer& scratch, size_t len,
+                               const std::shared_ptr<InetAddress>& from) {
+  if (len == 0 || !from) {
+    return;
+  }
+  // one peer, so anything from elsewhere is noise on the port
+  if (!(*from == *server_address_)) {
+    return;
+  }
+  scratch.CommitWrite(len);
+  inbox_->Push(Buffer(scratch.data(), scratch.size(), Endianness::BigEndian),
+               config_.max_inbox_datagrams);
+  if (on_data_) {
+    on_data_();  // the session has work; do not make it wait out its tick
+  }
+}
+
+void ZDTClientBackend::Pump() {
+  if (!poller_ || !inbox_ || !socket_ || !socket_->IsValid()) {
+    return;
+  }
+  if (!pump_scratch_) {
+    pump_scratch_ = std::make_unique<Buffer>(Endianness::BigEndian);
+    pump_scratch_->ReserveExact(ZNET_MAX_BUFFER_SIZE);
+  }
+  Buffer& scratch = *pump_scratch_;
+  // the inbox's own bound, so a flood waits in the kernel rather than
+  // holding the caller's loop here
+  for (size_t i = 0; i < config_.max_inbox_datagrams; i++) {
+    scratch.Reset();
+    size_t len = 0;
+    std::shared_ptr<InetAddress> from;
+    if (socket_->RecvFrom(scratch.write_cursor_data(), scratch.writable_bytes(),
+                          len, from) != RecvResult::Received) {
+      return;
     }
+    Deliver(scratch, len, from);
   }
 }
 
@@ -349,6 +244,13 @@ Result ZDTServerBackend::Bind() {
   socket_->SetReceiveTimeout(std::chrono::milliseconds(200));
   ApplySocketBufferSizes(*socket_, config_.socket_recv_buffer,
                          config_.socket_send_buffer);
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+  // every socket in the port's group has to ask, this one included
+  if (config_.connected_sockets && !socket_->SetReusePort(true)) {
+    ZNET_LOG_WARN("ZDT: cannot share the server's port, every session will "
+                  "use the shared socket: {}", GetLastErrorInfo());
+  }
+#endif
   result = socket_->Bind(*bind_address_);
   if (result != Result::Success) {
     return result;
@@ -403,14 +305,13 @@ void ZDTServerBackend::ReceiveLoop() {
       continue;
     }
     scratch.CommitWrite(len);
-    RouteDatagram(scratch, from);
-    if (on_data_) {
+    if (RouteDatagram(scratch, from) && on_data_) {
       on_data_();  // a session has work; do not make it wait out its tick
     }
   }
 }
 
-void ZDTServerBackend::RouteDatagram(Buffer& datagram,
+bool ZDTServerBackend::RouteDatagram(Buffer& datagram,
                                      const std::shared_ptr<InetAddress>& from) {
   ZNET_ZDT_ENTER_DOMAIN(receive_domain_);
   std::lock_guard<std::mutex> lock(state_mutex_);
@@ -418,19 +319,21 @@ void ZDTServerBackend::RouteDatagram(Buffer& datagram,
   if (static_cast<uint8_t>(datagram.data()[0]) & kFlagOnline) {
     auto it = routes_.find(from->readable());
     if (it != routes_.end()) {
+      ZDTInbox& inbox = *it->second.inbox;
       // right-sized for the inbox; the scratch's reservation stays behind
-      it->second.inbox->Push(Buffer(datagram.data(), datagram.size(),
-                                    Endianness::BigEndian),
-                             config_.max_inbox_datagrams);
-      return;
+      inbox.Push(Buffer(datagram.data(), datagram.size(), Endianness::BigEndian),
+                 config_.max_inbox_datagrams);
+      // an inbox that announces its own arrivals has told its worker already
+      return !inbox.notifies();
     }
     // online datagram from an unknown address -> drop.
     ZNET_METRIC(metrics_.zdt.datagrams_unroutable++);
-    return;
+    return false;
   }
   // offline datagrams are parsed straight out of the scratch; the reply
   // buffers HandleOffline builds are its own
   HandleOffline(datagram, from, datagram.size());
+  return true;
 }
 
 void ZDTServerBackend::MaybeRotateSecret() {
@@ -592,8 +495,12 @@ void ZDTServerBackend::HandleOffline(Buffer& buffer,
         mtu ? mtu : ZDTPayloadForLinkMTU(config_.mtu_ladder.back(), from->ipv());
     connection.local_guid = server_guid_;
     connection.remote_guid = client_guid;
+    // a socket of its own reads itself; the route below stays either way, for
+    // what still lands on the shared socket and for a repeated Request2
+    auto own_socket = OpenPeerSocket(from);
     auto transport = std::make_unique<ZDTTransportLayer>(
-        socket_, from, config_, /*drains_own_socket=*/false, inbox, connection,
+        own_socket ? own_socket : socket_, from, config_,
+        /*drains_own_socket=*/own_socket != nullptr, inbox, connection,
         child_session_options_.common);
     auto session = std::make_shared<PeerSession>(
         bind_address_, from, std::move(transport), ConnectionType::ZDT,
@@ -614,6 +521,46 @@ void ZDTServerBackend::HandleOffline(Buffer& buffer,
   }
 }
 
+std::shared_ptr<UDPSocket> ZDTServerBackend::OpenPeerSocket(
+    const std::shared_ptr<InetAddress>& peer) {
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+  if (!config_.connected_sockets) {
+    return nullptr;
+  }
+  auto socket = std::make_shared<UDPSocket>();
+  if (socket->Open(bind_address_->ipv()) != Result::Success ||
+      !socket->SetReusePort(true) || !socket->SetBlocking(false) ||
+      socket->Bind(*bind_address_) != Result::Success ||
+      socket->Connect(peer) != Result::Success) {
+    ZNET_METRIC(metrics_.zdt.connected_sockets_failed++);
+    ZNET_LOG_DEBUG("ZDT: no socket of its own for {}, using the shared one: {}",
+                   peer->readable(), GetLastErrorInfo());
+    return nullptr;
+  }
+  // until connect() the socket was one more member of the port's group, so
+  // the kernel may have handed it anyone's datagrams. Dropping them costs a
+  // retransmit at worst; the peer's first online datagram cannot be among
+  // them, since it waits for the Reply2 that goes out after this.
+  socket->DiscardQueued();
+  return socket;
+#else
+  (void)peer;
+  return nullptr;
+#endif
+}
+
+std::shared_ptr<WorkerIo> ZDTServerBackend::CreateWorkerIo() {
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+  if (config_.connected_sockets) {
+    auto poller = std::make_shared<ZDTWorkerPoller>();
+    if (poller->valid()) {
+      return poller;
+    }
+  }
+#endif
+  return nullptr;
+}
+
 void ZDTServerBackend::StopReceiving() {
   std::lock_guard<std::mutex> lock(receive_thread_mutex_);
   receiving_ = false;
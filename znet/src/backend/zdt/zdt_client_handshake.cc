@@ -0,0 +1,140 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/backends/zdt/zdt_client_handshake.h"
+
+#include <vector>
+
+namespace znet {
+namespace backends {
+
+ZDTClientHandshake::ZDTClientHandshake(std::shared_ptr<UDPSocket> socket,
+                                       std::shared_ptr<InetAddress> server,
+                                       const ZDTOptions& config, uint64_t guid)
+    : socket_(std::move(socket)), server_(std::move(server)), config_(config),
+      guid_(guid) {}
+
+void ZDTClientHandshake::Start(TimePoint now) {
+  SendRequest1(now);
+}
+
+void ZDTClientHandshake::SendRequest1(TimePoint now) {
+  // the request is padded to the candidate MTU so the padded datagram itself
+  // probes the path
+  while (rung_ < config_.mtu_ladder.count) {
+    if (attempts_ >= config_.handshake_retries_per_rung) {
+      rung_++;
+      attempts_ = 0;
+      continue;
+    }
+    // the rung is a link MTU; what goes in the datagram is the payload that
+    // fits inside it once the IP and UDP headers are accounted for
+    const uint16_t probe =
+        ZDTPayloadForLinkMTU(config_.mtu_ladder.rungs[rung_], server_->ipv());
+    Buffer request(Endianness::BigEndian);
+    WriteOfflineHeader(request, ZDTOfflineMsg::OpenConnectionRequest1);
+    request.WriteInt<uint8_t>(kZDTProtocolVersion);
+    if (request.size() < probe) {
+      std::vector<uint8_t> padding(probe - request.size(), 0);
+      request.Write(padding.data(), padding.size());
+    }
+    if (!socket_->SendTo(*server_, request.data(), request.size())) {
+      // datagram too big for the path (DF set) -> drop to next rung
+      rung_++;
+      attempts_ = 0;
+      continue;
+    }
+    attempts_++;
+    deadline_ = now + config_.handshake_retransmit;
+    return;
+  }
+  Fail(Result::Timeout);
+}
+
+void ZDTClientHandshake::SendRequest2(TimePoint now) {
+  if (attempts_ >= config_.max_retries) {
+    Fail(Result::Timeout);
+    return;
+  }
+  Buffer request(Endianness::BigEndian);
+  WriteOfflineHeader(request, ZDTOfflineMsg::OpenConnectionRequest2);
+  request.WriteInt<uint8_t>(static_cast<uint8_t>(cookie_.size()));
+  request.Write(cookie_.data(), cookie_.size());
+  request.WriteInt<uint32_t>(epoch_);
+  request.WriteInetAddress(*server_);
+  request.WriteInt<uint16_t>(negotiated_mtu_);
+  request.WriteInt<uint64_t>(guid_);
+  socket_->SendTo(*server_, request.data(), request.size());
+  attempts_++;
+  deadline_ = now + config_.handshake_retransmit;
+}
+
+void ZDTClientHandshake::Poll(TimePoint now) {
+  if (finished() || now < deadline_) {
+    return;
+  }
+  if (state_ == State::Probing) {
+    SendRequest1(now);
+  } else {
+    SendRequest2(now);
+  }
+}
+
+void ZDTClientHandshake::OnDatagram(Buffer& datagram, TimePoint now) {
+  if (finished() || datagram.size() == 0 ||
+      (static_cast<uint8_t>(datagram.data()[0]) & kFlagOnline)) {
+    return;
+  }
+  ZDTOfflineMsg id;
+  if (!ReadOfflineHeader(datagram, id)) {
+    return;
+  }
+  if (id == ZDTOfflineMsg::IncompatibleProtocolVersion) {
+    Fail(Result::IncompatibleVersion);
+    return;
+  }
+  if (id == ZDTOfflineMsg::NoFreeConnections) {
+    Fail(Result::ServerFull);
+    return;
+  }
+  if (state_ == State::Probing && id == ZDTOfflineMsg::OpenConnectionReply1) {
+    server_guid_ = datagram.ReadInt<uint64_t>();
+    negotiated_mtu_ = datagram.ReadInt<uint16_t>();
+    uint8_t cookie_len = datagram.ReadInt<uint8_t>();
+    if (cookie_len != kZDTCookieLen) {
+      return;
+    }
+    datagram.Read(cookie_.data(), cookie_.size());
+    epoch_ = datagram.ReadInt<uint32_t>();
+    state_ = State::Confirming;
+    attempts_ = 0;
+    SendRequest2(now);
+    return;
+  }
+  if (state_ == State::Confirming && id == ZDTOfflineMsg::OpenConnectionReply2) {
+    uint64_t reply_server_guid = datagram.ReadInt<uint64_t>();
+    auto external = datagram.ReadInetAddress();
+    uint16_t mtu = datagram.ReadInt<uint16_t>();
+    (void)external;
+    connection_.mtu = mtu ? mtu : negotiated_mtu_;
+    connection_.local_guid = guid_;
+    connection_.remote_guid = reply_server_guid ? reply_server_guid : server_guid_;
+    state_ = State::Done;
+    result_ = Result::Success;
+  }
+}
+
+void ZDTClientHandshake::Fail(Result result) {
+  state_ = State::Failed;
+  result_ = result;
+}
+
+}  // namespace backends
+}  // namespace znet
@@ -24,6 +24,12 @@
 #include <cstring>
 #include <thread>
 
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 namespace znet {
 namespace backends {
 
@@ -60,8 +66,12 @@ Result UDPSocket::Bind(const InetAddress& addr) {
 }
 
 bool UDPSocket::SendTo(const InetAddress& addr, const void* data, size_t len) {
-  ssize_t n =
-      SocketSendTo(handle(), data, len, addr.handle_ptr(), addr.addr_size());
+  // a connected socket's only destination is its peer, which `addr` is
+  const ssize_t n =
+      connected_.load(std::memory_order_acquire)
+          ? SocketSend(handle(), data, len)
+          : SocketSendTo(handle(), data, len, addr.handle_ptr(),
+                         addr.addr_size());
   if (n < 0) {
     ZNET_LOG_DEBUG("ZDT: sendto {} failed: {}", addr.readable(),
                    GetLastErrorInfo());
@@ -72,24 +82,37 @@ bool UDPSocket::SendTo(const InetAddress& addr, const void* data, size_t len) {
 
 RecvResult UDPSocket::RecvFrom(void* data, size_t cap, size_t& out_len,
                                std::shared_ptr<InetAddress>& out_from) {
+  const bool connected = connected_.load(std::memory_order_acquire);
   sockaddr_storage from{};
   socklen_t from_len = sizeof(from);
-  ssize_t n = SocketRecvFrom(handle(), data, cap,
-                             reinterpret_cast<sockaddr*>(&from), &from_len);
+  ssize_t n = connected
+                  ? SocketRecv(handle(), data, cap)
+                  : SocketRecvFrom(handle(), data, cap,
+                                   reinterpret_cast<sockaddr*>(&from),
+                                   &from_len);
   if (n < 0) {
+    // a connected socket also reports the ICMP unreachable an earlier send
+    // drew. Whether the peer is gone is the idle timeout's call, as it is
+    // on an unconnected socket, which never sees those.
 #ifdef ZNET_TARGET_WIN
     int err = WSAGetLastError();
-    if (err == WSAEWOULDBLOCK || err == WSAETIMEDOUT) {
+    if (err == WSAEWOULDBLOCK || err == WSAETIMEDOUT ||
+        (connected && err == WSAECONNRESET)) {
       return RecvResult::WouldBlock;
     }
 #else
-    if (errno == EWOULDBLOCK || errno == EAGAIN) {
+    if (errno == EWOULDBLOCK || errno == EAGAIN ||
+        (connected && errno == ECONNREFUSED)) {
       return RecvResult::WouldBlock;
     }
 #endif
     return RecvResult::Error;
   }
   out_len = static_cast<size_t>(n);
+  if (connected) {
+    out_from = peer_;
+    return RecvResult::Received;
+  }
   out_from = std::shared_ptr<InetAddress>(
       InetAddress::from(reinterpret_cast<sockaddr*>(&from)));
   return RecvResult::Received;
@@ -174,6 +197,38 @@ bool UDPSocket::SetDontFragment(bool enabled) {
 #endif
 }
 
+bool UDPSocket::SetReusePort(bool enabled) {
+#ifdef SO_REUSEPORT
+  const int value = enabled ? 1 : 0;
+  return setsockopt(handle(), SOL_SOCKET, SO_REUSEPORT,
+                    reinterpret_cast<const char*>(&value), sizeof(value)) == 0;
+#else
+  (void)enabled;
+  return false;
+#endif
+}
+
+Result UDPSocket::Connect(std::shared_ptr<InetAddress> peer) {
+  if (connect(handle(), peer->handle_ptr(), peer->addr_size()) != 0) {
+    ZNET_LOG_DEBUG("ZDT: failed to connect UDP socket to {}: {}",
+                   peer->readable(), GetLastErrorInfo());
+    return Result::CannotConnect;
+  }
+  peer_ = std::move(peer);
+  connected_.store(true, std::memory_order_release);
+  return Result::Success;
+}
+
+size_t UDPSocket::DiscardQueued() {
+  size_t dropped = 0;
+  char byte;
+  // a short read takes the whole datagram off the queue
+  while (SocketRecv(handle(), &byte, sizeof(byte)) >= 0) {
+    dropped++;
+  }
+  return dropped;
+}
+
 std::shared_ptr<InetAddress> UDPSocket::local_address() {
   sockaddr_storage ss{};
   socklen_t len = sizeof(ss);
@@ -199,20 +254,123 @@ Result UDPSocket::Close() {
   return Result::Success;
 }
 
+// ---------------------------------------------------------------------------
+// ZDTWorkerPoller
+// ---------------------------------------------------------------------------
+
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+
+ZDTWorkerPoller::ZDTWorkerPoller() {
+  epoll_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_ < 0 || wake_ < 0) {
+    ZNET_LOG_ERROR("ZDT: cannot set up a worker's poll set: {}",
+                   GetLastErrorInfo());
+    return;
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = wake_;
+  epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event);
+}
+
+ZDTWorkerPoller::~ZDTWorkerPoller() {
+  if (wake_ >= 0) {
+    close(wake_);
+  }
+  if (epoll_ >= 0) {
+    close(epoll_);
+  }
+}
+
+bool ZDTWorkerPoller::Poll(std::chrono::nanoseconds timeout) {
+  // rounded up, so a sleep asked for is never cut to a busy poll
+  const int64_t ms =
+      timeout.count() <= 0 ? 0 : (timeout.count() + 999999) / 1000000;
+  epoll_event events[64];
+  const int count = epoll_wait(epoll_, events, 64,
+                               static_cast<int>(std::min<int64_t>(ms, 1000)));
+  bool ready = false;
+  for (int i = 0; i < count; i++) {
+    if (events[i].data.fd == wake_) {
+      uint64_t value;
+      (void)!read(wake_, &value, sizeof(value));
+      continue;
+    }
+    ready = true;
+    std::function<void()> on_readable;
+    {
+      std::lock_guard<std::mutex> lock(callbacks_mutex_);
+      auto it = callbacks_.find(events[i].data.fd);
+      if (it != callbacks_.end()) {
+        on_readable = it->second;
+      }
+    }
+    if (on_readable) {
+      on_readable();
+    }
+  }
+  return ready;
+}
+
+void ZDTWorkerPoller::Wake() {
+  const uint64_t one = 1;
+  (void)!write(wake_, &one, sizeof(one));
+}
+
+bool ZDTWorkerPoller::Watch(SocketHandle socket) {
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = socket;
+  return epoll_ctl(epoll_, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+void ZDTWorkerPoller::OnReadable(SocketHandle socket,
+                                 std::function<void()> on_readable) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  callbacks_[socket] = std::move(on_readable);
+}
+
+void ZDTWorkerPoller::Unwatch(SocketHandle socket) {
+  epoll_event event{};  // ignored, but kernels before 2.6.9 want one
+  epoll_ctl(epoll_, EPOLL_CTL_DEL, socket, &event);
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  callbacks_.erase(socket);
+}
+
+#endif  // ZNET_HAS_ZDT_CONNECTED_SOCKETS
+
 // ---------------------------------------------------------------------------
 // ZDTInbox
 // ---------------------------------------------------------------------------
 
 bool ZDTInbox::Push(Buffer&& datagram, size_t limit) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (queue_.size() >= limit) {
-    dropped_++;
-    return false;
+  bool first = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() >= limit) {
+      dropped_++;
+      return false;
+    }
+    first = queue_.empty();
+    queue_.push_back(std::move(datagram));
+  }
+  if (first && notifies()) {
+    on_arrival_();
   }
-  queue_.push_back(std::move(datagram));
   return true;
 }
 
+bool ZDTInbox::empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.empty();
+}
+
+void ZDTInbox::SetOnArrival(std::function<void()> on_arrival) {
+  on_arrival_ = std::move(on_arrival);
+  notifies_.store(true, std::memory_order_release);
+}
+
 void ZDTInbox::Drain(std::deque<Buffer>& out) {
   std::lock_guard<std::mutex> lock(mutex_);
   out.swap(queue_);
@@ -80,13 +80,22 @@ bool ZDTTransportLayer::Send(std::shared_ptr<Buffer> buffer, SendOptions options
     return false;
   }
   // normally the session refuses long before this; this bounds what a shut
-  // send window can accumulate over many ticks. No out-count: FlushOutbound()
-  // runs on this transport's own worker, so there is nothing to wake.
-  if (!outbound_.Push(QueuedOut{std::move(buffer), options})) {
+  // send window can accumulate over many ticks
+  size_t queued = 0;
+  QueuedOut out{std::move(buffer), options};
+  if (options.Has<DeadlineKey>()) {
+    out.expires = steady_clock::now() + options.GetOr<DeadlineKey>({});
+  }
+  if (!outbound_.Push(std::move(out), &queued)) {
     ZNET_LOG_WARN("ZDT: outbound queue full ({}), dropping packet!",
                   outbound_.capacity());
     return false;
   }
+  // FlushOutbound() runs on the worker, which an encoder on another thread
+  // has to wake: a worker that only looks at ready sessions would not look
+  if (queued == 0 && on_ready_) {
+    on_ready_();
+  }
   return true;
 }
 
@@ -121,6 +130,86 @@ void ZDTTransportLayer::FillMetrics(SessionMetrics& out) const {
 #endif
 }
 
+void ZDTTransportLayer::BindWorkerIo(const std::shared_ptr<WorkerIo>& io) {
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+  auto poller = std::dynamic_pointer_cast<ZDTWorkerPoller>(io);
+  if (!poller || !drains_own_socket_ || !socket_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(poller_mutex_);
+  // checked under the lock, which Close() takes after setting it, so a
+  // socket is never left in the set past its shutdown
+  if (is_closed_) {
+    return;
+  }
+  if (poller->Watch(socket_->handle())) {
+    poller_ = std::move(poller);
+  }
+#else
+  (void)io;
+#endif
+}
+
+bool ZDTTransportLayer::SetReadyCallback(std::function<void()> ready) {
+  if (drains_own_socket_) {
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+    std::lock_guard<std::mutex> lock(poller_mutex_);
+    if (!poller_) {
+      return false;  // nothing would hear its datagrams
+    }
+    poller_->OnReadable(socket_->handle(), ready);
+#else
+    return false;
+#endif
+  }
+  // a connected session's route stays, so the shared socket can still
+  // deliver to the inbox what raced its connect()
+  inbox_->SetOnArrival(ready);
+  on_ready_ = std::move(ready);
+  return true;
+}
+
+ZDTTransportLayer::TimePoint ZDTTransportLayer::NextDeadline() {
+  ZNET_ZDT_ENTER_DOMAIN(worker_domain_);
+  if (handshake_ && !is_closed_) {
+    // what the session has queued waits for the handshake, so only a reply
+    // or a resend can be due
+    return inbox_->empty() ? handshake_->deadline() : TimePoint::min();
+  }
+  if (is_closed_ || !ready_.empty() || needs_ack_ || staged_count_ != 0 ||
+      !outbound_.Empty() || !inbox_->empty()) {
+    return TimePoint::min();
+  }
+  TimePoint next = TimePoint::max();
+  if (!unacked_.empty()) {
+    next = std::min(next_retransmit_scan_, tail_probe_at_);
+  }
+  if (keepalive_interval_.count() > 0) {
+    next = std::min(next, last_send_ + keepalive_interval_);
+  }
+  if (idle_timeout_.count() > 0) {
+    next = std::min(next, last_recv_ + idle_timeout_);
+  }
+  for (const auto& entry : reassembly_) {
+    next = std::min(next, entry.second.first_seen + config_.reassembly_timeout);
+  }
+  const auto max_age = config_.rto_max * 4;
+  for (const auto& entry : sent_packets_) {
+    next = std::min(next, entry.second.send_time + max_age);
+  }
+  return next;
+}
+
+void ZDTTransportLayer::StopWatching() {
+#if ZNET_HAS_ZDT_CONNECTED_SOCKETS
+  std::lock_guard<std::mutex> lock(poller_mutex_);
+  if (poller_) {
+    poller_->Unwatch(socket_->handle());
+    poller_ = nullptr;
+  }
+#endif
+}
+
 void ZDTTransportLayer::DrainSocket() {
   while (true) {
     recv_scratch_.Reset();
@@ -145,9 +234,19 @@ void ZDTTransportLayer::ProcessInbound() {
   inbound_scratch_.clear();
   inbox_->Drain(inbound_scratch_);
   for (Buffer& buffer : inbound_scratch_) {
-    if (buffer.size() == 0 ||
-        !(static_cast<uint8_t>(buffer.data()[0]) & kFlagOnline)) {
-      continue;  // stray/offline datagram on a connected transport
+    if (buffer.size() == 0) {
+      continue;
+    }
+    if (!(static_cast<uint8_t>(buffer.data()[0]) & kFlagOnline)) {
+      // a handshake reply, or a stray on a connected transport
+      if (handshake_) {
+        handshake_->OnDatagram(buffer, steady_clock::now());
+        SettleHandshake();
+      }
+      continue;
+    }
+    if (handshake_) {
+      continue;  // for a connection the server has not confirmed yet
     }
     ZDTHeader header;
     if (!ReadZDTHeader(buffer, header)) {
@@ -168,6 +267,7 @@ void ZDTTransportLayer::ProcessInbound() {
       if (drains_own_socket_ && socket_) {
         // shut down rather than close, as Close() does: the application may be
         // in SendTo() on this socket, sending its own FIN
+        StopWatching();
         socket_->Shutdown();
       }
       return;
@@ -337,60 +437,80 @@ void ZDTTransportLayer::FlushOutbound() {
     StageOutbound();
   }
 
+  // whether the lane's head may go now. Only reliable traffic is windowed;
+  // unreliable sends are never held back.
+  auto may_send = [&](const StagedLane& lane) {
+    if (!lane.messages.front().options.GetOr<ReliableKey>(true)) {
+      return true;
+    }
+    // both windows are global, but the lane is only skipped: another lane's
+    // front may be unreliable and free to go
+    if (unacked_.size() >= static_cast<size_t>(config_.max_messages_in_flight)) {
+      return false;
+    }
+    // the real congestion window: anything past what an ack can describe is
+    // resent for nothing and eventually trips max_retries.
+    if (in_flight_datagrams_ >= static_cast<size_t>(SendWindow())) {
+      return false;
+    }
+    if (!unacked_.empty()) {
+      auto oldest = unacked_.lower_bound(MsgKey{lane.channel, true, 0, 0});
+      if (oldest != unacked_.end() && oldest->first.channel == lane.channel &&
+          oldest->first.reliable &&
+          channels_[lane.channel].rel_send - oldest->first.message_seq >=
+              kMaxSeqGap) {
+        return false;  // stalled until its oldest unacked message is retired
+      }
+    }
+    return true;
+  };
+
   while (true) {
     // and again as the lanes empty, so a message encoded while this loop runs
     // still goes out in this flush rather than waiting for the next
     if (staged_count_ == 0 && StageOutbound() == 0) {
       break;
     }
-    // one message per lane per cycle: a lane the window refuses is skipped,
-    // not waited on, and a bulk transfer takes one slot per pass, so it can
-    // neither park another channel's traffic behind its backlog nor drain the
-    // window dry before another lane gets a turn.
-    bool sent_any = false;
+    // weighted fair queueing, self-clocked: each lane's head is tagged with
+    // the virtual time it would finish at, its start plus its bytes over its
+    // weight, and the earliest tag goes next. A backlogged lane so takes bytes
+    // in proportion to PriorityKey + 1, and one the window refuses is skipped,
+    // not waited on, so a bulk transfer can neither park another channel
+    // behind its backlog nor drain the window dry before another lane gets a
+    // turn.
+    StagedLane* next_lane = nullptr;
+    uint64_t next_finish = 0;
     const size_t lanes = staged_.size();
     for (size_t step = 0; step < lanes; step++) {
       StagedLane& lane = staged_[(staged_cursor_ + step) % lanes];
-      if (lane.messages.empty()) {
+      // a stale unreliable head is dropped here rather than spend the bytes
+      while (!lane.messages.empty() && lane.messages.front().expires <= now &&
+             !lane.messages.front().options.GetOr<ReliableKey>(true)) {
+        PopStaged(lane);
+        ZNET_METRIC(metrics_.zdt.messages_expired++);
+      }
+      if (lane.messages.empty() || !may_send(lane)) {
         continue;
       }
-      const SendOptions& next = lane.messages.front().options;
-      const bool next_reliable = next.GetOr<ReliableKey>(true);
-      // only reliable traffic is windowed; unreliable sends are never held
-      // back.
-      if (next_reliable) {
-        // both windows are global, but the lane is only skipped: another
-        // lane's front may be unreliable and free to go
-        if (unacked_.size() >= static_cast<size_t>(config_.max_messages_in_flight)) {
-          continue;
-        }
-        // the real congestion window: anything past what an ack can describe
-        // is resent for nothing and eventually trips max_retries.
-        if (in_flight_datagrams_ >= static_cast<size_t>(SendWindow())) {
-          continue;
-        }
-        if (!unacked_.empty()) {
-          auto oldest = unacked_.lower_bound(MsgKey{lane.channel, true, 0, 0});
-          if (oldest != unacked_.end() &&
-              oldest->first.channel == lane.channel &&
-              oldest->first.reliable &&
-              channels_[lane.channel].rel_send - oldest->first.message_seq >=
-                  kMaxSeqGap) {
-            continue;  // stalled until its oldest unacked message is retired
-          }
-        }
+      const QueuedOut& head = lane.messages.front();
+      const uint64_t weight = head.options.GetOr<PriorityKey>(0) + uint64_t{1};
+      const uint64_t bytes =
+          head.payload->readable_bytes() + kZDTRecordHeaderSize;
+      const uint64_t finish = lane.start + bytes * kLaneWeightScale / weight;
+      // strictly earlier, so a tie goes to the first lane after the cursor
+      if (next_lane == nullptr || finish < next_finish) {
+        next_lane = &lane;
+        next_finish = finish;
       }
-      QueuedOut queued = std::move(lane.messages.front());
-      lane.messages.pop_front();
-      staged_count_--;
-      pack_message(std::move(queued), lane.channel);
-      sent_any = true;
     }
-    if (!sent_any) {
+    if (next_lane == nullptr) {
       break;  // every lane is empty or refused by the window
     }
-    // rotate so a window with room for fewer messages than there are lanes
-    // serves a different lane first next time
+    // the next head starts where this one finished
+    virtual_clock_ = next_finish;
+    next_lane->start = next_finish;
+    pack_message(PopStaged(*next_lane), next_lane->channel);
+    // rotate so lanes that tie are served in turn
     staged_cursor_ = (staged_cursor_ + 1) % lanes;
   }
   flush_batch();  // whatever is left over goes out now, not next tick
@@ -413,13 +533,49 @@ size_t ZDTTransportLayer::StageOutbound() {
       staged_.back().channel = channel;
       lane = &staged_.back();
     }
+    // an unreliable message still waiting under the same key is stale now:
+    // this one takes its place, and its turn
+    const bool coalesces = queued.options.Has<CoalesceKey>() &&
+                           !queued.options.GetOr<ReliableKey>(true);
+    const uint64_t coalesce_key =
+        (uint64_t{channel} << 32) | queued.options.GetOr<CoalesceKey>(0);
+    if (coalesces) {
+      auto it = coalescing_.find(coalesce_key);
+      if (it != coalescing_.end()) {
+        *it->second = std::move(queued);
+        ZNET_METRIC(metrics_.zdt.messages_superseded++);
+        continue;
+      }
+    }
+    if (lane->messages.empty()) {
+      // one that was idle starts level with the clock rather than banking
+      // credit for the time it sent nothing. Pinned here, not on each pass:
+      // a tag taken from the clock as it moves would trail every backlogged
+      // lane's and never come first
+      lane->start = std::max(lane->start, virtual_clock_);
+    }
     lane->messages.push_back(std::move(queued));
+    if (coalesces) {
+      coalescing_[coalesce_key] = &lane->messages.back();
+    }
     count++;
   }
   staged_count_ += count;
   return count;
 }
 
+ZDTTransportLayer::QueuedOut ZDTTransportLayer::PopStaged(StagedLane& lane) {
+  QueuedOut queued = std::move(lane.messages.front());
+  lane.messages.pop_front();
+  staged_count_--;
+  if (queued.options.Has<CoalesceKey>() &&
+      !queued.options.GetOr<ReliableKey>(true)) {
+    coalescing_.erase((uint64_t{lane.channel} << 32) |
+                      queued.options.GetOr<CoalesceKey>(0));
+  }
+  return queued;
+}
+
 ZDTTransportLayer::PendingRecord ZDTTransportLayer::MakeRecord(
     const std::shared_ptr<Buffer>& owner, size_t offset, size_t length,
     uint8_t flags, uint8_t channel, SequenceId message_seq, uint8_t frag_index,
@@ -852,6 +1008,39 @@ void ZDTTransportLayer::CheckTimers() {
   }
 }
 
+void ZDTTransportLayer::AwaitHandshake(
+    std::unique_ptr<ZDTClientHandshake> handshake) {
+  handshake_ = std::move(handshake);
+  handshake_->Start(steady_clock::now());
+}
+
+bool ZDTTransportLayer::SettleHandshake() {
+  if (!handshake_ || !handshake_->finished()) {
+    return !handshake_;
+  }
+  if (handshake_->state() == ZDTClientHandshake::State::Failed) {
+    ZNET_LOG_ERROR("ZDT handshake with {} failed: {}", peer_->readable(),
+                   GetResultString(handshake_->result()));
+    handshake_ = nullptr;
+    // nothing to tell a server that never opened the connection
+    is_closed_ = true;
+    return false;
+  }
+  connection_ = handshake_->connection();
+  handshake_ = nullptr;
+  ZNET_LOG_DEBUG("ZDT connected to {} (mtu={})", peer_->readable(),
+                 connection_.mtu);
+  // one peer from here on: the kernel filters for it and every send skips
+  // the route lookup an address would cost. Merely slower without it.
+  if (socket_->Connect(peer_) != Result::Success) {
+    ZNET_LOG_DEBUG("ZDT: continuing on an unconnected socket.");
+  }
+  // the idle and keepalive clocks start with the connection, not the attempt
+  last_recv_ = steady_clock::now();
+  last_send_ = last_recv_;
+  return true;
+}
+
 void ZDTTransportLayer::Update() {
   ZNET_ZDT_ENTER_DOMAIN(worker_domain_);
   if (is_closed_) {
@@ -864,6 +1053,12 @@ void ZDTTransportLayer::Update() {
   if (is_closed_) {
     return;
   }
+  if (handshake_) {
+    handshake_->Poll(steady_clock::now());
+    if (!SettleHandshake()) {
+      return;  // nothing goes out before the server has confirmed
+    }
+  }
   RetransmitUnacked();
   if (is_closed_) {
     return;
@@ -880,7 +1075,7 @@ void ZDTTransportLayer::Update() {
 
 void ZDTTransportLayer::Flush() {
   ZNET_ZDT_ENTER_DOMAIN(worker_domain_);
-  if (is_closed_) {
+  if (is_closed_ || handshake_) {
     return;
   }
   FlushOutbound();
@@ -912,6 +1107,7 @@ Result ZDTTransportLayer::Close(CloseOptions options) {
   if (drains_own_socket_ && socket_) {
     // shut down rather than close: the session's worker may be inside
     // RecvFrom() on this socket via DrainSocket(). See UDPSocket::Shutdown().
+    StopWatching();
     socket_->Shutdown();
   }
   return Result::Success;
@@ -20,6 +20,11 @@ Client::Client(const ClientConfig& config) : config_(config) {
   server_address_ = InetAddress::from(config_.server_address, config_.server_port);
   backend_ = backends::CreateClientFromType(config.connection_type, server_address_,
                                             config.options);
+  if (config_.drive == DriveMode::Manual) {
+    poller_ = std::make_shared<ManualPoller>();
+    std::shared_ptr<ManualPoller> poller = poller_;
+    signal_->on_raise = [poller]() { poller->Wake(); };
+  }
 }
 
 Client::~Client() {
@@ -63,12 +68,18 @@ Result Client::Bind(const std::string& ip, PortNumber port) {
 }
 
 Result Client::Connect() {
-  if (task_.IsRunning()) {
+  if (task_.IsRunning() || stage_ == Stage::Connecting ||
+      stage_ == Stage::Connected) {
     return Result::AlreadyConnected;
   }
   if (ZNET_UNLIKELY(!backend_)) ZNET_UNLIKELY_ATTR {
     return Result::InvalidBackend;
   }
+  if (poller_ && !backend_->DriveManually(poller_)) {
+    ZNET_LOG_ERROR("This connection type needs its own threads; it cannot "
+                   "be driven manually.");
+    return Result::InvalidBackend;
+  }
   // registered before Connect() starts any receive thread, which reads it
   auto signal = signal_;
   backend_->SetWakeCallback([signal]() { signal->Raise(); });
@@ -79,6 +90,13 @@ Result Client::Connect() {
   }
 
   client_session_ = backend_->client_session();
+  if (poller_) {
+    // no encoder: a Send() encodes on the caller's thread, and only has to
+    // make sure the application's loop comes round to flush it
+    client_session_->SetWakeCallback([signal]() { signal->Raise(); });
+    stage_ = Stage::Connecting;
+    return Result::Success;
+  }
   // takes over the session's wake callback too, so start it before the session
   // reaches the application
   encoder_.Start(client_session_, [signal]() { signal->Raise(); });
@@ -180,4 +198,73 @@ ZNET_NODISCARD std::shared_ptr<InetAddress> Client::local_address() const {
   return backend_->local_address();
 }
 
+bool Client::Process() {
+  if (stage_ != Stage::Connecting && stage_ != Stage::Connected) {
+    return false;
+  }
+  // the loop's thread for the call only; see Server::Process()
+  signal_->owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  poller_->Drain();
+  signal_->woken.store(false, std::memory_order_relaxed);
+  backend_->Pump();
+  scheduler_.Start();
+  client_session_->Process();
+  scheduler_.End();
+  signal_->owner.store(std::thread::id(), std::memory_order_relaxed);
+  // the thread loop's events, at the same points
+  if (stage_ == Stage::Connecting) {
+    if (client_session_->IsAlive() && !client_session_->IsReady() &&
+        config_.connection_timeout.count() > 0 &&
+        client_session_->time_since_connect() > config_.connection_timeout) {
+      ZNET_LOG_DEBUG("Connection to {} timed-out.", server_address_->readable());
+      client_session_->Close();
+    }
+    if (!client_session_->IsAlive()) {
+      stage_ = Stage::Done;
+      ZNET_LOG_DEBUG("Connection attempt to {} failed before it was ready.",
+                     server_address_->readable());
+      ClientConnectionFailedEvent failed_event{client_session_};
+      event_callback()(failed_event);
+      return false;
+    }
+    if (!client_session_->IsReady()) {
+      return true;
+    }
+    stage_ = Stage::Connected;
+    ZNET_LOG_DEBUG("Connected to the server.");
+    ClientConnectedToServerEvent connected_event{client_session_};
+    event_callback()(connected_event);
+  }
+  if (!client_session_->IsAlive()) {
+    stage_ = Stage::Done;
+    ZNET_LOG_DEBUG("Disconnected from the server.");
+    ClientDisconnectedFromServerEvent disconnected_event{client_session_};
+    event_callback()(disconnected_event);
+    return false;
+  }
+  return true;
+}
+
+bool Client::PollOnce(std::chrono::milliseconds timeout) {
+  if (stage_ != Stage::Connecting && stage_ != Stage::Connected) {
+    return false;
+  }
+  auto until = std::chrono::steady_clock::duration(timeout);
+  if (stage_ == Stage::Connecting) {
+    // the connection timeout is only checked on a tick
+    until = std::min<std::chrono::steady_clock::duration>(
+        until, scheduler_.remaining());
+  }
+  const auto deadline = client_session_->NextDeadline();
+  if (deadline != std::chrono::steady_clock::time_point::max()) {
+    until = std::min(until, deadline - std::chrono::steady_clock::now());
+  }
+  if (until > std::chrono::steady_clock::duration::zero()) {
+    // rounded up: a wake a hair early finds nothing due
+    poller_->Wait(std::chrono::duration_cast<std::chrono::milliseconds>(
+        until + std::chrono::microseconds(999)));
+  }
+  return Process();
+}
+
 }  // namespace znet
\ No newline at end of file
@@ -0,0 +1,352 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/client_pool.h"
+#include "znet/backends/backend.h"
+#include "znet/client_events.h"
+#include "znet/error.h"
+#include "znet/init.h"
+#include "znet/logger.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace znet {
+
+ClientPool::ClientPool(const ClientPoolOptions& options) {
+  uint32_t count = options.workers;
+  if (count == 0) {
+    count = std::thread::hardware_concurrency();
+  }
+  if (count == 0) {
+    count = 1;  // unknown, and an empty pool would refuse every connection
+  }
+  workers_.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+    Worker& worker = *workers_.back();
+    worker.scheduler.SetTicksPerSecond(options.ticks_per_second);
+    // the worker sleeps in the poller, where a notify on its cv goes unheard
+    std::shared_ptr<ManualPoller> poller = worker.poller;
+    worker.signal->on_raise = [poller]() { poller->Wake(); };
+    worker.task.Run([this, &worker]() { WorkerLoop(worker); });
+  }
+}
+
+ClientPool::~ClientPool() {
+  Stop();
+}
+
+Result ClientPool::Bind() {
+  Result init_result = Init();
+  if (ZNET_UNLIKELY(init_result != Result::Success)) ZNET_UNLIKELY_ATTR {
+    ZNET_LOG_ERROR("Cannot bind because initialization of znet had failed with reason: {}", GetResultString(init_result));
+  }
+  return init_result;
+}
+
+Result ClientPool::Connect(const ClientConfig& config,
+                           std::shared_ptr<PeerSession>* out_session) {
+  if (stopping_.load(std::memory_order_acquire)) {
+    return Result::AlreadyStopped;
+  }
+  std::shared_ptr<InetAddress> server_address =
+      InetAddress::from(config.server_address, config.server_port);
+  auto backend = backends::CreateClientFromType(config.connection_type,
+                                                server_address, config.options);
+  if (ZNET_UNLIKELY(!backend)) ZNET_UNLIKELY_ATTR {
+    return Result::InvalidBackend;
+  }
+  Worker& worker = SelectWorker();
+  // before Connect(), which is where a backend would start its thread
+  if (!backend->DriveManually(worker.poller)) {
+    ZNET_LOG_ERROR("This connection type needs its own threads; it cannot "
+                   "join a client pool.");
+    return Result::InvalidBackend;
+  }
+  auto member = std::make_shared<Member>();
+  member->mark->member = member;
+  // and before Connect() too, which is where the socket joins the poller
+  backend->SetPollTag(member.get());
+  Result result = backend->Bind();
+  if (ZNET_UNLIKELY(result != Result::Success)) ZNET_UNLIKELY_ATTR {
+    return result;
+  }
+  std::shared_ptr<WorkerSignal> signal = worker.signal;
+  backend->SetWakeCallback([signal]() { signal->Raise(); });
+  result = backend->Connect();
+  if (ZNET_UNLIKELY(result != Result::Success)) ZNET_UNLIKELY_ATTR {
+    return result;
+  }
+
+  member->session = backend->client_session();
+  // no encoder: a Send() encodes on the caller's thread and only has to
+  // bring the worker round to this session to flush it
+  std::shared_ptr<Mark> mark = member->mark;
+  std::shared_ptr<ReadyQueue> ready = worker.ready;
+  member->session->SetWakeCallback([mark, ready, signal]() {
+    if (!mark->queued.exchange(true)) {
+      ready->Push(mark);
+      signal->Raise();
+    }
+  });
+  member->connection_timeout = config.connection_timeout;
+  if (out_session) {
+    *out_session = member->session;
+  }
+  member->backend = std::move(backend);
+  worker.count.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(worker.arrivals_mutex);
+    worker.arrivals.push_back(std::move(member));
+  }
+  signal->Raise();
+  return Result::Success;
+}
+
+Result ClientPool::Stop() {
+  if (stopping_.exchange(true, std::memory_order_acq_rel)) {
+    return Result::AlreadyStopped;
+  }
+  for (auto& worker : workers_) {
+    worker->task.RequestStop();
+    worker->poller->Wake();
+  }
+  for (auto& worker : workers_) {
+    worker->task.Wait();
+  }
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    stopped_ = true;
+  }
+  stop_cv_.notify_all();
+  return Result::Success;
+}
+
+void ClientPool::Wait() {
+  std::unique_lock<std::mutex> lock(stop_mutex_);
+  stop_cv_.wait(lock, [this]() { return stopped_; });
+}
+
+size_t ClientPool::size() const {
+  size_t total = 0;
+  for (const auto& worker : workers_) {
+    total += worker->count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+std::vector<size_t> ClientPool::worker_sizes() const {
+  std::vector<size_t> sizes;
+  sizes.reserve(workers_.size());
+  for (const auto& worker : workers_) {
+    sizes.push_back(worker->count.load(std::memory_order_relaxed));
+  }
+  return sizes;
+}
+
+uint64_t ClientPool::processed() const {
+  uint64_t total = 0;
+  for (const auto& worker : workers_) {
+    total += worker->processed.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+ClientPool::Worker& ClientPool::SelectWorker() {
+  // a stale count only places a session on a slightly busier worker
+  Worker* min = workers_.front().get();
+  for (auto& worker : workers_) {
+    if (worker->count.load(std::memory_order_relaxed) <
+        min->count.load(std::memory_order_relaxed)) {
+      min = worker.get();
+    }
+  }
+  return *min;
+}
+
+void ClientPool::WorkerLoop(Worker& worker) {
+  using Clock = std::chrono::steady_clock;
+  WorkerSignal& signal = *worker.signal;
+  signal.owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  // the poller names the sockets that are ready; off Linux it has no set
+  // to name them from, and every session is looked at every pass
+  const bool poll_all = worker.poller->fd() < 0;
+  // keyed by what the poller reports them as. A socket joins the poller in
+  // Connect(), before its member is handed over, so a tag is only trusted
+  // once it is found here.
+  std::unordered_map<Member*, std::shared_ptr<Member>> members;
+  detail::TimerWheel timers;
+  // what one pass runs, what it found still busy for the next, and what it
+  // found over. Raw, and valid for as long as they are held: a member is only
+  // dropped once its pass is over, and the lists with it.
+  std::vector<Member*> batch;
+  std::vector<Member*> again;
+  std::vector<Member*> gone;
+  // the tags the last wait found readable
+  std::vector<void*> readable;
+  std::vector<std::shared_ptr<Mark>> marks;
+  uint64_t pass = 0;
+
+  while (!worker.task.IsStopRequested()) {
+    worker.scheduler.Start();
+    pass++;
+    // taken before anything is read, so whatever lands after is seen by
+    // this pass or wakes the next
+    worker.poller->Drain();
+    signal.woken.store(false, std::memory_order_relaxed);
+    const auto now = Clock::now();
+    batch.swap(again);
+    {
+      std::lock_guard<std::mutex> lock(worker.arrivals_mutex);
+      for (auto& member : worker.arrivals) {
+        batch.push_back(member.get());
+        members[member.get()] = std::move(member);
+      }
+      worker.arrivals.clear();
+    }
+    worker.ready->TakeAll(marks);
+    for (auto& mark : marks) {
+      // expired for one dropped since; what it sent went with it
+      if (std::shared_ptr<Member> member = mark->member.lock()) {
+        batch.push_back(member.get());
+      }
+    }
+    marks.clear();
+    timers.Advance(now, [&](detail::TimerWheel::Node& node) {
+      batch.push_back(static_cast<Member*>(&node));
+    });
+    for (void* tag : readable) {
+      // one not handed over yet is still readable when its arrival runs it
+      auto found = members.find(static_cast<Member*>(tag));
+      if (found != members.end()) {
+        found->second->backend->Pump();
+        batch.push_back(found->first);
+      }
+    }
+    readable.clear();
+    if (poll_all) {
+      for (auto& item : members) {
+        item.second->backend->Pump();
+        batch.push_back(item.first);
+      }
+    }
+
+    for (Member* member : batch) {
+      if (member->pass == pass) {
+        continue;
+      }
+      member->pass = pass;
+      const bool worked = member->session->Process();
+      worker.processed.fetch_add(1, std::memory_order_relaxed);
+      if (!Advance(*member)) {
+        gone.push_back(member);
+        continue;
+      }
+      // cleared only now, so whatever Process() sent itself queued nothing;
+      // and before the deadline is asked for, so a send from another thread
+      // meanwhile is either seen by it or queues the member again
+      member->mark->queued.store(false, std::memory_order_seq_cst);
+      // work left over, or a handshake whose timeout only a pass can
+      // notice, is owed the next tick
+      const auto deadline = member->session->NextDeadline();
+      if (worked || !member->connected || deadline <= now) {
+        timers.Cancel(*member);
+        again.push_back(member);
+      } else if (deadline == Clock::time_point::max()) {
+        timers.Cancel(*member);
+      } else {
+        timers.Schedule(*member, deadline);
+      }
+    }
+    batch.clear();
+    for (Member* member : gone) {
+      timers.Cancel(*member);
+      member->session->ReleaseHandler();
+      worker.count.fetch_sub(1, std::memory_order_relaxed);
+      members.erase(member);
+    }
+    gone.clear();
+    worker.scheduler.End();
+
+    // otherwise nothing is due before the wheel's next deadline, capped so
+    // a clock step or a lost wake costs a second at most
+    Scheduler::Duration wait = worker.scheduler.remaining();
+    if (again.empty()) {
+      Clock::duration until = std::chrono::seconds(1);
+      const auto expiry = timers.NextExpiry();
+      if (expiry != Clock::time_point::max()) {
+        until = std::min(until, expiry - Clock::now());
+      }
+      wait = std::max(Scheduler::Duration::zero(),
+                      std::chrono::duration_cast<Scheduler::Duration>(until));
+    }
+    // waited even when nothing is owed a sleep, since the wait is what says
+    // which sockets are readable. Rounded up: a wake a hair early finds
+    // nothing due and sleeps again.
+    worker.poller->Wait(std::chrono::duration_cast<std::chrono::milliseconds>(
+                            wait + std::chrono::microseconds(999)),
+                        poll_all ? nullptr : &readable);
+  }
+
+  // closed on the worker, so each close is flushed and its event fired on
+  // the thread every other one came from
+  {
+    std::lock_guard<std::mutex> lock(worker.arrivals_mutex);
+    for (auto& member : worker.arrivals) {
+      members[member.get()] = std::move(member);
+    }
+    worker.arrivals.clear();
+  }
+  for (auto& item : members) {
+    Member* member = item.first;
+    timers.Cancel(*member);
+    member->session->Close();
+    member->session->Process();
+    Advance(*member);
+    member->session->ReleaseHandler();
+    worker.count.fetch_sub(1, std::memory_order_relaxed);
+  }
+  members.clear();
+}
+
+bool ClientPool::Advance(Member& member) {
+  const std::shared_ptr<PeerSession>& session = member.session;
+  if (!member.connected) {
+    if (session->IsAlive() && !session->IsReady() &&
+        member.connection_timeout.count() > 0 &&
+        session->time_since_connect() > member.connection_timeout) {
+      ZNET_LOG_DEBUG("Connection to {} timed-out.",
+                     session->remote_address()->readable());
+      session->Close();
+    }
+    if (!session->IsAlive()) {
+      ZNET_LOG_DEBUG("Connection attempt to {} failed before it was ready.",
+                     session->remote_address()->readable());
+      ClientConnectionFailedEvent failed_event{session};
+      event_callback()(failed_event);
+      return false;
+    }
+    if (!session->IsReady()) {
+      return true;
+    }
+    member.connected = true;
+    ClientConnectedToServerEvent connected_event{session};
+    event_callback()(connected_event);
+  }
+  if (!session->IsAlive()) {
+    ClientDisconnectedFromServerEvent disconnected_event{session};
+    event_callback()(disconnected_event);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace znet
@@ -10,6 +10,8 @@
 
 #include "znet/codec.h"
 
+#include "znet/stream.h"
+
 namespace znet {
 
 namespace {
@@ -37,6 +39,13 @@ void DumpUndecodableBuffer(Buffer& buffer, size_t frame_start) {
 
 }  // namespace
 
+Codec::Codec() {
+  Add(StreamChunkPacket::GetPacketId(),
+      std::make_unique<StreamChunkPacketSerializerV1>());
+  Add(StreamCreditPacket::GetPacketId(),
+      std::make_unique<StreamCreditPacketSerializerV1>());
+}
+
 DecodeStats Codec::Deserialize(std::shared_ptr<Buffer> buffer,
                                PacketHandlerBase& handler,
                                bool dump_on_failure) {
@@ -115,16 +124,26 @@ DecodeStats Codec::Deserialize(std::shared_ptr<Buffer> buffer,
 
 std::shared_ptr<Buffer> Codec::Serialize(std::shared_ptr<Packet> packet,
                                          size_t headroom) {
+  std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
+  if (headroom != 0) {
+    buffer->ReserveHeadroom(headroom);
+  }
+  if (!SerializeInto(packet, buffer)) {
+    return nullptr;
+  }
+  return buffer;
+}
+
+bool Codec::SerializeInto(const std::shared_ptr<Packet>& packet,
+                          const std::shared_ptr<Buffer>& buffer,
+                          size_t trailing_bytes) {
   auto it = serializers_.find(packet->id());
   if (it == serializers_.end()) {
     ZNET_LOG_WARN("Failed to find a serializer for packet {}!", packet->id());
-    return nullptr;
+    return false;
   }
   PacketSerializerBase& serializer = *it->second;
-  std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
-  if (headroom != 0) {
-    buffer->ReserveHeadroom(headroom);
-  }
+  const size_t frame_start = buffer->write_cursor();
   buffer->WriteVarInt(packet->id());
   // four bytes, not size_t: a frame is bounded far below 4 GiB and the old
   // eight-byte field was pure overhead on every message
@@ -135,7 +154,10 @@ std::shared_ptr<Buffer> Codec::Serialize(std::shared_ptr<Packet> packet,
   if (!out) {
     ZNET_LOG_WARN("Serializer for packet {} produced nothing, dropping packet!",
                   packet->id());
-    return nullptr;
+    // whatever it wrote is half a frame, and frames before it may be another
+    // packet's
+    buffer->set_write_cursor(frame_start);
+    return false;
   }
   // a serializer holding the bytes already, a cached encoding or a payload it
   // is forwarding, can hand back its own buffer rather than write them through
@@ -144,11 +166,11 @@ std::shared_ptr<Buffer> Codec::Serialize(std::shared_ptr<Packet> packet,
     buffer->Write(out->read_cursor_data(), out->readable_bytes());
   }
   const size_t write_cursor_end = buffer->write_cursor();
-  const size_t size = write_cursor_end - write_cursor;
+  const size_t size = write_cursor_end - write_cursor + trailing_bytes;
   buffer->set_write_cursor(write_cursor - sizeof(uint32_t));
   buffer->WriteInt(static_cast<uint32_t>(size));
   buffer->set_write_cursor(write_cursor_end);
-  return buffer;
+  return true;
 }
 
 void Codec::Add(PacketId id, std::unique_ptr<PacketSerializerBase> serializer) {
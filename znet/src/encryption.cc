@@ -294,11 +294,15 @@ bool DeriveKeyFromSharedSecret(const unsigned char* shared_secret,
 // `aad` is authenticated but not encrypted: the mode byte goes through it, so a
 // flipped mode fails the tag instead of steering the receiver somewhere else.
 //
+// `tail` continues the plaintext from wherever it lies, a mapped file for
+// one, so a message in two pieces is never gathered into one first.
+//
 // Returns the ciphertext length, or -1 on failure. Zero is a valid length (an
 // empty plaintext), which is why failure is not folded into it.
 int EncryptData(EVP_CIPHER_CTX* ctx, bool set_key, const unsigned char* key,
                 const unsigned char* nonce, const unsigned char* aad,
                 int aad_len, const unsigned char* plaintext, int plaintext_len,
+                const unsigned char* tail, int tail_len,
                 unsigned char* ciphertext, unsigned char* tag) {
   if (!ctx) {
     ZNET_LOG_ERROR("Failed to create EVP_CIPHER_CTX.");
@@ -332,6 +336,15 @@ int EncryptData(EVP_CIPHER_CTX* ctx, bool set_key, const unsigned char* key,
     ZNET_LOG_ERROR("Failed to encrypt data.");
     return -1;
   }
+  if (tail_len > 0) {
+    int tail_out = 0;
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext + ciphertext_len, &tail_out,
+                               tail, tail_len)) {
+      ZNET_LOG_ERROR("Failed to encrypt data.");
+      return -1;
+    }
+    ciphertext_len += tail_out;
+  }
 
   int len = 0;
   if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + ciphertext_len, &len)) {
@@ -685,15 +698,19 @@ std::shared_ptr<Buffer> EncryptionLayer::HandleIn(
 }
 
 std::shared_ptr<Buffer> EncryptionLayer::HandleOut(
-    std::shared_ptr<Buffer> buffer, uint8_t stream) {
+    std::shared_ptr<Buffer> buffer, uint8_t stream, const char* tail,
+    size_t tail_size) {
   // the message starts at the read cursor, not at zero: the send pipeline
   // reserves headroom for the byte prepended below
   if (buffer->readable_bytes() >
-      static_cast<size_t>(std::numeric_limits<int>::max())) {
+          static_cast<size_t>(std::numeric_limits<int>::max()) ||
+      tail_size > static_cast<size_t>(std::numeric_limits<int>::max()) -
+                      buffer->readable_bytes()) {
     ZNET_LOG_ERROR("Buffer length is too large");
     return nullptr;
   }
   int buffer_len = static_cast<int>(buffer->readable_bytes());
+  const int tail_len = static_cast<int>(tail_size);
   if (enable_encryption_) {
     std::shared_ptr<Buffer> new_buffer = std::make_shared<Buffer>();
     // GCM is a stream cipher: the ciphertext is exactly as long as the input.
@@ -703,7 +720,8 @@ std::shared_ptr<Buffer> EncryptionLayer::HandleOut(
     // transport frame in place afterwards.
     new_buffer->ReserveHeadroom(2);
     new_buffer->ReserveExact(2 + 1 + kHeaderLen +
-                             static_cast<size_t>(buffer_len) + kTagLen);
+                             static_cast<size_t>(buffer_len) + tail_size +
+                             kTagLen);
     new_buffer->WriteInt<uint8_t>(kModeAesGcm);
     const size_t header_pos = new_buffer->write_cursor();
     new_buffer->SkipWrite(kHeaderLen);  // backfilled once the counter is taken
@@ -738,7 +756,9 @@ std::shared_ptr<Buffer> EncryptionLayer::HandleOut(
                       static_cast<int>(sizeof(aad)),
                       reinterpret_cast<const unsigned char*>(
                           buffer->read_cursor_data()),
-                      buffer_len, ciphertext_dst, tag);
+                      buffer_len,
+                      reinterpret_cast<const unsigned char*>(tail), tail_len,
+                      ciphertext_dst, tag);
       if (ciphertext_len >= 0) {
         cipher_keyed_ = true;
       }
@@ -762,13 +782,19 @@ std::shared_ptr<Buffer> EncryptionLayer::HandleOut(
   }
   // in place when there is headroom left, otherwise a fresh buffer
   if (buffer->PrependInt8(0)) {  // no encryption
+    if (tail_size != 0) {
+      buffer->Write(tail, tail_size);
+    }
     return buffer;
   }
   auto new_buffer = std::make_shared<Buffer>();
   new_buffer->ReserveHeadroom(2);  // room for the transport's frame
-  new_buffer->ReserveExact(static_cast<size_t>(buffer_len) + 3);
+  new_buffer->ReserveExact(static_cast<size_t>(buffer_len) + tail_size + 3);
   new_buffer->WriteInt<uint8_t>(0);  // no encryption
   new_buffer->Write(buffer->read_cursor_data(), static_cast<size_t>(buffer_len));
+  if (tail_size != 0) {
+    new_buffer->Write(tail, tail_size);
+  }
   return new_buffer;
 }
 
@@ -0,0 +1,71 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/file_transfer.h"
+
+namespace znet {
+namespace detail {
+
+FileTransfer::FileTransfer(std::shared_ptr<MappedFile> file,
+                           std::shared_ptr<StreamWriter> writer,
+                           EventCallbackFn on_event)
+    : file_(std::move(file)),
+      writer_(std::move(writer)),
+      on_event_(std::move(on_event)) {}
+
+void FileTransfer::Write() {
+  if (done_ || sent_ == file_->size()) {
+    return;
+  }
+  uint64_t taken = 0;
+  // QueueFull leaves the rest for the next pass; anything else means the
+  // session is going, which Pump() learns from `alive`
+  writer_->WriteFile(file_, sent_, file_->size() - sent_, &taken);
+  sent_ += taken;
+}
+
+bool FileTransfer::Pump(bool alive) {
+  if (done_) {
+    return true;
+  }
+  if (!alive) {
+    Complete(Result::NotConnected);
+    return true;
+  }
+  Write();
+  if (sent_ != reported_) {
+    reported_ = sent_;
+    if (on_event_) {
+      FileTransferProgressEvent event(writer_->id(), sent_, file_->size());
+      on_event_(event);
+    }
+  }
+  if (sent_ == file_->size()) {
+    const Result result = writer_->Finish();
+    if (result == Result::Success) {
+      Complete(Result::Success);
+    } else if (result != Result::QueueFull) {
+      Complete(result);
+    }
+  }
+  return done_;
+}
+
+void FileTransfer::Complete(Result result) {
+  done_ = true;
+  if (on_event_) {
+    FileTransferCompletedEvent event(writer_->id(), result, sent_,
+                                     file_->size());
+    on_event_(event);
+  }
+}
+
+}  // namespace detail
+}  // namespace znet
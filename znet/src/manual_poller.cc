@@ -0,0 +1,128 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/manual_poller.h"
+#include "znet/detail/platform.h"
+#include "znet/logger.h"
+
+#if defined(ZNET_TARGET_LINUX)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace znet {
+
+ManualPoller::ManualPoller() {
+#if defined(ZNET_TARGET_LINUX)
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (epoll_fd_ < 0 || wake_fd_ < 0) {
+    ZNET_LOG_ERROR("Cannot create the manual-drive poller: errno {}.", errno);
+    return;
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;  // never reported to Wait()'s caller
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+#endif
+}
+
+ManualPoller::~ManualPoller() {
+#if defined(ZNET_TARGET_LINUX)
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+  }
+#endif
+}
+
+void ManualPoller::Add(SocketHandle socket, void* tag) {
+#if defined(ZNET_TARGET_LINUX)
+  if (epoll_fd_ < 0 || !IsValidSocketHandle(socket)) {
+    return;
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = tag;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &event) != 0 &&
+      errno != EEXIST) {
+    ZNET_LOG_WARN("Cannot watch descriptor {}: errno {}.", socket, errno);
+  }
+#else
+  (void)socket;
+  (void)tag;
+#endif
+}
+
+void ManualPoller::Wake() {
+  if (woken_.exchange(true)) {
+    return;
+  }
+#if defined(ZNET_TARGET_LINUX)
+  if (wake_fd_ >= 0) {
+    const uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+    return;
+  }
+#endif
+  {
+    // under the mutex, so a Wait() between testing the flag and sleeping
+    // cannot miss it
+    std::lock_guard<std::mutex> lock(mutex_);
+  }
+  cv_.notify_all();
+}
+
+void ManualPoller::Drain() {
+  // cleared before the read: a Wake() landing between the two writes again,
+  // costing one spare pass rather than a lost wake
+  if (!woken_.exchange(false)) {
+    return;
+  }
+#if defined(ZNET_TARGET_LINUX)
+  if (wake_fd_ >= 0) {
+    uint64_t count;
+    (void)!read(wake_fd_, &count, sizeof(count));
+  }
+#endif
+}
+
+bool ManualPoller::Wait(std::chrono::milliseconds timeout,
+                       std::vector<void*>* ready) {
+#if defined(ZNET_TARGET_LINUX)
+  if (epoll_fd_ >= 0) {
+    epoll_event events[kMaxEvents];
+    int count;
+    do {
+      count = epoll_wait(epoll_fd_, events, kMaxEvents,
+                         static_cast<int>(timeout.count()));
+    } while (count < 0 && errno == EINTR);
+    if (ready) {
+      for (int i = 0; i < count; i++) {
+        if (events[i].data.ptr) {
+          ready->push_back(events[i].data.ptr);
+        }
+      }
+    }
+    return count > 0;
+  }
+#else
+  (void)ready;
+#endif
+  std::unique_lock<std::mutex> lock(mutex_);
+  return cv_.wait_for(lock, timeout, [this]() { return woken_.load(); });
+}
+
+}  // namespace znet
@@ -0,0 +1,158 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/detail/mapped_file.h"
+
+#include "znet/logger.h"
+
+#include <algorithm>
+#include <limits>
+
+#ifdef ZNET_TARGET_WIN
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace znet {
+namespace detail {
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path,
+                                             uint64_t offset, uint64_t length,
+                                             Result* out_result) {
+  auto fail = [out_result](Result result) {
+    if (out_result != nullptr) {
+      *out_result = result;
+    }
+    return nullptr;
+  };
+  // not make_shared: the constructor is private
+  std::shared_ptr<MappedFile> file(new MappedFile());
+  uint64_t file_size = 0;
+  uint64_t granularity = 0;
+#ifdef ZNET_TARGET_WIN
+  HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    ZNET_LOG_WARN("Cannot open {} to send it.", path);
+    return fail(Result::CannotOpenFile);
+  }
+  file->file_handle_ = handle;
+  LARGE_INTEGER large_size;
+  if (!GetFileSizeEx(handle, &large_size)) {
+    ZNET_LOG_WARN("Cannot read the size of {}.", path);
+    return fail(Result::CannotOpenFile);
+  }
+  file_size = static_cast<uint64_t>(large_size.QuadPart);
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  granularity = info.dwAllocationGranularity;
+#else
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ZNET_LOG_WARN("Cannot open {} to send it.", path);
+    return fail(Result::CannotOpenFile);
+  }
+  file->fd_ = fd;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    // sendfile() and mmap() both want a regular file; a pipe or a device
+    // has no size to promise the receiver up front
+    ZNET_LOG_WARN("{} is not a regular file, cannot send it.", path);
+    return fail(Result::CannotOpenFile);
+  }
+  file_size = static_cast<uint64_t>(info.st_size);
+  granularity = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+  if (offset > file_size) {
+    return fail(Result::InvalidArgument);
+  }
+  file->offset_ = offset;
+  file->size_ = std::min(length, file_size - offset);
+  if (file->size_ == 0) {
+    if (out_result != nullptr) {
+      *out_result = Result::Success;
+    }
+    return file;
+  }
+  // a mapping starts on a boundary, so it reaches back to the one before
+  // `offset` and data() skips the difference
+  const uint64_t start = offset - offset % granularity;
+  const uint64_t span = offset - start + file->size_;
+  if (span > std::numeric_limits<size_t>::max()) {
+    ZNET_LOG_WARN("{} bytes of {} do not fit the address space.", span, path);
+    return fail(Result::InvalidArgument);
+  }
+  file->view_size_ = static_cast<size_t>(span);
+#ifdef ZNET_TARGET_WIN
+  HANDLE mapping =
+      CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    ZNET_LOG_WARN("Cannot map {}.", path);
+    return fail(Result::CannotOpenFile);
+  }
+  file->mapping_handle_ = mapping;
+  file->view_ = MapViewOfFile(mapping, FILE_MAP_READ,
+                              static_cast<DWORD>(start >> 32),
+                              static_cast<DWORD>(start & 0xFFFFFFFFu),
+                              file->view_size_);
+  if (file->view_ == nullptr) {
+    ZNET_LOG_WARN("Cannot map {}.", path);
+    return fail(Result::CannotOpenFile);
+  }
+#else
+  void* view = mmap(nullptr, file->view_size_, PROT_READ, MAP_SHARED, fd,
+                    static_cast<off_t>(start));
+  if (view == MAP_FAILED) {
+    ZNET_LOG_WARN("Cannot map {}.", path);
+    return fail(Result::CannotOpenFile);
+  }
+  file->view_ = view;
+#if defined(POSIX_MADV_SEQUENTIAL)
+  // read front to back exactly once, so the kernel may read ahead and drop
+  // pages behind
+  posix_madvise(view, file->view_size_, POSIX_MADV_SEQUENTIAL);
+#endif
+#endif
+  file->data_ = static_cast<const char*>(file->view_) + (offset - start);
+  if (out_result != nullptr) {
+    *out_result = Result::Success;
+  }
+  return file;
+}
+
+MappedFile::~MappedFile() {
+#ifdef ZNET_TARGET_WIN
+  if (view_ != nullptr) {
+    UnmapViewOfFile(view_);
+  }
+  if (mapping_handle_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(mapping_handle_));
+  }
+  if (file_handle_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(file_handle_));
+  }
+#else
+  if (view_ != nullptr) {
+    munmap(view_, view_size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+#endif
+}
+
+}  // namespace detail
+}  // namespace znet
@@ -18,20 +18,74 @@ namespace znet {
 std::shared_ptr<Buffer> MessagePipeline::Encode(
     const std::shared_ptr<Packet>& packet, uint8_t stream,
     size_t* out_payload_bytes) {
-  if (!codec_) {
+  auto buffer = Prepare(packet, out_payload_bytes);
+  if (!buffer) {
+    return nullptr;
+  }
+  return Seal(std::move(buffer), stream);
+}
+
+std::shared_ptr<Buffer> MessagePipeline::Prepare(
+    const std::shared_ptr<Packet>& packet, size_t* out_payload_bytes) {
+  Codec* codec = codec_view_.load(std::memory_order_acquire);
+  if (codec == nullptr) {
     ZNET_LOG_WARN("Session {} has no codec, dropping packet!", id_);
     return nullptr;
   }
-  auto buffer = codec_->Serialize(packet, kSendHeadroom);
+  auto buffer = codec->Serialize(packet, kSendHeadroom);
   if (!buffer) {
     return nullptr;
   }
   if (out_payload_bytes != nullptr) {
     *out_payload_bytes = buffer->readable_bytes();
   }
+  return Compress(std::move(buffer));
+}
+
+std::shared_ptr<Buffer> MessagePipeline::PrepareHead(
+    const std::shared_ptr<Packet>& packet, size_t trailing_bytes,
+    size_t* out_payload_bytes) {
+  Codec* codec = codec_view_.load(std::memory_order_acquire);
+  if (codec == nullptr) {
+    ZNET_LOG_WARN("Session {} has no codec, dropping packet!", id_);
+    return nullptr;
+  }
+  auto buffer = std::make_shared<Buffer>();
+  buffer->ReserveHeadroom(kSendHeadroom);
+  if (!codec->SerializeInto(packet, buffer, trailing_bytes)) {
+    return nullptr;
+  }
+  if (out_payload_bytes != nullptr) {
+    *out_payload_bytes = buffer->readable_bytes() + trailing_bytes;
+  }
+  // still marked, so the receiver's decompression stage passes it through
+  return compr::HandleOutWithType(CompressionType::None, std::move(buffer));
+}
+
+bool MessagePipeline::Append(const std::shared_ptr<Packet>& packet,
+                             const std::shared_ptr<Buffer>& batch,
+                             size_t* out_payload_bytes) {
+  Codec* codec = codec_view_.load(std::memory_order_acquire);
+  if (codec == nullptr) {
+    ZNET_LOG_WARN("Session {} has no codec, dropping packet!", id_);
+    return false;
+  }
+  const size_t before = batch->readable_bytes();
+  if (!codec->SerializeInto(packet, batch)) {
+    return false;
+  }
+  if (out_payload_bytes != nullptr) {
+    *out_payload_bytes = batch->readable_bytes() - before;
+  }
+  return true;
+}
+
+std::shared_ptr<Buffer> MessagePipeline::Compress(
+    std::shared_ptr<Buffer> buffer) {
   // small messages skip compression: the coder tables cost more than they can
   // ever save back.
-  CompressionType compression = out_compression_;
+  // read once, so a concurrent SetOutCompression() cannot change it midway
+  CompressionType compression = out_compression();
   if (buffer->readable_bytes() < compression_threshold_) {
     compression = CompressionType::None;
   }
@@ -40,7 +94,13 @@ std::shared_ptr<Buffer> MessagePipeline::Encode(
     ZNET_LOG_ERROR("Session {} compression failed, dropping packet!", id_);
     return nullptr;
   }
-  buffer = encryption_.HandleOut(std::move(buffer), stream);
+  return buffer;
+}
+
+std::shared_ptr<Buffer> MessagePipeline::Seal(std::shared_ptr<Buffer> buffer,
+                                              uint8_t stream, const char* tail,
+                                              size_t tail_size) {
+  buffer = encryption_.HandleOut(std::move(buffer), stream, tail, tail_size);
   if (!buffer) {
     ZNET_LOG_ERROR("Session {} encryption failed, dropping packet!", id_);
     return nullptr;
@@ -65,7 +125,8 @@ std::shared_ptr<Buffer> MessagePipeline::Decode(
 
 DecodeStats MessagePipeline::Dispatch(const std::shared_ptr<Buffer>& payload,
                                       PacketHandlerBase& handler) {
-  return codec_->Deserialize(payload, handler, dump_on_decode_failure_);
+  return codec_view_.load(std::memory_order_acquire)
+      ->Deserialize(payload, handler, dump_on_decode_failure_);
 }
 
 }  // namespace znet
@@ -12,8 +12,10 @@
 #include "znet/scheduler.h"
 #include "znet/error.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <iterator>
 #include <utility>
 
 namespace znet {
@@ -28,6 +30,21 @@ SessionId NextSessionId() {
   return counter.fetch_add(1, std::memory_order_relaxed);
 }
 
+// what a file chunk's message carries besides its bytes: the compression and
+// encryption markers, the codec's frame header and the chunk's own fields, all
+// at their longest
+constexpr size_t kFileChunkOverhead = 48;
+
+// a stream chunk pointing into a mapped file, which the drain sends from
+// the mapping rather than through the codec's buffer
+StreamChunkPacket* AsFileChunk(const std::shared_ptr<Packet>& packet) {
+  if (!packet || packet->id() != StreamChunkPacket::GetPacketId()) {
+    return nullptr;
+  }
+  auto* chunk = dynamic_cast<StreamChunkPacket*>(packet.get());
+  return chunk != nullptr && chunk->file ? chunk : nullptr;
+}
+
 }  // namespace
 
 PeerSession::PeerSession(std::shared_ptr<InetAddress> local_address,
@@ -58,6 +75,7 @@ PeerSession::PeerSession(std::shared_ptr<InetAddress> local_address,
       is_initiator ? CompressionType::None
                    : ResolveCompressionType(options_.common.compression);
   encryption_layer_.Initialize(is_initiator, options_.common.encryption);
+  stream_link_->session = this;
   if (self_managed) {
     task_.Run([this]() {
       while (IsAlive() && !task_.IsStopRequested()) {
@@ -72,6 +90,12 @@ PeerSession::PeerSession(std::shared_ptr<InetAddress> local_address,
 }
 
 PeerSession::~PeerSession() {
+  // first, so a writer on another thread is either finished with this
+  // session or finds it gone
+  {
+    std::lock_guard<std::mutex> lock(stream_link_->mutex);
+    stream_link_->session = nullptr;
+  }
   Close();
   // A self-managed session runs Process() on task_, which touches almost every
   // member declared after it. Leaving the join to ~Task would run it once those
@@ -82,16 +106,51 @@ PeerSession::~PeerSession() {
 }
 
 bool PeerSession::Process() {
+  return Process(std::chrono::nanoseconds::zero(), nullptr);
+}
+
+bool PeerSession::Process(std::chrono::nanoseconds budget, bool* out_cut_short) {
+  if (out_cut_short != nullptr) {
+    *out_cut_short = false;
+  }
   if (!IsAlive()) {
+    // so a file cut off by the close still reports it
+    PumpFiles();
     return false;
   }
   transport_layer_->Update();
   bool worked = false;
   // drain what is already buffered rather than one message per tick, otherwise
-  // throughput is capped at the caller's tick rate. The bound keeps one busy
-  // session from starving the others sharing this worker.
+  // throughput is capped at the caller's tick rate. The bound, a message
+  // count or the caller's time budget, keeps one busy session from starving
+  // the others sharing this worker.
+  const bool timed = budget > std::chrono::nanoseconds::zero();
+  const auto started = timed ? std::chrono::steady_clock::now()
+                             : std::chrono::steady_clock::time_point{};
+  bool delivering = true;
+  if (!held_.empty() && pipeline_.has_codec()) {
+    // what came in before the connect event installed a codec goes first
+    worked = true;
+    std::vector<std::shared_ptr<Buffer>> held;
+    held.swap(held_);
+    for (auto& message : held) {
+      if (!Deliver(message)) {
+        delivering = false;
+        break;
+      }
+    }
+  }
   std::shared_ptr<Buffer> buffer;
-  for (uint32_t i = 0; i < kMaxReceivesPerProcess; i++) {
+  for (uint32_t i = 0; delivering && (timed || i < kMaxReceivesPerProcess);
+       i++) {
+    if (timed && i > 0 &&
+        std::chrono::steady_clock::now() - started >= budget) {
+      if (out_cut_short != nullptr) {
+        *out_cut_short = true;
+      }
+      worked = true;
+      break;
+    }
     buffer = transport_layer_->Receive();
     if (!buffer) {
       break;
@@ -102,25 +161,31 @@ bool PeerSession::Process() {
     if (!buffer) {
       continue;
     }
-    if (handler_ && pipeline_.has_codec()) {
-      ZNET_METRIC(metrics_.common.messages_received++);
-      ZNET_METRIC(metrics_.common.payload_bytes_received += buffer->readable_bytes());
-      DecodeStats stats = pipeline_.Dispatch(buffer, *handler_);
-      if (stats.invalid_frames > 0) {
-        invalid_frames_ += stats.invalid_frames;
-        ZNET_METRIC(metrics_.common.invalid_frames += stats.invalid_frames);
-        const uint32_t limit = options_.common.max_invalid_frames;
-        if (limit != 0 && invalid_frames_ >= limit) {
-          ZNET_LOG_WARN("Session {} reached {} undecodable frames, closing.",
-                        id_, invalid_frames_);
-          CloseOptions close_options;
-          close_options.Set<NoLingerKey>(true);
-          Close(close_options);
-          break;
-        }
+    if (!pipeline_.has_codec()) {
+      // between the handshake's codec and the application's: the peer is
+      // ready and talking, the connect event has yet to run
+      if (held_.size() < kMaxHeldMessages) {
+        held_.push_back(std::move(buffer));
+      } else {
+        ZNET_LOG_DEBUG("Session {} has no codec and {} messages held already, "
+                       "dropping one.", id_, held_.size());
+      }
+      continue;
+    }
+    if (!Deliver(buffer)) {
+      break;
+    }
+  }
+  if (grants_pending_ && IsAlive()) {
+    grants_pending_ = false;
+    for (auto& entry : inbound_streams_) {
+      if (entry.second.grant_pending) {
+        MaybeGrant(entry.first, entry.second);
       }
     }
   }
+  // after the receive loop, which is where a peer's credit arrives
+  PumpFiles();
   // handlers above almost always answer, and Update() already ran, so without
   // this their replies would wait out a tick and every round trip would cost
   // two. A dead session drains anyway, to release what it queued rather than
@@ -134,11 +199,55 @@ bool PeerSession::Process() {
   return worked;
 }
 
+bool PeerSession::Deliver(const std::shared_ptr<Buffer>& buffer) {
+  // no handler is no reason to skip: the stream messages are the session's
+  // own. The counters still mean what reached a handler.
+  if (handler_) {
+    ZNET_METRIC(metrics_.common.messages_received++);
+    ZNET_METRIC(metrics_.common.payload_bytes_received += buffer->readable_bytes());
+  }
+  DecodeStats stats = pipeline_.Dispatch(buffer, dispatcher_);
+  if (stats.invalid_frames > 0) {
+    invalid_frames_ += stats.invalid_frames;
+    ZNET_METRIC(metrics_.common.invalid_frames += stats.invalid_frames);
+    const uint32_t limit = options_.common.max_invalid_frames;
+    if (limit != 0 && invalid_frames_ >= limit) {
+      ZNET_LOG_WARN("Session {} reached {} undecodable frames, closing.",
+                    id_, invalid_frames_);
+      CloseOptions close_options;
+      close_options.Set<NoLingerKey>(true);
+      Close(close_options);
+      return false;
+    }
+  }
+  return true;
+}
+
 Result PeerSession::Close(CloseOptions options) {
   if (!transport_layer_) {
     return Result::InvalidTransport;
   }
-  return transport_layer_->Close(options);
+  const Result result = transport_layer_->Close(options);
+  // a worker leaving this session alone would otherwise never see it die
+  NotifyReady();
+  return result;
+}
+
+bool PeerSession::SetReadyCallback(std::function<void()> ready) {
+  ready_ = ready;
+  return transport_layer_ &&
+         transport_layer_->SetReadyCallback(std::move(ready));
+}
+
+std::chrono::steady_clock::time_point PeerSession::NextDeadline() {
+  using TimePoint = std::chrono::steady_clock::time_point;
+  // a transfer writes as its window allows and a grant retries until it
+  // goes out, neither of which anything announces
+  if (!transport_layer_ || !IsAlive() || outbound_.size() != 0 ||
+      grants_pending_ || has_files_.load(std::memory_order_acquire)) {
+    return TimePoint::min();
+  }
+  return transport_layer_->NextDeadline();
 }
 
 bool PeerSession::IsAlive() const {
@@ -161,24 +270,108 @@ void PeerSession::Ready() {
 
 bool PeerSession::EncodeAndSend(const std::shared_ptr<Packet>& packet,
                                 SendOptions options) {
+  size_t payload_bytes = 0;
+  auto buffer = pipeline_.Prepare(packet, &payload_bytes);
+  if (!buffer) {
+    return false;
+  }
+  return SealAndSend(std::move(buffer), payload_bytes, options);
+}
+
+bool PeerSession::SealAndSend(std::shared_ptr<Buffer> buffer,
+                              size_t payload_bytes, SendOptions options,
+                              uint32_t messages) {
   // the transport decides what "in order relative to each other" means for
   // these options, and the cipher's sequence has to be scoped the same way
-  size_t payload_bytes = 0;
-  auto buffer = pipeline_.Encode(
-      packet, transport_layer_->OrderingDomain(options), &payload_bytes);
+  buffer = pipeline_.Seal(std::move(buffer),
+                          transport_layer_->OrderingDomain(options));
   if (!buffer) {
     return false;
   }
   ZNET_METRIC(metrics_.common.payload_bytes_sent += payload_bytes);
   ZNET_METRIC(metrics_.common.message_bytes_sent += buffer->readable_bytes());
   if (!transport_layer_->Send(buffer, options)) {
-    ZNET_METRIC(metrics_.common.send_failures++);
+    ZNET_METRIC(metrics_.common.send_failures += messages);
     return false;
   }
-  ZNET_METRIC(metrics_.common.messages_sent++);
+  ZNET_METRIC(metrics_.common.messages_sent += messages);
+  if (messages > 1) {
+    ZNET_METRIC(metrics_.common.coalesced_messages += messages);
+  }
+  return true;
+}
+
+bool PeerSession::Coalesce(const OutboundQueue::Item& item) {
+  size_t limit = transport_layer_->CoalesceLimit();
+  if (options_.common.coalesce_max_bytes < limit) {
+    limit = options_.common.coalesce_max_bytes;
+  }
+  // prepared bytes are compressed already, and two compressed payloads cannot
+  // share one compression header
+  if (limit == 0 || item.prepared) {
+    return false;
+  }
+  const uint8_t stream = transport_layer_->OrderingDomain(item.options);
+  const auto now = std::chrono::steady_clock::now();
+  const auto max_delay = options_.common.coalesce_max_delay;
+  if (batch_.messages > 0 &&
+      (batch_.stream != stream ||
+       (max_delay.count() > 0 && now - batch_.opened >= max_delay))) {
+    SealBatch();
+  }
+  if (!batch_.buffer) {
+    // sized for the cap up front, so packing never reallocates
+    batch_.buffer = std::make_shared<Buffer>();
+    batch_.buffer->ReserveHeadroom(MessagePipeline::kSendHeadroom);
+    batch_.buffer->ReserveExact(MessagePipeline::kSendHeadroom + limit);
+    batch_.stream = stream;
+    batch_.options = item.options;
+    batch_.opened = now;
+  }
+  const size_t frame_start = batch_.buffer->write_cursor();
+  size_t payload_bytes = 0;
+  if (!pipeline_.Append(item.packet, batch_.buffer, &payload_bytes)) {
+    return true;  // logged and dropped, as EncodeAndSend() would have
+  }
+  if (batch_.messages > 0 && batch_.buffer->readable_bytes() > limit) {
+    // it does not fit behind the others, and the cap is what keeps a packed
+    // message inside the transport's frame, so it opens the next batch. Only
+    // this packet's bytes are copied, which beats serializing it twice.
+    auto next = std::make_shared<Buffer>();
+    next->ReserveHeadroom(MessagePipeline::kSendHeadroom);
+    next->ReserveExact(MessagePipeline::kSendHeadroom +
+                       std::max(limit, payload_bytes));
+    next->Write(batch_.buffer->data() + frame_start, payload_bytes);
+    batch_.buffer->set_write_cursor(frame_start);
+    SealBatch();
+    batch_.buffer = std::move(next);
+    batch_.stream = stream;
+    batch_.options = item.options;
+    // not `now`: sealing the last batch is not time this packet spent waiting
+    batch_.opened = std::chrono::steady_clock::now();
+  }
+  batch_.messages++;
+  batch_.payload_bytes += payload_bytes;
+  if (batch_.buffer->readable_bytes() >= limit) {
+    SealBatch();
+  }
   return true;
 }
 
+void PeerSession::SealBatch() {
+  Batch batch;
+  std::swap(batch, batch_);
+  if (batch.messages == 0) {
+    return;
+  }
+  auto buffer = pipeline_.Compress(std::move(batch.buffer));
+  if (!buffer) {
+    return;
+  }
+  SealAndSend(std::move(buffer), batch.payload_bytes, batch.options,
+              batch.messages);
+}
+
 bool PeerSession::SendImmediate(std::shared_ptr<Packet> packet,
                                 SendOptions options) {
   if (!packet || !IsAlive()) {
@@ -206,9 +399,21 @@ Result PeerSession::SendPacket(std::shared_ptr<Packet> packet,
   if (!IsReady()) {
     return Result::NotReady;
   }
+  OutboundQueue::Item item{std::move(packet), options, nullptr, 0};
+  // a file's chunk is left whole: preparing it here would copy the file's
+  // bytes out of the mapping, which is what the drain avoids
+  if (options_.common.encode_on_send && !AsFileChunk(item.packet)) {
+    // the caller's thread pays for the codec and compression instead of the
+    // worker; see CommonOptions::encode_on_send. Only the bytes are queued.
+    item.prepared = pipeline_.Prepare(item.packet, &item.payload_bytes);
+    if (!item.prepared) {
+      return Result::Failure;
+    }
+    item.packet = nullptr;
+  }
   // no lock, no allocation and no encoding below: this runs on the
   // application's thread and must not block on a worker.
-  if (!outbound_.Push(std::move(packet), options)) {
+  if (!outbound_.Push(std::move(item))) {
     // debug, not a warning: nothing was lost and the caller has been told to
     // try again, so a caller pushing against a full queue would otherwise turn
     // its own backpressure into a log flood.
@@ -219,15 +424,353 @@ Result PeerSession::SendPacket(std::shared_ptr<Packet> packet,
   return Result::Success;
 }
 
+Result PeerSession::SendPackets(const OutgoingPacket* packets, size_t count,
+                                size_t* out_accepted) {
+  if (out_accepted != nullptr) {
+    *out_accepted = 0;
+  }
+  if (count == 0) {
+    return Result::Success;
+  }
+  if (packets == nullptr) {
+    return Result::InvalidArgument;
+  }
+  // checked up front, so a bad entry cannot leave half a batch queued
+  for (size_t i = 0; i < count; i++) {
+    if (!packets[i].packet) {
+      return Result::InvalidArgument;
+    }
+  }
+  if (!IsAlive()) {
+    return Result::NotConnected;
+  }
+  if (!IsReady()) {
+    return Result::NotReady;
+  }
+  Result result = Result::Success;
+  size_t accepted = 0;
+  if (options_.common.encode_on_send) {
+    // prepared before the reservation rather than inside it: the consumer
+    // cannot pass a claimed slot until it is filled, so serializing there
+    // would stall the drain behind this thread
+    std::vector<OutboundQueue::Item> items;
+    items.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      OutboundQueue::Item item{nullptr, packets[i].options, nullptr, 0};
+      item.prepared = pipeline_.Prepare(packets[i].packet, &item.payload_bytes);
+      if (!item.prepared) {
+        result = Result::Failure;
+        break;
+      }
+      items.push_back(std::move(item));
+    }
+    accepted = outbound_.PushBatch(
+        items.size(), [&items](size_t i) { return std::move(items[i]); });
+    if (accepted < items.size()) {
+      result = Result::QueueFull;
+    }
+  } else {
+    accepted = outbound_.PushBatch(count, [packets](size_t i) {
+      return OutboundQueue::Item{packets[i].packet, packets[i].options, nullptr,
+                                 0};
+    });
+    if (accepted < count) {
+      result = Result::QueueFull;
+    }
+  }
+  if (result == Result::QueueFull) {
+    // debug for the same reason as in SendPacket()
+    ZNET_LOG_DEBUG("Session {} outbound queue is full ({}), accepted {} of {}.",
+                   id_, outbound_.capacity(), accepted, count);
+  }
+  if (out_accepted != nullptr) {
+    *out_accepted = accepted;
+  }
+  return result;
+}
+
 bool PeerSession::DrainOutbound() {
-  return outbound_.Drain([this](OutboundQueue::Item& item) {
-    if (!IsAlive()) {
-      return false;  // keep draining, so a dead session releases what it holds
+  return outbound_.Drain(
+      [this](OutboundQueue::Item& item) {
+        if (!IsAlive()) {
+          // keep draining, so a dead session releases what it holds
+          return false;
+        }
+        if (StreamChunkPacket* chunk = AsFileChunk(item.packet)) {
+          SealBatch();
+          SendFileChunk(item.packet, *chunk, item.options);
+          return true;
+        }
+        if (Coalesce(item)) {
+          return true;
+        }
+        // whatever is packed so far was queued first, so it goes first
+        SealBatch();
+        if (item.prepared) {
+          SealAndSend(std::move(item.prepared), item.payload_bytes,
+                      item.options);
+        } else {
+          EncodeAndSend(item.packet, item.options);
+        }
+        return true;
+      },
+      [this]() {
+        // nothing is held past the drain: a lone message is not kept waiting
+        // for company, and the claim is about to go to whoever takes it next
+        if (!IsAlive()) {
+          batch_ = Batch();
+          return;
+        }
+        SealBatch();
+        // Process() flushes after a worker's drain anyway, but a dedicated
+        // encoder's would otherwise wait out the worker's next pass
+        if (transport_layer_->FlushIsThreadSafe()) {
+          transport_layer_->Flush();
+        }
+      });
+}
+
+bool PeerSession::SendFileChunk(const std::shared_ptr<Packet>& packet,
+                                StreamChunkPacket& chunk, SendOptions options) {
+  if (pipeline_.out_compression() != CompressionType::None) {
+    // the compressor reads the message in one piece, so it is gathered
+    // after all
+    return EncodeAndSend(packet, options);
+  }
+  const size_t body = chunk.body_size();
+  chunk.body_follows = true;
+  size_t payload_bytes = 0;
+  auto head = pipeline_.PrepareHead(packet, body, &payload_bytes);
+  if (!head) {
+    return false;
+  }
+  const uint8_t stream = transport_layer_->OrderingDomain(options);
+  bool sent;
+  if (encryption_layer_.encrypts()) {
+    // the cipher reads the file's bytes where they are mapped and writes
+    // them out encrypted; that is the only copy they get
+    head = pipeline_.Seal(std::move(head), stream, chunk.body(), body);
+    if (!head) {
+      return false;
+    }
+    ZNET_METRIC(metrics_.common.message_bytes_sent += head->readable_bytes());
+    sent = transport_layer_->Send(head, options);
+  } else {
+    head = pipeline_.Seal(std::move(head), stream);
+    if (!head) {
+      return false;
+    }
+    ZNET_METRIC(metrics_.common.message_bytes_sent +=
+                head->readable_bytes() + body);
+    sent = transport_layer_->SendFile(std::move(head), chunk.file,
+                                      chunk.file_position, body, options);
+  }
+  ZNET_METRIC(metrics_.common.payload_bytes_sent += payload_bytes);
+  if (!sent) {
+    ZNET_METRIC(metrics_.common.send_failures++);
+    return false;
+  }
+  ZNET_METRIC(metrics_.common.messages_sent++);
+  return true;
+}
+
+Result PeerSession::SendFile(const std::string& path, uint64_t offset,
+                             uint64_t length, EventCallbackFn on_event,
+                             StreamId* out_stream) {
+  if (!IsAlive()) {
+    return Result::NotConnected;
+  }
+  if (!IsReady()) {
+    return Result::NotReady;
+  }
+  Result result = Result::Success;
+  auto file = detail::MappedFile::Open(path, offset, length, &result);
+  if (!file) {
+    return result;
+  }
+  size_t chunk_bytes = options_.stream.chunk_bytes;
+  const size_t frame = transport_layer_->FileFrameLimit();
+  // both read off the worker, which is safe: whether the session encrypts is
+  // settled by the handshake and never changes once IsReady() published it,
+  // and the compression type is an atomic snapshot. It only sizes the
+  // chunks; SendFileChunk() checks it again for each one as it goes out.
+  if (frame > kFileChunkOverhead && !encryption_layer_.encrypts() &&
+      pipeline_.out_compression() == CompressionType::None) {
+    // one chunk to a message the transport can hand to the kernel whole;
+    // otherwise it would copy them after all
+    chunk_bytes = std::min(chunk_bytes, frame - kFileChunkOverhead);
+  }
+  auto transfer = std::make_unique<detail::FileTransfer>(
+      std::move(file), OpenStream(0, chunk_bytes), std::move(on_event));
+  if (out_stream != nullptr) {
+    *out_stream = transfer->stream_id();
+  }
+  // the first window goes now, from this thread, so the worker wakes to
+  // chunks already queued; the events all come from the worker
+  transfer->Write();
+  {
+    std::lock_guard<std::mutex> lock(files_mutex_);
+    files_.push_back(std::move(transfer));
+  }
+  has_files_.store(true, std::memory_order_release);
+  NotifyReady();
+  return Result::Success;
+}
+
+void PeerSession::PumpFiles() {
+  if (!has_files_.load(std::memory_order_acquire)) {
+    return;
+  }
+  // taken out to run, so an event callback may start another transfer
+  std::vector<std::unique_ptr<detail::FileTransfer>> files;
+  {
+    std::lock_guard<std::mutex> lock(files_mutex_);
+    files.swap(files_);
+  }
+  const bool alive = IsAlive();
+  auto done = [alive](const std::unique_ptr<detail::FileTransfer>& file) {
+    return file->Pump(alive);
+  };
+  files.erase(std::remove_if(files.begin(), files.end(), done), files.end());
+  std::lock_guard<std::mutex> lock(files_mutex_);
+  files_.insert(files_.begin(), std::make_move_iterator(files.begin()),
+                std::make_move_iterator(files.end()));
+  has_files_.store(!files_.empty(), std::memory_order_release);
+}
+
+std::shared_ptr<StreamWriter> PeerSession::OpenStream(uint8_t channel) {
+  return OpenStream(channel, options_.stream.chunk_bytes);
+}
+
+std::shared_ptr<StreamWriter> PeerSession::OpenStream(uint8_t channel,
+                                                      size_t chunk_bytes) {
+  chunk_bytes = std::max<size_t>(1, std::min(chunk_bytes, kStreamMaxChunkBytes));
+  std::lock_guard<std::mutex> lock(stream_link_->mutex);
+  const StreamId id = stream_link_->next_id++;
+  auto writer =
+      std::make_shared<StreamWriter>(stream_link_, id, channel, chunk_bytes);
+  stream_link_->writers[id] = writer;
+  return writer;
+}
+
+void PeerSession::Dispatcher::Handle(std::shared_ptr<Packet> packet) {
+  // the id is only a hint: an application could register its own serializer
+  // under a reserved one, so the type decides
+  const PacketId id = packet->id();
+  if (id == StreamChunkPacket::GetPacketId()) {
+    if (auto* chunk = dynamic_cast<const StreamChunkPacket*>(packet.get())) {
+      session_.OnStreamChunk(*chunk);
+      return;
+    }
+  } else if (id == StreamCreditPacket::GetPacketId()) {
+    if (auto* credit = dynamic_cast<const StreamCreditPacket*>(packet.get())) {
+      session_.OnStreamCredit(*credit);
+      return;
+    }
+  }
+  if (session_.handler_) {
+    session_.handler_->Handle(std::move(packet));
+  }
+}
+
+void PeerSession::OnStreamChunk(const StreamChunkPacket& packet) {
+  auto it = inbound_streams_.find(packet.stream_id);
+  if (it == inbound_streams_.end()) {
+    if (packet.offset != 0) {
+      StreamViolation(packet.stream_id, "a chunk of a stream it never opened");
+      return;
+    }
+    if (inbound_streams_.size() >= options_.stream.max_inbound) {
+      StreamViolation(packet.stream_id, "more open streams than max_inbound");
+      return;
+    }
+    InboundStream stream;
+    stream.channel = packet.channel;
+    it = inbound_streams_.emplace(packet.stream_id, stream).first;
+  }
+  InboundStream& stream = it->second;
+  const uint64_t size = packet.data.size();
+  if (packet.offset != stream.next_offset) {
+    StreamViolation(packet.stream_id, "a chunk out of order");
+    return;
+  }
+  if (packet.offset + size > stream.granted) {
+    StreamViolation(packet.stream_id, "a chunk past its credit");
+    return;
+  }
+  stream.next_offset += size;
+  if (stream_callback_) {
+    StreamChunk chunk;
+    chunk.stream_id = packet.stream_id;
+    chunk.channel = stream.channel;
+    chunk.offset = packet.offset;
+    chunk.data = packet.data.data();
+    chunk.size = packet.data.size();
+    chunk.last = packet.last;
+    stream_callback_(chunk);
+  }
+  if (packet.last) {
+    inbound_streams_.erase(packet.stream_id);
+    return;
+  }
+  MaybeGrant(packet.stream_id, stream);
+}
+
+void PeerSession::MaybeGrant(StreamId id, InboundStream& stream) {
+  const uint64_t window =
+      std::max<uint64_t>(options_.stream.window_bytes, kStreamInitialCredit);
+  // half a window of hysteresis, so a grant goes out per half window consumed
+  // rather than per chunk
+  if (!stream.grant_pending && stream.granted - stream.next_offset > window / 2) {
+    return;
+  }
+  auto credit = std::make_shared<StreamCreditPacket>();
+  credit->stream_id = id;
+  credit->limit = stream.next_offset + window;
+  // on the stream's own channel: a grant overtaking the chunks it answers
+  // would be harmless, but one stuck behind another channel's backlog would not
+  const Result result =
+      SendPacket(credit, SendOptions().Channel(stream.channel));
+  if (result != Result::Success) {
+    // the sender may already be waiting on this, and no further chunk is
+    // coming to prompt another, so Process() retries it
+    stream.grant_pending = true;
+    grants_pending_ = true;
+    return;
+  }
+  stream.granted = credit->limit;
+  stream.grant_pending = false;
+}
+
+void PeerSession::OnStreamCredit(const StreamCreditPacket& packet) {
+  std::shared_ptr<StreamWriter> writer;
+  std::function<void()> on_writable;
+  {
+    std::lock_guard<std::mutex> lock(stream_link_->mutex);
+    auto it = stream_link_->writers.find(packet.stream_id);
+    if (it == stream_link_->writers.end()) {
+      return;  // finished and dropped since; nothing to do
     }
-    EncodeAndSend(item.packet, item.options);
-    return true;
-  });
+    writer = it->second.lock();
+    if (!writer) {
+      return;
+    }
+    on_writable = writer->on_writable_;
+  }
+  writer->Grant(packet.limit);
+  // outside the lock: it will usually write
+  if (on_writable) {
+    on_writable();
+  }
 }
 
+void PeerSession::StreamViolation(StreamId id, const char* what) {
+  ZNET_LOG_WARN("Session {} peer sent {} (stream {}), closing.", id_, what,
+                id);
+  inbound_streams_.clear();
+  CloseOptions close_options;
+  close_options.Set<NoLingerKey>(true);
+  Close(close_options);
+}
 
-}
\ No newline at end of file
+}
@@ -9,10 +9,46 @@
 //
 
 #include "znet/scheduler.h"
+#include "znet/detail/platform.h"
 
-#include <cmath>
+#include <algorithm>
 #include <thread>
 
+#if defined(ZNET_TARGET_WIN)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <time.h>
+#endif
+
+namespace {
+
+// CPU time the calling thread has used, for what a wait itself costs
+Scheduler::Duration ThreadCpuTime() {
+#if defined(ZNET_TARGET_WIN)
+  FILETIME created, exited, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) {
+    return Scheduler::Duration::zero();
+  }
+  auto ticks = [](const FILETIME& time) {
+    return (static_cast<uint64_t>(time.dwHighDateTime) << 32) |
+           time.dwLowDateTime;
+  };
+  // in 100 ns units
+  return Scheduler::Duration(
+      static_cast<Scheduler::Duration::rep>((ticks(kernel) + ticks(user)) / 10));
+#else
+  timespec now{};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+    return Scheduler::Duration::zero();
+  }
+  return std::chrono::duration_cast<Scheduler::Duration>(
+      std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec));
+#endif
+}
+
+}  // namespace
+
 Scheduler::Scheduler(uint16_t tps) {
   SetTicksPerSecond(tps);
 }
@@ -35,44 +71,61 @@ void Scheduler::End() {
 }
 
 void Scheduler::Wait() {
-  if (delta_time_ < target_delta_time_) {
-    auto sleep =
-        std::chrono::duration_cast<Duration>(target_delta_time_ - delta_time_);
-#if !ZNET_PREFER_STD_SLEEP
-    PreciseSleep(sleep);
+  // a tick that began within one period of the last deadline keeps to that
+  // deadline's grid, so the lateness of one wake is not carried into the
+  // next; one that began later than that overran, and starts a new grid
+  TimePoint anchor = start_time_;
+  if (start_time_ >= deadline_ && start_time_ - deadline_ < target_delta_time_) {
+    anchor = deadline_;
+  }
+  deadline_ = anchor + target_delta_time_;
+
+  if (!measure_) {
+    SleepUntil(deadline_, spin_budget_);
+    return;
+  }
+  stats_.ticks++;
+  const TimePoint before = Clock::now();
+  if (before >= deadline_) {
+    stats_.overruns++;
+    return;
+  }
+  const Duration cpu_before = ThreadCpuTime();
+  SleepUntil(deadline_, spin_budget_);
+  const TimePoint woke = Clock::now();
+  stats_.wait_cpu += ThreadCpuTime() - cpu_before;
+  stats_.waited += std::chrono::duration_cast<Duration>(woke - before);
+  const auto late = std::chrono::duration_cast<Duration>(woke - deadline_);
+  stats_.jitter_total += late;
+  stats_.jitter_max = std::max(stats_.jitter_max, late);
+}
+
+void Scheduler::SleepUntil(TimePoint deadline, Duration spin) {
+#if ZNET_PREFER_STD_SLEEP
+  spin = Duration::zero();
+#endif
+  const TimePoint wake = deadline - spin;
+  if (Clock::now() < wake) {
+#if defined(ZNET_TARGET_LINUX)
+    // steady_clock is CLOCK_MONOTONIC here, so its epoch is the kernel's
+    // and the deadline can be handed over as it is: one absolute sleep, with
+    // no rounding to whole milliseconds and no drift from re-arming
+    const auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        wake.time_since_epoch());
+    timespec until{};
+    until.tv_sec = static_cast<time_t>(since_epoch.count() / 1000000000);
+    until.tv_nsec = static_cast<long>(since_epoch.count() % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) ==
+           EINTR) {
+    }
 #else
-    std::this_thread::sleep_for(sleep);
+    std::this_thread::sleep_until(wake);
 #endif
   }
+  while (Clock::now() < deadline) {
+  }
 }
 
 void Scheduler::PreciseSleep(Duration duration) {
-  double estimate = 5e-3;
-  double mean = 5e-3;
-  double m2 = 0;
-  double count = 1;
-  double delta = 0;
-  double stddev = 0;
-
-  // microseconds to seconds
-  double seconds = static_cast<double>(duration.count()) / 1000000.0;
-  while (seconds > estimate) {
-    TimePoint start = Clock::now();
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    TimePoint end = Clock::now();
-
-    double observed = static_cast<double>((end - start).count()) / 1000000000.0;
-    seconds -= observed;
-
-    count++;
-    delta = observed - mean;
-    mean += delta / count;
-    m2 += delta * (observed - mean);
-    stddev = std::sqrt(m2 / (count - 1));
-    estimate = mean + stddev;
-  }
-
-  // spin lock
-  TimePoint start = Clock::now();
-  while (static_cast<double>((Clock::now() - start).count()) / 1000000000.0 < seconds);
+  SleepUntil(Clock::now() + duration, Duration(200));
 }
@@ -10,38 +10,192 @@
 
 #include "znet/server.h"
 #include "znet/backends/tcp.h"
+#include "znet/detail/platform.h"
 #include "znet/init.h"
 #include "znet/error.h"
 #include "znet/server_events.h"
 
+#include <algorithm>
+#include <unordered_map>
+
+#if defined(ZNET_TARGET_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace znet {
 
+namespace {
+
+// Keeps the calling worker on one CPU, so its sessions' state stays in that
+// core's caches. Failing leaves it where the OS put it, which still works.
+void PinThisThread(uint32_t cpu) {
+#if defined(ZNET_TARGET_LINUX)
+  if (cpu >= CPU_SETSIZE) {
+    ZNET_LOG_WARN("Cannot pin a worker to CPU {}: out of range.", cpu);
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (error != 0) {
+    ZNET_LOG_WARN("Cannot pin a worker to CPU {}: error {}.", cpu, error);
+  }
+#else
+  (void)cpu;
+#endif
+}
+
+}  // namespace
+
 
 Server::Server(const ServerConfig& config) : Interface(), config_(config) {
   bind_address_ = InetAddress::from(config_.bind_address, config_.bind_port);
+  scheduler_.SetSpinBudget(config_.options.tick_spin_budget);
+  scheduler_.SetMeasureWaits(config_.options.measure_ticks);
   backend_ = backends::CreateServerFromType(config.connection_type, bind_address_,
                                             config.child_options, config.options);
-  unsigned int core_count = std::thread::hardware_concurrency();
-  if (core_count == 0) {
-    core_count = 1;  // unknown, and an empty pool would refuse every connection
+  const WorkerOptions& workers = config_.options.workers;
+  if (config_.drive == DriveMode::Manual) {
+    // one worker, never started: Process() runs its passes on the caller's
+    // thread, and a wake meant for it makes the poller readable instead
+    poller_ = std::make_shared<ManualPoller>();
+    manual_ = std::make_unique<WorkerState>();
+    tasks_.push_back(std::make_unique<TaskData>());
+    std::shared_ptr<ManualPoller> poller = poller_;
+    tasks_.back()->signal_->on_raise = [poller]() { poller->Wake(); };
+    last_busy_ns_.assign(1, 0);
+    return;
   }
-  tasks_.reserve(core_count);
-  for (uint32_t i = 0; i < core_count; i++) {
+  uint32_t count = workers.count;
+  if (count == 0) {
+    count = workers.cpus.empty()
+                ? std::thread::hardware_concurrency()
+                : static_cast<uint32_t>(workers.cpus.size());
+  }
+  if (count == 0) {
+    count = 1;  // unknown, and an empty pool would refuse every connection
+  }
+#if !defined(ZNET_TARGET_LINUX)
+  if (!workers.cpus.empty()) {
+    ZNET_LOG_WARN("Worker CPU pinning is Linux only; workers stay unpinned.");
+  }
+#endif
+  tasks_.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
     tasks_.push_back(std::make_unique<TaskData>());
     TaskData& data = *tasks_.back();
-    data.task_ = std::make_unique<Task>();
-    data.task_->Run([this, &data]() { WorkerLoop(data); });
+    if (backend_) {
+      data.io_ = backend_->CreateWorkerIo();
+    }
+    if (data.io_) {
+      // the worker sleeps in the I/O, where a notify on its cv goes unheard
+      std::shared_ptr<WorkerIo> io = data.io_;
+      data.signal_->on_raise = [io]() { io->Wake(); };
+    }
+    if (!workers.cpus.empty()) {
+      data.pinned_ = true;
+      data.cpu_ = workers.cpus[i % workers.cpus.size()];
+    }
+    if (!workers.elastic) {
+      StartWorker(data);
+    }
   }
+  can_rebalance_ = std::none_of(
+      tasks_.begin(), tasks_.end(),
+      [](const std::unique_ptr<TaskData>& data) { return data->io_ != nullptr; });
+  last_busy_ns_.assign(tasks_.size(), 0);
 }
 
+void Server::StartWorker(TaskData& data) {
+  data.task_ = std::make_unique<Task>();
+  data.task_->Run([this, &data]() {
+    if (data.pinned_) {
+      PinThisThread(data.cpu_);
+    }
+    WorkerLoop(data);
+  });
+}
+
+void Server::SessionSet::Hand(std::shared_ptr<PeerSession> session,
+                              std::shared_ptr<Scheduled> entry) {
+  // counted before it is queued, so a worker that sees it queued and then
+  // erases it never takes the count below what the map holds
+  count_.fetch_add(1, std::memory_order_relaxed);
+  Arrival arrival{std::move(session), std::move(entry)};
+  if (inbox_.Push(arrival)) {
+    return;
+  }
+  // full: the one path that locks, and it waits only on another producer
+  // or on the owner's swap below, never on a tick
+  std::lock_guard<std::mutex> lock(overflow_mutex_);
+  overflow_.push_back(std::move(arrival));
+  overflowed_.store(true, std::memory_order_release);
+}
+
+void Server::SessionSet::Drain(std::vector<std::shared_ptr<Scheduled>>& arrived) {
+  auto take = [&](Arrival& arrival) {
+    arrival.entry->slot = sessions_.Insert(std::move(arrival.session));
+    arrived.push_back(std::move(arrival.entry));
+  };
+  Arrival arrival;
+  while (inbox_.Pop(arrival)) {
+    take(arrival);
+  }
+  if (overflowed_.exchange(false, std::memory_order_acquire)) {
+    std::vector<Arrival> overflow;
+    {
+      std::lock_guard<std::mutex> lock(overflow_mutex_);
+      overflow.swap(overflow_);
+    }
+    for (auto& item : overflow) {
+      take(item);
+    }
+  }
+}
+
+void Server::SessionSet::Erase(Scheduled& entry) {
+  if (sessions_.Erase(entry.slot)) {
+    count_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  entry.slot = SessionSlots::kNullKey;
+}
+
+// The worker's own schedule, touched by no other thread: the deadline of
+// every session waiting on one, the sessions taken on, and those driven every
+// tick because nothing else would tell the worker about them.
+struct Server::WorkerState {
+  detail::TimerWheel timers;
+  std::unordered_map<Scheduled*, std::shared_ptr<Scheduled>> owned;
+  std::vector<std::shared_ptr<Scheduled>> polled;
+  // what one pass runs, and what it found still busy for the next
+  std::vector<std::shared_ptr<Scheduled>> batch;
+  std::vector<std::shared_ptr<Scheduled>> again;
+  uint64_t pass = 0;
+  // when the sessions' cost window last turned over
+  std::chrono::steady_clock::time_point window =
+      std::chrono::steady_clock::now();
+};
+
 void Server::WorkerLoop(TaskData& data) {
   WorkerSignal& signal = *data.signal_;
   signal.owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  WorkerState state;
 
   while (!data.task_->IsStopRequested()) {
     // nothing to drive yet: sleep until a session is handed over, with no
     // deadline, since no tick is owed on an empty worker
-    if (data.sessions_.count() == 0 || !backend_->IsAlive()) {
+    if (data.io_) {
+      // still in the I/O, so the sockets of sessions that just left are
+      // finished off rather than held until the next one arrives
+      while (data.sessions_.count() == 0 && !data.task_->IsStopRequested()) {
+        data.io_->Poll(std::chrono::seconds(1));
+      }
+      if (data.task_->IsStopRequested()) {
+        break;
+      }
+    } else if (data.sessions_.count() == 0 || !backend_->IsAlive()) {
       std::unique_lock<std::mutex> lock(signal.mutex);
       signal.cv.wait(lock, [&]() {
         return data.sessions_.count() != 0 || data.task_->IsStopRequested();
@@ -51,20 +205,17 @@ void Server::WorkerLoop(TaskData& data) {
       }
     }
 
-    // per-task scheduler: Scheduler holds tick state, so workers cannot share
-    // one instance.
-    data.scheduler_.Start();
-    data.sessions_.With(
-        [this](SessionMap& sessions) { CleanupAndProcessSessions(sessions); });
-    data.scheduler_.End();
+    RunWorkerPass(data, state);
 
-    // sit out the rest of the tick, but return early when a backend with its
-    // own receive thread reports work; otherwise an arriving datagram is not
-    // looked at, let alone acked, until the next tick
-    const auto remaining = data.scheduler_.remaining();
-    if (remaining > Scheduler::Duration::zero()) {
+    const Scheduler::Duration wait = NextWorkerWait(data, state);
+    if (data.io_) {
+      // what the tick queued goes out here, in one batch, and whatever
+      // completes ends the wait
+      data.io_->Poll(wait);
+      signal.woken.store(false, std::memory_order_relaxed);
+    } else if (wait > Scheduler::Duration::zero()) {
       std::unique_lock<std::mutex> lock(signal.mutex);
-      signal.cv.wait_for(lock, remaining, [&]() {
+      signal.cv.wait_for(lock, wait, [&]() {
         return signal.woken.load(std::memory_order_relaxed) ||
                data.task_->IsStopRequested();
       });
@@ -72,22 +223,246 @@ void Server::WorkerLoop(TaskData& data) {
     }
   }
 
-  data.sessions_.With([](SessionMap& sessions) {
-    for (auto&& item : sessions) {
-      item.second->Close();
-      // still on the worker, and it is about to exit, so this is the last
-      // chance to break a handler->session cycle before ~TaskData drops the
-      // map. closing alone would not: a cycle keeps both ends alive whether
-      // the transport is open or not.
-      item.second->ReleaseHandler();
+  CloseWorkerSessions(data, state);
+  if (data.io_) {
+    // the closes above are only queued on the ring; nothing polls it after
+    // this thread
+    data.io_->Shutdown(std::chrono::milliseconds(100));
+  }
+}
+
+void Server::RunWorkerPass(TaskData& data, WorkerState& state) {
+  using Clock = std::chrono::steady_clock;
+  // per-task scheduler: Scheduler holds tick state, so workers cannot share
+  // one instance.
+  data.scheduler_.Start();
+  state.pass++;
+  const auto now = Clock::now();
+  state.batch.swap(state.again);
+  // sessions handed over since the last tick, created queued
+  data.sessions_.Drain(state.batch);
+  data.ready_->TakeAll(state.batch);
+  state.timers.Advance(now, [&](detail::TimerWheel::Node& node) {
+    auto& entry = static_cast<Scheduled&>(node);
+    // one already queued runs this pass or the next either way
+    if (!entry.queued.exchange(true)) {
+      state.batch.push_back(state.owned[&entry]);
     }
   });
+  state.batch.insert(state.batch.end(), state.polled.begin(),
+                     state.polled.end());
+
+  // with a tick budget, every session with work is credited an equal
+  // share of it; one that overspends pays it back before it runs again
+  const auto budget = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      config_.options.workers.tick_budget);
+  const bool budgeted = budget > std::chrono::nanoseconds::zero();
+  const int64_t quantum =
+      budgeted ? budget.count() / static_cast<int64_t>(
+                                      std::max<size_t>(state.batch.size(), 1))
+               : 0;
+  const auto tick_began = Clock::now();
+  uint64_t deferred = 0;
+
+  bool dropped_polled = false;
+  uint64_t busy_ns = 0;
+  for (auto& entry : state.batch) {
+    if (entry->worker.load(std::memory_order_acquire) != &data) {
+      continue;  // moved to another worker since this was queued
+    }
+    if (entry->pass == state.pass) {
+      continue;
+    }
+    entry->pass = state.pass;
+    auto session = entry->session.lock();
+    if (!session) {
+      continue;  // retired already; this was a wake on its way in
+    }
+    if (!entry->owned) {
+      entry->owned = true;
+      state.owned[entry.get()] = entry;
+      if (entry->polled) {
+        state.polled.push_back(entry);
+      }
+    }
+    if (budgeted && session->IsAlive()) {
+      // whatever the tick has no time left for waits, and so does one
+      // still in debt; both go first next tick. The dead are let through:
+      // retiring them is cheap and frees their slot.
+      entry->deficit_ns += quantum;
+      if (Clock::now() - tick_began >= budget || entry->deficit_ns <= 0) {
+        state.again.push_back(entry);
+        deferred++;
+        continue;
+      }
+    }
+    const auto began = Clock::now();
+    bool cut_short = false;
+    const bool worked = session->Process(
+        std::chrono::nanoseconds(budgeted ? entry->deficit_ns : 0),
+        &cut_short);
+    const auto cost = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             began)
+            .count());
+    entry->cost_ns += cost;
+    busy_ns += cost;
+    if (budgeted) {
+      entry->deficit_ns -= static_cast<int64_t>(cost);
+      if (cut_short) {
+        deferred++;  // and `worked`, so it is in `again` below
+      } else {
+        // done for now: a debt carries over, unspent credit does not, or
+        // a quiet session would bank a burst's worth of the worker
+        entry->deficit_ns = std::min<int64_t>(entry->deficit_ns, 0);
+      }
+    }
+    if (!session->IsAlive()) {
+      RetireSession(session);
+      data.sessions_.Erase(*entry);
+      state.timers.Cancel(*entry);
+      dropped_polled = dropped_polled || entry->polled;
+      state.owned.erase(entry.get());
+      continue;
+    }
+    // cleared only now, so whatever Process() queued itself raised nothing;
+    // and before the deadline is asked for, so whatever another thread
+    // queued meanwhile is either seen by it or queues the entry again
+    entry->queued.store(false, std::memory_order_seq_cst);
+    if (entry->polled) {
+      continue;
+    }
+    const auto deadline = session->NextDeadline();
+    if (worked || deadline <= now) {
+      // left unqueued, so new work still ends the sleep before the tick
+      // is out; running twice in a pass is what `pass` is for
+      state.timers.Cancel(*entry);
+      state.again.push_back(entry);
+    } else if (deadline == Clock::time_point::max()) {
+      state.timers.Cancel(*entry);
+    } else {
+      state.timers.Schedule(*entry, deadline);
+    }
+  }
+  state.batch.clear();
+  data.busy_ns_.fetch_add(busy_ns, std::memory_order_relaxed);
+  if (budgeted) {
+    if (busy_ns > static_cast<uint64_t>(budget.count())) {
+      data.budget_overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    data.sessions_deferred_.fetch_add(deferred, std::memory_order_relaxed);
+  }
+  if (now - state.window >= std::chrono::seconds(1)) {
+    state.window = now;
+    for (auto& item : state.owned) {
+      item.second->last_cost_ns = item.second->cost_ns;
+      item.second->cost_ns = 0;
+    }
+  }
+  if (data.steal_pending_.load(std::memory_order_acquire)) {
+    TaskData* to;
+    uint64_t gap;
+    {
+      std::lock_guard<std::mutex> lock(data.steal_mutex_);
+      to = data.steal_to_;
+      gap = data.steal_gap_ns_;
+    }
+    // the costliest first. Moving a session that costs c narrows the gap
+    // by 2c, so one costing the whole gap or more would only swap which
+    // worker is the busy one.
+    std::vector<std::shared_ptr<Scheduled>> candidates;
+    for (auto& item : state.owned) {
+      if (item.second->last_cost_ns > 0) {
+        candidates.push_back(item.second);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::shared_ptr<Scheduled>& a,
+                 const std::shared_ptr<Scheduled>& b) {
+                return a->last_cost_ns > b->last_cost_ns;
+              });
+    // never all of them: the worker keeps at least one
+    size_t left = state.owned.size();
+    for (auto& entry : candidates) {
+      const uint64_t cost = entry->last_cost_ns;
+      if (left <= 1 || cost >= gap) {
+        continue;
+      }
+      auto session = entry->session.lock();
+      if (!session || !session->IsAlive()) {
+        continue;
+      }
+      gap -= std::min(gap, 2 * cost);
+      state.timers.Cancel(*entry);
+      state.owned.erase(entry.get());
+      if (entry->polled) {
+        state.polled.erase(
+          std::remove(state.polled.begin(), state.polled.end(), entry),
+          state.polled.end());
+      }
+      left--;
+      HandOff(data, *to, entry, session);
+    }
+    data.steal_pending_.store(false, std::memory_order_release);
+  }
+  if (dropped_polled) {
+    state.polled.erase(
+        std::remove_if(state.polled.begin(), state.polled.end(),
+                       [](const std::shared_ptr<Scheduled>& entry) {
+                         auto session = entry->session.lock();
+                         return !session || !session->IsAlive();
+                       }),
+        state.polled.end());
+  }
+  data.scheduler_.End();
+}
+
+Scheduler::Duration Server::NextWorkerWait(TaskData& data, WorkerState& state) {
+  using Clock = std::chrono::steady_clock;
+  // a session still busy, or one driven every tick, is owed the next tick.
+  // Otherwise nothing is due before the wheel's next deadline, and
+  // anything that turns up sooner ends the sleep: a backend's receive
+  // thread, a poll thread or a send wakes it through its ready callback.
+  Scheduler::Duration wait = data.scheduler_.remaining();
+  if (state.again.empty() && state.polled.empty()) {
+    // capped, so a clock step or a lost wake costs a second at most
+    Clock::duration until = std::chrono::seconds(1);
+    const auto expiry = state.timers.NextExpiry();
+    if (expiry != Clock::time_point::max()) {
+      until = std::min(until, expiry - Clock::now());
+    }
+    // rounded up: a wake a hair early finds nothing due and sleeps again
+    wait = std::max(Scheduler::Duration::zero(),
+                    std::chrono::duration_cast<Scheduler::Duration>(until) +
+                        Scheduler::Duration(1));
+  }
+  return wait;
+}
+
+void Server::CloseWorkerSessions(TaskData& data, WorkerState& state) {
+  for (auto& item : state.owned) {
+    state.timers.Cancel(*item.second);
+  }
+  // whatever was handed over too late to run is closed with the rest
+  state.batch.clear();
+  data.sessions_.Drain(state.batch);
+  state.batch.clear();
+  for (auto& session : data.sessions_.owned()) {
+    session->Close();
+    // still on the worker, and it is about to exit, so this is the last
+    // chance to break a handler->session cycle before ~TaskData drops the
+    // map. closing alone would not: a cycle keeps both ends alive whether
+    // the transport is open or not.
+    session->ReleaseHandler();
+  }
 }
 
 Server::~Server() {
   ZNET_LOG_DEBUG("Destructor of the server is called.");
   Stop();
   task_.Wait();
+  // the application stopped driving it before a Process() saw the stop
+  ShutdownManual();
 }
 
 Result Server::Bind() {
@@ -124,12 +499,18 @@ void Server::Wait() {
 }
 
 Result Server::Listen() {
-  if (task_.IsRunning()) {
+  if (task_.IsRunning() || manual_running_) {
     return Result::AlreadyListening;
   }
   if (ZNET_UNLIKELY(!backend_)) ZNET_UNLIKELY_ATTR {
     return Result::InvalidBackend;
   }
+  // before Listen(), which is where a backend would start its poll thread
+  if (poller_ && !backend_->DriveManually(poller_)) {
+    ZNET_LOG_ERROR("This connection type needs its own threads; it cannot "
+                   "be driven manually.");
+    return Result::InvalidBackend;
+  }
   Result result = backend_->Listen();
   if (ZNET_UNLIKELY(result != Result::Success)) ZNET_UNLIKELY_ATTR {
     return result;
@@ -137,6 +518,14 @@ Result Server::Listen() {
 
   shutdown_complete_ = false;
 
+  if (poller_) {
+    manual_running_ = true;
+    ZNET_LOG_DEBUG("Listening connections from: {}", bind_address_->readable());
+    ServerStartupEvent startup_event{*this};
+    event_callback()(startup_event);
+    return Result::Success;
+  }
+
    task_.Run([this]() {
     MainProcessor();
   });
@@ -147,7 +536,12 @@ Result Server::Stop() {
   if (ZNET_UNLIKELY(!backend_)) ZNET_UNLIKELY_ATTR {
     return Result::InvalidBackend;
   }
-  return backend_->Close();
+  Result result = backend_->Close();
+  if (poller_) {
+    // so a loop waiting on poll_fd() comes round to a Process() that sees it
+    poller_->Wake();
+  }
+  return result;
 }
 
 void Server::SetTicksPerSecond(uint16_t tps) {
@@ -161,7 +555,111 @@ bool Server::IsAlive() const {
 }
 
 ServerMetrics Server::metrics() const {
-  return backend_ ? backend_->metrics() : ServerMetrics{};
+  ServerMetrics out = backend_ ? backend_->metrics() : ServerMetrics{};
+  for (const auto& data : tasks_) {
+    WorkerMetrics worker;
+    worker.running = data->task_ != nullptr || manual_running_;
+    worker.sessions = data->sessions_.count();
+    worker.busy_us = data->busy_ns_.load(std::memory_order_relaxed) / 1000;
+    worker.sessions_moved_in = data->moved_in_.load(std::memory_order_relaxed);
+    worker.sessions_moved_out =
+        data->moved_out_.load(std::memory_order_relaxed);
+    worker.budget_overruns =
+        data->budget_overruns_.load(std::memory_order_relaxed);
+    worker.sessions_deferred =
+        data->sessions_deferred_.load(std::memory_order_relaxed);
+    out.workers.push_back(worker);
+  }
+  std::lock_guard<std::mutex> lock(tick_mutex_);
+  out.tick = tick_metrics_;
+  return out;
+}
+
+std::shared_ptr<PeerSession> Server::FindSession(SessionId id) const {
+  std::lock_guard<std::mutex> lock(directory_mutex_);
+  auto it = directory_.find(id);
+  return it == directory_.end() ? nullptr : it->second.lock();
+}
+
+bool Server::Process() {
+  if (!manual_running_) {
+    return false;
+  }
+  TaskData& data = *tasks_.front();
+  WorkerSignal& signal = *data.signal_;
+  // the worker's thread for the call only: a Send() from it between calls
+  // has no pass to ride along with, and has to wake the loop like any other
+  signal.owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  poller_->Drain();
+  signal.woken.store(false, std::memory_order_relaxed);
+  backend_->Pump();
+  if (!backend_->IsAlive()) {
+    signal.owner.store(std::thread::id(), std::memory_order_relaxed);
+    ShutdownManual();
+    return false;
+  }
+  scheduler_.Start();
+  CheckNetwork();
+  ProcessSessions();
+  scheduler_.End();
+  RunWorkerPass(data, *manual_);
+  signal.owner.store(std::thread::id(), std::memory_order_relaxed);
+  return true;
+}
+
+bool Server::PollOnce(std::chrono::milliseconds timeout) {
+  if (!manual_running_) {
+    return false;
+  }
+  Scheduler::Duration wait = std::min<Scheduler::Duration>(
+      NextWorkerWait(*tasks_.front(), *manual_), timeout);
+  if (!pending_sessions_.empty()) {
+    // a handshake's timeout is only checked on the listener's tick
+    wait = std::min(wait, scheduler_.remaining());
+  }
+  if (wait > Scheduler::Duration::zero()) {
+    // rounded up, as the worker's own sleep is
+    poller_->Wait(std::chrono::duration_cast<std::chrono::milliseconds>(
+        wait + std::chrono::microseconds(999)));
+  }
+  return Process();
+}
+
+void Server::ShutdownManual() {
+  if (!manual_running_) {
+    return;
+  }
+  manual_running_ = false;
+  // MainProcessor()'s teardown, in the same order
+  ZNET_LOG_DEBUG("Shutting down server!");
+  ServerShutdownEvent shutdown_event{*this};
+  event_callback()(shutdown_event);
+  backend_->StopReceiving();
+  CloseWorkerSessions(*tasks_.front(), *manual_);
+  manual_.reset();
+  tasks_.clear();
+  {
+    std::lock_guard<std::mutex> lock(directory_mutex_);
+    directory_.clear();
+  }
+  DisconnectPending();
+  backend_->Close();
+  ZNET_LOG_DEBUG("Server shutdown complete.");
+  shutdown_complete_ = true;
+}
+
+void Server::PublishTickMetrics() {
+  const Scheduler::WaitStats& stats = scheduler_.wait_stats();
+  auto us = [](Scheduler::Duration duration) {
+    return static_cast<uint64_t>(duration.count());
+  };
+  std::lock_guard<std::mutex> lock(tick_mutex_);
+  tick_metrics_.ticks = stats.ticks;
+  tick_metrics_.overruns = stats.overruns;
+  tick_metrics_.jitter_total_us = us(stats.jitter_total);
+  tick_metrics_.jitter_max_us = us(stats.jitter_max);
+  tick_metrics_.wait_us = us(stats.waited);
+  tick_metrics_.wait_cpu_us = us(stats.wait_cpu);
 }
 
 void Server::MainProcessor() {
@@ -173,8 +671,12 @@ void Server::MainProcessor() {
     scheduler_.Start();
     CheckNetwork();
     ProcessSessions();
+    Rebalance();
     scheduler_.End();
     scheduler_.Wait();
+    if (config_.options.measure_ticks) {
+      PublishTickMetrics();
+    }
   }
 
   ZNET_LOG_DEBUG("Shutting down server!");
@@ -186,6 +688,11 @@ void Server::MainProcessor() {
   // pending sessions can still send their FINs.
   backend_->StopReceiving();
   tasks_.clear();
+  {
+    // the workers closed what they still held without retiring it
+    std::lock_guard<std::mutex> lock(directory_mutex_);
+    directory_.clear();
+  }
   DisconnectPending();
   backend_->Close();
 
@@ -208,7 +715,7 @@ void Server::CheckNetwork() {
       continue;
     }
     ZNET_LOG_DEBUG("Accepted new connection from: {}", session->remote_address()->readable());
-    pending_sessions_[session->remote_address()] = session;
+    pending_sessions_.Insert(std::move(session));
   }
 }
 
@@ -220,42 +727,45 @@ size_t Server::ActiveSessionCount() const {
   return count;
 }
 
-void Server::CleanupAndProcessSessions(SessionMap& sessions) {
-  std::vector<std::shared_ptr<InetAddress>> remove;
+void Server::CleanupAndProcessSessions(SessionSlots& sessions) {
   // cleanup dead sessions
-  for (auto&& item : sessions) {
-    if (item.second->IsAlive()) {
-      continue;
+  sessions.EraseIf([&](const std::shared_ptr<PeerSession>& session) {
+    if (session->IsAlive()) {
+      return false;
     }
-    remove.emplace_back(item.first);
-  }
+    RetireSession(session);
+    return true;
+  });
 
-  for (auto&& address : remove) {
-    auto session = sessions[address];
-    // one that never became ready died still handshaking, and the application
-    // was never told it connected, so a disconnect event would be unpaired.
-    if (session->IsReady()) {
-      IncomingClientDisconnectedEvent event{session};
-      event_callback()(event);
-      ZNET_LOG_DEBUG("Client disconnected: {}",
-                     session->remote_address()->readable());
-    }
-    // the map is about to drop its reference, and a handler holding one back
-    // to the session would be the only thing left pointing at either of them.
-    // see PeerSession::ReleaseHandler. this runs on the worker, the same
-    // thread that dispatches into the handler, so it cannot race one.
-    session->ReleaseHandler();
-    sessions.erase(address);
+  for (auto& session : sessions) {
+    session->Process();
   }
+}
 
-  for (auto&& item : sessions) {
-    item.second->Process();
+void Server::RetireSession(const std::shared_ptr<PeerSession>& session) {
+  // one that never became ready died still handshaking, and the application
+  // was never told it connected, so a disconnect event would be unpaired.
+  if (session->IsReady()) {
+    {
+      // delisted first, so one the application has heard is gone is gone
+      std::lock_guard<std::mutex> lock(directory_mutex_);
+      directory_.erase(session->id());
+    }
+    IncomingClientDisconnectedEvent event{session};
+    event_callback()(event);
+    ZNET_LOG_DEBUG("Client disconnected: {}",
+                   session->remote_address()->readable());
   }
+  // the map is about to drop its reference, and a handler holding one back
+  // to the session would be the only thing left pointing at either of them.
+  // see PeerSession::ReleaseHandler. this runs on the thread that dispatches
+  // into the handler, so it cannot race one.
+  session->ReleaseHandler();
 }
 
 void Server::DisconnectPending() {
-  for (auto&& item : pending_sessions_) {
-    item.second->Close();
+  for (auto& session : pending_sessions_) {
+    session->Close();
   }
   ProcessSessions();
 }
@@ -276,55 +786,166 @@ void Server::ProcessSessions() {
   CleanupAndProcessSessions(pending_sessions_);
 
   // process pending connections and promote them
-  std::vector<decltype(pending_sessions_)::key_type> promote;
-  for (auto&& item : pending_sessions_) {
-    if (!item.second->IsReady()) {
-      if (config_.connection_timeout.count() > 0 && item.second->time_since_connect() > config_.connection_timeout) {
-        ZNET_LOG_DEBUG("Pending connection from {} was timed-out.", item.second->remote_address()->readable());
-        item.second->Close();
+  pending_sessions_.EraseIf([&](const std::shared_ptr<PeerSession>& session) {
+    if (!session->IsReady()) {
+      if (config_.connection_timeout.count() > 0 && session->time_since_connect() > config_.connection_timeout) {
+        ZNET_LOG_DEBUG("Pending connection from {} was timed-out.", session->remote_address()->readable());
+        session->Close();
       }
-      continue;
+      return false;
     }
-    promote.emplace_back(item.first);
-  }
-
-  for (auto&& address : promote) {
-    auto session = pending_sessions_[address];
-    // promote to connected
+    // promote to connected, then erase pending
     PromoteReady(session);
-    // erase pending
-    pending_sessions_.erase(address);
-  }
+    return true;
+  });
 }
 
 void Server::SubmitSession(TaskData& data, std::shared_ptr<PeerSession> session) {
-  auto signal = data.signal_;
-  session->SetWakeCallback([signal]() { signal->Raise(); });
+  auto entry = std::make_shared<Scheduled>();
+  entry->session = session;
+  entry->ready = data.ready_;
+  entry->signal = data.signal_;
+  entry->worker.store(&data, std::memory_order_release);
+  // queues the session, once however many report work before the worker gets
+  // to it, and ends the worker's sleep. Every source of work shares it.
+  std::function<void()> mark = [entry]() {
+    if (!entry->queued.exchange(true)) {
+      std::lock_guard<std::mutex> lock(entry->home_mutex);
+      entry->ready->Push(entry);
+      entry->signal->Raise();
+    }
+  };
+  session->SetWakeCallback(mark);
+  if (data.io_) {
+    session->BindWorkerIo(data.io_);
+  }
+  entry->polled = !session->SetReadyCallback(std::move(mark));
+  {
+    // listed before the application hears of it, so the event's handler can
+    // already find it
+    std::lock_guard<std::mutex> lock(directory_mutex_);
+    directory_[session->id()] = session;
+  }
   IncomingClientConnectedEvent event{session};
   event_callback()(event);
-  data.sessions_.With([&](SessionMap& sessions) {
-    sessions[session->remote_address()] = session;
-  });
   ZNET_LOG_DEBUG("New connection is ready. {}", session->remote_address()->readable());
+  // created queued, so arriving is its one entry however many wakes came
+  // first
+  data.sessions_.Hand(std::move(session), std::move(entry));
   data.signal_->Raise();
 }
 
+void Server::HandOff(TaskData& from, TaskData& to,
+                     const std::shared_ptr<Scheduled>& entry,
+                     const std::shared_ptr<PeerSession>& session) {
+  from.sessions_.Erase(*entry);
+  // the new worker starts it from scratch: its own pass count, its own
+  // wheel, and no cost until it has run there
+  entry->owned = false;
+  entry->pass = 0;
+  entry->cost_ns = 0;
+  entry->last_cost_ns = 0;
+  entry->deficit_ns = 0;
+  {
+    std::lock_guard<std::mutex> lock(entry->home_mutex);
+    entry->ready = to.ready_;
+    entry->signal = to.signal_;
+    entry->worker.store(&to, std::memory_order_release);
+  }
+  // queued whether or not a wake already was: one that went to the old
+  // worker is dropped there, and what it announced is seen here instead
+  entry->queued.store(true);
+  to.sessions_.Hand(session, entry);
+  to.signal_->Raise();
+  from.moved_out_.fetch_add(1, std::memory_order_relaxed);
+  to.moved_in_.fetch_add(1, std::memory_order_relaxed);
+  ZNET_LOG_DEBUG("Moved {} to a less busy worker.",
+                 session->remote_address()->readable());
+}
+
+void Server::Rebalance() {
+  const auto interval = config_.options.workers.rebalance_interval;
+  if (!can_rebalance_ || interval.count() <= 0 || tasks_.size() < 2) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_rebalance_ < interval) {
+    return;
+  }
+  const bool first = last_rebalance_ == std::chrono::steady_clock::time_point{};
+  last_rebalance_ = now;
+  TaskData* busiest = nullptr;
+  TaskData* idlest = nullptr;
+  uint64_t most = 0;
+  uint64_t least = 0;
+  for (size_t i = 0; i < tasks_.size(); i++) {
+    TaskData& data = *tasks_[i];
+    const uint64_t busy = data.busy_ns_.load(std::memory_order_relaxed);
+    const uint64_t load = busy - last_busy_ns_[i];
+    last_busy_ns_[i] = busy;
+    if (!data.task_) {
+      continue;  // elastic and not started; the acceptor starts it if needed
+    }
+    if (!busiest || load > most) {
+      busiest = &data;
+      most = load;
+    }
+    if (!idlest || load < least) {
+      idlest = &data;
+      least = load;
+    }
+  }
+  // the first sample only sets the baseline
+  if (first || !busiest || busiest == idlest ||
+      busiest->sessions_.count() < 2 ||
+      busiest->steal_pending_.load(std::memory_order_acquire)) {
+    return;
+  }
+  const auto interval_ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count());
+  if (most - least < interval_ns / 20) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(busiest->steal_mutex_);
+    busiest->steal_to_ = idlest;
+    // a second's worth, the window a session's cost is counted over
+    busiest->steal_gap_ns_ = static_cast<uint64_t>(
+        static_cast<double>(most - least) * 1e9 /
+        static_cast<double>(interval_ns));
+  }
+  busiest->steal_pending_.store(true, std::memory_order_release);
+  busiest->signal_->Raise();
+}
+
 Server::TaskData* Server::SelectNextTask() {
-  if (tasks_.empty()) {
-    return nullptr;
-  }
-  // the published count, not the map: this runs on the acceptor while the
-  // workers are mutating their own maps under their own locks. a stale count
-  // only picks a slightly less idle worker.
-  TaskData* min = tasks_[0].get();
-  size_t min_count = min->sessions_.count();
+  // the published count, not the map: this runs on the acceptor while each
+  // worker mutates its own. a stale count only picks a slightly less idle
+  // worker.
+  if (poller_) {
+    // the one worker there is, until shutdown takes it
+    return tasks_.empty() ? nullptr : tasks_.front().get();
+  }
+  TaskData* min = nullptr;
+  TaskData* idle = nullptr;
+  size_t min_count = 0;
   for (auto& data : tasks_) {
+    if (!data->task_) {
+      // elastic, and not needed yet
+      idle = idle ? idle : data.get();
+      continue;
+    }
     const size_t count = data->sessions_.count();
-    if (count < min_count) {
+    if (!min || count < min_count) {
       min = data.get();
       min_count = count;
     }
   }
+  const WorkerOptions& workers = config_.options.workers;
+  if (idle && (!min || min_count >= workers.elastic_threshold)) {
+    StartWorker(*idle);
+    return idle;
+  }
   return min;
 }
 }  // namespace znet
\ No newline at end of file
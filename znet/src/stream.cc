@@ -0,0 +1,169 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/stream.h"
+
+#include "znet/logger.h"
+#include "znet/peer_session.h"
+#include "znet/send_options.h"
+
+#include <algorithm>
+
+namespace znet {
+
+namespace {
+
+SendOptions ChunkOptions(uint8_t channel) {
+  // reliable and ordered whatever the session's defaults: a stream is bytes,
+  // and neither a hole nor a swap can be handed to the application as such
+  return SendOptions().Reliable(true).Ordered(true).Channel(channel);
+}
+
+}  // namespace
+
+StreamWriter::StreamWriter(std::shared_ptr<detail::StreamLink> link,
+                           StreamId id, uint8_t channel, size_t chunk_bytes)
+    : link_(std::move(link)),
+      id_(id),
+      channel_(channel),
+      chunk_bytes_(chunk_bytes) {}
+
+StreamWriter::~StreamWriter() {
+  if (!finished_) {
+    // a receiver keeps a stream's state until it ends, so one that is
+    // dropped unfinished is ended here rather than left open on the peer
+    const Result result = Finish();
+    if (result != Result::Success && result != Result::NotConnected) {
+      ZNET_LOG_DEBUG("Stream {} was dropped unfinished and could not be ended "
+                     "({}).", id_, GetResultString(result));
+    }
+  }
+  std::lock_guard<std::mutex> lock(link_->mutex);
+  link_->writers.erase(id_);
+}
+
+template <typename FillFn>
+Result StreamWriter::WriteChunks(uint64_t size, uint64_t* out_taken,
+                                 FillFn&& fill) {
+  if (out_taken != nullptr) {
+    *out_taken = 0;
+  }
+  if (finished_) {
+    return Result::AlreadyClosed;
+  }
+  // held across the sends, so the session cannot be destroyed under them.
+  // SendPacket() only queues, so this is never held for long.
+  std::lock_guard<std::mutex> lock(link_->mutex);
+  if (link_->session == nullptr) {
+    return Result::NotConnected;
+  }
+  uint64_t taken = 0;
+  Result result = Result::Success;
+  while (taken < size) {
+    const uint64_t room = writable_bytes();
+    if (room == 0) {
+      // out of credit: the receiver has not consumed enough yet
+      result = Result::QueueFull;
+      break;
+    }
+    const size_t length = static_cast<size_t>(std::min<uint64_t>(
+        std::min<uint64_t>(size - taken, chunk_bytes_), room));
+    auto packet = std::make_shared<StreamChunkPacket>();
+    packet->stream_id = id_;
+    packet->channel = channel_;
+    packet->offset = written_;
+    fill(*packet, taken, length);
+    result = link_->session->SendPacket(std::move(packet),
+                                        ChunkOptions(channel_));
+    if (result != Result::Success) {
+      break;
+    }
+    written_ += length;
+    taken += length;
+  }
+  if (out_taken != nullptr) {
+    *out_taken = taken;
+  }
+  return result;
+}
+
+Result StreamWriter::Write(const void* data, size_t size,
+                           size_t* out_written) {
+  if (out_written != nullptr) {
+    *out_written = 0;
+  }
+  if (data == nullptr && size != 0) {
+    return Result::InvalidArgument;
+  }
+  const char* bytes = static_cast<const char*>(data);
+  uint64_t taken = 0;
+  const Result result = WriteChunks(
+      size, &taken,
+      [bytes](StreamChunkPacket& packet, uint64_t from, size_t length) {
+        packet.data.assign(bytes + static_cast<size_t>(from), length);
+      });
+  if (out_written != nullptr) {
+    *out_written = static_cast<size_t>(taken);
+  }
+  return result;
+}
+
+Result StreamWriter::WriteFile(const std::shared_ptr<detail::MappedFile>& file,
+                               uint64_t position, uint64_t size,
+                               uint64_t* out_written) {
+  return WriteChunks(
+      size, out_written,
+      [&file, position](StreamChunkPacket& packet, uint64_t from,
+                        size_t length) {
+        packet.file = file;
+        packet.file_position = position + from;
+        packet.file_size = static_cast<uint32_t>(length);
+      });
+}
+
+Result StreamWriter::Finish() {
+  if (finished_) {
+    return Result::AlreadyClosed;
+  }
+  std::lock_guard<std::mutex> lock(link_->mutex);
+  if (link_->session == nullptr) {
+    finished_ = true;
+    return Result::NotConnected;
+  }
+  auto packet = std::make_shared<StreamChunkPacket>();
+  packet->stream_id = id_;
+  packet->channel = channel_;
+  packet->offset = written_;
+  packet->last = true;
+  const Result result =
+      link_->session->SendPacket(std::move(packet), ChunkOptions(channel_));
+  if (result == Result::Success) {
+    finished_ = true;
+  }
+  return result;
+}
+
+void StreamWriter::SetWritableCallback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(link_->mutex);
+  on_writable_ = std::move(callback);
+}
+
+void StreamWriter::Grant(uint64_t limit) {
+  // grants are absolute, so the limit only ever rises and a late or repeated
+  // one changes nothing
+  uint64_t current = credit_.load(std::memory_order_relaxed);
+  while (limit > current &&
+         !credit_.compare_exchange_weak(current, limit,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace znet
@@ -0,0 +1,146 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/detail/timer_wheel.h"
+
+#include <algorithm>
+
+namespace znet {
+namespace detail {
+
+TimerWheel::TimerWheel(TimePoint now) : epoch_(now) {}
+
+void TimerWheel::Schedule(Node& node, TimePoint deadline) {
+  Cancel(node);
+  // never the tick already reached: Advance() has moved past its slot
+  node.expiry_ = std::max(CeilTick(deadline), now_ + 1);
+  Place(node);
+  size_++;
+}
+
+void TimerWheel::Cancel(Node& node) {
+  if (!node.scheduled()) {
+    return;
+  }
+  node.prev_->next_ = node.next_;
+  node.next_->prev_ = node.prev_;
+  node.prev_ = node.next_ = nullptr;
+  size_--;
+}
+
+size_t TimerWheel::Advance(TimePoint now,
+                           const std::function<void(Node&)>& fire) {
+  const uint64_t target = FloorTick(now);
+  size_t fired = 0;
+  while (now_ < target) {
+    if (size_ == 0) {
+      // nothing to cascade or fire on the way, so skip the walk
+      now_ = target;
+      break;
+    }
+    now_++;
+    const size_t index = static_cast<size_t>(now_ & (kRootSlots - 1));
+    if (index == 0) {
+      // the root came round: pull the next slot of each outer level in, and
+      // the level above that only when this one came round too
+      for (int level = 0; level < kLevels; level++) {
+        const size_t slot = static_cast<size_t>(
+            (now_ >> (kRootBits + level * kLevelBits)) & (kLevelSlots - 1));
+        Cascade(level, slot);
+        if (slot != 0) {
+          break;
+        }
+      }
+    }
+    Node& head = root_[index].head;
+    // whatever fire() arms lands a tick or more ahead, never in this slot
+    while (head.next_ != &head) {
+      Node& node = *head.next_;
+      Cancel(node);
+      fired++;
+      fire(node);
+    }
+  }
+  return fired;
+}
+
+TimerWheel::TimePoint TimerWheel::NextExpiry() const {
+  if (size_ == 0) {
+    return TimePoint::max();
+  }
+  for (uint64_t tick = now_ + 1;; tick++) {
+    const size_t index = static_cast<size_t>(tick & (kRootSlots - 1));
+    // where the root wraps an outer slot is pulled in, which may hold the
+    // next deadline; stop there rather than look into the outer levels
+    if (index == 0 || root_[index].head.next_ != &root_[index].head) {
+      return epoch_ + std::chrono::milliseconds(tick);
+    }
+  }
+}
+
+void TimerWheel::Place(Node& node) {
+  uint64_t delta = node.expiry_ - now_;
+  if (delta > kMaxDelta) {
+    delta = kMaxDelta;
+    node.expiry_ = now_ + delta;
+  }
+  Slot* slot;
+  if (delta < kRootSlots) {
+    slot = &root_[static_cast<size_t>(node.expiry_ & (kRootSlots - 1))];
+  } else {
+    int level = 0;
+    while (delta >> (kRootBits + (level + 1) * kLevelBits) != 0) {
+      level++;
+    }
+    const size_t index = static_cast<size_t>(
+        (node.expiry_ >> (kRootBits + level * kLevelBits)) &
+        (kLevelSlots - 1));
+    slot = &levels_[static_cast<size_t>(level)][index];
+  }
+  Node& head = slot->head;
+  node.prev_ = head.prev_;
+  node.next_ = &head;
+  head.prev_->next_ = &node;
+  head.prev_ = &node;
+}
+
+void TimerWheel::Cascade(int level, size_t index) {
+  Node& head = levels_[static_cast<size_t>(level)][index].head;
+  while (head.next_ != &head) {
+    Node& node = *head.next_;
+    node.prev_->next_ = node.next_;
+    node.next_->prev_ = node.prev_;
+    Place(node);
+  }
+}
+
+uint64_t TimerWheel::CeilTick(TimePoint time) const {
+  if (time <= epoch_) {
+    return 0;
+  }
+  const auto elapsed = time - epoch_;
+  auto ticks = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+  if (ticks < elapsed) {
+    ticks += std::chrono::milliseconds(1);
+  }
+  return static_cast<uint64_t>(ticks.count());
+}
+
+uint64_t TimerWheel::FloorTick(TimePoint time) const {
+  if (time <= epoch_) {
+    return 0;
+  }
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(time - epoch_)
+          .count());
+}
+
+}  // namespace detail
+}  // namespace znet
@@ -0,0 +1,274 @@
+//
+//    Copyright 2026 Metehan Gezer
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "znet/detail/uring.h"
+
+#if ZNET_HAS_IO_URING
+
+#include "znet/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace znet {
+namespace detail {
+
+namespace {
+
+int SetupRing(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+void* MapRing(int fd, size_t size, off_t offset) {
+  void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ring == MAP_FAILED ? nullptr : ring;
+}
+
+template <typename T>
+T* At(void* base, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+bool KernelAtLeast(int major, int minor) {
+  utsname name{};
+  if (uname(&name) != 0) {
+    return false;
+  }
+  int have_major = 0;
+  int have_minor = 0;
+  if (std::sscanf(name.release, "%d.%d", &have_major, &have_minor) != 2) {
+    return false;
+  }
+  return have_major > major || (have_major == major && have_minor >= minor);
+}
+
+}  // namespace
+
+Uring::~Uring() {
+  if (buffers_ != nullptr) {
+    munmap(buffers_, buffers_size_);
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  // closing cancels whatever is still in flight
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool Uring::Supported() {
+  static const bool supported = []() {
+    // multishot receive, new in 6.0, which a probe cannot ask about
+    if (!KernelAtLeast(6, 0)) {
+      ZNET_LOG_DEBUG("io_uring: kernel older than 6.0.");
+      return false;
+    }
+    Uring ring;
+    if (!ring.Init(8) || !ring.SetupBuffers(0, 2, 4096)) {
+      return false;
+    }
+    return true;
+  }();
+  return supported;
+}
+
+bool Uring::Init(unsigned entries) {
+  io_uring_params params{};
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL |
+                 IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER |
+                 IORING_SETUP_DEFER_TASKRUN;
+  params.cq_entries = entries * 4;
+  fd_ = SetupRing(entries, &params);
+  if (fd_ < 0 && errno == EINVAL) {
+    // the task-run flags are 6.1; without them completions run whenever the
+    // thread enters the kernel, which costs only some batching
+    params = io_uring_params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = entries * 4;
+    fd_ = SetupRing(entries, &params);
+  }
+  if (fd_ < 0) {
+    ZNET_LOG_DEBUG("io_uring: setup refused: {}", std::strerror(errno));
+    return false;
+  }
+  if ((params.features & IORING_FEAT_EXT_ARG) == 0 ||
+      (params.features & IORING_FEAT_NODROP) == 0) {
+    ZNET_LOG_DEBUG("io_uring: kernel lacks timed waits or overflow safety.");
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = sq_ring_size_;
+  }
+  sq_ring_ = MapRing(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+  cq_ring_ = single ? sq_ring_ : MapRing(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = MapRing(fd_, sqes_size_, IORING_OFF_SQES);
+  if (sq_ring_ == nullptr || cq_ring_ == nullptr || sqes == nullptr) {
+    ZNET_LOG_DEBUG("io_uring: cannot map the rings: {}", std::strerror(errno));
+    if (sqes != nullptr) {
+      munmap(sqes, sqes_size_);
+    }
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  sq_head_ = At<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = At<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = *At<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  // submissions are filled in ring order, so the index array stays the
+  // identity and never needs touching again
+  unsigned* array = At<unsigned>(sq_ring_, params.sq_off.array);
+  for (unsigned i = 0; i < sq_entries_; i++) {
+    array[i] = i;
+  }
+  sqe_tail_ = *sq_tail_;
+
+  cq_head_ = At<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = At<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *At<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = At<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+  return true;
+}
+
+io_uring_sqe* Uring::NextSqe() {
+  const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sqe_tail_ - head >= sq_entries_) {
+    return nullptr;
+  }
+  io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+  sqe_tail_++;
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int Uring::Submit() {
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+  // counted from what the kernel has consumed, so entries a refused call
+  // left behind go with the next one
+  const unsigned pending =
+      sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (pending == 0) {
+    return 0;
+  }
+  const int submitted = Enter(pending, 0, 0, nullptr, 0);
+  return submitted < 0 ? -errno : submitted;
+}
+
+void Uring::Wait(std::chrono::nanoseconds timeout) {
+  const bool waiting = *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  const long long nanos = waiting || timeout.count() < 0 ? 0 : timeout.count();
+  __kernel_timespec ts{};
+  ts.tv_sec = nanos / 1000000000;
+  ts.tv_nsec = nanos % 1000000000;
+  io_uring_getevents_arg arg{};
+  arg.ts = reinterpret_cast<uint64_t>(&ts);
+  // ETIME and EINTR both just end the wait
+  Enter(0, nanos > 0 ? 1u : 0u,
+        IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+bool Uring::SetupBuffers(uint16_t group, uint16_t count, uint32_t size) {
+  buffers_size_ = static_cast<size_t>(count) * size;
+  void* buffers = mmap(nullptr, buffers_size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffers == MAP_FAILED) {
+    buffers_ = nullptr;
+    return false;
+  }
+  buffers_ = static_cast<char*>(buffers);
+  buffer_size_ = size;
+  buffer_group_ = group;
+
+  // handed over with a submission rather than as a registered buffer ring:
+  // some kernels accept the ring and then never draw from it, which only
+  // shows as every receive failing with ENOBUFS
+  io_uring_sqe* sqe = NextSqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = count;
+  sqe->addr = reinterpret_cast<uint64_t>(buffers_);
+  sqe->len = size;
+  sqe->buf_group = group;
+  sqe->off = 0;
+  sqe->user_data = kInternal;
+  if (Submit() != 1) {
+    return false;
+  }
+  Wait(std::chrono::seconds(1));
+  int result = -ETIME;
+  Reap([&result](const io_uring_cqe& cqe) {
+    if (cqe.user_data == kInternal) {
+      result = cqe.res;
+    }
+  });
+  if (result < 0) {
+    ZNET_LOG_DEBUG("io_uring: cannot provide buffers: {}",
+                   std::strerror(-result));
+    return false;
+  }
+  return true;
+}
+
+void Uring::RecycleBuffer(uint16_t id) {
+  io_uring_sqe* sqe = NextSqe();
+  if (sqe == nullptr) {
+    Submit();
+    sqe = NextSqe();
+    if (sqe == nullptr) {
+      return;
+    }
+  }
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = 1;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer(id));
+  sqe->len = buffer_size_;
+  sqe->buf_group = buffer_group_;
+  sqe->off = id;
+  // only a failure completes
+  sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+  sqe->user_data = kInternal;
+}
+
+int Uring::Enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+                 const void* arg, size_t arg_size) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit,
+                                  min_complete, flags, arg, arg_size));
+}
+
+}  // namespace detail
+}  // namespace znet
+
+#endif  // ZNET_HAS_IO_URING